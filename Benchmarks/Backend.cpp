@@ -0,0 +1,166 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+
+// Deterministic fakes of system functions. They size buffers like the OS does, but cost next to nothing, so the
+// benchmarks measure WinStd's own overhead: buffer probing, retries, allocations and parameter marshalling.
+
+static const size_t fake_value_length = WINSTD_STACK_BUFFER_BYTES;
+static const wchar_t fake_message[] = L"Access is denied.\r\n";
+
+static int WINAPI fake_WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ LPCWCH lpWideCharStr, _In_ int cchWideChar, _Out_writes_opt_(cbMultiByte) LPSTR lpMultiByteStr, _In_ int cbMultiByte, _In_opt_ LPCCH lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar)
+{
+	UNREFERENCED_PARAMETER(CodePage);
+	UNREFERENCED_PARAMETER(dwFlags);
+	UNREFERENCED_PARAMETER(lpDefaultChar);
+	UNREFERENCED_PARAMETER(lpUsedDefaultChar);
+	const int count = cchWideChar != -1 ? cchWideChar : (int)wcslen(lpWideCharStr) + 1;
+	if (!cbMultiByte)
+		return count;
+	if (cbMultiByte < count) {
+		SetLastError(ERROR_INSUFFICIENT_BUFFER);
+		return 0;
+	}
+	for (int i = 0; i < count; ++i)
+		lpMultiByteStr[i] = static_cast<char>(lpWideCharStr[i]);
+	return count;
+}
+
+static int WINAPI fake_MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ LPCCH lpMultiByteStr, _In_ int cbMultiByte, _Out_writes_opt_(cchWideChar) LPWSTR lpWideCharStr, _In_ int cchWideChar)
+{
+	UNREFERENCED_PARAMETER(CodePage);
+	UNREFERENCED_PARAMETER(dwFlags);
+	const int count = cbMultiByte != -1 ? cbMultiByte : (int)strlen(lpMultiByteStr) + 1;
+	if (!cchWideChar)
+		return count;
+	if (cchWideChar < count) {
+		SetLastError(ERROR_INSUFFICIENT_BUFFER);
+		return 0;
+	}
+	for (int i = 0; i < count; ++i)
+		lpWideCharStr[i] = static_cast<unsigned char>(lpMultiByteStr[i]);
+	return count;
+}
+
+template <class _Elem>
+static DWORD fake_FormatMessage(_In_ DWORD dwFlags, _Out_ _Elem *lpBuffer, _In_ DWORD nSize)
+{
+	const DWORD count = _countof(fake_message) - 1;
+	_Elem *dst;
+	if (dwFlags & FORMAT_MESSAGE_ALLOCATE_BUFFER) {
+		dst = static_cast<_Elem*>(LocalAlloc(LMEM_FIXED, sizeof(_Elem) * (count + 1)));
+		if (!dst) {
+			SetLastError(ERROR_OUTOFMEMORY);
+			return 0;
+		}
+		*reinterpret_cast<_Elem**>(lpBuffer) = dst;
+	} else if (nSize <= count) {
+		SetLastError(ERROR_INSUFFICIENT_BUFFER);
+		return 0;
+	} else
+		dst = lpBuffer;
+	for (DWORD i = 0; i <= count; ++i)
+		dst[i] = static_cast<_Elem>(fake_message[i]);
+	return count;
+}
+
+static DWORD WINAPI fake_FormatMessageA(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _Out_ LPSTR lpBuffer, _In_ DWORD nSize, _In_opt_ va_list *Arguments)
+{
+	UNREFERENCED_PARAMETER(lpSource);
+	UNREFERENCED_PARAMETER(dwMessageId);
+	UNREFERENCED_PARAMETER(dwLanguageId);
+	UNREFERENCED_PARAMETER(Arguments);
+	return fake_FormatMessage(dwFlags, lpBuffer, nSize);
+}
+
+static DWORD WINAPI fake_FormatMessageW(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _Out_ LPWSTR lpBuffer, _In_ DWORD nSize, _In_opt_ va_list *Arguments)
+{
+	UNREFERENCED_PARAMETER(lpSource);
+	UNREFERENCED_PARAMETER(dwMessageId);
+	UNREFERENCED_PARAMETER(dwLanguageId);
+	UNREFERENCED_PARAMETER(Arguments);
+	return fake_FormatMessage(dwFlags, lpBuffer, nSize);
+}
+
+template <class _Elem>
+static LSTATUS fake_RegQueryValueEx(_Out_opt_ LPDWORD lpType, _Out_writes_bytes_opt_(*lpcbData) LPBYTE lpData, _Inout_opt_ LPDWORD lpcbData)
+{
+	// REG_SZ value of fake_value_length characters.
+	const DWORD size = (DWORD)(sizeof(_Elem) * (fake_value_length + 1));
+	if (lpType)
+		*lpType = REG_SZ;
+	if (!lpcbData)
+		return lpData ? ERROR_INVALID_PARAMETER : ERROR_SUCCESS;
+	if (!lpData) {
+		*lpcbData = size;
+		return ERROR_SUCCESS;
+	}
+	if (*lpcbData < size) {
+		*lpcbData = size;
+		return ERROR_MORE_DATA;
+	}
+	_Elem *dst = reinterpret_cast<_Elem*>(lpData);
+	for (size_t i = 0; i < fake_value_length; ++i)
+		dst[i] = 'x';
+	dst[fake_value_length] = 0;
+	*lpcbData = size;
+	return ERROR_SUCCESS;
+}
+
+static LSTATUS APIENTRY fake_RegQueryValueExA(_In_ HKEY hKey, _In_opt_ LPCSTR lpValueName, _Reserved_ LPDWORD lpReserved, _Out_opt_ LPDWORD lpType, _Out_writes_bytes_opt_(*lpcbData) LPBYTE lpData, _Inout_opt_ LPDWORD lpcbData)
+{
+	UNREFERENCED_PARAMETER(hKey);
+	UNREFERENCED_PARAMETER(lpValueName);
+	UNREFERENCED_PARAMETER(lpReserved);
+	return fake_RegQueryValueEx<char>(lpType, lpData, lpcbData);
+}
+
+static LSTATUS APIENTRY fake_RegQueryValueExW(_In_ HKEY hKey, _In_opt_ LPCWSTR lpValueName, _Reserved_ LPDWORD lpReserved, _Out_opt_ LPDWORD lpType, _Out_writes_bytes_opt_(*lpcbData) LPBYTE lpData, _Inout_opt_ LPDWORD lpcbData)
+{
+	UNREFERENCED_PARAMETER(hKey);
+	UNREFERENCED_PARAMETER(lpValueName);
+	UNREFERENCED_PARAMETER(lpReserved);
+	return fake_RegQueryValueEx<wchar_t>(lpType, lpData, lpcbData);
+}
+
+static int WINAPI fake_NormalizeString(_In_ NORM_FORM NormForm, _In_ LPCWSTR lpSrcString, _In_ int cwSrcLength, _Out_writes_opt_(cwDstLength) LPWSTR lpDstString, _In_ int cwDstLength)
+{
+	UNREFERENCED_PARAMETER(NormForm);
+	const int count = cwSrcLength != -1 ? cwSrcLength : (int)wcslen(lpSrcString) + 1;
+	if (!cwDstLength)
+		return count;
+	if (cwDstLength < count) {
+		SetLastError(ERROR_INSUFFICIENT_BUFFER);
+		return -count;
+	}
+	wmemcpy(lpDstString, lpSrcString, count);
+	return count;
+}
+
+static ULONG EVNTAPI fake_EventWrite(_In_ REGHANDLE RegHandle, _In_ PCEVENT_DESCRIPTOR EventDescriptor, _In_range_(0, MAX_EVENT_DATA_DESCRIPTORS) ULONG UserDataCount, _In_reads_opt_(UserDataCount) PEVENT_DATA_DESCRIPTOR UserData)
+{
+	UNREFERENCED_PARAMETER(RegHandle);
+	UNREFERENCED_PARAMETER(EventDescriptor);
+	ULONG size = 0;
+	for (ULONG i = 0; i < UserDataCount; ++i)
+		size += UserData[i].Size;
+	benchmark::do_not_optimize(size);
+	return ERROR_SUCCESS;
+}
+
+void benchmark::use_fake_backend()
+{
+	winstd::backend::WideCharToMultiByte = fake_WideCharToMultiByte;
+	winstd::backend::MultiByteToWideChar = fake_MultiByteToWideChar;
+	winstd::backend::FormatMessageA = fake_FormatMessageA;
+	winstd::backend::FormatMessageW = fake_FormatMessageW;
+	winstd::backend::RegQueryValueExA = fake_RegQueryValueExA;
+	winstd::backend::RegQueryValueExW = fake_RegQueryValueExW;
+	winstd::backend::NormalizeString = fake_NormalizeString;
+	winstd::backend::EventWrite = fake_EventWrite;
+}
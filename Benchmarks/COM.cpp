@@ -0,0 +1,32 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+
+static vector<LONG> make_numbers(_In_ size_t count)
+{
+	vector<LONG> numbers(count);
+	for (size_t i = 0; i < count; ++i)
+		numbers[i] = (LONG)i;
+	return numbers;
+}
+
+static const vector<LONG> numbers_16 = make_numbers(0x10);
+static const vector<LONG> numbers_4k = make_numbers(0x1000);
+
+#define BENCHMARK_VBARRAY(name, numbers) \
+	BENCHMARK(name) \
+	{ \
+		for (size_t i = 0; i < iterations; ++i) { \
+			VARIANT var = winstd::BuildVBARRAY((numbers).data(), (ULONG)(numbers).size()); \
+			benchmark::do_not_optimize(var); \
+			VariantClear(&var); \
+		} \
+	}
+
+BENCHMARK_VBARRAY(BuildVBARRAY_16, numbers_16)
+BENCHMARK_VBARRAY(BuildVBARRAY_4k, numbers_4k)
@@ -0,0 +1,222 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+
+namespace legacy
+{
+	// vsprintf() as it was before formatting into the target string: stack buffer first, then
+	// _vsnprintf(NULL, 0) to query the length, then the final pass.
+	template<class _Traits, class _Ax>
+	static int vsprintf(_Inout_ std::basic_string<char, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const char *format, _In_ va_list arg)
+	{
+		char buf[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
+		int count = _vsnprintf(buf, _countof(buf), format, arg);
+		if (0 <= count && count < _countof(buf)) {
+			str.append(buf, count);
+			return count;
+		}
+		if (count < 0)
+			count = _vsnprintf(NULL, 0, format, arg);
+		size_t offset = str.size();
+		str.resize(offset + count);
+		_vsnprintf(&str[offset], count + 1, format, arg);
+		return count;
+	}
+
+	template<class _Traits, class _Ax>
+	static int sprintf(_Inout_ std::basic_string<char, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const char *format, ...)
+	{
+		va_list arg;
+		va_start(arg, format);
+		const int res = vsprintf(str, format, arg);
+		va_end(arg);
+		return res;
+	}
+
+	// win_runtime_error as it was before deferring the message: formatted at construction.
+	class win_runtime_error : public winstd::num_runtime_error<DWORD>
+	{
+	public:
+		win_runtime_error(_In_ error_type num, _In_z_ const char *msg) : num_runtime_error<DWORD>(num, std::string(msg) + ": " + message(num))
+		{}
+
+	protected:
+		static std::string message(_In_ error_type num)
+		{
+			std::wstring wstr;
+			FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, 0, num, 0, wstr, NULL);
+			wstr.erase(wstr.find_last_not_of(L" \t\n\r\f\v") + 1);
+			std::string str;
+			WideCharToMultiByte(CP_UTF8, 0, wstr, str, NULL, NULL);
+			return str;
+		}
+	};
+}
+
+static const string short_text("short log line");
+static const string boundary_text(WINSTD_STACK_BUFFER_BYTES + 16, 'x');
+static const string huge_text(0x10000, 'x');
+
+#define BENCHMARK_SPRINTF(name, impl, text) \
+	BENCHMARK(name) \
+	{ \
+		string str; \
+		for (size_t i = 0; i < iterations; ++i) { \
+			str.clear(); \
+			impl(str, "%s %zu", (text).c_str(), i); \
+			benchmark::do_not_optimize(str); \
+		} \
+	}
+
+BENCHMARK_SPRINTF(legacy_sprintf_short, legacy::sprintf, short_text)
+BENCHMARK_SPRINTF(legacy_sprintf_1k_boundary, legacy::sprintf, boundary_text)
+BENCHMARK_SPRINTF(legacy_sprintf_64k, legacy::sprintf, huge_text)
+BENCHMARK_SPRINTF(sprintf_short, ::sprintf, short_text)
+BENCHMARK_SPRINTF(sprintf_1k_boundary, ::sprintf, boundary_text)
+BENCHMARK_SPRINTF(sprintf_64k, ::sprintf, huge_text)
+
+#define BENCHMARK_STRING_PRINTF(name, text) \
+	BENCHMARK(name) \
+	{ \
+		for (size_t i = 0; i < iterations; ++i) { \
+			winstd::string_printf str("%s %zu", (text).c_str(), i); \
+			benchmark::do_not_optimize(str); \
+		} \
+	}
+
+BENCHMARK_STRING_PRINTF(string_printf_short, short_text)
+BENCHMARK_STRING_PRINTF(string_printf_1k_boundary, boundary_text)
+BENCHMARK_STRING_PRINTF(string_printf_64k, huge_text)
+
+#define BENCHMARK_SPRINTF_BUFFER(name, text) \
+	BENCHMARK(name) \
+	{ \
+		for (size_t i = 0; i < iterations; ++i) { \
+			winstd::format_buffer::scratch buf; \
+			benchmark::do_not_optimize(::sprintf(*buf, "%s %zu", (text).c_str(), i)); \
+		} \
+	}
+
+BENCHMARK_SPRINTF_BUFFER(sprintf_buffer_short, short_text)
+BENCHMARK_SPRINTF_BUFFER(sprintf_buffer_1k_boundary, boundary_text)
+BENCHMARK_SPRINTF_BUFFER(sprintf_buffer_64k, huge_text)
+
+#ifdef __cpp_lib_format
+#define BENCHMARK_FORMAT_TO(name, text) \
+	BENCHMARK(name) \
+	{ \
+		string str; \
+		for (size_t i = 0; i < iterations; ++i) { \
+			str.clear(); \
+			::format_to(str, "{} {}", (text), i); \
+			benchmark::do_not_optimize(str); \
+		} \
+	}
+
+BENCHMARK_FORMAT_TO(format_to_short, short_text)
+BENCHMARK_FORMAT_TO(format_to_1k_boundary, boundary_text)
+BENCHMARK_FORMAT_TO(format_to_64k, huge_text)
+
+#define BENCHMARK_FORMAT_TO_BUFFER(name, text) \
+	BENCHMARK(name) \
+	{ \
+		for (size_t i = 0; i < iterations; ++i) { \
+			winstd::format_buffer::scratch buf; \
+			benchmark::do_not_optimize(::format_to(*buf, "{} {}", (text), i)); \
+		} \
+	}
+
+BENCHMARK_FORMAT_TO_BUFFER(format_to_buffer_short, short_text)
+BENCHMARK_FORMAT_TO_BUFFER(format_to_buffer_1k_boundary, boundary_text)
+BENCHMARK_FORMAT_TO_BUFFER(format_to_buffer_64k, huge_text)
+#endif
+
+#define BENCHMARK_WIPE(name, wipe, size) \
+	BENCHMARK(name) \
+	{ \
+		static unsigned char buf[size]; \
+		for (size_t i = 0; i < iterations; ++i) { \
+			wipe(buf, sizeof(buf)); \
+			benchmark::do_not_optimize(buf); \
+		} \
+	}
+
+BENCHMARK_WIPE(SecureZeroMemory_64, SecureZeroMemory, 0x40)
+BENCHMARK_WIPE(SecureZeroMemory_4k, SecureZeroMemory, 0x1000)
+BENCHMARK_WIPE(SecureZeroMemory_1M, SecureZeroMemory, 0x100000)
+BENCHMARK_WIPE(secure_wipe_64, winstd::secure_wipe, 0x40)
+BENCHMARK_WIPE(secure_wipe_4k, winstd::secure_wipe, 0x1000)
+BENCHMARK_WIPE(secure_wipe_1M, winstd::secure_wipe, 0x100000)
+
+BENCHMARK(FormatMessage_system)
+{
+	wstring str;
+	for (size_t i = 0; i < iterations; ++i) {
+		str.clear();
+		FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, ERROR_ACCESS_DENIED, 0, str, NULL);
+		benchmark::do_not_optimize(str);
+	}
+}
+
+BENCHMARK(message_cache_system)
+{
+	wstring str;
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::message_cache::instance().format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, ERROR_ACCESS_DENIED, 0, str);
+		benchmark::do_not_optimize(str);
+	}
+}
+
+#define BENCHMARK_THROW(name, exception) \
+	BENCHMARK(name) \
+	{ \
+		for (size_t i = 0; i < iterations; ++i) { \
+			try { \
+				throw exception(ERROR_ACCESS_DENIED, "CreateFile failed"); \
+			} \
+			catch (const std::exception &e) { \
+				benchmark::do_not_optimize(e); \
+			} \
+		} \
+	}
+
+BENCHMARK_THROW(legacy_win_runtime_error_throw, legacy::win_runtime_error)
+BENCHMARK_THROW(win_runtime_error_throw, winstd::win_runtime_error)
+
+static const winstd::bstr bstr_text(L"The quick brown fox jumps over the lazy dog");
+
+BENCHMARK(bstr_copy)
+{
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::bstr copy(bstr_text);
+		benchmark::do_not_optimize(copy);
+	}
+}
+
+BENCHMARK(shared_bstr_copy)
+{
+	winstd::shared_bstr str(bstr_text.duplicate());
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::shared_bstr copy(str);
+		benchmark::do_not_optimize(copy);
+	}
+}
+
+#define BENCHMARK_STRING_CHURN(name, type) \
+	BENCHMARK(name) \
+	{ \
+		for (size_t i = 0; i < iterations; ++i) { \
+			type str(short_text.c_str()); \
+			str += boundary_text.c_str(); \
+			type copy(str); \
+			benchmark::do_not_optimize(copy); \
+		} \
+	}
+
+BENCHMARK_STRING_CHURN(string_churn, string)
+BENCHMARK_STRING_CHURN(sanitizing_string_churn, winstd::sanitizing_string)
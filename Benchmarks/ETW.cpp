@@ -0,0 +1,47 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+
+static const unsigned char user_data[0x100] = {};
+static EVENT_HEADER_EXTENDED_DATA_ITEM extended_data[2] = {
+	{ 0, EVENT_HEADER_EXT_TYPE_RELATED_ACTIVITYID, { 0, 0 }, sizeof(GUID), (ULONGLONG)(ULONG_PTR)&GUID_NULL },
+	{ 0, EVENT_HEADER_EXT_TYPE_SID, { 0, 0 }, sizeof(user_data), (ULONGLONG)(ULONG_PTR)user_data },
+};
+
+static EVENT_RECORD make_event_record()
+{
+	EVENT_RECORD rec = {};
+	rec.ExtendedDataCount = _countof(extended_data);
+	rec.ExtendedData = extended_data;
+	rec.UserDataLength = sizeof(user_data);
+	rec.UserData = (PVOID)user_data;
+	return rec;
+}
+
+static const EVENT_RECORD event_record = make_event_record();
+
+BENCHMARK(event_rec_copy)
+{
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::event_rec rec(event_record);
+		benchmark::do_not_optimize(rec);
+	}
+}
+
+// {5B7F6F3B-62E2-4C3B-9B3C-8E8B1DBE8F47}
+static const GUID benchmark_provider = { 0x5b7f6f3b, 0x62e2, 0x4c3b, { 0x9b, 0x3c, 0x8e, 0x8b, 0x1d, 0xbe, 0x8f, 0x47 } };
+static const EVENT_DESCRIPTOR benchmark_event = { 1, 0, 0, TRACE_LEVEL_INFORMATION, 0, 0, 0 };
+
+BENCHMARK(event_provider_write)
+{
+	winstd::event_provider ep;
+	if (ep.create(&benchmark_provider) != ERROR_SUCCESS)
+		return;
+	for (size_t i = 0; i < iterations; ++i)
+		benchmark::do_not_optimize(ep.write(&benchmark_event, winstd::event_data((unsigned int)i), winstd::event_data(L"benchmark"), winstd::blank_event_data));
+}
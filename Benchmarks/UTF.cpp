@@ -0,0 +1,91 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+
+namespace legacy
+{
+	// CP_UTF8 conversions as they were before the built-in transcoder: all work is done by the OS.
+	static int MultiByteToWideChar(_In_ const string &src, _Out_ wstring &dst)
+	{
+		const int cch = ::MultiByteToWideChar(CP_UTF8, 0, src.c_str(), (int)src.length(), NULL, 0);
+		dst.resize(cch);
+		return ::MultiByteToWideChar(CP_UTF8, 0, src.c_str(), (int)src.length(), &dst[0], cch);
+	}
+
+	static int WideCharToMultiByte(_In_ const wstring &src, _Out_ string &dst)
+	{
+		const int cch = ::WideCharToMultiByte(CP_UTF8, 0, src.c_str(), (int)src.length(), NULL, 0, NULL, NULL);
+		dst.resize(cch);
+		return ::WideCharToMultiByte(CP_UTF8, 0, src.c_str(), (int)src.length(), &dst[0], cch, NULL, NULL);
+	}
+}
+
+static string make_text(_In_ const char *unit)
+{
+	string text;
+	while (text.length() < 0x1000)
+		text += unit;
+	return text;
+}
+
+static const string ascii_text = make_text("The quick brown fox jumps over the lazy dog. ");
+static const string mixed_text = make_text("P\xc5\x99\xc3\xadli\xc5\xa1 \xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88 \xf0\x9f\x90\x8e. ");
+static wstring to_wide(_In_ const string &text)
+{
+	wstring wtext;
+	legacy::MultiByteToWideChar(text, wtext);
+	return wtext;
+}
+static const wstring ascii_wtext = to_wide(ascii_text);
+static const wstring mixed_wtext = to_wide(mixed_text);
+
+#define BENCHMARK_MB2WC(name, impl) \
+	BENCHMARK(name) \
+	{ \
+		wstring wstr; \
+		for (size_t i = 0; i < iterations; ++i) { \
+			impl; \
+			benchmark::do_not_optimize(wstr); \
+		} \
+	}
+
+#define BENCHMARK_WC2MB(name, impl) \
+	BENCHMARK(name) \
+	{ \
+		string str; \
+		for (size_t i = 0; i < iterations; ++i) { \
+			impl; \
+			benchmark::do_not_optimize(str); \
+		} \
+	}
+
+BENCHMARK_MB2WC(legacy_MultiByteToWideChar_ascii, legacy::MultiByteToWideChar(ascii_text, wstr))
+BENCHMARK_MB2WC(legacy_MultiByteToWideChar_mixed, legacy::MultiByteToWideChar(mixed_text, wstr))
+BENCHMARK_MB2WC(MultiByteToWideChar_ascii, ::MultiByteToWideChar(CP_UTF8, 0, ascii_text, wstr))
+BENCHMARK_MB2WC(MultiByteToWideChar_mixed, ::MultiByteToWideChar(CP_UTF8, 0, mixed_text, wstr))
+BENCHMARK_MB2WC(utf8_to_utf16_ascii, wstr.resize(winstd::utf8_to_utf16_length(ascii_text.c_str(), ascii_text.length())); winstd::utf8_to_utf16(ascii_text.c_str(), ascii_text.length(), &wstr[0]))
+BENCHMARK_MB2WC(utf8_to_utf16_mixed, wstr.resize(winstd::utf8_to_utf16_length(mixed_text.c_str(), mixed_text.length())); winstd::utf8_to_utf16(mixed_text.c_str(), mixed_text.length(), &wstr[0]))
+
+BENCHMARK_WC2MB(legacy_WideCharToMultiByte_ascii, legacy::WideCharToMultiByte(ascii_wtext, str))
+BENCHMARK_WC2MB(legacy_WideCharToMultiByte_mixed, legacy::WideCharToMultiByte(mixed_wtext, str))
+BENCHMARK_WC2MB(WideCharToMultiByte_ascii, ::WideCharToMultiByte(CP_UTF8, 0, ascii_wtext, str, NULL, NULL))
+BENCHMARK_WC2MB(WideCharToMultiByte_mixed, ::WideCharToMultiByte(CP_UTF8, 0, mixed_wtext, str, NULL, NULL))
+BENCHMARK_WC2MB(utf16_to_utf8_ascii, str.resize(winstd::utf16_to_utf8_length(ascii_wtext.c_str(), ascii_wtext.length())); winstd::utf16_to_utf8(ascii_wtext.c_str(), ascii_wtext.length(), &str[0]))
+BENCHMARK_WC2MB(utf16_to_utf8_mixed, str.resize(winstd::utf16_to_utf8_length(mixed_wtext.c_str(), mixed_wtext.length())); winstd::utf16_to_utf8(mixed_wtext.c_str(), mixed_wtext.length(), &str[0]))
+
+// Lengths around the stack buffer: the zero-terminated results fit the stack buffer just below the boundary and
+// need a heap-allocated retry at the boundary.
+static const wstring below_boundary_wtext(WINSTD_STACK_BUFFER_BYTES - 1, L'x');
+static const wstring boundary_wtext(WINSTD_STACK_BUFFER_BYTES, L'x');
+static const string below_boundary_text(WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t) - 1, 'x');
+static const string boundary_text(WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t), 'x');
+
+BENCHMARK_MB2WC(MultiByteToWideChar_below_boundary, ::MultiByteToWideChar(1252, 0, below_boundary_text.c_str(), -1, wstr))
+BENCHMARK_MB2WC(MultiByteToWideChar_boundary, ::MultiByteToWideChar(1252, 0, boundary_text.c_str(), -1, wstr))
+BENCHMARK_WC2MB(WideCharToMultiByte_below_boundary, ::WideCharToMultiByte(1252, 0, below_boundary_wtext.c_str(), -1, str, NULL, NULL))
+BENCHMARK_WC2MB(WideCharToMultiByte_boundary, ::WideCharToMultiByte(1252, 0, boundary_wtext.c_str(), -1, str, NULL, NULL))
@@ -0,0 +1,482 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+
+namespace legacy
+{
+	// StringToGuidA() as it was before the canonical fast path.
+	static BOOL StringToGuidA(_In_z_ LPCSTR lpszGuid, _Out_ LPGUID lpGuid)
+	{
+		GUID g;
+		LPSTR lpszEnd;
+		unsigned long ulTmp;
+		unsigned long long ullTmp;
+
+		if (!lpszGuid || !lpGuid || *lpszGuid != '{') return FALSE;
+		lpszGuid++;
+		errno = 0;
+		g.Data1 = strtoul(lpszGuid, &lpszEnd, 16);
+		if (errno == ERANGE) return FALSE;
+		lpszGuid = lpszEnd;
+		if (*lpszGuid != '-') return FALSE;
+		lpszGuid++;
+		ulTmp = strtoul(lpszGuid, &lpszEnd, 16);
+		if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
+		g.Data2 = static_cast<unsigned short>(ulTmp);
+		lpszGuid = lpszEnd;
+		if (*lpszGuid != '-') return FALSE;
+		lpszGuid++;
+		ulTmp = strtoul(lpszGuid, &lpszEnd, 16);
+		if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
+		g.Data3 = static_cast<unsigned short>(ulTmp);
+		lpszGuid = lpszEnd;
+		if (*lpszGuid != '-') return FALSE;
+		lpszGuid++;
+		ulTmp = strtoul(lpszGuid, &lpszEnd, 16);
+		if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
+		g.Data4[0] = static_cast<unsigned char>((ulTmp >> 8) & 0xff);
+		g.Data4[1] = static_cast<unsigned char>( ulTmp       & 0xff);
+		lpszGuid = lpszEnd;
+		if (*lpszGuid != '-') return FALSE;
+		lpszGuid++;
+		ullTmp = _strtoui64(lpszGuid, &lpszEnd, 16);
+		if (errno == ERANGE || ullTmp > 0xFFFFFFFFFFFF) return FALSE;
+		for (size_t i = 0; i < 6; ++i)
+			g.Data4[2 + i] = static_cast<unsigned char>((ullTmp >> (40 - 8 * i)) & 0xff);
+		lpszGuid = lpszEnd;
+		if (*lpszGuid != '}') return FALSE;
+		*lpGuid = g;
+		return TRUE;
+	}
+
+	// Directory tree walk as hand-written before directory_range: one FindNextFile() call per entry.
+	static size_t walk_FindFirstFile(_In_ const wstring &dir)
+	{
+		WIN32_FIND_DATAW fd;
+		winstd::find_file find(FindFirstFileW((dir + L"\\*").c_str(), &fd));
+		if (!find)
+			return 0;
+		size_t count = 0;
+		do {
+			if (fd.cFileName[0] == L'.' && (!fd.cFileName[1] || (fd.cFileName[1] == L'.' && !fd.cFileName[2])))
+				continue;
+			count++;
+			if ((fd.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT)) == FILE_ATTRIBUTE_DIRECTORY)
+				count += walk_FindFirstFile(dir + L"\\" + fd.cFileName);
+		} while (FindNextFileW(find, &fd));
+		return count;
+	}
+
+	// Handle wrapper as it was before traits-based basic_handle: virtual destructor and free_internal().
+	class null_handle : public winstd::handle<HANDLE, NULL>
+	{
+		WINSTD_HANDLE_IMPL(null_handle, HANDLE, NULL)
+
+	public:
+		virtual ~null_handle()
+		{
+			if (m_h != invalid)
+				free_internal();
+		}
+
+	protected:
+		void free_internal() noexcept override
+		{}
+	};
+}
+
+struct null_handle_traits : winstd::basic_handle_traits<HANDLE, NULL>
+{
+	static void close(_In_ HANDLE h) noexcept
+	{
+		UNREFERENCED_PARAMETER(h);
+	}
+};
+typedef winstd::basic_handle<null_handle_traits> null_handle;
+
+static_assert(sizeof(null_handle) == sizeof(HANDLE), "basic_handle must not carry a virtual table");
+static_assert(sizeof(legacy::null_handle) > sizeof(HANDLE), "handle carries a virtual table");
+
+static const GUID guid = { 0x01234567, 0x89ab, 0xcdef, { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+static const char guid_str[] = "{01234567-89AB-CDEF-0123-456789ABCDEF}";
+
+BENCHMARK(legacy_string_guid)
+{
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::string_printf str("{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+			guid.Data1,
+			guid.Data2,
+			guid.Data3,
+			guid.Data4[0], guid.Data4[1],
+			guid.Data4[2], guid.Data4[3], guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+		benchmark::do_not_optimize(str);
+	}
+}
+
+BENCHMARK(string_guid)
+{
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::string_guid str(guid);
+		benchmark::do_not_optimize(str);
+	}
+}
+
+BENCHMARK(guid_string)
+{
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::guid_string str(guid);
+		benchmark::do_not_optimize(str);
+	}
+}
+
+BENCHMARK(guids_to_chars_1k)
+{
+	static GUID guids[1024];
+	static char str[_countof(guids) * winstd::guid_chars];
+	for (size_t i = 0; i < iterations; i += _countof(guids)) {
+		winstd::guids_to_chars(guids, _countof(guids), str);
+		benchmark::do_not_optimize(str);
+	}
+}
+
+BENCHMARK(legacy_StringToGuid)
+{
+	GUID g;
+	for (size_t i = 0; i < iterations; ++i) {
+		legacy::StringToGuidA(guid_str, &g);
+		benchmark::do_not_optimize(g);
+	}
+}
+
+BENCHMARK(StringToGuid)
+{
+	GUID g;
+	for (size_t i = 0; i < iterations; ++i) {
+		::StringToGuidA(guid_str, &g);
+		benchmark::do_not_optimize(g);
+	}
+}
+
+BENCHMARK(chars_to_guid)
+{
+	GUID g;
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::chars_to_guid(guid_str, g);
+		benchmark::do_not_optimize(g);
+	}
+}
+
+#define BENCHMARK_HANDLE_VECTOR(name, type) \
+	BENCHMARK(name) \
+	{ \
+		vector<type> handles; \
+		for (size_t i = 0; i < iterations; i += 0x400) { \
+			for (size_t j = 1; j <= 0x400; ++j) \
+				handles.emplace_back(reinterpret_cast<HANDLE>(j)); \
+			benchmark::do_not_optimize(handles); \
+			handles.clear(); \
+		} \
+	}
+
+BENCHMARK_HANDLE_VECTOR(legacy_handle_vector_1k, legacy::null_handle)
+BENCHMARK_HANDLE_VECTOR(basic_handle_vector_1k, null_handle)
+
+BENCHMARK(win_handle_event)
+{
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::win_handle<NULL> event(CreateEvent(NULL, TRUE, FALSE, NULL));
+		benchmark::do_not_optimize(event);
+	}
+}
+
+BENCHMARK(deferred_win_handle_event)
+{
+	for (size_t i = 0; i < iterations; ++i) {
+		winstd::deferred_win_handle<NULL> event(CreateEvent(NULL, TRUE, FALSE, NULL));
+		benchmark::do_not_optimize(event);
+	}
+	winstd::close_queue::instance().flush();
+}
+
+static const wstring below_boundary_wtext(WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t) - 1, L'x');
+static const wstring boundary_wtext(WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t), L'x');
+
+#define BENCHMARK_NORMALIZE(name, policy, text) \
+	BENCHMARK(name) \
+	{ \
+		wstring str; \
+		for (size_t i = 0; i < iterations; ++i) { \
+			NormalizeString<policy>(NormalizationC, (text).c_str(), -1, str); \
+			benchmark::do_not_optimize(str); \
+		} \
+	}
+
+BENCHMARK_NORMALIZE(NormalizeString_below_boundary, winstd::default_buffer_policy, below_boundary_wtext)
+BENCHMARK_NORMALIZE(NormalizeString_boundary, winstd::default_buffer_policy, boundary_wtext)
+BENCHMARK_NORMALIZE(NormalizeString_boundary_adaptive, winstd::adaptive_buffer_policy, boundary_wtext)
+
+BENCHMARK(RegQueryStringValue)
+{
+	winstd::reg_key key;
+	if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion", 0, KEY_READ, key) != ERROR_SUCCESS)
+		return;
+	wstring str;
+	for (size_t i = 0; i < iterations; ++i) {
+		RegQueryStringValue(key, L"ProductName", str);
+		benchmark::do_not_optimize(str);
+	}
+}
+
+// Synthetic tree of 16 x 16 directories with 64 files each, created once in the temporary folder.
+static const wstring& synthetic_tree()
+{
+	static const wstring root = []
+	{
+		WCHAR szTemp[MAX_PATH];
+		GetTempPathW(_countof(szTemp), szTemp);
+		wstring root = wstring(szTemp) + L"WinStd.Benchmarks.tree";
+		CreateDirectoryW(root.c_str(), NULL);
+		for (size_t i = 0; i < 16; ++i) {
+			const wstring dir1 = root + L"\\" + to_wstring(i);
+			CreateDirectoryW(dir1.c_str(), NULL);
+			for (size_t j = 0; j < 16; ++j) {
+				const wstring dir2 = dir1 + L"\\" + to_wstring(j);
+				CreateDirectoryW(dir2.c_str(), NULL);
+				for (size_t k = 0; k < 64; ++k)
+					winstd::file f(CreateFileW((dir2 + L"\\file" + to_wstring(k) + L".dat").c_str(), GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL));
+			}
+		}
+		return root;
+	}();
+	return root;
+}
+
+static size_t walk_directory_range(_In_ const wstring &dir)
+{
+	winstd::directory_range range(dir.c_str());
+	size_t count = 0;
+	for (auto &entry : range) {
+		count++;
+		if (entry.is_directory() && !entry.is_reparse_point()) {
+			wstring_view name = entry.name();
+			count += walk_directory_range(dir + L"\\" + wstring(name.data(), name.size()));
+		}
+	}
+	return count;
+}
+
+BENCHMARK(legacy_tree_FindFirstFile)
+{
+	const wstring &root = synthetic_tree();
+	for (size_t i = 0; i < iterations; i += 0x4000) {
+		size_t count = legacy::walk_FindFirstFile(root);
+		benchmark::do_not_optimize(count);
+	}
+}
+
+BENCHMARK(tree_directory_range)
+{
+	const wstring &root = synthetic_tree();
+	for (size_t i = 0; i < iterations; i += 0x4000) {
+		size_t count = walk_directory_range(root);
+		benchmark::do_not_optimize(count);
+	}
+}
+
+BENCHMARK(tree_walk_directory_tree)
+{
+	const wstring &root = synthetic_tree();
+	for (size_t i = 0; i < iterations; i += 0x4000) {
+		winstd::directory_walk_stats stats = winstd::walk_directory_tree(root.c_str(), [](const wstring &dir, const winstd::directory_entry &entry)
+		{
+			UNREFERENCED_PARAMETER(dir);
+			UNREFERENCED_PARAMETER(entry);
+			return true;
+		});
+		benchmark::do_not_optimize(stats);
+	}
+}
+
+// Synthetic 64 MiB file, created once in the temporary folder.
+static const wstring& synthetic_file()
+{
+	static const wstring path = []
+	{
+		WCHAR szTemp[MAX_PATH];
+		GetTempPathW(_countof(szTemp), szTemp);
+		wstring path = wstring(szTemp) + L"WinStd.Benchmarks.file";
+		winstd::file f(CreateFileW(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL));
+		if (!!f) {
+			vector<BYTE> data(0x100000);
+			for (size_t i = 0; i < data.size(); ++i)
+				data[i] = static_cast<BYTE>(i);
+			DWORD dwWritten;
+			for (size_t i = 0; i < 64; ++i)
+				WriteFile(f, data.data(), static_cast<DWORD>(data.size()), &dwWritten, NULL);
+		}
+		return path;
+	}();
+	return path;
+}
+
+static size_t checksum(_In_reads_bytes_(size) const BYTE *data, _In_ size_t size)
+{
+	size_t sum = 0;
+	for (size_t i = 0; i < size; i += 0x1000)
+		sum += data[i];
+	return sum;
+}
+
+BENCHMARK(file_ReadFile_64M)
+{
+	winstd::file f(CreateFileW(synthetic_file().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+	vector<BYTE> buffer(0x100000);
+	for (size_t i = 0; i < iterations; i += 0x4000) {
+		SetFilePointer(f, 0, NULL, FILE_BEGIN);
+		size_t sum = 0;
+		DWORD dwRead;
+		while (ReadFile(f, buffer.data(), static_cast<DWORD>(buffer.size()), &dwRead, NULL) && dwRead)
+			sum += checksum(buffer.data(), dwRead);
+		benchmark::do_not_optimize(sum);
+	}
+}
+
+#define BENCHMARK_MAPPED_WINDOW(name, prefetch) \
+	BENCHMARK(name) \
+	{ \
+		winstd::file f(CreateFileW(synthetic_file().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)); \
+		winstd::mapped_window window(f, PAGE_READONLY, winstd::mapped_window::default_window_bytes, winstd::mapped_window::default_cached_views, prefetch); \
+		for (size_t i = 0; i < iterations; i += 0x4000) { \
+			size_t sum = 0; \
+			for (auto &chunk : window) \
+				sum += checksum(chunk.data, chunk.size); \
+			benchmark::do_not_optimize(sum); \
+		} \
+	}
+
+BENCHMARK_MAPPED_WINDOW(file_mapped_window_64M, false)
+BENCHMARK_MAPPED_WINDOW(file_mapped_window_prefetch_64M, true)
+
+// Each of 4 threads fills and clears a std::map of 256 nodes.
+template <class _Alloc>
+static void map_churn_mt(_In_ size_t iterations, _In_ const _Alloc &alloc)
+{
+	static const size_t thread_count = 4, node_count = 256;
+	vector<thread> threads;
+	for (size_t t = 0; t < thread_count; ++t) {
+		threads.emplace_back([&]
+		{
+			map<size_t, size_t, less<size_t>, _Alloc> m(alloc);
+			for (size_t i = 0; i < iterations / thread_count; i += node_count) {
+				for (size_t j = 0; j < node_count; ++j)
+					m.emplace(j, i);
+				benchmark::do_not_optimize(m);
+				m.clear();
+			}
+		});
+	}
+	for (auto &t : threads)
+		t.join();
+}
+
+BENCHMARK(map_churn_mt_std_allocator)
+{
+	map_churn_mt(iterations, allocator<pair<const size_t, size_t>>());
+}
+
+BENCHMARK(map_churn_mt_heap_allocator)
+{
+	winstd::heap heap(HeapCreate(0, 0, 0));
+	map_churn_mt(iterations, winstd::heap_allocator<pair<const size_t, size_t>>(heap));
+}
+
+BENCHMARK(map_churn_mt_pool_allocator)
+{
+	winstd::heap heap(HeapCreate(0, 0, 0));
+	winstd::heap_pool pool(heap);
+	map_churn_mt(iterations, winstd::pool_allocator<pair<const size_t, size_t>>(pool));
+}
+
+// Heap of 100000 blocks of mixed sizes with every fourth one freed
+static winstd::heap& fragmented_heap()
+{
+	static winstd::heap heap([]
+	{
+		HANDLE heap = HeapCreate(0, 0, 0);
+		vector<void*> blocks;
+		for (size_t i = 0; i < 100000; ++i)
+			blocks.push_back(HeapAlloc(heap, 0, 16 + i % 7 * 40));
+		for (size_t i = 0; i < blocks.size(); i += 4)
+			HeapFree(heap, 0, blocks[i]);
+		return heap;
+	}());
+	return heap;
+}
+
+BENCHMARK(heap_enumerate)
+{
+	auto &heap = fragmented_heap();
+	for (size_t i = 0; i < iterations; i += 0x4000)
+		benchmark::do_not_optimize(heap.enumerate());
+}
+
+BENCHMARK(heap_stats)
+{
+	auto &heap = fragmented_heap();
+	winstd::heap_stats stats;
+	for (size_t i = 0; i < iterations; i += 0x4000) {
+		heap.stats(stats);
+		benchmark::do_not_optimize(stats);
+	}
+}
+
+BENCHMARK(heap_stats_prefix_1000)
+{
+	auto &heap = fragmented_heap();
+	winstd::heap_stats stats;
+	for (size_t i = 0; i < iterations; i += 0x4000) {
+		heap.stats(stats, 1000);
+		benchmark::do_not_optimize(stats);
+	}
+}
+
+#ifdef __cpp_lib_memory_resource
+// Each request builds a map of 256 strings and discards it.
+static void request_arena(_In_ size_t iterations, _In_ std::pmr::memory_resource *res, _In_opt_ winstd::monotonic_vmemory_resource *arena = NULL)
+{
+	static const size_t node_count = 256;
+	for (size_t i = 0; i < iterations; i += node_count) {
+		{
+			std::pmr::map<size_t, std::pmr::string> m(res);
+			for (size_t j = 0; j < node_count; ++j)
+				m.emplace(j, std::pmr::string(40, 'x', res));
+			benchmark::do_not_optimize(m);
+		}
+		if (arena)
+			arena->release();
+	}
+}
+
+BENCHMARK(request_arena_new_delete_resource)
+{
+	request_arena(iterations, std::pmr::new_delete_resource());
+}
+
+BENCHMARK(request_arena_heap_memory_resource)
+{
+	winstd::heap heap(HeapCreate(0, 0, 0));
+	winstd::heap_memory_resource res(heap);
+	request_arena(iterations, &res);
+}
+
+BENCHMARK(request_arena_monotonic_vmemory_resource)
+{
+	winstd::monotonic_vmemory_resource arena(0x1000000);
+	request_arena(iterations, &arena, &arena);
+}
+#endif
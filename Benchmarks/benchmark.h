@@ -0,0 +1,78 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#pragma once
+
+#include <intrin.h>
+#include <sal.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace benchmark
+{
+	///
+	/// Benchmark case function
+	///
+	/// \param[in] iterations  Number of iterations to run
+	///
+	typedef void (*case_fn)(_In_ size_t iterations);
+
+	///
+	/// Registered benchmark case
+	///
+	struct case_info
+	{
+		const char *name;	///< Case name
+		case_fn fn;			///< Case function
+	};
+
+	///
+	/// Returns list of registered benchmark cases
+	///
+	inline std::vector<case_info>& cases()
+	{
+		static std::vector<case_info> cases;
+		return cases;
+	}
+
+	///
+	/// Registers benchmark case on construction
+	///
+	struct registrar
+	{
+		registrar(_In_z_ const char *name, _In_ case_fn fn)
+		{
+			cases().push_back({ name, fn });
+		}
+	};
+
+	///
+	/// Prevents the compiler from optimizing away the computation of given value
+	///
+	template <class T>
+	inline void do_not_optimize(_In_ const T &value)
+	{
+		static const void * volatile sink;
+		sink = &value;
+		_ReadWriteBarrier();
+	}
+
+	///
+	/// Replaces system functions WinStd calls with deterministic fakes
+	///
+	/// Use to measure WinStd's own overhead without the cost and variance of the OS.
+	///
+	void use_fake_backend();
+}
+
+///
+/// Declares and registers a benchmark case
+///
+#define BENCHMARK(name) \
+	static void benchmark_##name(_In_ size_t iterations); \
+	static benchmark::registrar benchmark_##name##_registrar(#name, benchmark_##name); \
+	static void benchmark_##name(_In_ size_t iterations)
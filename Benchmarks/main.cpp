@@ -0,0 +1,68 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+
+enum class output_t {
+	text,
+	csv,
+	json,
+};
+
+// Usage: Benchmarks [--csv|--json] [--fake] [filter]
+int main(int argc, const char *argv[])
+{
+	output_t output = output_t::text;
+	const char *backend = "system";
+	const char *filter = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--csv") == 0)
+			output = output_t::csv;
+		else if (strcmp(argv[i], "--json") == 0)
+			output = output_t::json;
+		else if (strcmp(argv[i], "--fake") == 0) {
+			benchmark::use_fake_backend();
+			backend = "fake";
+		}
+		else
+			filter = argv[i];
+	}
+
+	switch (output) {
+	case output_t::csv: printf("name,backend,ns_per_op,iterations\n"); break;
+	case output_t::json: printf("["); break;
+	}
+
+	bool first = true;
+	for (auto &c : benchmark::cases()) {
+		if (filter && !strstr(c.name, filter))
+			continue;
+
+		// Warm up, then double the iteration count until a run takes long enough to measure reliably.
+		c.fn(1);
+		for (size_t iterations = 1;; iterations *= 2) {
+			auto start = chrono::high_resolution_clock::now();
+			c.fn(iterations);
+			auto duration = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count();
+			if (duration >= 1e8 || iterations >= (size_t)1 << 30) {
+				switch (output) {
+				case output_t::text: printf("%-40s %12.1f ns/op %12zu iterations\n", c.name, duration / iterations, iterations); break;
+				case output_t::csv: printf("%s,%s,%.1f,%zu\n", c.name, backend, duration / iterations, iterations); break;
+				case output_t::json: printf("%s\n  { \"name\": \"%s\", \"backend\": \"%s\", \"ns_per_op\": %.1f, \"iterations\": %zu }", first ? "" : ",", c.name, backend, duration / iterations, iterations); break;
+				}
+				fflush(stdout);
+				break;
+			}
+		}
+		first = false;
+	}
+
+	if (output == output_t::json)
+		printf("\n]\n");
+
+	return 0;
+}
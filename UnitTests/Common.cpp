@@ -0,0 +1,678 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2022-2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	struct limited_policy : public winstd::default_buffer_policy
+	{
+		static const size_t max_calls = 2;
+	};
+
+	static size_t allocations = 0;
+
+	template <class _Ty>
+	struct counting_allocator : public std::allocator<_Ty>
+	{
+		template <class _Other>
+		struct rebind { typedef counting_allocator<_Other> other; };
+
+		counting_allocator() noexcept {}
+		template <class _Other>
+		counting_allocator(_In_ const counting_allocator<_Other>&) noexcept {}
+
+		_Ty* allocate(_In_ size_t count)
+		{
+			++allocations;
+			return std::allocator<_Ty>::allocate(count);
+		}
+	};
+
+	// Allocator failing allocations of more than 64 bytes
+	template <class _Ty>
+	struct failing_allocator : public std::allocator<_Ty>
+	{
+		template <class _Other>
+		struct rebind { typedef failing_allocator<_Other> other; };
+
+		failing_allocator() noexcept {}
+		template <class _Other>
+		failing_allocator(_In_ const failing_allocator<_Other>&) noexcept {}
+
+		_Ty* allocate(_In_ size_t count)
+		{
+			if (count * sizeof(_Ty) > 64)
+				throw std::bad_alloc();
+			return std::allocator<_Ty>::allocate(count);
+		}
+	};
+
+#ifdef WINSTD_MOCK_BACKEND
+	static size_t fake_calls = 0;
+
+	// Deterministic WideCharToMultiByte() mapping UTF-16 code units to bytes. Reports ERROR_INSUFFICIENT_BUFFER like the OS.
+	static int WINAPI fake_WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ LPCWCH lpWideCharStr, _In_ int cchWideChar, _Out_writes_opt_(cbMultiByte) LPSTR lpMultiByteStr, _In_ int cbMultiByte, _In_opt_ LPCCH lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar)
+	{
+		UNREFERENCED_PARAMETER(CodePage);
+		UNREFERENCED_PARAMETER(dwFlags);
+		UNREFERENCED_PARAMETER(lpDefaultChar);
+		UNREFERENCED_PARAMETER(lpUsedDefaultChar);
+		++fake_calls;
+		const int count = cchWideChar != -1 ? cchWideChar : (int)wcslen(lpWideCharStr) + 1;
+		if (!cbMultiByte)
+			return count;
+		if (cbMultiByte < count) {
+			SetLastError(ERROR_INSUFFICIENT_BUFFER);
+			return 0;
+		}
+		for (int i = 0; i < count; ++i)
+			lpMultiByteStr[i] = static_cast<char>(lpWideCharStr[i]);
+		return count;
+	}
+#endif
+
+	TEST_CLASS(Common)
+	{
+	public:
+		TEST_METHOD(probe_then_fill)
+		{
+			// Simulates a system function reporting the required size, or not.
+			static const size_t required = 3 * WINSTD_STACK_BUFFER_BYTES;
+			auto reporting = [](_Out_writes_(cch) char *buf, _In_ size_t cch)
+			{
+				if (cch < required)
+					return winstd::buffer_probe::more(required);
+				memset(buf, 'x', required);
+				return winstd::buffer_probe::ok(required);
+			};
+			auto silent = [](_Out_writes_(cch) char *buf, _In_ size_t cch)
+			{
+				if (cch < required)
+					return winstd::buffer_probe::more();
+				memset(buf, 'x', required);
+				return winstd::buffer_probe::ok(required);
+			};
+
+			string str;
+			Assert::IsTrue(winstd::probe_then_fill(str, reporting));
+			Assert::AreEqual<size_t>(2, winstd::last_probe_calls());
+			Assert::AreEqual(string(required, 'x').c_str(), str.c_str());
+
+			vector<char> vec;
+			Assert::IsTrue(winstd::probe_then_fill<winstd::in_place_buffer_policy>(vec, reporting, required));
+			Assert::AreEqual<size_t>(1, winstd::last_probe_calls());
+			Assert::AreEqual(required, vec.size());
+
+			Assert::IsTrue(winstd::probe_then_fill(str, silent));
+			Assert::AreEqual<size_t>(3, winstd::last_probe_calls());
+			Assert::AreEqual(string(required, 'x').c_str(), str.c_str());
+
+			Assert::IsFalse(winstd::probe_then_fill<limited_policy>(str, silent));
+			Assert::AreEqual<size_t>(2, winstd::last_probe_calls());
+			Assert::IsTrue(str.empty());
+
+			Assert::IsFalse(winstd::probe_then_fill(str, [](_Out_writes_(cch) char *buf, _In_ size_t cch) { return winstd::buffer_probe::fail(); }));
+			Assert::AreEqual<size_t>(1, winstd::last_probe_calls());
+		}
+
+		TEST_METHOD(adaptive_buffer_policy)
+		{
+			size_t required = 3 * WINSTD_STACK_BUFFER_BYTES, capacity = 0;
+			auto sized = [&](_Out_writes_(cch) char *buf, _In_ size_t cch)
+			{
+				capacity = cch;
+				if (cch < required)
+					return winstd::buffer_probe::more(required);
+				memset(buf, 'x', required);
+				return winstd::buffer_probe::ok(required);
+			};
+
+			// The first call learns the capacity, the next one starts with it.
+			string str;
+			Assert::IsTrue(winstd::probe_then_fill<winstd::adaptive_buffer_policy>(str, sized));
+			Assert::AreEqual<size_t>(2, winstd::last_probe_calls());
+			Assert::IsTrue(winstd::probe_then_fill<winstd::adaptive_buffer_policy>(str, sized));
+			Assert::AreEqual<size_t>(1, winstd::last_probe_calls());
+			Assert::AreEqual(required, capacity);
+			Assert::AreEqual(string(required, 'x').c_str(), str.c_str());
+
+			// Smaller output: the remembered capacity decays back to the stack buffer.
+			required = 0x10;
+			const size_t expected[] = { 3 * WINSTD_STACK_BUFFER_BYTES, 3 * WINSTD_STACK_BUFFER_BYTES / 2, WINSTD_STACK_BUFFER_BYTES, WINSTD_STACK_BUFFER_BYTES };
+			for (auto e : expected) {
+				Assert::IsTrue(winstd::probe_then_fill<winstd::adaptive_buffer_policy>(str, sized));
+				Assert::AreEqual<size_t>(1, winstd::last_probe_calls());
+				Assert::AreEqual(e, capacity);
+				Assert::AreEqual(string(required, 'x').c_str(), str.c_str());
+			}
+
+			// A derived policy type instantiates its own function and remembers its own capacity.
+			struct own_policy : winstd::adaptive_buffer_policy {};
+			required = 3 * WINSTD_STACK_BUFFER_BYTES;
+			Assert::IsTrue(winstd::probe_then_fill<winstd::adaptive_buffer_policy>(str, sized));
+			Assert::AreEqual<size_t>(2, winstd::last_probe_calls());
+			Assert::IsTrue(winstd::probe_then_fill<own_policy>(str, sized));
+			Assert::AreEqual<size_t>(2, winstd::last_probe_calls());
+			Assert::IsTrue(winstd::probe_then_fill<winstd::adaptive_buffer_policy>(str, sized));
+			Assert::AreEqual<size_t>(1, winstd::last_probe_calls());
+		}
+
+		TEST_METHOD(sprintf)
+		{
+			string str;
+			Assert::AreEqual(13, ::sprintf(str, "%s, %s!", "Hello", "World"));
+			Assert::AreEqual("Hello, World!", str.c_str());
+
+			// Appends, and spills over stack buffer.
+			string long_str(WINSTD_STACK_BUFFER_BYTES, 'x');
+			Assert::AreEqual<int>(WINSTD_STACK_BUFFER_BYTES, ::sprintf(str, "%s", long_str.c_str()));
+			Assert::AreEqual<size_t>(13 + WINSTD_STACK_BUFFER_BYTES, str.size());
+			Assert::IsTrue(str.compare(13, string::npos, long_str) == 0);
+
+			wstring wstr;
+			wstring long_wstr(WINSTD_STACK_BUFFER_BYTES, L'x');
+			Assert::AreEqual<int>(WINSTD_STACK_BUFFER_BYTES, ::sprintf(wstr, L"%ls", long_wstr.c_str()));
+			Assert::AreEqual(long_wstr.c_str(), wstr.c_str());
+
+			// Stale errno from earlier calls is not taken for a formatting failure.
+			errno = ERANGE;
+			str.clear();
+			Assert::AreEqual<int>(WINSTD_STACK_BUFFER_BYTES, ::sprintf(str, "%s", long_str.c_str()));
+			errno = EINVAL;
+			wstr.clear();
+			Assert::AreEqual<int>(WINSTD_STACK_BUFFER_BYTES, ::sprintf(wstr, L"%ls", long_wstr.c_str()));
+		}
+
+		TEST_METHOD(guid_string)
+		{
+			static const GUID guid = { 0x01234567, 0x89ab, 0xcdef, { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+			Assert::AreEqual("{01234567-89AB-CDEF-0123-456789ABCDEF}", winstd::guid_string(guid).c_str());
+			Assert::AreEqual(L"{01234567-89AB-CDEF-0123-456789ABCDEF}", winstd::wguid_string(guid).c_str());
+			Assert::AreEqual("{01234567-89AB-CDEF-0123-456789ABCDEF}", winstd::string_guid(guid).c_str());
+			Assert::AreEqual(L"{01234567-89AB-CDEF-0123-456789ABCDEF}", winstd::wstring_guid(guid).c_str());
+
+			GUID result;
+			Assert::IsTrue(winstd::chars_to_guid("{01234567-89ab-cdef-0123-456789ABCDEF}", result));
+			Assert::IsTrue(IsEqualGUID(guid, result));
+			Assert::IsTrue(winstd::chars_to_guid(L"{01234567-89AB-CDEF-0123-456789abcdef}", result));
+			Assert::IsTrue(IsEqualGUID(guid, result));
+			Assert::IsFalse(winstd::chars_to_guid("{01234567-89AB-CDEF-0123-456789ABCDEG}", result));
+			Assert::IsFalse(winstd::chars_to_guid("{01234567-89AB-CDEF-0123+456789ABCDEF}", result));
+			Assert::IsFalse(winstd::chars_to_guid(L"{01234567-89AB-CDEF-0123-456789ABCDE\u0146}", result));
+
+			GUID guids[3] = { {}, guid, guid };
+			guids[2].Data1 = 0xffffffff;
+			wchar_t str[3 * 40];
+			winstd::guids_to_chars(guids, _countof(guids), str, 40);
+			Assert::AreEqual(L"{FFFFFFFF-89AB-CDEF-0123-456789ABCDEF}", wstring(str + 80, winstd::guid_chars).c_str());
+			GUID results[3];
+			Assert::AreEqual<size_t>(3, winstd::chars_to_guids(str, _countof(results), results, 40));
+			for (size_t i = 0; i < _countof(guids); ++i)
+				Assert::IsTrue(IsEqualGUID(guids[i], results[i]));
+		}
+
+		TEST_METHOD(inline_string)
+		{
+			// Helpers write into the in-place storage.
+			winstd::inline_wstring<> path;
+			Assert::IsTrue(GetModuleFileNameW(NULL, path) > 0);
+			Assert::IsTrue(path.is_inline());
+			wstring expected;
+			GetModuleFileNameW(NULL, expected);
+			Assert::AreEqual(expected.c_str(), path.c_str());
+
+			// Copies get their own storage.
+			winstd::inline_wstring<> copy(path), moved(std::move(path));
+			Assert::IsTrue(copy.is_inline());
+			Assert::IsTrue(moved.is_inline());
+			Assert::AreEqual(expected.c_str(), copy.c_str());
+			Assert::AreEqual(expected.c_str(), moved.c_str());
+
+			// Longer strings spill to heap.
+			copy.assign(2 * MAX_PATH, L'x');
+			Assert::IsFalse(copy.is_inline());
+			Assert::AreEqual<size_t>(2 * MAX_PATH, copy.size());
+
+			winstd::inline_vector<unsigned char, 16> vec(16);
+			Assert::IsTrue(vec.is_inline());
+			vec.push_back(0);
+			Assert::IsFalse(vec.is_inline());
+			Assert::AreEqual<size_t>(17, vec.size());
+
+			// Swapping copies contents, each string keeping its own storage.
+			winstd::inline_wstring<> short_str(L"short");
+			swap(short_str, copy);
+			Assert::AreEqual(L"short", copy.c_str());
+			Assert::AreEqual<size_t>(2 * MAX_PATH, short_str.size());
+			short_str.swap(copy);
+			Assert::AreEqual(L"short", short_str.c_str());
+			Assert::AreEqual<size_t>(2 * MAX_PATH, copy.size());
+
+			winstd::inline_vector<unsigned char, 16> vec2{ 1, 2, 3 };
+			swap(vec, vec2);
+			Assert::AreEqual<size_t>(3, vec.size());
+			Assert::AreEqual<unsigned char>(3, vec[2]);
+			Assert::AreEqual<size_t>(17, vec2.size());
+
+			// Containers move the vectors when they grow.
+			static_assert(is_nothrow_move_constructible_v<winstd::inline_vector<unsigned char, 16>>);
+			static_assert(is_nothrow_move_constructible_v<winstd::inline_wstring<>>);
+			vector<winstd::inline_vector<unsigned char, 16>> vecs;
+			for (size_t i = 0; i < 10; ++i)
+				vecs.push_back(winstd::inline_vector<unsigned char, 16>(i));
+			for (size_t i = 0; i < 10; ++i) {
+				Assert::AreEqual(i, vecs[i].size());
+				Assert::IsTrue(vecs[i].is_inline());
+			}
+		}
+
+		TEST_METHOD(string_view)
+		{
+			typedef basic_string<char, char_traits<char>, counting_allocator<char>> counted_string;
+			typedef basic_string<wchar_t, char_traits<wchar_t>, counting_allocator<wchar_t>> counted_wstring;
+			static const wchar_t text[] = L"This text is long enough not to fit into the small string buffer.";
+			static const char text_a[] = "This text is long enough not to fit into the small string buffer.";
+			size_t base;
+
+			// Input views are converted in place: the output is the only allocation.
+			counted_string str;
+			base = allocations;
+			Assert::AreEqual<int>((int)_countof(text) - 1, ::WideCharToMultiByte(CP_UTF8, 0, wstring_view(text), str, NULL, NULL));
+			Assert::AreEqual<size_t>(1, allocations - base);
+			Assert::AreEqual(text_a, str.c_str());
+
+			counted_wstring wstr;
+			base = allocations;
+			Assert::AreEqual<int>((int)_countof(text) - 1, ::MultiByteToWideChar(CP_ACP, 0, string_view(str), wstr));
+			Assert::AreEqual<size_t>(1, allocations - base);
+			Assert::AreEqual(text, wstr.c_str());
+
+			counted_wstring normalized;
+			base = allocations;
+			Assert::IsTrue(::NormalizeString(NormalizationC, wstring_view(text), normalized) > 0);
+			Assert::AreEqual<size_t>(1, allocations - base);
+			Assert::AreEqual(text, normalized.c_str());
+
+			// Input strings are not copied either.
+			counted_string str2;
+			base = allocations;
+			Assert::AreEqual<int>((int)_countof(text) - 1, ::SecureWideCharToMultiByte(CP_ACP, 0, wstr, str2, NULL, NULL));
+			Assert::AreEqual<size_t>(1, allocations - base);
+			Assert::AreEqual(text_a, str2.c_str());
+		}
+
+		TEST_METHOD(sanitizing_arena)
+		{
+			winstd::sanitizing_arena arena;
+
+			// Blocks are naturally aligned to their size class and recycled.
+			unsigned char *p = static_cast<unsigned char*>(arena.allocate(33));
+			Assert::AreEqual<uintptr_t>(0, reinterpret_cast<uintptr_t>(p) & 63);
+			memset(p, 0xcc, 33);
+			arena.deallocate(p, 33);
+			for (size_t i = sizeof(void*); i < 64; ++i)
+				Assert::AreEqual<unsigned char>(0, p[i]);
+			Assert::IsTrue(p == arena.allocate(64));
+			arena.deallocate(p, 64);
+
+			// Large blocks
+			void *large = arena.allocate(0x10000, 0x1000);
+			Assert::AreEqual<uintptr_t>(0, reinterpret_cast<uintptr_t>(large) & 0xfff);
+			arena.deallocate(large, 0x10000, 0x1000);
+
+			typedef basic_string<char, char_traits<char>, winstd::sanitizing_arena_allocator<char>> arena_string;
+			arena_string str{ winstd::sanitizing_arena_allocator<char>(arena) };
+			for (int i = 0; i < 100; ++i)
+				str += "Very secret password ";
+			Assert::AreEqual<size_t>(2100, str.length());
+
+			// Moving to a container of another arena keeps the target arena and moves the elements.
+			winstd::sanitizing_arena other;
+			arena_string str2{ winstd::sanitizing_arena_allocator<char>(other) };
+			str2 = std::move(str);
+			Assert::AreEqual<size_t>(2100, str2.length());
+			Assert::IsTrue(str2.get_allocator() == winstd::sanitizing_arena_allocator<char>(other));
+
+#ifdef __cpp_lib_memory_resource
+			std::pmr::wstring wstr(&arena);
+			wstr.assign(1000, L'*');
+			Assert::AreEqual<size_t>(1000, wstr.length());
+#endif
+		}
+
+#ifdef __cpp_lib_memory_resource
+		TEST_METHOD(sanitizing_memory_resource)
+		{
+			// Upstream resource checking blocks are wiped before they are returned.
+			class checking_resource : public std::pmr::memory_resource
+			{
+			public:
+				size_t dirty = 0;
+
+			protected:
+				void* do_allocate(size_t size, size_t align) override { return std::pmr::new_delete_resource()->allocate(size, align); }
+				void do_deallocate(void* p, size_t size, size_t align) override
+				{
+					for (size_t i = 0; i < size; ++i)
+						if (static_cast<unsigned char*>(p)[i])
+							++dirty;
+					std::pmr::new_delete_resource()->deallocate(p, size, align);
+				}
+				bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+			} upstream;
+
+			winstd::sanitizing_memory_resource res(&upstream), other(&upstream);
+			Assert::IsTrue(res.upstream_resource() == &upstream);
+			Assert::IsTrue(res == other);
+			{
+				std::pmr::string str(&res);
+				for (int i = 0; i < 100; ++i)
+					str += "Very secret password ";
+				std::pmr::vector<std::pmr::string> v(&res);
+				v.resize(100, str);
+			}
+			Assert::AreEqual<size_t>(0, upstream.dirty);
+		}
+#endif
+
+		TEST_METHOD(secure_wipe)
+		{
+			unsigned char buf[300];
+			for (size_t offset = 0; offset < 32; offset += 7) {
+				for (size_t size = 0; size < 260; size += 13) {
+					memset(buf, 0xcc, sizeof(buf));
+					winstd::secure_wipe(buf + offset, size);
+					for (size_t i = 0; i < sizeof(buf); ++i)
+						Assert::AreEqual<unsigned char>(offset <= i && i < offset + size ? 0x00 : 0xcc, buf[i]);
+				}
+			}
+		}
+
+		TEST_METHOD(sanitizing_blob)
+		{
+			winstd::sanitizing_blob<16> fixed;
+			memset(fixed.data(), 0xcc, fixed.size());
+			winstd::sanitizing_blob<16> fixed2(std::move(fixed));
+			Assert::AreEqual<unsigned char>(0xcc, fixed2.m_data[15]);
+			Assert::AreEqual<unsigned char>(0, fixed.m_data[15]);
+
+			winstd::sanitizing_blob<> key("Very secret key", 16);
+			Assert::AreEqual<size_t>(16, key.size());
+			winstd::sanitizing_blob<> copy(key);
+			Assert::AreEqual(0, memcmp(key.data(), copy.data(), 16));
+			winstd::sanitizing_blob<> moved(std::move(copy));
+			Assert::AreEqual<size_t>(0, copy.size());
+			Assert::AreEqual("Very secret key", reinterpret_cast<const char*>(moved.data()));
+			moved.resize(64);
+			Assert::AreEqual<size_t>(64, moved.size());
+			Assert::AreEqual("Very secret key", reinterpret_cast<const char*>(moved.data()));
+		}
+
+		TEST_METHOD(format_buffer)
+		{
+			winstd::format_buffer buf(0x100);
+			Assert::IsTrue(::sprintf(buf, "%i is less than %i.", 1, 5) == "1 is less than 5.");
+			const char *data = buf.c_str();
+			Assert::IsTrue(::sprintf(buf, "%i is less than %i.", 2, 5) == "2 is less than 5.");
+			Assert::IsTrue(data == buf.c_str());
+
+			// Capacity above the high-water mark is released on reset.
+			string long_str(0x1000, 'x');
+			Assert::AreEqual<size_t>(0x1000, ::sprintf(buf, "%s", long_str.c_str()).size());
+			buf.reset();
+			Assert::IsTrue(buf.capacity() <= 0x100);
+
+			// Nested users of the thread's buffer get a private one.
+			winstd::wformat_buffer::scratch outer;
+			Assert::IsTrue(&*outer == &winstd::wformat_buffer::thread_buffer());
+			{
+				winstd::wformat_buffer::scratch inner;
+				Assert::IsTrue(&*inner != &*outer);
+			}
+#ifdef __cpp_lib_format
+			Assert::IsTrue(::format_to(*outer, L"{} is less than {}.", 1, 5) == L"1 is less than 5.");
+#endif
+		}
+
+		TEST_METHOD(message_cache)
+		{
+			winstd::message_cache cache(2);
+			wstring str, str2;
+			Assert::IsTrue(cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, ERROR_ACCESS_DENIED, 0, str));
+			Assert::IsTrue(FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, ERROR_ACCESS_DENIED, 0, str2, NULL) > 0);
+			Assert::AreEqual(str2.c_str(), str.c_str());
+			Assert::IsTrue(cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, ERROR_ACCESS_DENIED, 0, str));
+			Assert::AreEqual<uint64_t>(1, cache.hits());
+			Assert::AreEqual<uint64_t>(1, cache.misses());
+
+			// Messages not found are cached too.
+			Assert::IsFalse(cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, 0x7fffffff, 0, str));
+			Assert::AreEqual<DWORD>(ERROR_MR_MID_NOT_FOUND, GetLastError());
+			Sleep(50); // Let the coarse recency clock advance.
+			SetLastError(ERROR_SUCCESS);
+			Assert::IsFalse(cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, 0x7fffffff, 0, str));
+			Assert::AreEqual<DWORD>(ERROR_MR_MID_NOT_FOUND, GetLastError());
+			Assert::AreEqual<uint64_t>(2, cache.hits());
+			Assert::AreEqual<uint64_t>(2, cache.misses());
+
+			// The least recently used entry is evicted.
+			Assert::IsTrue(cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, ERROR_FILE_NOT_FOUND, 0, str));
+			Assert::AreEqual<uint64_t>(1, cache.evictions());
+			Assert::IsFalse(cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, 0x7fffffff, 0, str));
+			Assert::AreEqual<uint64_t>(3, cache.hits());
+			Assert::IsTrue(cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, ERROR_ACCESS_DENIED, 0, str));
+			Assert::AreEqual<uint64_t>(4, cache.misses());
+
+			// Lookups race with inserts, evictions and clear().
+			std::atomic<bool> failed(false);
+			list<thread> workers;
+			for (DWORD i = 0; i < 4; ++i) {
+				workers.push_back(thread([&, i]
+				{
+					static const DWORD codes[] = { ERROR_ACCESS_DENIED, ERROR_FILE_NOT_FOUND, ERROR_PATH_NOT_FOUND, ERROR_INVALID_HANDLE };
+					wstring s;
+					for (DWORD j = 0; j < 1000; ++j) {
+						if (!cache.format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, codes[(i + j) % _countof(codes)], 0, s) || s.empty())
+							failed = true;
+						if (i == 0 && j % 100 == 0)
+							cache.clear();
+					}
+				}));
+			}
+			for (auto &w : workers)
+				w.join();
+			Assert::IsFalse(failed);
+			Assert::AreEqual<uint64_t>(4007, cache.hits() + cache.misses());
+		}
+
+		TEST_METHOD(win_runtime_error)
+		{
+			wstring wstr;
+			Assert::IsTrue(winstd::message_cache::instance().format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, ERROR_ACCESS_DENIED, 0, wstr));
+			wstr.erase(wstr.find_last_not_of(L" \t\n\r\f\v") + 1);
+			string msg;
+			WideCharToMultiByte(CP_UTF8, 0, wstr, msg, NULL, NULL);
+
+			// The message is formatted on the first what() call, and survives copying.
+			winstd::win_runtime_error err(ERROR_ACCESS_DENIED, "CreateFile failed");
+			Assert::AreEqual<DWORD>(ERROR_ACCESS_DENIED, err.number());
+			Assert::AreEqual(("CreateFile failed: " + msg).c_str(), err.what());
+			Assert::IsTrue(err.what() == err.what());
+			winstd::win_runtime_error copy(err);
+			Assert::AreEqual(err.what(), copy.what());
+			Assert::AreEqual(msg.c_str(), winstd::win_runtime_error(ERROR_ACCESS_DENIED).what());
+			Assert::AreEqual((": " + msg).c_str(), winstd::win_runtime_error(ERROR_ACCESS_DENIED, "").what());
+			static_assert(is_nothrow_copy_constructible_v<winstd::win_runtime_error>);
+
+			SetLastError(ERROR_ACCESS_DENIED);
+			winstd::win_runtime_error last("CreateFile failed");
+			Assert::AreEqual<DWORD>(ERROR_ACCESS_DENIED, last.number());
+			Assert::AreEqual(err.what(), last.what());
+		}
+
+#ifdef WINSTD_MOCK_BACKEND
+		TEST_METHOD(backend_override)
+		{
+			winstd::backend_override<decltype(winstd::backend::WideCharToMultiByte)> fake(winstd::backend::WideCharToMultiByte, fake_WideCharToMultiByte);
+			string str;
+
+			// Fits the stack buffer.
+			fake_calls = 0;
+			Assert::AreEqual(6, ::WideCharToMultiByte(1252, 0, L"backend", 6, str, NULL, NULL));
+			Assert::AreEqual("backen", str.c_str());
+			Assert::AreEqual<size_t>(1, fake_calls);
+
+			// Zero-terminated input exceeding the stack buffer: fails, queries the size, and fills.
+			wstring wstr(WINSTD_STACK_BUFFER_BYTES * 2, L'x');
+			fake_calls = 0;
+			Assert::AreEqual((int)wstr.size() + 1, ::WideCharToMultiByte(1252, 0, wstr.c_str(), -1, str, NULL, NULL));
+			Assert::AreEqual(string(wstr.size(), 'x').c_str(), str.c_str());
+			Assert::AreEqual<size_t>(3, fake_calls);
+		}
+#endif
+
+		TEST_METHOD(expected)
+		{
+#ifdef WINSTD_MOCK_BACKEND
+			winstd::backend_override<decltype(winstd::backend::WideCharToMultiByte)> fake(winstd::backend::WideCharToMultiByte, fake_WideCharToMultiByte);
+#endif
+
+			// Success carries the value.
+			auto str = ::WideCharToMultiByte(1252, 0, L"expected");
+			Assert::IsTrue(str.has_value());
+			Assert::AreEqual("expected", str->c_str());
+			Assert::AreEqual<DWORD>(ERROR_SUCCESS, str.error());
+
+			// Empty input is not an error.
+			Assert::IsTrue(::WideCharToMultiByte(1252, 0, L"").value().empty());
+
+			// Failure carries the error in-band.
+			auto wstr = ::MultiByteToWideChar(0xffff, 0, "expected");
+			Assert::IsFalse(wstr.has_value());
+			Assert::AreEqual<DWORD>(ERROR_INVALID_PARAMETER, wstr.error());
+			Assert::AreEqual(L"fallback", wstr.value_or(L"fallback").c_str());
+
+			auto value = ::RegQueryStringValue(HKEY_CURRENT_USER, L"WinStd.UnitTests.NonExistent");
+			Assert::IsFalse(value.has_value());
+			Assert::AreEqual<DWORD>(ERROR_FILE_NOT_FOUND, value.error());
+
+			// Allocation failures are reported rather than thrown.
+			static const char text[] = "This text is long enough not to fit into the string object itself.";
+			basic_string<wchar_t, char_traits<wchar_t>, failing_allocator<wchar_t>> wstr2;
+			Assert::AreEqual(0, ::MultiByteToWideChar(CP_UTF8, 0, text, -1, wstr2));
+			Assert::AreEqual<DWORD>(ERROR_OUTOFMEMORY, GetLastError());
+			Assert::AreEqual(0, ::MultiByteToWideChar(1252, 0, text, -1, wstr2));
+			Assert::AreEqual<DWORD>(ERROR_OUTOFMEMORY, GetLastError());
+			auto oom = ::MultiByteToWideChar<winstd::default_buffer_policy, char_traits<wchar_t>, failing_allocator<wchar_t>>(CP_UTF8, 0, text);
+			Assert::IsFalse(oom.has_value());
+			Assert::AreEqual<DWORD>(ERROR_OUTOFMEMORY, oom.error());
+		}
+
+#if defined(WINSTD_MOCK_BACKEND) && defined(WINSTD_BUFFER_STATS)
+		TEST_METHOD(buffer_stats)
+		{
+			winstd::backend_override<decltype(winstd::backend::WideCharToMultiByte)> fake(winstd::backend::WideCharToMultiByte, fake_WideCharToMultiByte);
+			auto &registry = winstd::buffer_stats_registry::instance();
+			string str;
+
+			// Fits the stack buffer.
+			winstd::buffer_stats before = registry.stats("WideCharToMultiByte");
+			::WideCharToMultiByte(1252, 0, L"backend", 6, str, NULL, NULL);
+			winstd::buffer_stats after = registry.stats("WideCharToMultiByte");
+			Assert::AreEqual<uint64_t>(before.invocations + 1, after.invocations);
+			Assert::AreEqual<uint64_t>(before.stack_hits + 1, after.stack_hits);
+			Assert::AreEqual<uint64_t>(before.heap_retries, after.heap_retries);
+			Assert::AreEqual<uint64_t>(before.bytes_allocated + 6, after.bytes_allocated);
+			Assert::AreEqual<uint64_t>(before.system_calls + 1, after.system_calls);
+
+			// Exceeds the stack buffer: one heap retry of the reported size.
+			wstring wstr(WINSTD_STACK_BUFFER_BYTES * 2, L'x');
+			before = after;
+			::WideCharToMultiByte(1252, 0, wstr.c_str(), -1, str, NULL, NULL);
+			after = registry.stats("WideCharToMultiByte");
+			Assert::AreEqual<uint64_t>(before.invocations + 1, after.invocations);
+			Assert::AreEqual<uint64_t>(before.stack_hits, after.stack_hits);
+			Assert::AreEqual<uint64_t>(before.heap_retries + 1, after.heap_retries);
+			Assert::AreEqual<uint64_t>(before.bytes_allocated + wstr.size() + 1, after.bytes_allocated);
+			Assert::AreEqual<uint64_t>(before.system_calls + 3, after.system_calls);
+
+			// Counts of other threads are included.
+			before = after;
+			thread([] {
+				string str;
+				::WideCharToMultiByte(1252, 0, L"thread", 6, str, NULL, NULL);
+			}).join();
+			after = registry.stats("WideCharToMultiByte");
+			Assert::AreEqual<uint64_t>(before.invocations + 1, after.invocations);
+			Assert::AreEqual<uint64_t>(before.stack_hits + 1, after.stack_hits);
+		}
+#endif
+
+		TEST_METHOD(shared_dplhandle)
+		{
+			auto &stats = winstd::shared_bstr::stats();
+			const uint64_t shared = stats.shared, duplicated = stats.duplicated;
+
+			// Copies share the string.
+			winstd::shared_bstr str(winstd::bstr(L"shared"));
+			winstd::shared_bstr copy(str), other;
+			other = copy;
+			Assert::IsTrue(copy == (BSTR)str);
+			Assert::IsTrue(other == (BSTR)str);
+			Assert::AreEqual(3l, str.use_count());
+			Assert::AreEqual<uint64_t>(shared + 2, stats.shared);
+			Assert::AreEqual<uint64_t>(duplicated, stats.duplicated);
+
+			// Modification duplicates the string first.
+			BSTR b = copy.mutable_ref();
+			Assert::IsTrue(b != (BSTR)str);
+			b[0] = L'S';
+			Assert::AreEqual(L"shared", (BSTR)str);
+			Assert::AreEqual(L"Shared", (BSTR)copy);
+			Assert::AreEqual(2l, str.use_count());
+			Assert::AreEqual(1l, copy.use_count());
+			Assert::IsTrue(copy.mutable_ref() == b);
+			Assert::AreEqual<uint64_t>(duplicated + 1, stats.duplicated);
+
+			// Detaching the last copy returns the string itself.
+			other.free();
+			BSTR s = str;
+			winstd::bstr owned(str.detach());
+			Assert::IsTrue(!str);
+			Assert::IsTrue(owned == s);
+			Assert::AreEqual<uint64_t>(duplicated + 1, stats.duplicated);
+		}
+
+		TEST_METHOD(string_printf)
+		{
+			Assert::AreEqual("1 is less than 5.", winstd::string_printf("%i is less than %i.", 1, 5).c_str());
+			Assert::AreEqual(L"1 is less than 5.", winstd::wstring_printf(L"%i is less than %i.", 1, 5).c_str());
+		}
+
+#ifdef __cpp_lib_format
+		TEST_METHOD(format_to)
+		{
+			string str("> ");
+			Assert::AreEqual<size_t>(17, ::format_to(str, "{} is less than {}.", 1, 5));
+			Assert::AreEqual("> 1 is less than 5.", str.c_str());
+
+			wstring wstr;
+			wstring long_wstr(WINSTD_STACK_BUFFER_BYTES, L'x');
+			Assert::AreEqual<size_t>(WINSTD_STACK_BUFFER_BYTES, ::format_to(wstr, L"{}", long_wstr));
+			Assert::AreEqual(long_wstr.c_str(), wstr.c_str());
+		}
+
+		TEST_METHOD(string_format)
+		{
+			Assert::AreEqual("1 is less than 5.", winstd::string_format("{} is less than {}.", 1, 5).c_str());
+			Assert::AreEqual(L"1 is less than 5.", winstd::wstring_format(L"{} is less than {}.", 1, 5).c_str());
+		}
+#endif
+	};
+}
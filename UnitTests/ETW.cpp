@@ -0,0 +1,75 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+#ifdef WINSTD_MOCK_BACKEND
+	static BOOLEAN fake_enabled = FALSE;
+	static size_t fake_writes = 0;
+	static wstring fake_string;
+
+	static BOOLEAN EVNTAPI fake_EventProviderEnabled(_In_ REGHANDLE RegHandle, _In_ UCHAR Level, _In_ ULONGLONG Keyword)
+	{
+		UNREFERENCED_PARAMETER(RegHandle);
+		UNREFERENCED_PARAMETER(Level);
+		UNREFERENCED_PARAMETER(Keyword);
+		return fake_enabled;
+	}
+
+	static ULONG EVNTAPI fake_EventWriteString(_In_ REGHANDLE RegHandle, _In_ UCHAR Level, _In_ ULONGLONG Keyword, _In_ PCWSTR String)
+	{
+		UNREFERENCED_PARAMETER(RegHandle);
+		UNREFERENCED_PARAMETER(Level);
+		UNREFERENCED_PARAMETER(Keyword);
+		++fake_writes;
+		fake_string = String;
+		return ERROR_SUCCESS;
+	}
+#endif
+
+	TEST_CLASS(ETW)
+	{
+	public:
+#ifdef WINSTD_MOCK_BACKEND
+		TEST_METHOD(event_provider_write_string)
+		{
+			winstd::backend_override<decltype(winstd::backend::EventProviderEnabled)> fake_enabled_override(winstd::backend::EventProviderEnabled, fake_EventProviderEnabled);
+			winstd::backend_override<decltype(winstd::backend::EventWriteString)> fake_write_override(winstd::backend::EventWriteString, fake_EventWriteString);
+
+			// {4B0B9B1F-5D4C-4E8B-9F0B-7C5B8A6C2E11}
+			static const GUID provider_id = { 0x4b0b9b1f, 0x5d4c, 0x4e8b, { 0x9f, 0x0b, 0x7c, 0x5b, 0x8a, 0x6c, 0x2e, 0x11 } };
+			winstd::event_provider ep;
+			Assert::AreEqual<ULONG>(ERROR_SUCCESS, ep.create(&provider_id));
+
+			// Nothing is formatted or written when no session is listening.
+			fake_enabled = FALSE;
+			fake_writes = 0;
+			Assert::AreEqual<ULONG>(ERROR_SUCCESS, ep.write(TRACE_LEVEL_INFORMATION, 0, L"%d %ls", 5, L"events"));
+			Assert::AreEqual<size_t>(0, fake_writes);
+
+			fake_enabled = TRUE;
+			Assert::AreEqual<ULONG>(ERROR_SUCCESS, ep.write(TRACE_LEVEL_INFORMATION, 0, L"%d %ls", 5, L"events"));
+			Assert::AreEqual<size_t>(1, fake_writes);
+			Assert::AreEqual(L"5 events", fake_string.c_str());
+
+#ifdef __cpp_lib_format
+			fake_enabled = FALSE;
+			Assert::AreEqual<ULONG>(ERROR_SUCCESS, ep.write_format(TRACE_LEVEL_INFORMATION, 0, L"{} {}", 6, L"events"));
+			Assert::AreEqual<size_t>(1, fake_writes);
+
+			fake_enabled = TRUE;
+			Assert::AreEqual<ULONG>(ERROR_SUCCESS, ep.write_format(TRACE_LEVEL_INFORMATION, 0, L"{} {}", 6, L"events"));
+			Assert::AreEqual<size_t>(2, fake_writes);
+			Assert::AreEqual(L"6 events", fake_string.c_str());
+#endif
+		}
+#endif
+	};
+}
@@ -0,0 +1,171 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2024 Amebis
+*/
+
+#include "pch.h"
+
+using namespace std;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+	static const char* utf8_samples[] = {
+		"",
+		"ASCII only, long enough to cover at least one full SIMD block.",
+		"Ko\xc5\xa1" "ek \xc4\x8d" "okolade, \xe2\x82\xac 10, \xf0\x9f\x98\x80 and some ASCII after the emoji",
+		"\xf4\x8f\xbf\xbf\xef\xbf\xbf\xed\x9f\xbf\xee\x80\x80\xc2\x80\x7f",
+	};
+
+	static const char* utf8_invalid[] = {
+		"\xc0\x80", // Overlong NUL
+		"\xe0\x80\xaf", // Overlong slash
+		"\xed\xa0\x80", // Encoded surrogate
+		"\xf4\x90\x80\x80", // Above U+10FFFF
+		"\xf5\x80\x80\x80", // Invalid lead byte
+		"ASCII prefix\x80", // Stray continuation byte
+		"Truncated \xe2\x82", // Truncated sequence
+	};
+
+	static const wchar_t* utf16_invalid[] = {
+		L"\xd800", // Lone high surrogate
+		L"\xdc00 trailing", // Lone low surrogate
+		L"ASCII prefix \xdbff\x0041", // High surrogate followed by non-surrogate
+	};
+
+	TEST_CLASS(UTF)
+	{
+	public:
+		TEST_METHOD(utf8_to_utf16)
+		{
+			for (auto src : utf8_samples) {
+				const size_t count = strlen(src);
+				const int cch = ::MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, src, (int)count + 1, NULL, 0);
+				Assert::AreNotEqual(0, cch);
+				vector<wchar_t> expected(cch);
+				::MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, src, (int)count + 1, expected.data(), cch);
+
+				Assert::AreEqual<size_t>(cch - 1, winstd::utf8_to_utf16_length(src, count));
+				wstring result(cch - 1, 0);
+				Assert::AreEqual<size_t>(cch - 1, winstd::utf8_to_utf16(src, count, result.data()));
+				Assert::AreEqual(expected.data(), result.c_str());
+
+				wstring wstr;
+				Assert::AreEqual(cch, ::MultiByteToWideChar(CP_UTF8, 0, src, -1, wstr));
+				Assert::AreEqual(expected.data(), wstr.c_str());
+				Assert::AreEqual<size_t>(0, winstd::last_probe_calls());
+				vector<wchar_t> wvec;
+				Assert::AreEqual(cch, ::MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, src, -1, wvec));
+				Assert::IsTrue(expected == wvec);
+			}
+		}
+
+		TEST_METHOD(utf16_to_utf8)
+		{
+			for (auto sample : utf8_samples) {
+				wstring src;
+				::MultiByteToWideChar(CP_UTF8, 0, sample, -1, src);
+				const int cch = ::WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, src.c_str(), (int)src.length() + 1, NULL, 0, NULL, NULL);
+				Assert::AreNotEqual(0, cch);
+
+				Assert::AreEqual<size_t>(cch - 1, winstd::utf16_to_utf8_length(src.c_str(), src.length()));
+				string result(cch - 1, 0);
+				Assert::AreEqual<size_t>(cch - 1, winstd::utf16_to_utf8(src.c_str(), src.length(), result.data()));
+				Assert::AreEqual(sample, result.c_str());
+
+				string str;
+				Assert::AreEqual(cch, ::WideCharToMultiByte(CP_UTF8, 0, src.c_str(), -1, str, NULL, NULL));
+				Assert::AreEqual(sample, str.c_str());
+				Assert::AreEqual<size_t>(0, winstd::last_probe_calls());
+			}
+		}
+
+		TEST_METHOD(invalid)
+		{
+			for (auto src : utf8_invalid) {
+				const int count = (int)strlen(src);
+				Assert::AreEqual(winstd::utf_invalid, winstd::utf8_to_utf16_length(src, count));
+
+				// Must match the OS: error with MB_ERR_INVALID_CHARS, U+FFFD replacement without.
+				wstring wstr;
+				Assert::AreEqual(0, ::MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, src, count, wstr));
+				Assert::AreEqual<DWORD>(ERROR_NO_UNICODE_TRANSLATION, GetLastError());
+				const int cch = ::MultiByteToWideChar(CP_UTF8, 0, src, count, NULL, 0);
+				vector<wchar_t> expected(cch + 1);
+				::MultiByteToWideChar(CP_UTF8, 0, src, count, expected.data(), cch);
+				Assert::AreEqual(cch, ::MultiByteToWideChar(CP_UTF8, 0, src, count, wstr));
+				Assert::AreEqual(expected.data(), wstr.c_str());
+			}
+
+			for (auto src : utf16_invalid) {
+				const int count = (int)wcslen(src);
+				Assert::AreEqual(winstd::utf_invalid, winstd::utf16_to_utf8_length(src, count));
+
+				string str;
+				Assert::AreEqual(0, ::WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, src, count, str, NULL, NULL));
+				Assert::AreEqual<DWORD>(ERROR_NO_UNICODE_TRANSLATION, GetLastError());
+				const int cch = ::WideCharToMultiByte(CP_UTF8, 0, src, count, NULL, 0, NULL, NULL);
+				vector<char> expected(cch + 1);
+				::WideCharToMultiByte(CP_UTF8, 0, src, count, expected.data(), cch, NULL, NULL);
+				Assert::AreEqual(cch, ::WideCharToMultiByte(CP_UTF8, 0, src, count, str, NULL, NULL));
+				Assert::AreEqual(expected.data(), str.c_str());
+			}
+		}
+
+		TEST_METHOD(transcoder)
+		{
+			// Feed the samples one code unit at a time to split every sequence.
+			for (auto src : utf8_samples) {
+				wstring expected, result;
+				::MultiByteToWideChar(CP_UTF8, 0, src, -1, expected);
+				winstd::utf8_to_utf16_transcoder t([&](_In_reads_(count) const wchar_t *data, _In_ size_t count) { result.append(data, count); });
+				const size_t length = strlen(src);
+				for (size_t i = 0; i < length; ++i)
+					Assert::IsTrue(t.feed(src + i, 1));
+				Assert::IsTrue(t.finish());
+				Assert::AreEqual(expected.c_str(), result.c_str());
+				Assert::AreEqual<uint64_t>(length, t.consumed());
+				Assert::AreEqual<uint64_t>(expected.length(), t.produced());
+
+				string back;
+				winstd::utf16_to_utf8_transcoder t2([&](_In_reads_(count) const char *data, _In_ size_t count) { back.append(data, count); });
+				for (size_t i = 0; i < result.length(); ++i)
+					Assert::IsTrue(t2.feed(result.c_str() + i, 1));
+				Assert::IsTrue(t2.finish());
+				Assert::AreEqual(src, back.c_str());
+			}
+
+			// Output larger than the transcoder buffer
+			string huge(3 * winstd::utf8_to_utf16_transcoder::buffer_size + 1, 'x');
+			huge += "\xc5\xa1";
+			wstring result;
+			size_t blocks = 0;
+			winstd::utf8_to_utf16_transcoder t([&](_In_reads_(count) const wchar_t *data, _In_ size_t count)
+			{
+				Assert::IsTrue(count <= winstd::utf8_to_utf16_transcoder::buffer_size);
+				result.append(data, count);
+				++blocks;
+			});
+			Assert::IsTrue(t.feed(huge.c_str(), huge.length() - 1));
+			Assert::IsTrue(t.feed(huge.c_str() + huge.length() - 1, 1));
+			Assert::IsTrue(t.finish());
+			Assert::IsTrue(blocks > 3);
+			Assert::AreEqual<size_t>(huge.length() - 1, result.length());
+			Assert::AreEqual(L'\x0161', result.back());
+
+			// Ill-formed input
+			static const char bad[] = "a\x80" "b\xe2\x82";
+			result.clear();
+			Assert::IsTrue(t.feed(bad, 4));
+			Assert::IsTrue(t.feed(bad + 4, sizeof(bad) - 5));
+			Assert::IsTrue(t.finish());
+			Assert::AreEqual(L"a\xfffd" L"b\xfffd", result.c_str());
+			winstd::utf8_to_utf16_transcoder strict([&](_In_reads_(count) const wchar_t *data, _In_ size_t count) { result.append(data, count); }, true);
+			result.clear();
+			Assert::IsFalse(strict.feed(bad, sizeof(bad) - 1));
+			Assert::IsTrue(strict.failed());
+			Assert::AreEqual<uint64_t>(1, strict.consumed());
+			Assert::AreEqual(L"a", result.c_str());
+		}
+	};
+}
\ No newline at end of file
@@ -31,6 +31,22 @@ namespace UnitTests
 			}
 		}
 
+		TEST_METHOD(StringToGuid)
+		{
+			static const GUID guid = { 0x01234567, 0x89ab, 0xcdef, { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+			GUID result;
+			LPCSTR end;
+			Assert::IsTrue(::StringToGuidA("{01234567-89AB-CDEF-0123-456789ABCDEF}.", &result, &end));
+			Assert::IsTrue(IsEqualGUID(guid, result));
+			Assert::AreEqual('.', *end);
+
+			// Non-canonical representation. A stale errno must not affect parsing.
+			errno = ERANGE;
+			Assert::IsTrue(::StringToGuidW(L"{1234567-89ab-cdef-123-456789abcdef}", &result));
+			Assert::IsTrue(IsEqualGUID(guid, result));
+			Assert::IsFalse(::StringToGuidW(L"{01234567-89AB-CDEF-0123-456789ABCDEF", &result));
+		}
+
 		TEST_METHOD(CreateWellKnownSid)
 		{
 			std::unique_ptr<SID> sid;
@@ -65,6 +81,58 @@ namespace UnitTests
 				Assert::Fail(L"LoadLibraryEx failed");
 		}
 
+		TEST_METHOD(basic_handle)
+		{
+			static_assert(sizeof(winstd::library) == sizeof(HMODULE), "basic_handle must not carry a virtual table");
+			static_assert(sizeof(winstd::heap) == sizeof(HANDLE), "basic_handle must not carry a virtual table");
+			static_assert(sizeof(winstd::bstr) == sizeof(BSTR), "basic_dplhandle must not carry a virtual table");
+			static_assert(is_nothrow_move_constructible<winstd::win_handle<NULL>>::value, "basic_handle must be nothrow movable");
+
+			winstd::win_handle<NULL> event(CreateEvent(NULL, TRUE, FALSE, NULL));
+			Assert::IsTrue(!!event);
+			HANDLE h = event;
+			vector<winstd::win_handle<NULL>> handles;
+			handles.push_back(move(event));
+			Assert::IsTrue(!event);
+			Assert::IsTrue(handles[0] == h);
+			handles.reserve(handles.capacity() * 2);
+			Assert::IsTrue(handles[0] == h);
+			Assert::IsTrue(WaitForSingleObject(handles[0], 0) == WAIT_TIMEOUT);
+
+			winstd::heap heap(HeapCreate(0, 0, 0));
+			Assert::IsTrue(!!heap);
+			Assert::IsFalse(heap.enumerate());
+
+			winstd::bstr str(L"basic_dplhandle");
+			winstd::bstr copy(str);
+			Assert::IsTrue(copy != (BSTR)str);
+			Assert::AreEqual(str.length(), copy.length());
+			Assert::AreEqual(0, wcscmp(str, copy));
+		}
+
+		TEST_METHOD(close_queue)
+		{
+			auto &queue = winstd::close_queue::instance();
+			queue.flush();
+			const winstd::close_queue_stats before = queue.stats();
+
+			HANDLE h;
+			{
+				winstd::deferred_win_handle<NULL> event(CreateEvent(NULL, TRUE, FALSE, NULL));
+				Assert::IsTrue(!!event);
+				h = event;
+			}
+			queue.flush();
+			DWORD dwFlags;
+			Assert::IsFalse(GetHandleInformation(h, &dwFlags));
+
+			const winstd::close_queue_stats after = queue.stats();
+			Assert::AreEqual<size_t>(0, after.depth);
+			Assert::AreEqual<uint64_t>(before.queued + 1, after.queued);
+			Assert::AreEqual<uint64_t>(before.closed + 1, after.closed);
+			Assert::IsTrue(after.batches > before.batches);
+		}
+
 		TEST_METHOD(system_impersonator)
 		{
 			winstd::win_handle<NULL> processToken;
@@ -81,6 +149,249 @@ namespace UnitTests
 				Assert::IsTrue(!system_impersonator && GetLastError() == ERROR_ACCESS_DENIED);
 		}
 
+		TEST_METHOD(directory_range)
+		{
+			WCHAR szTemp[MAX_PATH];
+			Assert::AreNotEqual<DWORD>(0, GetTempPathW(_countof(szTemp), szTemp));
+			const wstring root = wstring(szTemp) + L"WinStd.UnitTests.directory_range";
+			static const size_t dir_count = 4, file_count = 100;
+			CreateDirectoryW(root.c_str(), NULL);
+			for (size_t i = 0; i < dir_count; ++i) {
+				const wstring dir = root + L"\\dir" + to_wstring(i);
+				CreateDirectoryW(dir.c_str(), NULL);
+				for (size_t j = 0; j < file_count; ++j) {
+					winstd::file f(CreateFileW((dir + L"\\file_with_a_longer_name_" + to_wstring(j)).c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL));
+					Assert::IsTrue(!!f);
+				}
+			}
+
+			{
+				// Small batch buffer forces multiple batches.
+				winstd::directory_range range((root + L"\\dir0").c_str(), 0x400);
+				Assert::IsTrue(!!range);
+				size_t count = 0;
+				for (auto &entry : range) {
+					Assert::IsFalse(entry.is_directory());
+					count++;
+				}
+				Assert::AreEqual(file_count, count);
+				Assert::AreEqual<DWORD>(ERROR_SUCCESS, range.error());
+				Assert::IsTrue(range.batches() > 1);
+			}
+
+			{
+				winstd::directory_range range((root + L"\\nonexistent").c_str());
+				Assert::IsFalse(!!range);
+				Assert::AreEqual<DWORD>(ERROR_FILE_NOT_FOUND, range.error());
+				Assert::IsTrue(range.begin() == range.end());
+			}
+
+			atomic<size_t> files(0);
+			auto stats = winstd::walk_directory_tree(root.c_str(), [&](const wstring &dir, const winstd::directory_entry &entry)
+			{
+				UNREFERENCED_PARAMETER(dir);
+				if (!entry.is_directory())
+					files++;
+				return true;
+			}, 4);
+			Assert::AreEqual(dir_count * file_count, files.load());
+			Assert::AreEqual<uint64_t>(1 + dir_count, stats.directories);
+			Assert::AreEqual<uint64_t>(dir_count + dir_count * file_count, stats.entries);
+			Assert::AreEqual<uint64_t>(0, stats.errors);
+
+			for (size_t i = 0; i < dir_count; ++i) {
+				const wstring dir = root + L"\\dir" + to_wstring(i);
+				for (size_t j = 0; j < file_count; ++j)
+					DeleteFileW((dir + L"\\file_with_a_longer_name_" + to_wstring(j)).c_str());
+				RemoveDirectoryW(dir.c_str());
+			}
+			RemoveDirectoryW(root.c_str());
+		}
+
+		TEST_METHOD(mapped_window)
+		{
+			WCHAR szTemp[MAX_PATH], szPath[MAX_PATH];
+			Assert::AreNotEqual<DWORD>(0, GetTempPathW(_countof(szTemp), szTemp));
+			Assert::AreNotEqual<UINT>(0, GetTempFileNameW(szTemp, L"WS", 0, szPath));
+			{
+				winstd::file f(CreateFileW(szPath, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL));
+				Assert::IsTrue(!!f);
+				const DWORD granularity = winstd::mapped_view::allocation_granularity();
+				vector<BYTE> data(granularity * 5 + 123);
+				for (size_t i = 0; i < data.size(); ++i)
+					data[i] = static_cast<BYTE>(i * 7 % 251);
+				DWORD dwWritten;
+				Assert::IsTrue(!!WriteFile(f, data.data(), static_cast<DWORD>(data.size()), &dwWritten, NULL));
+
+				winstd::mapped_window window(f, PAGE_READONLY, granularity * 2, 1);
+				Assert::IsTrue(!!window);
+				Assert::AreEqual<ULONGLONG>(data.size(), window.size());
+
+				// Consecutive windows cover the whole file.
+				size_t total = 0, chunks = 0;
+				for (auto &chunk : window) {
+					Assert::AreEqual(chunk.offset, static_cast<ULONGLONG>(total));
+					Assert::IsTrue(memcmp(chunk.data, data.data() + chunk.offset, chunk.size) == 0);
+					total += chunk.size;
+					chunks++;
+				}
+				Assert::AreEqual(data.size(), total);
+				Assert::AreEqual<size_t>(3, chunks);
+
+				// Range straddling windows is mapped contiguously.
+				BYTE *p = window.view(granularity * 2 - 8, 16);
+				Assert::IsNotNull(p);
+				Assert::IsTrue(memcmp(p, data.data() + granularity * 2 - 8, 16) == 0);
+
+				// Range inside a recently used view is served without mapping.
+				const uint64_t maps = window.maps();
+				Assert::IsNotNull(window.view(granularity * 2 - 4, 4));
+				Assert::AreEqual(maps, window.maps());
+
+				Assert::IsNull(window.view(data.size(), 1));
+				Assert::AreEqual<DWORD>(ERROR_INVALID_PARAMETER, window.error());
+			}
+		}
+
+		TEST_METHOD(pool_allocator)
+		{
+			winstd::heap heap(HeapCreate(0, 0, 0));
+			Assert::IsTrue(!!heap);
+			{
+				winstd::heap_pool pool(heap), other(heap);
+				winstd::pool_allocator<int> a(pool);
+				Assert::IsTrue(a == winstd::pool_allocator<char>(pool));
+				Assert::IsTrue(a != winstd::pool_allocator<int>(other));
+
+				map<int, int, less<int>, winstd::pool_allocator<pair<const int, int>>> m(a);
+				for (int i = 0; i < 1000; ++i)
+					m.emplace(i, i * 2);
+				Assert::AreEqual<size_t>(1000, m.size());
+				Assert::AreEqual(1998, m[999]);
+
+				// Blocks larger than the size classes are passed to the heap.
+				vector<int, winstd::pool_allocator<int>> v(1000, 7, a);
+				Assert::AreEqual(7, v[999]);
+
+				// Nodes allocated on one thread and freed on another.
+				list<int, winstd::pool_allocator<int>> l(a);
+				for (int i = 0; i < 1000; ++i)
+					l.push_back(i);
+				thread([&] { l.clear(); }).join();
+				for (int i = 0; i < 1000; ++i)
+					l.push_back(i);
+				Assert::AreEqual<size_t>(1000, l.size());
+				Assert::AreEqual<uint64_t>(0, pool.uncached());
+			}
+			{
+				// All pools share one FLS index.
+				vector<unique_ptr<winstd::heap_pool>> pools;
+				for (size_t i = 0; i < 200; ++i) {
+					pools.emplace_back(new winstd::heap_pool(heap));
+					void* p = pools.back()->allocate(32);
+					Assert::IsNotNull(p);
+					pools.back()->deallocate(p, 32);
+				}
+				pools.erase(pools.begin(), pools.begin() + 100);
+				thread([&] {
+					for (auto& pool : pools) {
+						void* p = pool->allocate(100);
+						Assert::IsNotNull(p);
+						pool->deallocate(p, 100);
+					}
+				}).join();
+				for (auto& pool : pools)
+					Assert::AreEqual<uint64_t>(0, pool->uncached());
+			}
+			Assert::IsTrue(!!HeapValidate(heap, 0, NULL));
+		}
+
+		TEST_METHOD(heap_stats)
+		{
+			winstd::heap heap(HeapCreate(0, 0, 0));
+			Assert::IsTrue(!!heap);
+			vector<void*> blocks;
+			for (size_t i = 0; i < 1000; ++i)
+				blocks.push_back(HeapAlloc(heap, 0, i % 2 ? 24 : 1000));
+			for (size_t i = 0; i < blocks.size(); i += 4)
+				HeapFree(heap, 0, blocks[i]);
+
+			winstd::heap_stats stats;
+			Assert::IsTrue(heap.stats(stats));
+			Assert::IsFalse(stats.truncated);
+			Assert::IsTrue(stats.blocks >= 750);
+			Assert::IsTrue(stats.allocated >= 250 * 1000 + 500 * 24);
+			Assert::IsTrue(stats.histogram[4] >= 500);
+			Assert::IsTrue(stats.histogram[9] >= 250);
+			Assert::IsTrue(stats.committed >= stats.allocated + stats.free);
+			Assert::IsTrue(0.0 <= stats.fragmentation() && stats.fragmentation() <= 1.0);
+
+			winstd::heap_stats prefix;
+			Assert::IsTrue(heap.stats(prefix, 10));
+			Assert::IsTrue(prefix.truncated);
+			Assert::IsTrue(prefix.blocks <= 10);
+			Assert::IsTrue(prefix.committed > 0);
+
+			// A limit reaching the end of the heap does not truncate the walk.
+			size_t entries = 0;
+			PROCESS_HEAP_ENTRY e = {};
+			Assert::IsTrue(!!HeapLock(heap));
+			while (HeapWalk(heap, &e))
+				entries++;
+			Assert::IsTrue(!!HeapUnlock(heap));
+			Assert::IsTrue(heap.stats(prefix, entries));
+			Assert::IsFalse(prefix.truncated);
+			Assert::AreEqual(stats.blocks, prefix.blocks);
+		}
+
+#ifdef __cpp_lib_memory_resource
+		TEST_METHOD(memory_resource)
+		{
+			winstd::heap heap(HeapCreate(0, 0, 0));
+			Assert::IsTrue(!!heap);
+			{
+				winstd::heap_memory_resource res(heap);
+				Assert::IsTrue(res == winstd::heap_memory_resource(heap));
+				Assert::IsFalse(res == winstd::heap_memory_resource(GetProcessHeap()));
+				std::pmr::map<int, std::pmr::string> m(&res);
+				for (int i = 0; i < 1000; ++i)
+					m.emplace(i, std::pmr::string(100, 'x'));
+				Assert::AreEqual<size_t>(100, m[999].size());
+
+				// Over-aligned blocks
+				void* p = res.allocate(100, 0x100);
+				Assert::AreEqual<uintptr_t>(0, reinterpret_cast<uintptr_t>(p) & 0xff);
+				res.deallocate(p, 100, 0x100);
+			}
+			Assert::IsTrue(!!HeapValidate(heap, 0, NULL));
+
+			winstd::monotonic_vmemory_resource arena(0x1000000);
+			Assert::IsTrue(!!arena);
+			for (int round = 0; round < 3; ++round) {
+				{
+					std::pmr::list<std::pmr::string> l(&arena);
+					for (int i = 0; i < 1000; ++i)
+						l.emplace_back(100, 'x');
+					Assert::AreEqual<size_t>(1000, l.size());
+				}
+				Assert::IsTrue(arena.used() > 100000);
+				Assert::IsTrue(arena.committed() >= arena.used());
+				arena.release();
+				Assert::AreEqual<size_t>(0, arena.used());
+				Assert::AreEqual<size_t>(0, arena.committed());
+			}
+			void* p = arena.allocate(8, 0x40);
+			Assert::AreEqual<uintptr_t>(0, reinterpret_cast<uintptr_t>(p) & 0x3f);
+			Assert::ExpectException<std::bad_alloc>([&] { (void)arena.allocate(0x2000000); });
+
+			// Nothing can be allocated when the region could not be reserved.
+			winstd::monotonic_vmemory_resource none(SIZE_MAX);
+			Assert::IsFalse(!!none);
+			Assert::ExpectException<std::bad_alloc>([&] { (void)none.allocate(0); });
+			Assert::ExpectException<std::bad_alloc>([&] { (void)none.allocate(8); });
+		}
+#endif
+
 		TEST_METHOD(ACLsAndSIDs)
 		{
 			vector<EXPLICIT_ACCESS> eas;
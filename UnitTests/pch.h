@@ -8,6 +8,9 @@
 #define SECURITY_WIN32
 #define _WINSOCKAPI_	// Prevent inclusion of winsock.h in windows.h
 
+// The Debug configuration defines WINSTD_MOCK_BACKEND and WINSTD_BUFFER_STATS to allow tests to replace system
+// functions and count buffer use per call site. The Release configuration tests WinStd as built by default.
+
 #include <WinStd/COM.h>
 #include <WinStd/Cred.h>
 #include <WinStd/Crypt.h>
@@ -25,3 +28,6 @@
 #include <WinStd/WLAN.h>
 
 #include <CppUnitTest.h>
+#include <list>
+#include <map>
+#include <thread>
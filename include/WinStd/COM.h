@@ -191,12 +191,45 @@ namespace winstd
         }
     };
 
+    ///
+    /// Traits of bstr
+    ///
+    struct bstr_traits : basic_handle_traits<BSTR, NULL>
+    {
+        ///
+        /// Destroys the string
+        ///
+        /// \sa [SysFreeString function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms221481.aspx)
+        ///
+        static void close(_In_ BSTR h) noexcept
+        {
+            SysFreeString(h);
+        }
+
+        ///
+        /// Duplicates the string
+        ///
+        /// \param[in] h  Object handle of existing object
+        ///
+        /// \return Duplicated string
+        ///
+        /// \sa [SysAllocString function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms221458.aspx)
+        ///
+        static BSTR duplicate(_In_ BSTR h)
+        {
+            handle_type h_new = SysAllocStringLen(h, SysStringLen(h));
+            if (h_new != invalid)
+                return h_new;
+            throw std::bad_alloc();
+        }
+    };
+
     ///
     /// BSTR string wrapper
     ///
-    class bstr : public dplhandle<BSTR, NULL>
+    class bstr : public basic_dplhandle<bstr_traits>
     {
-        WINSTD_DPLHANDLE_IMPL(bstr, BSTR, NULL)
+        WINSTD_BASIC_DPLHANDLE_IMPL(bstr, bstr_traits)
 
     public:
         ///
@@ -233,17 +266,6 @@ namespace winstd
                 throw std::bad_alloc();
         }
 
-        ///
-        /// Destroys the string
-        ///
-        /// \sa [SysFreeString function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms221481.aspx)
-        ///
-        virtual ~bstr()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
         ///
         /// Returns the length of the string
         ///
@@ -253,36 +275,15 @@ namespace winstd
         {
             return SysStringLen(m_h);
         }
-
-    protected:
-        ///
-        /// Destroys the string
-        ///
-        /// \sa [SysFreeString function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms221481.aspx)
-        ///
-        void free_internal() noexcept override
-        {
-            SysFreeString(m_h);
-        }
-
-        ///
-        /// Duplicates the string
-        ///
-        /// \param[in] h  Existing string
-        ///
-        /// \return Duplicated string
-        ///
-        /// \sa [SysAllocString function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms221458.aspx)
-        ///
-        handle_type duplicate_internal(_In_ handle_type h) const override
-        {
-            handle_type h_new = SysAllocStringLen(h, SysStringLen(h));
-            if (h_new != invalid)
-                return h_new;
-            throw std::bad_alloc();
-        }
     };
 
+    ///
+    /// BSTR string wrapper sharing the object between copies
+    ///
+    /// \sa shared_dplhandle
+    ///
+    typedef shared_dplhandle<bstr_traits> shared_bstr;
+
     ///
     /// VARIANT struct wrapper
     ///
@@ -1037,33 +1038,18 @@ namespace winstd
     #pragma warning(pop)
 
     ///
-    /// SAFEARRAY string wrapper
+    /// Traits of safearray
     ///
-    class safearray : public dplhandle<SAFEARRAY*, NULL>
+    struct safearray_traits : basic_handle_traits<SAFEARRAY*, NULL>
     {
-        WINSTD_DPLHANDLE_IMPL(safearray, SAFEARRAY*, NULL)
-
-    public:
-        ///
-        /// Destroys the array
-        ///
-        /// \sa [SafeArrayDestroy function](https://learn.microsoft.com/en-us/windows/win32/api/oleauto/nf-oleauto-safearraydestroy)
-        ///
-        virtual ~safearray()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Destroys the array
         ///
         /// \sa [SafeArrayDestroy function](https://learn.microsoft.com/en-us/windows/win32/api/oleauto/nf-oleauto-safearraydestroy)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ SAFEARRAY* h) noexcept
         {
-            SafeArrayDestroy(m_h);
+            SafeArrayDestroy(h);
         }
 
         ///
@@ -1075,7 +1061,7 @@ namespace winstd
         ///
         /// \sa [SysAllocString function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms221458.aspx)
         ///
-        handle_type duplicate_internal(_In_ handle_type h) const override
+        static SAFEARRAY* duplicate(_In_ SAFEARRAY* h)
         {
             handle_type h_new;
             HRESULT hr = SafeArrayCopy(h, &h_new);
@@ -1085,6 +1071,18 @@ namespace winstd
         }
     };
 
+    ///
+    /// SAFEARRAY string wrapper
+    ///
+    typedef basic_dplhandle<safearray_traits> safearray;
+
+    ///
+    /// SAFEARRAY wrapper sharing the object between copies
+    ///
+    /// \sa shared_dplhandle
+    ///
+    typedef shared_dplhandle<safearray_traits> shared_safearray;
+
     ///
     /// Context scope automatic SAFEARRAY (un)access
     ///
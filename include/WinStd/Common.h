@@ -6,16 +6,35 @@
 
 #pragma once
 
+#include "UTF.h"
 #include <Windows.h>
 #include <assert.h>
 #include <intsafe.h>
 #include <stdarg.h>
 #include <tchar.h>
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
+#if __has_include(<version>)
+#include <version>
+#endif
+#ifdef __cpp_lib_format
+#include <format>
+#include <iterator>
+#endif
+#ifdef __cpp_lib_memory_resource
+#include <memory_resource>
+#endif
+#ifdef __cpp_lib_span
+#include <span>
+#endif
 
 /// \defgroup WinStdGeneral General
 ///
@@ -26,6 +45,9 @@
 /// // Please note the PCSTR typecasting invokes an operator to return
 /// // pointer to formatted buffer rather than class reference itself.
 /// cout << (PCSTR)(winstd::string_printf("%i is less than %i.\n", 1, 5));
+///
+/// // C++20: Template is checked against the arguments at compile time.
+/// cout << winstd::string_format("{} is less than {}.\n", 1, 5);
 /// \endcode
 ///
 /// \defgroup WinStdSysHandles System Handles
@@ -33,6 +55,16 @@
 /// \defgroup WinStdExceptions Exceptions
 ///
 /// \defgroup WinStdMemSanitize Auto-sanitize Memory Management
+///
+/// \defgroup WinStdBackend System Function Backend
+///
+/// \par Example
+/// \code
+/// // Compile with WINSTD_MOCK_BACKEND defined before including WinStd.
+/// static int WINAPI fake_WideCharToMultiByte(UINT, DWORD, LPCWCH, int, LPSTR, int, LPCCH, LPBOOL) { ... }
+///
+/// winstd::backend_override<decltype(winstd::backend::WideCharToMultiByte)> fake(winstd::backend::WideCharToMultiByte, fake_WideCharToMultiByte);
+/// \endcode
 
 /// \addtogroup WinStdGeneral
 /// @{
@@ -91,9 +123,76 @@ private: \
 /// \note
 /// Decrease this value in case of stack overflow.
 ///
+/// \sa winstd::default_buffer_policy
+///
 #define WINSTD_STACK_BUFFER_BYTES  1024
 #endif
 
+#ifndef WINSTD_FORMAT_BUFFER_BYTES
+///
+/// Largest capacity in bytes a formatting buffer retains between uses
+///
+/// Formatting buffers keep their capacity to avoid heap allocations on
+/// subsequent use. When a buffer outgrows this limit, its memory is released
+/// on reset, so a single huge message does not pin a large block on the
+/// thread forever.
+///
+/// \sa winstd::basic_format_buffer
+///
+#define WINSTD_FORMAT_BUFFER_BYTES  0x10000
+#endif
+
+#ifndef WINSTD_MESSAGE_CACHE_SIZE
+///
+/// Maximum number of message texts kept by the process-wide message cache
+///
+/// \sa winstd::message_cache
+///
+#define WINSTD_MESSAGE_CACHE_SIZE  256
+#endif
+
+#ifndef WINSTD_BUFFER_STATS_MAX_SITES
+///
+/// Maximum number of distinct call sites buffer statistics are collected for
+///
+/// Each thread using instrumented helpers keeps a block of counters sized by
+/// this value. Sites registering beyond the limit are not counted.
+///
+/// \sa winstd::buffer_stats_registry
+///
+#define WINSTD_BUFFER_STATS_MAX_SITES  64
+#endif
+
+#ifdef WINSTD_BUFFER_STATS
+///
+/// Names the helper function buffer statistics of the current scope are collected for
+///
+/// \param[in] name  Call site name
+///
+/// \sa winstd::buffer_stats_registry
+///
+#define WINSTD_BUFFER_SITE(name) \
+    static const size_t _winstd_buffer_site = winstd::buffer_stats_registry::instance().site(name); \
+    const winstd::buffer_site_scope _winstd_buffer_site_scope(_winstd_buffer_site)
+
+///
+/// Records buffer use of a helper function call to the current call site
+///
+/// \param[in] stack_hit     `true` when the stack buffer sufficed
+/// \param[in] heap_retries  Number of attempts made using heap-allocated output
+/// \param[in] bytes         Number of bytes of heap-allocated output
+/// \param[in] calls         Number of system function calls made
+///
+/// \sa winstd::buffer_stats_registry
+///
+#define WINSTD_BUFFER_RECORD(stack_hit, heap_retries, bytes, calls) \
+    winstd::buffer_stats_registry::instance().record((stack_hit), (heap_retries), (bytes), (calls))
+#else
+#define WINSTD_BUFFER_SITE(name)
+#define WINSTD_BUFFER_RECORD(stack_hit, heap_retries, bytes, calls) \
+    ((void)(stack_hit), (void)(heap_retries), (void)(bytes), (void)(calls))
+#endif
+
 /// @}
 
 /// \addtogroup WinStdStrFormat
@@ -184,6 +283,106 @@ public: \
     C& operator=(_Inout_        C &&h) noexcept                                                  { dplhandle<T, INVAL>::operator=(std::move(h)); return *this; } \
 private:
 
+///
+/// Implements default constructors and operators of classes derived from winstd::basic_handle.
+///
+#define WINSTD_BASIC_HANDLE_IMPL(C, TRAITS) \
+public: \
+       C        (                                       ) noexcept                                        {} \
+       C        (_In_opt_ typename TRAITS::handle_type h) noexcept : basic_handle<TRAITS>(          h )  {} \
+       C        (_Inout_  C                          &&h) noexcept : basic_handle<TRAITS>(std::move(h))  {} \
+    C& operator=(_In_opt_ typename TRAITS::handle_type h) noexcept { basic_handle<TRAITS>::operator=(          h ); return *this; } \
+    C& operator=(_Inout_  C                          &&h) noexcept { basic_handle<TRAITS>::operator=(std::move(h)); return *this; } \
+WINSTD_NONCOPYABLE(C)
+
+///
+/// Implements default constructors and operators of classes derived from winstd::basic_dplhandle.
+///
+#define WINSTD_BASIC_DPLHANDLE_IMPL(C, TRAITS) \
+public: \
+       C        (                                       ) noexcept                                           {} \
+       C        (_In_opt_ typename TRAITS::handle_type h) noexcept : basic_dplhandle<TRAITS>(          h )  {} \
+       C        (_In_     const C                     &h)          : basic_dplhandle<TRAITS>(          h )  {} \
+       C        (_Inout_  C                          &&h) noexcept : basic_dplhandle<TRAITS>(std::move(h))  {} \
+    C& operator=(_In_opt_ typename TRAITS::handle_type h) noexcept { basic_dplhandle<TRAITS>::operator=(          h ); return *this; } \
+    C& operator=(_In_     const C                     &h)          { basic_dplhandle<TRAITS>::operator=(          h ); return *this; } \
+    C& operator=(_Inout_  C                          &&h) noexcept { basic_dplhandle<TRAITS>::operator=(std::move(h)); return *this; } \
+private:
+
+/// @}
+
+/// \addtogroup WinStdBackend
+/// @{
+
+#ifdef WINSTD_MOCK_BACKEND
+
+///
+/// Declares a replaceable pointer to system function \p fn as `winstd::backend::fn`
+///
+/// The pointer initially points to the system function. Must be used before WinStd declares its own overloads of \p fn.
+///
+#define WINSTD_BACKEND_FN(fn) namespace winstd { namespace backend { inline decltype(&::fn) fn = &::fn; } }
+
+///
+/// Resolves system function \p fn through the `winstd::backend` function table
+///
+/// Define `WINSTD_MOCK_BACKEND` before including WinStd to make the system functions WinStd helpers call replaceable
+/// by tests and benchmarks. Without it, \p fn is called directly.
+///
+#define WINSTD_BACKEND(fn) (*winstd::backend::fn)
+
+namespace winstd
+{
+    ///
+    /// Replaces a `winstd::backend` function for the lifetime of the object
+    ///
+    /// \note Fakes must use the `WINAPI` calling convention of the function they replace. Replacing functions is not
+    /// thread-safe. Replace them before starting the code under test.
+    ///
+    template <class T>
+    class backend_override
+    {
+        WINSTD_NONCOPYABLE(backend_override)
+        WINSTD_NONMOVABLE(backend_override)
+
+    public:
+        ///
+        /// Replaces the function
+        ///
+        /// \param[inout] fn    `winstd::backend` function pointer
+        /// \param[in]    fake  Replacement function
+        ///
+        backend_override(_Inout_ T &fn, _In_ T fake) noexcept : m_fn(fn), m_original(fn)
+        {
+            fn = fake;
+        }
+
+        ///
+        /// Restores the original function
+        ///
+        ~backend_override()
+        {
+            m_fn = m_original;
+        }
+
+    protected:
+        T &m_fn;        ///< Replaced function pointer
+        T m_original;   ///< Original function
+    };
+}
+
+#else
+
+#define WINSTD_BACKEND_FN(fn)
+#define WINSTD_BACKEND(fn) ::fn
+
+#endif
+
+WINSTD_BACKEND_FN(WideCharToMultiByte)
+WINSTD_BACKEND_FN(MultiByteToWideChar)
+WINSTD_BACKEND_FN(FormatMessageA)
+WINSTD_BACKEND_FN(FormatMessageW)
+
 /// @}
 
 #ifndef _FormatMessage_format_string_
@@ -240,1649 +439,5511 @@ inline SIZE_T SIZETAdd(SIZE_T a, SIZE_T b)
 }
 #endif
 
-/// \addtogroup WinStdStrFormat
-/// @{
-
-///
-/// Formats string using `printf()`.
-///
-/// \param[out] str     Formatted string
-/// \param[in ] format  String template using `printf()` style
-/// \param[in ] arg     Arguments to `format`
-///
-/// \returns Number of characters in result.
-///
-template<class _Traits, class _Ax>
-static int vsprintf(_Inout_ std::basic_string<char, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const char *format, _In_ va_list arg)
+namespace winstd
 {
-    char buf[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
+    /// \addtogroup WinStdMemSanitize
+    /// @{
 
-    // Try with stack buffer first.
-    int count = _vsnprintf(buf, _countof(buf), format, arg);
-    if (0 <= count && count < _countof(buf)) {
-        // Copy from stack.
-        str.append(buf, count);
-        return count;
-    }
-    if (count < 0) {
-        switch (errno) {
-        case 0:
-            count = _vsnprintf(NULL, 0, format, arg);
-            assert(count >= 0);
-            break;
-        case EINVAL: throw std::invalid_argument("invalid vsnprintf arguments");
-        case EILSEQ: throw std::runtime_error("encoding error");
-        default: throw std::runtime_error("failed to format string");
+    ///
+    /// Wipes memory with zeros in a way the compiler cannot optimize away
+    ///
+    /// Unlike SecureZeroMemory(), which writes one byte at a time through a volatile pointer, the memory is cleared using
+    /// the widest vector stores available. The pointer is then passed to an opaque function, so the compiler must assume
+    /// the memory is read afterwards and cannot elide the stores.
+    ///
+    /// \param[out] data  Memory to wipe
+    /// \param[in ] size  Number of bytes
+    ///
+    inline void secure_wipe(_Out_writes_bytes_all_(size) void *data, _In_ size_t size) noexcept
+    {
+        unsigned char *p = static_cast<unsigned char*>(data);
+#if defined(WINSTD_AVX)
+        const __m256i zero = _mm256_setzero_si256();
+        if (size >= 32) {
+            for (unsigned char *end = p + size - 32; p < end; p += 32)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), zero);
+            // Overlap the last store with the previous one rather than finishing byte-by-byte.
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<unsigned char*>(data) + size - 32), zero);
+            size = 0;
         }
-    }
-    size_t offset = str.size();
-    str.resize(offset + count);
-    if (_vsnprintf(&str[offset], count + 1, format, arg) != count)
-        throw std::runtime_error("failed to format string");
-    return count;
-}
-
-///
-/// Formats string using `printf()`.
-///
-/// \param[out] str     Formatted string
-/// \param[in ] format  String template using `printf()` style
-/// \param[in ] arg     Arguments to `format`
-///
-/// \returns Number of characters in result.
-///
-template<class _Traits, class _Ax>
-static int vsprintf(_Inout_ std::basic_string<wchar_t, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const wchar_t *format, _In_ va_list arg)
-{
-    wchar_t buf[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
+#elif defined(WINSTD_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        if (size >= 16) {
+            unsigned char *end = p + size - 16;
+            for (; p + 48 < end; p += 64) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p     ), zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16), zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 32), zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 48), zero);
+            }
+            for (; p < end; p += 16)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p), zero);
+            // Overlap the last store with the previous one rather than finishing byte-by-byte.
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(end), zero);
+            size = 0;
+        }
+#endif
+        for (; size; --size)
+            *p++ = 0;
 
-    // Try with stack buffer first.
-    int count = _vsnwprintf(buf, _countof(buf), format, arg);
-    if (0 <= count && count < _countof(buf)) {
-        // Copy from stack.
-        str.append(buf, count);
-        return count;
+        static void (* volatile const barrier)(_In_ const void*) noexcept = [](_In_ const void*) noexcept {};
+        barrier(data);
     }
-    if (count < 0) {
-        switch (errno) {
-        case 0:
-            count = _vsnwprintf(NULL, 0, format, arg);
-            assert(count >= 0);
-            break;
-        case EINVAL: throw std::invalid_argument("invalid vsnprintf arguments");
-        case EILSEQ: throw std::runtime_error("encoding error");
-        default: throw std::runtime_error("failed to format string");
-        }
+
+#ifdef __cpp_lib_span
+    ///
+    /// Wipes memory with zeros in a way the compiler cannot optimize away
+    ///
+    /// \param[out] data  Memory to wipe
+    ///
+    template<class _Ty, size_t _Extent>
+    void secure_wipe(_Out_ std::span<_Ty, _Extent> data) noexcept
+    {
+        secure_wipe(data.data(), data.size_bytes());
     }
-    size_t offset = str.size();
-    str.resize(offset + count);
-    if (_vsnwprintf(&str[offset], count + 1, format, arg) != count)
-        throw std::runtime_error("failed to format string");
-    return count;
-}
+#endif
 
-///
-/// Formats string using `printf()`.
-///
-/// \param[out] str     Formatted string
-/// \param[in ] format  String template using `printf()` style
-///
-/// \returns Number of characters in result.
-///
-template<class _Elem, class _Traits, class _Ax>
-static int sprintf(_Inout_ std::basic_string<_Elem, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const _Elem *format, ...)
-{
-    va_list arg;
-    va_start(arg, format);
-    const int res = vsprintf(str, format, arg);
-    va_end(arg);
-    return res;
-}
+    /// @}
 
-///
-/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
-///
-/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
-///
-template<class _Traits, class _Ax>
-static _Success_(return != 0) int WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::basic_string<char, _Traits, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
-{
-    CHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(CHAR)];
+    /// \addtogroup WinStdGeneral
+    /// @{
 
-    // Try to convert to stack buffer first.
-    int cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, szStackBuffer, _countof(szStackBuffer), lpDefaultChar, lpUsedDefaultChar);
-    if (cch) {
-        // Copy from stack. Be careful not to include zero terminator.
-        sMultiByteStr.assign(szStackBuffer, cchWideChar != -1 ? strnlen(szStackBuffer, cch) : (size_t)cch - 1);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, NULL, 0, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cch);
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, &sMultiByteStr[0], cch, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cchWideChar != -1 ? strnlen(&sMultiByteStr[0], cch) : (size_t)cch - 1);
-    }
+    ///
+    /// Sizing policy of probe_then_fill() matching the classic stack-first/heap-retry behaviour
+    ///
+    /// Derive from this structure and override individual members to tune the policy for a particular call site.
+    ///
+    struct default_buffer_policy
+    {
+        static const size_t stack_bytes = WINSTD_STACK_BUFFER_BYTES;  ///< Size of the stack buffer in bytes
+        static const size_t growth_factor = 2;                        ///< Capacity multiplier when the system function does not report the required size
+        static const size_t max_calls = 10;                           ///< Maximum number of system function calls before giving up
+        static const bool in_place = false;                           ///< Skip the stack buffer and write into the output directly
+        static const bool sanitize = false;                           ///< Wipe the stack buffer and discarded output using secure_wipe()
+        static const bool adaptive = false;                           ///< Start with the capacity the previous call on this thread needed
+        static const size_t max_hint_bytes = 0x10000;                 ///< Largest capacity in bytes an adaptive call site remembers
+    };
 
-    return cch;
-}
+    ///
+    /// Sizing policy of probe_then_fill() writing into the output directly
+    ///
+    /// Saves copying from the stack buffer at the cost of allocating the estimated output size on heap up front.
+    ///
+    struct in_place_buffer_policy : public default_buffer_policy
+    {
+        static const bool in_place = true;  ///< Skip the stack buffer and write into the output directly
+    };
 
-///
-/// Maps a UTF-16 (wide character) string to a std::vector. The new character vector is not necessarily from a multibyte character set.
-///
-/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
-///
-template<class _Ax>
-static _Success_(return != 0) int WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::vector<char, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
-{
-    CHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(CHAR)];
+    ///
+    /// Sizing policy of probe_then_fill() for sensitive data
+    ///
+    struct sanitizing_buffer_policy : public default_buffer_policy
+    {
+        static const bool sanitize = true;  ///< Wipe the stack buffer and discarded output using secure_wipe()
+    };
 
-    // Try to convert to stack buffer first.
-    int cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, szStackBuffer, _countof(szStackBuffer), lpDefaultChar, lpUsedDefaultChar);
-    if (cch) {
-        // Copy from stack.
-        sMultiByteStr.assign(szStackBuffer, szStackBuffer + cch);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, NULL, 0, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cch);
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, sMultiByteStr.data(), cch, lpDefaultChar, lpUsedDefaultChar);
-    }
+    ///
+    /// Sizing policy of probe_then_fill() remembering the required capacity per helper instantiation
+    ///
+    /// Repeated queries of the same data, like the same registry values or the same certificates, need about the
+    /// same capacity every time. This policy makes each thread remember the capacity the last call of a helper
+    /// needed, and start the next call with it, skipping the failing first attempt using the stack buffer. When the
+    /// output shrinks, the remembered capacity halves with every call, until the output fits the stack buffer again.
+    /// Capacities above `max_hint_bytes` are not remembered.
+    ///
+    /// The capacity is remembered per instantiation of the helper, not per call site: all calls of the same helper
+    /// with the same policy and output type on a thread share it. Queries of differently sized data through the same
+    /// helper compete for the capacity and make it decay. To give a call site its own capacity, derive a distinct
+    /// policy type for it, e.g. `struct cert_hash_policy : winstd::adaptive_buffer_policy {};`.
+    ///
+    struct adaptive_buffer_policy : public default_buffer_policy
+    {
+        static const bool adaptive = true;  ///< Start with the capacity the previous call on this thread needed
+    };
 
-    return cch;
-}
+    ///
+    /// Outcome of a probe_then_fill() attempt
+    ///
+    struct buffer_probe
+    {
+        ///
+        /// Attempt status
+        ///
+        enum status_t {
+            success = 0,    ///< Output fits the buffer
+            more_data,      ///< Buffer is too small
+            failure,        ///< System function failed for other reason
+        } status;           ///< Attempt status
+        size_t size;        ///< Number of elements written on success; required capacity on `more_data` (0 when unknown)
+        size_t calls;       ///< Number of system function calls the attempt made
 
-///
-/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
-///
-/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
-///
-template<class _Traits1, class _Ax1, class _Traits2, class _Ax2>
-static _Success_(return != 0) int WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ std::basic_string<wchar_t, _Traits1, _Ax1> sWideCharStr, _Out_ std::basic_string<char, _Traits2, _Ax2> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
-{
-    CHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(CHAR)];
+        ///
+        /// Output fits the buffer
+        ///
+        /// \param[in] size   Number of elements written
+        /// \param[in] calls  Number of system function calls made
+        ///
+        static buffer_probe ok(_In_ size_t size, _In_ size_t calls = 1) noexcept { return { success, size, calls }; }
 
-    // Try to convert to stack buffer first.
-    int cch = ::WideCharToMultiByte(CodePage, dwFlags, sWideCharStr.c_str(), (int)sWideCharStr.length(), szStackBuffer, _countof(szStackBuffer), lpDefaultChar, lpUsedDefaultChar);
-    if (cch) {
-        // Copy from stack.
-        sMultiByteStr.assign(szStackBuffer, cch);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, sWideCharStr.c_str(), (int)sWideCharStr.length(), NULL, 0, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cch);
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, sWideCharStr.c_str(), (int)sWideCharStr.length(), &sMultiByteStr[0], cch, lpDefaultChar, lpUsedDefaultChar);
-    }
-
-    return cch;
-}
+        ///
+        /// Buffer is too small
+        ///
+        /// \param[in] size   Required capacity in elements; 0 when unknown
+        /// \param[in] calls  Number of system function calls made
+        ///
+        static buffer_probe more(_In_ size_t size = 0, _In_ size_t calls = 1) noexcept { return { more_data, size, calls }; }
 
-///
-/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
-///
-/// \note This function cleans all internal buffers using SecureZeroMemory() before returning.
-///
-/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
-///
-template<class _Traits, class _Ax>
-static _Success_(return != 0) int SecureWideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::basic_string<char, _Traits, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
-{
-    CHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(CHAR)];
+        ///
+        /// System function failed for other reason
+        ///
+        /// \param[in] calls  Number of system function calls made
+        ///
+        static buffer_probe fail(_In_ size_t calls = 1) noexcept { return { failure, 0, calls }; }
+    };
 
-    // Try to convert to stack buffer first.
-    int cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, szStackBuffer, _countof(szStackBuffer), lpDefaultChar, lpUsedDefaultChar);
-    if (cch) {
-        // Copy from stack. Be careful not to include zero terminator.
-        sMultiByteStr.assign(szStackBuffer, cchWideChar != -1 ? strnlen(szStackBuffer, cch) : (size_t)cch - 1);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, NULL, 0, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cch);
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, &sMultiByteStr[0], cch, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cchWideChar != -1 ? strnlen(&sMultiByteStr[0], cch) : (size_t)cch - 1);
+    ///
+    /// Returns number of system function calls the last probe_then_fill() on the calling thread made
+    ///
+    inline size_t& last_probe_calls() noexcept
+    {
+        static thread_local size_t calls = 0;
+        return calls;
     }
 
-    SecureZeroMemory(szStackBuffer, sizeof(szStackBuffer));
-
-    return cch;
-}
-
-///
-/// Maps a UTF-16 (wide character) string to a std::vector. The new character vector is not necessarily from a multibyte character set.
-///
-/// \note This function cleans all internal buffers using SecureZeroMemory() before returning.
-///
-/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
-///
-template<class _Ax>
-static _Success_(return != 0) int SecureWideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::vector<char, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
-{
-    CHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(CHAR)];
+    ///
+    /// Buffer use counters of a call site
+    ///
+    /// \sa buffer_stats_registry
+    ///
+    struct buffer_stats
+    {
+        const char *site;           ///< Call site name
+        uint64_t invocations;       ///< Number of helper function calls
+        uint64_t stack_hits;        ///< Number of helper function calls the stack buffer sufficed for
+        uint64_t heap_retries;      ///< Number of attempts made using heap-allocated output
+        uint64_t bytes_allocated;   ///< Total number of bytes of heap-allocated output
+        uint64_t system_calls;      ///< Number of system function calls
+    };
 
-    // Try to convert to stack buffer first.
-    int cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, szStackBuffer, _countof(szStackBuffer), lpDefaultChar, lpUsedDefaultChar);
-    if (cch) {
-        // Copy from stack.
-        sMultiByteStr.assign(szStackBuffer, szStackBuffer + cch);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, NULL, 0, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cch);
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, lpWideCharStr, cchWideChar, sMultiByteStr.data(), cch, lpDefaultChar, lpUsedDefaultChar);
-    }
+#ifdef WINSTD_BUFFER_STATS
+    ///
+    /// Process-wide per-call-site buffer use counters
+    ///
+    /// Define `WINSTD_BUFFER_STATS` to have helper functions count stack buffer hits, heap retries, heap-allocated
+    /// bytes and system function calls per call site. Counting is lock-free: each thread owns a block of counters it
+    /// alone writes to, and stats() sums the blocks on read. Blocks of terminated threads are reused by new threads,
+    /// so their counts are never lost.
+    ///
+    /// \sa WINSTD_BUFFER_SITE, WINSTD_BUFFER_RECORD
+    ///
+    class buffer_stats_registry
+    {
+        WINSTD_NONCOPYABLE(buffer_stats_registry)
+        WINSTD_NONMOVABLE(buffer_stats_registry)
 
-    SecureZeroMemory(szStackBuffer, sizeof(szStackBuffer));
+    public:
+        ///
+        /// Site ID of no call site
+        ///
+        static const size_t no_site = WINSTD_BUFFER_STATS_MAX_SITES;
 
-    return cch;
-}
+        ///
+        /// Returns the process-wide registry
+        ///
+        static buffer_stats_registry& instance()
+        {
+            static buffer_stats_registry registry;
+            return registry;
+        }
 
-///
-/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
-///
-/// \note This function cleans all internal buffers using SecureZeroMemory() before returning.
-///
-/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
-///
-template<class _Traits1, class _Ax1, class _Traits2, class _Ax2>
-static _Success_(return != 0) int SecureWideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _Out_ std::basic_string<wchar_t, _Traits1, _Ax1> sWideCharStr, _Out_ std::basic_string<char, _Traits2, _Ax2> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
-{
-    CHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(CHAR)];
+        ///
+        /// Registers a call site
+        ///
+        /// Registering the same name again returns the same site ID.
+        ///
+        /// \param[in] name  Call site name. Must remain valid for the lifetime of the process.
+        ///
+        /// \return Site ID; `no_site` when the registry is full
+        ///
+        size_t site(_In_z_ const char *name) noexcept
+        {
+            for (size_t i = 0; i < WINSTD_BUFFER_STATS_MAX_SITES; ++i) {
+                const char *n = m_names[i].load(std::memory_order_acquire);
+                if (!n && m_names[i].compare_exchange_strong(n, name, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return i;
+                if (strcmp(n, name) == 0)
+                    return i;
+            }
+            return no_site;
+        }
 
-    // Try to convert to stack buffer first.
-    int cch = ::WideCharToMultiByte(CodePage, dwFlags, sWideCharStr.c_str(), (int)sWideCharStr.length(), szStackBuffer, _countof(szStackBuffer), lpDefaultChar, lpUsedDefaultChar);
-    if (cch) {
-        // Copy from stack.
-        sMultiByteStr.assign(szStackBuffer, cch);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, sWideCharStr.c_str(), (int)sWideCharStr.length(), NULL, 0, lpDefaultChar, lpUsedDefaultChar);
-        sMultiByteStr.resize(cch);
-        cch = ::WideCharToMultiByte(CodePage, dwFlags, sWideCharStr.c_str(), (int)sWideCharStr.length(), &sMultiByteStr[0], cch, lpDefaultChar, lpUsedDefaultChar);
-    }
+        ///
+        /// Records buffer use of a helper function call to the current call site of the calling thread
+        ///
+        /// \param[in] stack_hit     `true` when the stack buffer sufficed
+        /// \param[in] heap_retries  Number of attempts made using heap-allocated output
+        /// \param[in] bytes         Number of bytes of heap-allocated output
+        /// \param[in] calls         Number of system function calls made
+        ///
+        void record(_In_ bool stack_hit, _In_ size_t heap_retries, _In_ size_t bytes, _In_ size_t calls) noexcept
+        {
+            const size_t site = current_site();
+            if (site == no_site)
+                return;
+            thread_block *b = thread_slot();
+            if (!b)
+                return;
+            std::atomic<uint64_t> *c = b->counters[site];
+            bump(c[0], 1);
+            bump(c[1], stack_hit ? 1 : 0);
+            bump(c[2], heap_retries);
+            bump(c[3], bytes);
+            bump(c[4], calls);
+        }
 
-    SecureZeroMemory(szStackBuffer, sizeof(szStackBuffer));
+        ///
+        /// Returns counters of all registered call sites
+        ///
+        std::vector<buffer_stats> stats() const
+        {
+            std::vector<buffer_stats> result;
+            for (size_t i = 0; i < WINSTD_BUFFER_STATS_MAX_SITES; ++i) {
+                const char *n = m_names[i].load(std::memory_order_acquire);
+                if (!n)
+                    break;
+                buffer_stats s = { n, 0, 0, 0, 0, 0 };
+                for (thread_block *b = m_blocks.load(std::memory_order_acquire); b; b = b->next) {
+                    const std::atomic<uint64_t> *c = b->counters[i];
+                    s.invocations += c[0].load(std::memory_order_relaxed);
+                    s.stack_hits += c[1].load(std::memory_order_relaxed);
+                    s.heap_retries += c[2].load(std::memory_order_relaxed);
+                    s.bytes_allocated += c[3].load(std::memory_order_relaxed);
+                    s.system_calls += c[4].load(std::memory_order_relaxed);
+                }
+                result.push_back(s);
+            }
+            return result;
+        }
 
-    return cch;
-}
+        ///
+        /// Returns counters of a call site
+        ///
+        /// \param[in] name  Call site name
+        ///
+        /// \return Counters; all zero when the call site was never registered
+        ///
+        buffer_stats stats(_In_z_ const char *name) const
+        {
+            for (const auto &s : stats())
+                if (strcmp(s.site, name) == 0)
+                    return s;
+            return { name, 0, 0, 0, 0, 0 };
+        }
 
-///
-/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
-///
-/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
-///
-template<class _Traits, class _Ax>
-static _Success_(return != 0) int MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sWideCharStr) noexcept
-{
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(WCHAR)];
+        /// \cond internal
 
-    // Try to convert to stack buffer first.
-    int cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, szStackBuffer, _countof(szStackBuffer));
-    if (cch) {
-        // Copy from stack.
-        sWideCharStr.assign(szStackBuffer, cbMultiByte != -1 ? wcsnlen(szStackBuffer, cch) : (size_t)cch - 1);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, NULL, 0);
-        sWideCharStr.resize(cch);
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, &sWideCharStr[0], cch);
-        sWideCharStr.resize(cbMultiByte != -1 ? wcsnlen(&sWideCharStr[0], cch) : (size_t)cch - 1);
-    }
+        static size_t& current_site() noexcept
+        {
+            static thread_local size_t site = no_site;
+            return site;
+        }
 
-    return cch;
-}
+    protected:
+        buffer_stats_registry() noexcept : m_blocks(nullptr)
+        {
+            for (auto &n : m_names)
+                n.store(nullptr, std::memory_order_relaxed);
+        }
 
-///
-/// Maps a character string to a UTF-16 (wide character) std::vector. The character vector is not necessarily from a multibyte character set.
-///
-/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
-///
-template<class _Ax>
-static _Success_(return != 0) int MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::vector<wchar_t, _Ax> &sWideCharStr) noexcept
-{
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(WCHAR)];
+        struct thread_block
+        {
+            std::atomic<uint64_t> counters[WINSTD_BUFFER_STATS_MAX_SITES][5];
+            std::atomic<bool> in_use;
+            thread_block *next;
+        };
 
-    // Try to convert to stack buffer first.
-    int cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, szStackBuffer, _countof(szStackBuffer));
-    if (cch) {
-        // Copy from stack.
-        sWideCharStr.assign(szStackBuffer, szStackBuffer + cch);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, NULL, 0);
-        sWideCharStr.resize(cch);
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, sWideCharStr.data(), cch);
-    }
+        struct thread_owner
+        {
+            thread_block *block = nullptr;
 
-    return cch;
-}
+            ~thread_owner()
+            {
+                if (block)
+                    block->in_use.store(false, std::memory_order_release);
+            }
+        };
 
-///
-/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
-///
-/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
-///
-template<class _Traits1, class _Ax1, class _Traits2, class _Ax2>
-static _Success_(return != 0) int MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ const std::basic_string<char, _Traits1, _Ax1> &sMultiByteStr, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sWideCharStr) noexcept
-{
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(WCHAR)];
+        thread_block* thread_slot() noexcept
+        {
+            static thread_local thread_owner owner;
+            if (!owner.block)
+                owner.block = claim();
+            return owner.block;
+        }
 
-    // Try to convert to stack buffer first.
-    int cch = ::MultiByteToWideChar(CodePage, dwFlags, sMultiByteStr.c_str(), (int)sMultiByteStr.length(), szStackBuffer, _countof(szStackBuffer));
-    if (cch) {
-        // Copy from stack.
-        sWideCharStr.assign(szStackBuffer, cch);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, sMultiByteStr.c_str(), (int)sMultiByteStr.length(), NULL, 0);
-        sWideCharStr.resize(cch);
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, sMultiByteStr.c_str(), (int)sMultiByteStr.length(), &sWideCharStr[0], cch);
-    }
+        thread_block* claim() noexcept
+        {
+            // Reuse a block of a terminated thread first.
+            for (thread_block *b = m_blocks.load(std::memory_order_acquire); b; b = b->next) {
+                bool in_use = false;
+                if (!b->in_use.load(std::memory_order_relaxed) && b->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+                    return b;
+            }
 
-    return cch;
-}
+            // Blocks are never freed, as stats() may be reading them at any time.
+            thread_block *b = new (std::nothrow) thread_block();
+            if (!b)
+                return nullptr;
+            b->in_use.store(true, std::memory_order_relaxed);
+            b->next = m_blocks.load(std::memory_order_relaxed);
+            while (!m_blocks.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed));
+            return b;
+        }
 
-///
-/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
-///
-/// \note This function cleans all internal buffers using SecureZeroMemory() before returning.
-///
-/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
-///
-template<class _Traits, class _Ax>
-static _Success_(return != 0) int SecureMultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sWideCharStr) noexcept
-{
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(WCHAR)];
+        static void bump(_Inout_ std::atomic<uint64_t> &counter, _In_ uint64_t value) noexcept
+        {
+            // The block is written by the owning thread only.
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
 
-    // Try to convert to stack buffer first.
-    int cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, szStackBuffer, _countof(szStackBuffer));
-    if (cch) {
-        // Copy from stack.
-        sWideCharStr.assign(szStackBuffer, cbMultiByte != -1 ? wcsnlen(szStackBuffer, cch) : (size_t)cch - 1);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, NULL, 0);
-        sWideCharStr.resize(cch);
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, &sWideCharStr[0], cch);
-        sWideCharStr.resize(cbMultiByte != -1 ? wcsnlen(&sWideCharStr[0], cch) : (size_t)cch - 1);
-    }
+        /// \endcond
 
-    SecureZeroMemory(szStackBuffer, sizeof(szStackBuffer));
+    protected:
+        std::atomic<const char*> m_names[WINSTD_BUFFER_STATS_MAX_SITES];  ///< Registered call site names
+        std::atomic<thread_block*> m_blocks;                              ///< List of per-thread counter blocks
+    };
 
-    return cch;
-}
+    ///
+    /// Makes a call site current on the calling thread for the lifetime of the object
+    ///
+    /// \sa WINSTD_BUFFER_SITE
+    ///
+    class buffer_site_scope
+    {
+        WINSTD_NONCOPYABLE(buffer_site_scope)
+        WINSTD_NONMOVABLE(buffer_site_scope)
 
-///
-/// Maps a character string to a UTF-16 (wide character) std::vector. The character vector is not necessarily from a multibyte character set.
-///
-/// \note This function cleans all internal buffers using SecureZeroMemory() before returning.
-///
-/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
-///
-template<class _Ax>
-static _Success_(return != 0) int SecureMultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::vector<wchar_t, _Ax> &sWideCharStr) noexcept
-{
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(WCHAR)];
+    public:
+        ///
+        /// Makes a call site current
+        ///
+        /// \param[in] site  Site ID as returned by buffer_stats_registry::site()
+        ///
+        buffer_site_scope(_In_ size_t site) noexcept : m_previous(buffer_stats_registry::current_site())
+        {
+            buffer_stats_registry::current_site() = site;
+        }
 
-    // Try to convert to stack buffer first.
-    int cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, szStackBuffer, _countof(szStackBuffer));
-    if (cch) {
-        // Copy from stack.
-        sWideCharStr.assign(szStackBuffer, szStackBuffer + cch);
-    }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, NULL, 0);
-        sWideCharStr.resize(cch);
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, sWideCharStr.data(), cch);
-    }
+        ///
+        /// Restores the previously current call site
+        ///
+        ~buffer_site_scope()
+        {
+            buffer_stats_registry::current_site() = m_previous;
+        }
 
-    SecureZeroMemory(szStackBuffer, sizeof(szStackBuffer));
+    protected:
+        size_t m_previous;  ///< Previously current call site
+    };
+#endif
 
-    return cch;
-}
+    ///
+    /// Calls a system function with variable length output repeatedly until the output fits
+    ///
+    /// Unless the policy requests in-place writing or the hint exceeds it, the first attempt is made using a stack buffer,
+    /// which is copied to the output when the data fits. Further attempts write into the output directly, sized as
+    /// reported by the system function, or grown by the policy growth factor when the system function does not report
+    /// the required size.
+    ///
+    /// \param[out] out   Output std::basic_string or std::vector. Replaced on success, cleared on failure.
+    /// \param[in ] fn    Function making the attempt: `buffer_probe fn(_Elem *buf, size_t capacity)`
+    /// \param[in ] hint  Estimated output capacity in elements; 0 when unknown. Adaptive policies use the capacity the
+    ///                   previous call of this instantiation on this thread needed instead.
+    ///
+    /// \return
+    /// - `true` when the output was filled;
+    /// - `false` when the system function failed or the policy call limit was reached.
+    ///
+    /// \sa last_probe_calls(), buffer_stats_registry, adaptive_buffer_policy
+    ///
+    template<class _Policy = default_buffer_policy, class _Container, class _Fn>
+    bool probe_then_fill(_Inout_ _Container &out, _In_ _Fn &&fn, _In_ size_t hint = 0)
+    {
+        typedef typename _Container::value_type _Elem;
+        const size_t stack_capacity = _Policy::stack_bytes / sizeof(_Elem);
+        size_t calls = 0, capacity, heap_retries = 0, bytes = 0;
+        buffer_probe r;
+
+        size_t *site_hint = NULL;
+        if constexpr (_Policy::adaptive) {
+            // One hint per instantiation: shared by all calls of a helper with the same policy and output type.
+            static thread_local size_t cached_hint = 0;
+            site_hint = &cached_hint;
+            if (!hint)
+                hint = cached_hint;
+        }
 
-///
-/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
-///
-/// \note This function cleans all internal buffers using SecureZeroMemory() before returning.
-///
-/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
-///
-template<class _Traits1, class _Ax1, class _Traits2, class _Ax2>
-static _Success_(return != 0) int SecureMultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ const std::basic_string<char, _Traits1, _Ax1> &sMultiByteStr, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sWideCharStr) noexcept
-{
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(WCHAR)];
+        if (!_Policy::in_place && hint <= stack_capacity) {
+            // Try with stack buffer first.
+            _Elem buf[_Policy::stack_bytes / sizeof(_Elem)];
+            r = fn(buf, stack_capacity);
+            calls += r.calls;
+            if (r.status == buffer_probe::success) {
+                // Copy from stack.
+                out.assign(buf, buf + r.size);
+            }
+            if constexpr (_Policy::sanitize)
+                secure_wipe(buf, sizeof(buf));
+            if (r.status == buffer_probe::success) {
+                if (site_hint)
+                    *site_hint = 0;
+                last_probe_calls() = calls;
+                WINSTD_BUFFER_RECORD(true, 0, r.size * sizeof(_Elem), calls);
+                return true;
+            }
+            if (r.status == buffer_probe::failure) {
+                out.clear();
+                last_probe_calls() = calls;
+                WINSTD_BUFFER_RECORD(false, 0, 0, calls);
+                return false;
+            }
+            capacity = r.size > stack_capacity ? r.size : stack_capacity * _Policy::growth_factor;
+        } else
+            capacity = hint ? hint : stack_capacity;
+
+        while (calls < _Policy::max_calls) {
+            // Allocate on heap and write into the output directly.
+            if (_Policy::sanitize && !out.empty())
+                secure_wipe(&out[0], out.size() * sizeof(_Elem));
+            out.resize(capacity);
+            heap_retries++;
+            bytes += capacity * sizeof(_Elem);
+            r = fn(&out[0], capacity);
+            calls += r.calls;
+            if (r.status == buffer_probe::success) {
+                if (_Policy::sanitize && r.size < capacity)
+                    secure_wipe(&out[r.size], (capacity - r.size) * sizeof(_Elem));
+                out.resize(r.size);
+                if (site_hint) {
+                    // Remember the capacity. Decay when it proved much larger than needed.
+                    const size_t next = r.size < capacity / 2 ? capacity / 2 : capacity;
+                    *site_hint = next > stack_capacity && next <= _Policy::max_hint_bytes / sizeof(_Elem) ? next : 0;
+                }
+                last_probe_calls() = calls;
+                WINSTD_BUFFER_RECORD(false, heap_retries, bytes, calls);
+                return true;
+            }
+            if (r.status == buffer_probe::failure)
+                break;
+            capacity = r.size > capacity ? r.size : capacity * _Policy::growth_factor;
+        }
 
-    // Try to convert to stack buffer first.
-    int cch = ::MultiByteToWideChar(CodePage, dwFlags, sMultiByteStr.c_str(), (int)sMultiByteStr.length(), szStackBuffer, _countof(szStackBuffer));
-    if (cch) {
-        // Copy from stack.
-        sWideCharStr.assign(szStackBuffer, cch);
+        if (_Policy::sanitize && !out.empty())
+            secure_wipe(&out[0], out.size() * sizeof(_Elem));
+        out.clear();
+        last_probe_calls() = calls;
+        WINSTD_BUFFER_RECORD(false, heap_retries, bytes, calls);
+        return false;
     }
-    else if (::GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // Query the required output size. Allocate buffer. Then convert again.
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, sMultiByteStr.c_str(), (int)sMultiByteStr.length(), NULL, 0);
-        sWideCharStr.resize(cch);
-        cch = ::MultiByteToWideChar(CodePage, dwFlags, sMultiByteStr.c_str(), (int)sMultiByteStr.length(), &sWideCharStr[0], cch);
-    }
-
-    SecureZeroMemory(szStackBuffer, sizeof(szStackBuffer));
 
-    return cch;
-}
+    /// \cond internal
 
-///
-/// Formats a message string.
-///
-/// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
-///
-template<class _Traits, class _Ax>
-static DWORD FormatMessageA(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _Inout_ std::basic_string<char, _Traits, _Ax> &str, _In_opt_ va_list *Arguments)
-{
-	LPSTR lpBuffer;
-    DWORD dwResult = FormatMessageA(dwFlags | FORMAT_MESSAGE_ALLOCATE_BUFFER, lpSource, dwMessageId, dwLanguageId, reinterpret_cast<LPSTR>(&lpBuffer), 0, Arguments);
-    if (dwResult) {
-        str.assign(lpBuffer, dwResult);
-        LocalFree(lpBuffer);
+    template<class _Container>
+    int utf16_to_utf8_fill(_In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _In_opt_z_ LPCSTR lpDefaultChar, _In_opt_ LPBOOL lpUsedDefaultChar, _Out_ _Container &out)
+    {
+        // Anything WideCharToMultiByte() would reject or need to replace is left to the OS.
+        if ((dwFlags & ~WC_ERR_INVALID_CHARS) || lpDefaultChar || lpUsedDefaultChar || cchWideChar == 0 || cchWideChar < -1)
+            return -1;
+        const size_t count = cchWideChar != -1 ? (size_t)cchWideChar : wcslen(lpWideCharStr) + 1;
+        const size_t len = utf16_to_utf8_length(lpWideCharStr, count);
+        if (len == utf_invalid || len > INT_MAX)
+            return -1;
+        out.resize(len);
+        utf16_to_utf8(lpWideCharStr, count, &out[0]);
+        last_probe_calls() = 0;
+        WINSTD_BUFFER_RECORD(false, 0, len * sizeof(out[0]), 0);
+        return (int)len;
     }
-    return dwResult;
-}
 
-///
-/// Formats a message string.
-///
-/// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
-///
-template<class _Traits, class _Ax>
-static DWORD FormatMessageW(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _Inout_ std::basic_string<wchar_t, _Traits, _Ax> &str, _In_opt_ va_list *Arguments)
-{
-    LPWSTR lpBuffer;
-    DWORD dwResult = FormatMessageW(dwFlags | FORMAT_MESSAGE_ALLOCATE_BUFFER, lpSource, dwMessageId, dwLanguageId, reinterpret_cast<LPWSTR>(&lpBuffer), 0, Arguments);
-    if (dwResult) {
-        str.assign(lpBuffer, dwResult);
-        LocalFree(lpBuffer);
+    template<class _Container>
+    int utf8_to_utf16_fill(_In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ _Container &out)
+    {
+        // Anything MultiByteToWideChar() would reject or need to replace is left to the OS.
+        if ((dwFlags & ~MB_ERR_INVALID_CHARS) || cbMultiByte == 0 || cbMultiByte < -1)
+            return -1;
+        const size_t count = cbMultiByte != -1 ? (size_t)cbMultiByte : strlen(lpMultiByteStr) + 1;
+        const size_t len = utf8_to_utf16_length(lpMultiByteStr, count);
+        if (len == utf_invalid || len > INT_MAX)
+            return -1;
+        out.resize(len);
+        utf8_to_utf16(lpMultiByteStr, count, &out[0]);
+        last_probe_calls() = 0;
+        WINSTD_BUFFER_RECORD(false, 0, len * sizeof(out[0]), 0);
+        return (int)len;
     }
-    return dwResult;
-}
 
-/// @}
+    /// \endcond
 
-#pragma warning(pop)
+    ///
+    /// Error code carried in-band by winstd::expected
+    ///
+    typedef DWORD error_code;
 
-namespace winstd
-{
-    /// \addtogroup WinStdGeneral
+    ///
+    /// Wraps an error to construct a failed winstd::expected
+    ///
+    template<class _Err = error_code>
+    class unexpected
+    {
+    public:
+        ///
+        /// Wraps an error
+        ///
+        /// \param[in] err  Error
+        ///
+        explicit constexpr unexpected(_In_ _Err err) noexcept : m_error(err)
+        {}
+
+        ///
+        /// Returns the error
+        ///
+        constexpr const _Err& error() const noexcept
+        {
+            return m_error;
+        }
+
+    protected:
+        _Err m_error; ///< Error
+    };
+
+    ///
+    /// Holds either a value or the error that prevented computing it
+    ///
+    /// Mirrors a subset of C++23 `std::expected` for use with C++17. Functions returning it report failures in-band instead of throwing or leaving the error in `GetLastError()`.
+    ///
+    template<class _Ty, class _Err = error_code>
+    class expected
+    {
+    public:
+        ///
+        /// Constructs a successful result by copying the value
+        ///
+        /// \param[in] value  Value
+        ///
+        expected(_In_ const _Ty &value) :
+            m_value(value),
+            m_error()
+        {}
+
+        ///
+        /// Constructs a successful result by moving the value
+        ///
+        /// \param[in] value  Value
+        ///
+        expected(_Inout_ _Ty &&value) noexcept(std::is_nothrow_move_constructible_v<_Ty>) :
+            m_value(std::move(value)),
+            m_error()
+        {}
+
+        ///
+        /// Constructs a failed result
+        ///
+        /// \param[in] err  Error
+        ///
+        template<class _Err2>
+        expected(_In_ const unexpected<_Err2> &err) noexcept :
+            m_error(static_cast<_Err>(err.error()))
+        {}
+
+        ///
+        /// Returns true if the result holds a value
+        ///
+        bool has_value() const noexcept
+        {
+            return m_value.has_value();
+        }
+
+        ///
+        /// Returns true if the result holds a value
+        ///
+        explicit operator bool() const noexcept
+        {
+            return m_value.has_value();
+        }
+
+        ///
+        /// Returns the value
+        ///
+        /// \note The result must hold a value.
+        ///
+        _Ty& value() & noexcept
+        {
+            assert(m_value.has_value());
+            return *m_value;
+        }
+
+        ///
+        /// Returns the value
+        ///
+        /// \note The result must hold a value.
+        ///
+        const _Ty& value() const & noexcept
+        {
+            assert(m_value.has_value());
+            return *m_value;
+        }
+
+        ///
+        /// Returns the value
+        ///
+        /// \note The result must hold a value.
+        ///
+        _Ty&& value() && noexcept
+        {
+            assert(m_value.has_value());
+            return std::move(*m_value);
+        }
+
+        ///
+        /// Returns the value or the given default when the result holds an error
+        ///
+        template<class _Ty2>
+        _Ty value_or(_In_ _Ty2 &&def) const &
+        {
+            return m_value.has_value() ? *m_value : static_cast<_Ty>(std::forward<_Ty2>(def));
+        }
+
+        ///
+        /// Returns the value
+        ///
+        _Ty& operator*() & noexcept { return value(); }
+
+        ///
+        /// Returns the value
+        ///
+        const _Ty& operator*() const & noexcept { return value(); }
+
+        ///
+        /// Returns the value
+        ///
+        _Ty&& operator*() && noexcept { return std::move(*this).value(); }
+
+        ///
+        /// Accesses value members
+        ///
+        _Ty* operator->() noexcept { return &value(); }
+
+        ///
+        /// Accesses value members
+        ///
+        const _Ty* operator->() const noexcept { return &value(); }
+
+        ///
+        /// Returns the error
+        ///
+        /// \returns Error when the result does not hold a value; default-constructed `_Err` (`ERROR_SUCCESS`) otherwise.
+        ///
+        const _Err& error() const noexcept
+        {
+            return m_error;
+        }
+
+    protected:
+        std::optional<_Ty> m_value; ///< Value
+        _Err m_error;               ///< Error
+    };
+
+    /// \cond internal
+
+    ///
+    /// Fills an output and returns it, or the error that prevented it
+    ///
+    /// \param[in] fn  Callable taking `_Ty&` to fill. Returns `ERROR_SUCCESS` or error code.
+    ///
+    /// The `noexcept` helpers \p fn wraps report allocation failures as `ERROR_OUTOFMEMORY` themselves. Exceptions
+    /// escaping \p fn are mapped the same way: `std::bad_alloc` to `ERROR_OUTOFMEMORY`, anything else to
+    /// `ERROR_GEN_FAILURE`.
+    ///
+    template<class _Ty, class _Fn>
+    expected<_Ty> expect_fill(_In_ _Fn &&fn) noexcept
+    {
+        try {
+            _Ty out;
+            const error_code err = fn(out);
+            if (err != ERROR_SUCCESS)
+                return unexpected<error_code>(err);
+            return expected<_Ty>(std::move(out));
+        } catch (const std::bad_alloc&) {
+            return unexpected<error_code>(ERROR_OUTOFMEMORY);
+        } catch (...) {
+            return unexpected<error_code>(ERROR_GEN_FAILURE);
+        }
+    }
+
+    /// \endcond
+
+    /// @}
+
+    /// \addtogroup WinStdStrFormat
+    /// @{
+
+    ///
+    /// Reusable string formatting buffer
+    ///
+    /// The buffer retains its capacity between uses, so formatting into it makes no heap allocations once it has grown
+    /// large enough. Capacity exceeding the high-water mark is released when the buffer is reset.
+    ///
+    /// \sa sprintf(), format_to()
+    ///
+    template<class _Elem>
+    class basic_format_buffer
+    {
+        WINSTD_NONCOPYABLE(basic_format_buffer)
+        WINSTD_NONMOVABLE(basic_format_buffer)
+
+    public:
+        typedef std::basic_string<_Elem> string_type;      ///< Underlying string type
+        typedef std::basic_string_view<_Elem> view_type;   ///< Formatted string view type
+
+        class scratch; ///< Reserves the calling thread's buffer
+
+        ///
+        /// Constructs an empty buffer
+        ///
+        /// \param[in] high_water  Largest capacity in characters retained between uses
+        ///
+        basic_format_buffer(_In_ size_t high_water = WINSTD_FORMAT_BUFFER_BYTES / sizeof(_Elem)) noexcept :
+            m_high_water(high_water),
+            m_busy(false)
+        {}
+
+        ///
+        /// Clears the buffer for the next use
+        ///
+        /// Capacity exceeding the high-water mark is released.
+        ///
+        /// \returns String to format into
+        ///
+        string_type& reset() noexcept
+        {
+            if (m_str.capacity() > m_high_water)
+                string_type().swap(m_str);
+            else
+                m_str.clear();
+            return m_str;
+        }
+
+        ///
+        /// Returns the underlying string
+        ///
+        string_type& str() noexcept { return m_str; }
+
+        ///
+        /// Returns the formatted string
+        ///
+        const _Elem* c_str() const noexcept { return m_str.c_str(); }
+
+        ///
+        /// Returns the formatted string length in characters
+        ///
+        size_t size() const noexcept { return m_str.size(); }
+
+        ///
+        /// Returns the capacity in characters currently retained
+        ///
+        size_t capacity() const noexcept { return m_str.capacity(); }
+
+        ///
+        /// Returns the formatted string
+        ///
+        operator view_type() const noexcept { return view_type(m_str); }
+
+        ///
+        /// Returns the largest capacity in characters retained between uses
+        ///
+        size_t high_water() const noexcept { return m_high_water; }
+
+        ///
+        /// Sets the largest capacity in characters retained between uses
+        ///
+        void set_high_water(_In_ size_t high_water) noexcept { m_high_water = high_water; }
+
+        ///
+        /// Returns the calling thread's buffer
+        ///
+        /// \note The buffer is shared by all code running on the thread. Use scratch to reserve it.
+        ///
+        static basic_format_buffer& thread_buffer() noexcept
+        {
+            static thread_local basic_format_buffer buf;
+            return buf;
+        }
+
+    protected:
+        string_type m_str;      ///< Formatted string
+        size_t m_high_water;    ///< Largest capacity retained between uses
+        bool m_busy;            ///< Is the buffer reserved by scratch?
+    };
+
+    ///
+    /// Reserves the calling thread's buffer for the lifetime of the object
+    ///
+    /// When the thread's buffer is already reserved higher up the call stack, a private buffer is used instead. The
+    /// thread's buffer is reset on release.
+    ///
+    template<class _Elem>
+    class basic_format_buffer<_Elem>::scratch
+    {
+        WINSTD_NONCOPYABLE(scratch)
+        WINSTD_NONMOVABLE(scratch)
+
+    public:
+        ///
+        /// Reserves the buffer
+        ///
+        scratch() noexcept : m_buf(&thread_buffer())
+        {
+            if (m_buf->m_busy)
+                m_buf = &m_local;
+            else
+                m_buf->m_busy = true;
+        }
+
+        ///
+        /// Resets and releases the buffer
+        ///
+        ~scratch()
+        {
+            if (m_buf != &m_local) {
+                m_buf->reset();
+                m_buf->m_busy = false;
+            }
+        }
+
+        ///
+        /// Returns the reserved buffer
+        ///
+        basic_format_buffer& operator*() const noexcept { return *m_buf; }
+
+        ///
+        /// Returns the reserved buffer
+        ///
+        basic_format_buffer* operator->() const noexcept { return m_buf; }
+
+    protected:
+        basic_format_buffer m_local; ///< Private buffer when the thread's buffer is busy
+        basic_format_buffer *m_buf;  ///< Reserved buffer
+    };
+
+    ///
+    /// Single-byte character formatting buffer
+    ///
+    typedef basic_format_buffer<char> format_buffer;
+
+    ///
+    /// Wide character formatting buffer
+    ///
+    typedef basic_format_buffer<wchar_t> wformat_buffer;
+
+    ///
+    /// Multi-byte / Wide-character formatting buffer (according to _UNICODE)
+    ///
+#ifdef _UNICODE
+    typedef wformat_buffer tformat_buffer;
+#else
+    typedef format_buffer tformat_buffer;
+#endif
+
+    /// \cond internal
+
+    ///
+    /// Formats wide string reporting the required length on overflow like C99 `vsnprintf()` does where the C runtime
+    /// supports it, or returning -1 with `errno` 0 like `_vsnwprintf()` otherwise
+    ///
+    inline int vsnwprintf(_Out_writes_opt_(count) wchar_t *buffer, _In_ size_t count, _In_z_ _Printf_format_string_ const wchar_t *format, _In_ va_list arg)
+    {
+#ifdef _CRT_INTERNAL_PRINTF_STANDARD_SNPRINTF_BEHAVIOR
+        return __stdio_common_vswprintf(_CRT_INTERNAL_LOCAL_PRINTF_OPTIONS | _CRT_INTERNAL_PRINTF_STANDARD_SNPRINTF_BEHAVIOR, buffer, count, format, NULL, arg);
+#else
+        return _vsnwprintf(buffer, count, format, arg);
+#endif
+    }
+
+    /// \endcond
+
+    /// @}
+}
+
+/// \addtogroup WinStdStrFormat
+/// @{
+
+///
+/// Formats string using `printf()`.
+///
+/// The string is formatted into a stack buffer first. C99 `vsnprintf()` returns the required length on overflow. When the
+/// stack buffer proves insufficient, the result is formatted directly into the string again without a separate length
+/// query.
+///
+/// \param[out] str     Formatted string
+/// \param[in ] format  String template using `printf()` style
+/// \param[in ] arg     Arguments to `format`
+///
+/// \returns Number of characters in result.
+///
+template<class _Traits, class _Ax>
+static int vsprintf(_Inout_ std::basic_string<char, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const char *format, _In_ va_list arg)
+{
+    char buf[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
+
+    // Try with stack buffer first.
+    va_list arg2;
+    va_copy(arg2, arg);
+    errno = 0;
+    int count = ::vsnprintf(buf, _countof(buf), format, arg);
+    if (0 <= count && count < _countof(buf)) {
+        // Copy from stack.
+        va_end(arg2);
+        str.append(buf, count);
+        return count;
+    }
+    if (count < 0) {
+        va_end(arg2);
+        switch (errno) {
+        case EINVAL: throw std::invalid_argument("invalid vsnprintf arguments");
+        case EILSEQ: throw std::runtime_error("encoding error");
+        default: throw std::runtime_error("failed to format string");
+        }
+    }
+    size_t offset = str.size();
+    str.resize(offset + count);
+    count = ::vsnprintf(&str[offset], (size_t)count + 1, format, arg2);
+    va_end(arg2);
+    if (offset + count != str.size())
+        throw std::runtime_error("failed to format string");
+    return count;
+}
+
+///
+/// Formats string using `printf()`.
+///
+/// The string is formatted into a stack buffer first. The C runtime is asked to return the required length on
+/// overflow, so the result is formatted directly into the string on the second call. Only C runtimes not supporting
+/// this need an extra `_vscwprintf()` length query.
+///
+/// \param[out] str     Formatted string
+/// \param[in ] format  String template using `printf()` style
+/// \param[in ] arg     Arguments to `format`
+///
+/// \returns Number of characters in result.
+///
+template<class _Traits, class _Ax>
+static int vsprintf(_Inout_ std::basic_string<wchar_t, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const wchar_t *format, _In_ va_list arg)
+{
+    wchar_t buf[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
+
+    // Try with stack buffer first.
+    va_list arg2;
+    va_copy(arg2, arg);
+    errno = 0;
+    int count = winstd::vsnwprintf(buf, _countof(buf), format, arg);
+    if (0 <= count && count < _countof(buf)) {
+        // Copy from stack.
+        va_end(arg2);
+        str.append(buf, count);
+        return count;
+    }
+    if (count < 0) {
+        switch (errno) {
+        case 0: {
+            // The C runtime does not report the required length on overflow.
+            va_list arg3;
+            va_copy(arg3, arg2);
+            count = _vscwprintf(format, arg3);
+            va_end(arg3);
+            assert(count >= 0);
+            break;
+        }
+        case EINVAL: va_end(arg2); throw std::invalid_argument("invalid vsnprintf arguments");
+        case EILSEQ: va_end(arg2); throw std::runtime_error("encoding error");
+        default: va_end(arg2); throw std::runtime_error("failed to format string");
+        }
+    }
+    size_t offset = str.size();
+    str.resize(offset + count);
+    count = winstd::vsnwprintf(&str[offset], (size_t)count + 1, format, arg2);
+    va_end(arg2);
+    if (offset + count != str.size())
+        throw std::runtime_error("failed to format string");
+    return count;
+}
+
+///
+/// Formats string using `printf()`.
+///
+/// \param[out] str     Formatted string
+/// \param[in ] format  String template using `printf()` style
+///
+/// \returns Number of characters in result.
+///
+template<class _Elem, class _Traits, class _Ax>
+static int sprintf(_Inout_ std::basic_string<_Elem, _Traits, _Ax> &str, _In_z_ _Printf_format_string_ const _Elem *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    const int res = vsprintf(str, format, arg);
+    va_end(arg);
+    return res;
+}
+
+///
+/// Formats string using `printf()` into a reusable buffer.
+///
+/// \param[inout] buf     Formatting buffer. Previous contents are discarded.
+/// \param[in   ] format  String template using `printf()` style
+/// \param[in   ] arg     Arguments to `format`
+///
+/// \returns Formatted string. It remains valid until the buffer is reset.
+///
+template<class _Elem>
+static std::basic_string_view<_Elem> vsprintf(_Inout_ winstd::basic_format_buffer<_Elem> &buf, _In_z_ _Printf_format_string_ const _Elem *format, _In_ va_list arg)
+{
+    auto &str = buf.reset();
+    vsprintf(str, format, arg);
+    return str;
+}
+
+///
+/// Formats string using `printf()` into a reusable buffer.
+///
+/// \param[inout] buf     Formatting buffer. Previous contents are discarded.
+/// \param[in   ] format  String template using `printf()` style
+///
+/// \returns Formatted string. It remains valid until the buffer is reset.
+///
+template<class _Elem>
+static std::basic_string_view<_Elem> sprintf(_Inout_ winstd::basic_format_buffer<_Elem> &buf, _In_z_ _Printf_format_string_ const _Elem *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    auto res = vsprintf(buf, format, arg);
+    va_end(arg);
+    return res;
+}
+
+#ifdef __cpp_lib_format
+
+///
+/// Formats string using `std::format()` and appends it to the string.
+///
+/// Unlike `sprintf()`, the template is checked against the arguments at compile time, and the result is written into
+/// the string in a single pass.
+///
+/// \param[inout] str     Formatted string
+/// \param[in   ] format  String template using `std::format()` style
+/// \param[in   ] args    Arguments to `format`
+///
+/// \returns Number of characters appended.
+///
+template<class _Traits, class _Ax, class... _Types>
+static size_t format_to(_Inout_ std::basic_string<char, _Traits, _Ax> &str, _In_ const std::format_string<_Types...> format, _In_ _Types&&... args)
+{
+    const size_t offset = str.size();
+    std::format_to(std::back_inserter(str), format, std::forward<_Types>(args)...);
+    return str.size() - offset;
+}
+
+///
+/// Formats string using `std::format()` and appends it to the string.
+///
+/// Unlike `sprintf()`, the template is checked against the arguments at compile time, and the result is written into
+/// the string in a single pass.
+///
+/// \param[inout] str     Formatted string
+/// \param[in   ] format  String template using `std::format()` style
+/// \param[in   ] args    Arguments to `format`
+///
+/// \returns Number of characters appended.
+///
+template<class _Traits, class _Ax, class... _Types>
+static size_t format_to(_Inout_ std::basic_string<wchar_t, _Traits, _Ax> &str, _In_ const std::wformat_string<_Types...> format, _In_ _Types&&... args)
+{
+    const size_t offset = str.size();
+    std::format_to(std::back_inserter(str), format, std::forward<_Types>(args)...);
+    return str.size() - offset;
+}
+
+///
+/// Formats string using `std::format()` into a reusable buffer.
+///
+/// \param[inout] buf     Formatting buffer. Previous contents are discarded.
+/// \param[in   ] format  String template using `std::format()` style
+/// \param[in   ] args    Arguments to `format`
+///
+/// \returns Formatted string. It remains valid until the buffer is reset.
+///
+template<class... _Types>
+static std::string_view format_to(_Inout_ winstd::format_buffer &buf, _In_ const std::format_string<_Types...> format, _In_ _Types&&... args)
+{
+    auto &str = buf.reset();
+    std::format_to(std::back_inserter(str), format, std::forward<_Types>(args)...);
+    return str;
+}
+
+///
+/// Formats string using `std::format()` into a reusable buffer.
+///
+/// \param[inout] buf     Formatting buffer. Previous contents are discarded.
+/// \param[in   ] format  String template using `std::format()` style
+/// \param[in   ] args    Arguments to `format`
+///
+/// \returns Formatted string. It remains valid until the buffer is reset.
+///
+template<class... _Types>
+static std::wstring_view format_to(_Inout_ winstd::wformat_buffer &buf, _In_ const std::wformat_string<_Types...> format, _In_ _Types&&... args)
+{
+    auto &str = buf.reset();
+    std::format_to(std::back_inserter(str), format, std::forward<_Types>(args)...);
+    return str;
+}
+
+#endif
+
+///
+/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf16_to_utf8() directly into the output without calling the OS.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
+static _Success_(return != 0) int WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::basic_string<char, _Traits, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    WINSTD_BUFFER_SITE("WideCharToMultiByte");
+    try {
+        int cch;
+        if (CodePage == CP_UTF8 && (cch = winstd::utf16_to_utf8_fill(dwFlags, lpWideCharStr, cchWideChar, lpDefaultChar, lpUsedDefaultChar, sMultiByteStr)) > 0) {
+            // Be careful not to include zero terminator.
+            sMultiByteStr.resize(strnlen(sMultiByteStr.data(), cch));
+            return cch;
+        }
+        cch = 0;
+        winstd::probe_then_fill<_Policy>(sMultiByteStr, [&](_Out_writes_(cchBuffer) CHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(WideCharToMultiByte)(CodePage, dwFlags, lpWideCharStr, cchWideChar, pBuffer, (int)cchBuffer, lpDefaultChar, lpUsedDefaultChar);
+            if (cch) {
+                // Be careful not to include zero terminator.
+                return winstd::buffer_probe::ok(cchWideChar != -1 ? strnlen(pBuffer, cch) : (size_t)cch - 1);
+            }
+            if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                return winstd::buffer_probe::fail();
+            // Query the required output size.
+            cch = WINSTD_BACKEND(WideCharToMultiByte)(CodePage, dwFlags, lpWideCharStr, cchWideChar, NULL, 0, lpDefaultChar, lpUsedDefaultChar);
+            return cch ? winstd::buffer_probe::more(cch, 2) : winstd::buffer_probe::fail(2);
+        }, cchWideChar != -1 ? (size_t)cchWideChar : 0);
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
+    }
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::vector. The new character vector is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf16_to_utf8() directly into the output without calling the OS.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Ax>
+static _Success_(return != 0) int WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::vector<char, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    WINSTD_BUFFER_SITE("WideCharToMultiByte");
+    try {
+        int cch;
+        if (CodePage == CP_UTF8 && (cch = winstd::utf16_to_utf8_fill(dwFlags, lpWideCharStr, cchWideChar, lpDefaultChar, lpUsedDefaultChar, sMultiByteStr)) > 0)
+            return cch;
+        cch = 0;
+        winstd::probe_then_fill<_Policy>(sMultiByteStr, [&](_Out_writes_(cchBuffer) CHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(WideCharToMultiByte)(CodePage, dwFlags, lpWideCharStr, cchWideChar, pBuffer, (int)cchBuffer, lpDefaultChar, lpUsedDefaultChar);
+            if (cch)
+                return winstd::buffer_probe::ok(cch);
+            if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                return winstd::buffer_probe::fail();
+            // Query the required output size.
+            cch = WINSTD_BACKEND(WideCharToMultiByte)(CodePage, dwFlags, lpWideCharStr, cchWideChar, NULL, 0, lpDefaultChar, lpUsedDefaultChar);
+            return cch ? winstd::buffer_probe::more(cch, 2) : winstd::buffer_probe::fail(2);
+        }, cchWideChar != -1 ? (size_t)cchWideChar : 0);
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
+    }
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf16_to_utf8() directly into the output without calling the OS.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ std::basic_string_view<wchar_t, _Traits1> sWideCharStr, _Out_ std::basic_string<char, _Traits2, _Ax2> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    WINSTD_BUFFER_SITE("WideCharToMultiByte");
+    try {
+        int cch;
+        if (CodePage == CP_UTF8 && (cch = winstd::utf16_to_utf8_fill(dwFlags, sWideCharStr.data(), (int)sWideCharStr.length(), lpDefaultChar, lpUsedDefaultChar, sMultiByteStr)) > 0)
+            return cch;
+        cch = 0;
+        winstd::probe_then_fill<_Policy>(sMultiByteStr, [&](_Out_writes_(cchBuffer) CHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(WideCharToMultiByte)(CodePage, dwFlags, sWideCharStr.data(), (int)sWideCharStr.length(), pBuffer, (int)cchBuffer, lpDefaultChar, lpUsedDefaultChar);
+            if (cch)
+                return winstd::buffer_probe::ok(cch);
+            if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                return winstd::buffer_probe::fail();
+            // Query the required output size.
+            cch = WINSTD_BACKEND(WideCharToMultiByte)(CodePage, dwFlags, sWideCharStr.data(), (int)sWideCharStr.length(), NULL, 0, lpDefaultChar, lpUsedDefaultChar);
+            return cch ? winstd::buffer_probe::more(cch, 2) : winstd::buffer_probe::fail(2);
+        }, sWideCharStr.length());
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
+    }
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf16_to_utf8() directly into the output without calling the OS.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits1, class _Ax1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ const std::basic_string<wchar_t, _Traits1, _Ax1> &sWideCharStr, _Out_ std::basic_string<char, _Traits2, _Ax2> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    return WideCharToMultiByte<_Policy>(CodePage, dwFlags, std::basic_string_view<wchar_t, _Traits1>(sWideCharStr), sMultiByteStr, lpDefaultChar, lpUsedDefaultChar);
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
+///
+/// \returns Converted string on success; error code otherwise. The error is reported in-band and `GetLastError()` need not be consulted.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits = std::char_traits<char>, class _Ax = std::allocator<char>>
+static winstd::expected<std::basic_string<char, _Traits, _Ax>> WideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ std::wstring_view sWideCharStr, _In_opt_z_ LPCSTR lpDefaultChar = NULL, _Out_opt_ LPBOOL lpUsedDefaultChar = NULL) noexcept
+{
+    return winstd::expect_fill<std::basic_string<char, _Traits, _Ax>>([&](_Out_ std::basic_string<char, _Traits, _Ax> &sMultiByteStr)
+    {
+        return sWideCharStr.empty() || WideCharToMultiByte<_Policy>(CodePage, dwFlags, sWideCharStr, sMultiByteStr, lpDefaultChar, lpUsedDefaultChar) ? ERROR_SUCCESS : ::GetLastError();
+    });
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Traits, class _Ax>
+static _Success_(return != 0) int SecureWideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::basic_string<char, _Traits, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    return WideCharToMultiByte<winstd::sanitizing_buffer_policy>(CodePage, dwFlags, lpWideCharStr, cchWideChar, sMultiByteStr, lpDefaultChar, lpUsedDefaultChar);
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::vector. The new character vector is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Ax>
+static _Success_(return != 0) int SecureWideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cchWideChar) LPCWSTR lpWideCharStr, _In_ int cchWideChar, _Out_ std::vector<char, _Ax> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    return WideCharToMultiByte<winstd::sanitizing_buffer_policy>(CodePage, dwFlags, lpWideCharStr, cchWideChar, sMultiByteStr, lpDefaultChar, lpUsedDefaultChar);
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Traits1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int SecureWideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ std::basic_string_view<wchar_t, _Traits1> sWideCharStr, _Out_ std::basic_string<char, _Traits2, _Ax2> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    return WideCharToMultiByte<winstd::sanitizing_buffer_policy>(CodePage, dwFlags, sWideCharStr, sMultiByteStr, lpDefaultChar, lpUsedDefaultChar);
+}
+
+///
+/// Maps a UTF-16 (wide character) string to a std::string. The new character string is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [WideCharToMultiByte function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd374130.aspx)
+///
+template<class _Traits1, class _Ax1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int SecureWideCharToMultiByte(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ const std::basic_string<wchar_t, _Traits1, _Ax1> &sWideCharStr, _Out_ std::basic_string<char, _Traits2, _Ax2> &sMultiByteStr, _In_opt_z_ LPCSTR lpDefaultChar, _Out_opt_ LPBOOL lpUsedDefaultChar) noexcept
+{
+    return SecureWideCharToMultiByte(CodePage, dwFlags, std::basic_string_view<wchar_t, _Traits1>(sWideCharStr), sMultiByteStr, lpDefaultChar, lpUsedDefaultChar);
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf8_to_utf16() directly into the output without calling the OS.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
+static _Success_(return != 0) int MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sWideCharStr) noexcept
+{
+    WINSTD_BUFFER_SITE("MultiByteToWideChar");
+    try {
+        int cch;
+        if (CodePage == CP_UTF8 && (cch = winstd::utf8_to_utf16_fill(dwFlags, lpMultiByteStr, cbMultiByte, sWideCharStr)) > 0) {
+            // Be careful not to include zero terminator.
+            sWideCharStr.resize(wcsnlen(sWideCharStr.data(), cch));
+            return cch;
+        }
+        cch = 0;
+        winstd::probe_then_fill<_Policy>(sWideCharStr, [&](_Out_writes_(cchBuffer) WCHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(MultiByteToWideChar)(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, pBuffer, (int)cchBuffer);
+            if (cch) {
+                // Be careful not to include zero terminator.
+                return winstd::buffer_probe::ok(cbMultiByte != -1 ? wcsnlen(pBuffer, cch) : (size_t)cch - 1);
+            }
+            if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                return winstd::buffer_probe::fail();
+            // Query the required output size.
+            cch = WINSTD_BACKEND(MultiByteToWideChar)(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, NULL, 0);
+            return cch ? winstd::buffer_probe::more(cch, 2) : winstd::buffer_probe::fail(2);
+        }, cbMultiByte != -1 ? (size_t)cbMultiByte : 0);
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
+    }
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::vector. The character vector is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf8_to_utf16() directly into the output without calling the OS.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Ax>
+static _Success_(return != 0) int MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::vector<wchar_t, _Ax> &sWideCharStr) noexcept
+{
+    WINSTD_BUFFER_SITE("MultiByteToWideChar");
+    try {
+        int cch;
+        if (CodePage == CP_UTF8 && (cch = winstd::utf8_to_utf16_fill(dwFlags, lpMultiByteStr, cbMultiByte, sWideCharStr)) > 0)
+            return cch;
+        cch = 0;
+        winstd::probe_then_fill<_Policy>(sWideCharStr, [&](_Out_writes_(cchBuffer) WCHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(MultiByteToWideChar)(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, pBuffer, (int)cchBuffer);
+            if (cch)
+                return winstd::buffer_probe::ok(cch);
+            if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                return winstd::buffer_probe::fail();
+            // Query the required output size.
+            cch = WINSTD_BACKEND(MultiByteToWideChar)(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, NULL, 0);
+            return cch ? winstd::buffer_probe::more(cch, 2) : winstd::buffer_probe::fail(2);
+        }, cbMultiByte != -1 ? (size_t)cbMultiByte : 0);
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
+    }
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf8_to_utf16() directly into the output without calling the OS.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ std::basic_string_view<char, _Traits1> sMultiByteStr, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sWideCharStr) noexcept
+{
+    WINSTD_BUFFER_SITE("MultiByteToWideChar");
+    try {
+        int cch;
+        if (CodePage == CP_UTF8 && (cch = winstd::utf8_to_utf16_fill(dwFlags, sMultiByteStr.data(), (int)sMultiByteStr.length(), sWideCharStr)) > 0)
+            return cch;
+        cch = 0;
+        winstd::probe_then_fill<_Policy>(sWideCharStr, [&](_Out_writes_(cchBuffer) WCHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(MultiByteToWideChar)(CodePage, dwFlags, sMultiByteStr.data(), (int)sMultiByteStr.length(), pBuffer, (int)cchBuffer);
+            if (cch)
+                return winstd::buffer_probe::ok(cch);
+            if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                return winstd::buffer_probe::fail();
+            // Query the required output size.
+            cch = WINSTD_BACKEND(MultiByteToWideChar)(CodePage, dwFlags, sMultiByteStr.data(), (int)sMultiByteStr.length(), NULL, 0);
+            return cch ? winstd::buffer_probe::more(cch, 2) : winstd::buffer_probe::fail(2);
+        }, sMultiByteStr.length());
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
+    }
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
+///
+/// \note With `CP_UTF8`, well-formed input is transcoded by winstd::utf8_to_utf16() directly into the output without calling the OS.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits1, class _Ax1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ const std::basic_string<char, _Traits1, _Ax1> &sMultiByteStr, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sWideCharStr) noexcept
+{
+    return MultiByteToWideChar<_Policy>(CodePage, dwFlags, std::basic_string_view<char, _Traits1>(sMultiByteStr), sWideCharStr);
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
+///
+/// \returns Converted string on success; error code otherwise. The error is reported in-band and `GetLastError()` need not be consulted.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits = std::char_traits<wchar_t>, class _Ax = std::allocator<wchar_t>>
+static winstd::expected<std::basic_string<wchar_t, _Traits, _Ax>> MultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ std::string_view sMultiByteStr) noexcept
+{
+    return winstd::expect_fill<std::basic_string<wchar_t, _Traits, _Ax>>([&](_Out_ std::basic_string<wchar_t, _Traits, _Ax> &sWideCharStr)
+    {
+        return sMultiByteStr.empty() || MultiByteToWideChar<_Policy>(CodePage, dwFlags, sMultiByteStr, sWideCharStr) ? ERROR_SUCCESS : ::GetLastError();
+    });
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Traits, class _Ax>
+static _Success_(return != 0) int SecureMultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sWideCharStr) noexcept
+{
+    return MultiByteToWideChar<winstd::sanitizing_buffer_policy>(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, sWideCharStr);
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::vector. The character vector is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Ax>
+static _Success_(return != 0) int SecureMultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_z_count_(cbMultiByte) LPCSTR lpMultiByteStr, _In_ int cbMultiByte, _Out_ std::vector<wchar_t, _Ax> &sWideCharStr) noexcept
+{
+    return MultiByteToWideChar<winstd::sanitizing_buffer_policy>(CodePage, dwFlags, lpMultiByteStr, cbMultiByte, sWideCharStr);
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Traits1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int SecureMultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ std::basic_string_view<char, _Traits1> sMultiByteStr, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sWideCharStr) noexcept
+{
+    return MultiByteToWideChar<winstd::sanitizing_buffer_policy>(CodePage, dwFlags, sMultiByteStr, sWideCharStr);
+}
+
+///
+/// Maps a character string to a UTF-16 (wide character) std::wstring. The character string is not necessarily from a multibyte character set.
+///
+/// \note This function cleans all internal buffers using winstd::secure_wipe() before returning.
+///
+/// \sa [MultiByteToWideChar function](https://msdn.microsoft.com/en-us/library/windows/desktop/dd319072.aspx)
+///
+template<class _Traits1, class _Ax1, class _Traits2, class _Ax2>
+static _Success_(return != 0) int SecureMultiByteToWideChar(_In_ UINT CodePage, _In_ DWORD dwFlags, _In_ const std::basic_string<char, _Traits1, _Ax1> &sMultiByteStr, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sWideCharStr) noexcept
+{
+    return SecureMultiByteToWideChar(CodePage, dwFlags, std::basic_string_view<char, _Traits1>(sMultiByteStr), sWideCharStr);
+}
+
+///
+/// Formats a message string.
+///
+/// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+///
+template<class _Traits, class _Ax>
+static DWORD FormatMessageA(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _Inout_ std::basic_string<char, _Traits, _Ax> &str, _In_opt_ va_list *Arguments)
+{
+	LPSTR lpBuffer;
+    DWORD dwResult = WINSTD_BACKEND(FormatMessageA)(dwFlags | FORMAT_MESSAGE_ALLOCATE_BUFFER, lpSource, dwMessageId, dwLanguageId, reinterpret_cast<LPSTR>(&lpBuffer), 0, Arguments);
+    if (dwResult) {
+        str.assign(lpBuffer, dwResult);
+        LocalFree(lpBuffer);
+    }
+    return dwResult;
+}
+
+///
+/// Formats a message string.
+///
+/// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+///
+template<class _Traits, class _Ax>
+static DWORD FormatMessageW(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _Inout_ std::basic_string<wchar_t, _Traits, _Ax> &str, _In_opt_ va_list *Arguments)
+{
+    LPWSTR lpBuffer;
+    DWORD dwResult = WINSTD_BACKEND(FormatMessageW)(dwFlags | FORMAT_MESSAGE_ALLOCATE_BUFFER, lpSource, dwMessageId, dwLanguageId, reinterpret_cast<LPWSTR>(&lpBuffer), 0, Arguments);
+    if (dwResult) {
+        str.assign(lpBuffer, dwResult);
+        LocalFree(lpBuffer);
+    }
+    return dwResult;
+}
+
+/// @}
+
+#pragma warning(pop)
+
+namespace winstd
+{
+    /// \addtogroup WinStdGeneral
+    /// @{
+
+    ///
+    /// Multi-byte / Wide-character string (according to _UNICODE)
+    ///
+#ifdef _UNICODE
+    typedef std::wstring tstring;
+#else
+    typedef std::string tstring;
+#endif
+
+    ///
+    /// Deleter for unique_ptr using LocalFree
+    ///
+    template <class _Ty>
+    struct LocalFree_delete
+    {
+        typedef LocalFree_delete<_Ty> _Myt; ///< This type
+
+        ///
+        /// Default construct
+        ///
+        LocalFree_delete() {}
+
+        ///
+        /// Construct from another LocalFree_delete
+        ///
+        template <class _Ty2> LocalFree_delete(const LocalFree_delete<_Ty2>&) {}
+
+        ///
+        /// Delete a pointer
+        ///
+        /// \sa [LocalFree function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366730.aspx)
+        ///
+        void operator()(_Frees_ptr_opt_ _Ty *_Ptr) const
+        {
+            LocalFree(_Ptr);
+        }
+    };
+
+    ///
+    /// Deleter for unique_ptr to array of unknown size using LocalFree
+    ///
+    template <class _Ty>
+    struct LocalFree_delete<_Ty[]>
+    {
+        typedef LocalFree_delete<_Ty> _Myt; ///< This type
+
+        ///
+        /// Default construct
+        ///
+        LocalFree_delete() noexcept {}
+
+        ///
+        /// Delete a pointer
+        ///
+        void operator()(_Frees_ptr_opt_ _Ty *_Ptr) const noexcept
+        {
+            LocalFree(_Ptr);
+        }
+
+        ///
+        /// Delete a pointer of another type
+        ///
+        /// \sa [LocalFree function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366730.aspx)
+        ///
+        template<class _Other>
+        void operator()(_Other *) const
+        {
+            LocalFree(_Ptr);
+        }
+    };
+
+    ///
+    /// Deleter for unique_ptr using GlobalFree
+    ///
+    struct GlobalFree_delete
+    {
+        ///
+        /// Default construct
+        ///
+        GlobalFree_delete() {}
+
+        ///
+        /// Delete a pointer
+        ///
+        /// \sa [GlobalFree function](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-globalfree)
+        ///
+        void operator()(HGLOBAL _Ptr) const
+        {
+            GlobalFree(_Ptr);
+        }
+    };
+
+    ///
+    /// Context scope automatic GlobalAlloc (un)access
+    ///
+    template <class T>
+    class globalmem_accessor
+    {
+        WINSTD_NONCOPYABLE(globalmem_accessor)
+        WINSTD_NONMOVABLE(globalmem_accessor)
+
+    public:
+        ///
+        /// Locks a global memory object and returns a pointer to the first byte of the object's memory block.
+        ///
+        /// \sa [GlobalLock function](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-globallock)
+        ///
+        globalmem_accessor(_In_ HGLOBAL hMem) : m_h(hMem)
+        {
+            m_data = reinterpret_cast<T*>(GlobalLock(hMem));
+            if (!m_data)
+                throw win_runtime_error("GlobalLock failed");
+        }
+
+        ///
+        /// Decrements the lock count associated with a memory object.
+        ///
+        /// \sa [GlobalUnlock function](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-globalunlock)
+        ///
+        virtual ~globalmem_accessor()
+        {
+            GlobalUnlock(m_h);
+        }
+
+        ///
+        /// Return data pointer.
+        ///
+        T* data() const noexcept
+        {
+            return m_data;
+        }
+
+    protected:
+        HGLOBAL m_h;  ///< memory handle
+        T* m_data;    ///< memory pointer
+    };
+
+    /// @}
+
+    /// \addtogroup WinStdSysHandles
+    /// @{
+
+    ///
+    /// Base abstract template class to support generic object handle keeping
+    ///
+    /// It provides basic operators and methods common to all descendands of this class establishing a base to ease the replacement of native object handle type with classes in object-oriented approach.
+    ///
+    template <class T, const T INVAL>
+    class handle
+    {
+    public:
+        ///
+        /// Datatype of the object handle this template class handles
+        ///
+        typedef T handle_type;
+
+        ///
+        /// Invalid handle value
+        ///
+        static const T invalid;
+
+        ///
+        /// Initializes a new class instance with the object handle set to INVAL.
+        ///
+        handle() noexcept : m_h(invalid)
+        {}
+
+        ///
+        /// Initializes a new class instance with an already available object handle.
+        ///
+        /// \param[in] h  Initial object handle value
+        ///
+        handle(_In_opt_ handle_type h) noexcept : m_h(h)
+        {}
+
+        ///
+        /// Move constructor
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        handle(_Inout_ handle<handle_type, INVAL> &&h) noexcept
+        {
+            // Transfer handle.
+            m_h   = h.m_h;
+            h.m_h = invalid;
+        }
+
+    private:
+        // This class is noncopyable.
+        handle(_In_ const handle<handle_type, INVAL> &h) noexcept {};
+        handle<handle_type, INVAL>& operator=(_In_ const handle<handle_type, INVAL> &h) noexcept {};
+
+    public:
+        ///
+        /// Attaches already available object handle.
+        ///
+        /// \param[in] h  Object handle value
+        ///
+        handle<handle_type, INVAL>& operator=(_In_opt_ handle_type h) noexcept
+        {
+            attach(h);
+            return *this;
+        }
+
+        ///
+        /// Move assignment
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        #pragma warning(suppress: 26432) // Move constructor is also present, but not detected by code analysis somehow.
+        handle<handle_type, INVAL>& operator=(_Inout_ handle<handle_type, INVAL> &&h) noexcept
+        {
+            if (this != std::addressof(h)) {
+                // Transfer handle.
+                if (m_h != invalid)
+                    free_internal();
+                m_h   = h.m_h;
+                h.m_h = invalid;
+            }
+            return *this;
+        }
+
+        ///
+        /// Auto-typecasting operator
+        ///
+        /// \return Object handle
+        ///
+        operator handle_type() const
+        {
+            return m_h;
+        }
+
+        ///
+        /// Returns the object handle value when the object handle is a pointer to a value (class, struct, etc.).
+        ///
+        /// \return Object handle value
+        ///
+        handle_type*& operator*() const
+        {
+            assert(m_h != invalid);
+            return *m_h;
+        }
+
+        ///
+        /// Returns the object handle reference.
+        /// \return Object handle reference
+        ///
+        handle_type* operator&()
+        {
+            assert(m_h == invalid);
+            return &m_h;
+        }
+
+        ///
+        /// Provides object handle member access when the object handle is a pointer to a class or struct.
+        ///
+        /// \return Object handle
+        ///
+        handle_type operator->() const
+        {
+            assert(m_h != invalid);
+            return m_h;
+        }
+
+        ///
+        /// Tests if the object handle is invalid.
+        ///
+        /// \return
+        /// - Non zero when object handle is invalid;
+        /// - Zero otherwise.
+        ///
+        /// \note Implementing `operator bool() const` would be correct C++ approach here. Unfortunately, it would produce ambiguities where `bool` and `handle_type` are polymorphed.
+        /// Use `!!` to test if the object handle is valid.
+        ///
+        bool operator!() const
+        {
+            return m_h == invalid;
+        }
+
+        ///
+        /// Is handle less than?
+        ///
+        /// \param[in] h  Object handle to compare against
+        /// \return
+        /// - Non zero when object handle is less than h;
+        /// - Zero otherwise.
+        ///
+        bool operator<(_In_opt_ handle_type h) const
+        {
+            return m_h < h;
+        }
+
+        ///
+        /// Is handle less than or equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        /// \return
+        /// - Non zero when object handle is less than or equal to h;
+        /// - Zero otherwise.
+        ///
+        bool operator<=(_In_opt_ handle_type h) const
+        {
+            return !operator>(h);
+        }
+
+        ///
+        /// Is handle greater than or equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        /// \return
+        /// - Non zero when object handle is greater than or equal to h;
+        /// - Zero otherwise.
+        ///
+        bool operator>=(_In_opt_ handle_type h) const
+        {
+            return !operator<(h);
+        }
+
+        ///
+        /// Is handle greater than?
+        ///
+        /// \param[in] h  Object handle to compare against
+        /// \return
+        /// - Non zero when object handle is greater than h;
+        /// - Zero otherwise.
+        ///
+        bool operator>(_In_opt_ handle_type h) const
+        {
+            return h < m_h;
+        }
+
+        ///
+        /// Is handle not equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        /// \return
+        /// - Non zero when object handle is not equal to h;
+        /// - Zero otherwise.
+        ///
+        bool operator!=(_In_opt_ handle_type h) const
+        {
+            return !operator==(h);
+        }
+
+        ///
+        /// Is handle equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        /// \return
+        /// - Non zero when object handle is equal to h;
+        /// - Zero otherwise.
+        ///
+        bool operator==(_In_opt_ handle_type h) const
+        {
+            return m_h == h;
+        }
+
+        ///
+        /// Sets a new object handle for the class
+        ///
+        /// When the current object handle of the class is non-INVAL, the object is destroyed first.
+        ///
+        /// \param[in] h  New object handle
+        ///
+        void attach(_In_opt_ handle_type h) noexcept
+        {
+            if (m_h != invalid)
+                free_internal();
+            m_h = h;
+        }
+
+        ///
+        /// Dismisses the object handle from this class
+        ///
+        /// \return Object handle
+        ///
+        handle_type detach()
+        {
+            handle_type h = m_h;
+            m_h = invalid;
+            return h;
+        }
+
+        ///
+        /// Destroys the object
+        ///
+        void free()
+        {
+            if (m_h != invalid) {
+                free_internal();
+                m_h = invalid;
+            }
+        }
+
+    protected:
+        ///
+        /// Abstract member function that must be implemented by child classes to do the actual object destruction.
+        ///
+        virtual void free_internal() noexcept = 0;
+
+    protected:
+        handle_type m_h; ///< Object handle
+    };
+
+    template <class T, const T INVAL>
+    const T handle<T, INVAL>::invalid = INVAL;
+
+    ///
+    /// Base abstract template class to support object handle keeping for objects that support trivial handle duplication
+    ///
+    template <class T, T INVAL>
+    class dplhandle : public handle<T, INVAL>
+    {
+    public:
+        ///
+        /// Initializes a new class instance with the object handle set to INVAL.
+        ///
+        dplhandle() noexcept
+        {}
+
+        ///
+        /// Initializes a new class instance with an already available object handle.
+        ///
+        /// \param[in] h  Initial object handle value
+        ///
+        dplhandle(_In_opt_ handle_type h) noexcept : handle<handle_type, INVAL>(h)
+        {}
+
+        ///
+        /// Copy constructor
+        ///
+        /// \param[inout] h  A reference of another object
+        ///
+        dplhandle<handle_type, INVAL>(_In_ const dplhandle<handle_type, INVAL> &h) : handle<handle_type, INVAL>(duplicate_internal(h.m_h))
+        {}
+
+        ///
+        /// Move constructor
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        dplhandle<handle_type, INVAL>(_Inout_ dplhandle<handle_type, INVAL> &&h) noexcept : handle<handle_type, INVAL>(std::move(h))
+        {}
+
+        ///
+        /// Attaches already available object handle.
+        ///
+        /// \param[in] h  Object handle value
+        ///
+        dplhandle<handle_type, INVAL>& operator=(_In_opt_ handle_type h) noexcept
+        {
+            handle<handle_type, INVAL>::operator=(h);
+            return *this;
+        }
+
+        ///
+        /// Duplicates the object.
+        ///
+        /// \param[in] h  Object
+        ///
+        dplhandle<handle_type, INVAL>& operator=(_In_ const dplhandle<handle_type, INVAL> &h) noexcept
+        {
+            if (this != std::addressof(h)) {
+                if (h.m_h != invalid) {
+                    handle_type h_new = duplicate_internal(h.m_h);
+
+                    if (m_h != invalid)
+                        free_internal();
+
+                    m_h = h_new;
+                } else {
+                    if (m_h != invalid)
+                        free_internal();
+
+                    m_h = invalid;
+                }
+            }
+            return *this;
+        }
+
+        ///
+        /// Moves the object.
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        #pragma warning(disable: 26432) // Move constructor is also present, but not detected by code analysis somehow.
+        dplhandle<handle_type, INVAL>& operator=(_Inout_ dplhandle<handle_type, INVAL> &&h) noexcept
+        {
+            handle<handle_type, INVAL>::operator=(std::move(h));
+            return *this;
+        }
+
+        ///
+        /// Duplicates and returns a new object handle.
+        ///
+        /// \return Duplicated object handle
+        ///
+        handle_type duplicate() const
+        {
+            return m_h != invalid ? duplicate_internal(m_h) : invalid;
+        }
+
+        ///
+        /// Duplicates an object handle and sets a new object handle.
+        ///
+        /// \param[in] h  Object handle of existing object
+        ///
+        void attach_duplicated(_In_opt_ handle_type h)
+        {
+            if (m_h != invalid)
+                free_internal();
+
+            m_h = h != invalid ? duplicate_internal(h) : invalid;
+        }
+
+    protected:
+        ///
+        /// Abstract member function that must be implemented by child classes to do the actual object handle duplication.
+        /// On failure, it should throw appropriate exception describing the cause, rather than return an invalid handle.
+        ///
+        /// \param[in] h  Object handle of existing object
+        ///
+        /// \return Duplicated object handle
+        ///
+        virtual handle_type duplicate_internal(_In_ handle_type h) const = 0;
+    };
+
+    ///
+    /// Base traits for basic_handle and basic_dplhandle
+    ///
+    /// Derive object-specific traits from this structure and add the static member functions:
+    /// - `static void close(handle_type h) noexcept` destroying the object;
+    /// - `static handle_type duplicate(handle_type h)` duplicating the object handle; basic_dplhandle only. On failure, it
+    ///   should throw appropriate exception describing the cause, rather than return an invalid handle.
+    ///
+    template <class T, const T INVAL>
+    struct basic_handle_traits
+    {
+        typedef T handle_type;                          ///< Datatype of the object handle
+        static constexpr handle_type invalid = INVAL;   ///< Invalid handle value
+    };
+
+    ///
+    /// Template class to support generic object handle keeping without virtual dispatch
+    ///
+    /// Unlike handle, the object is destroyed by `_Traits::close()` called directly. The class has no virtual table: it is
+    /// exactly the size of the native handle, and moving it copies the handle value only.
+    ///
+    /// \sa basic_handle_traits
+    ///
+    template <class _Traits>
+    class basic_handle
+    {
+        WINSTD_NONCOPYABLE(basic_handle)
+
+    public:
+        ///
+        /// Object handle traits
+        ///
+        typedef _Traits traits_type;
+
+        ///
+        /// Datatype of the object handle this template class handles
+        ///
+        typedef typename _Traits::handle_type handle_type;
+
+        ///
+        /// Invalid handle value
+        ///
+        static constexpr handle_type invalid = _Traits::invalid;
+
+        ///
+        /// Initializes a new class instance with the object handle set to invalid.
+        ///
+        basic_handle() noexcept : m_h(invalid)
+        {}
+
+        ///
+        /// Initializes a new class instance with an already available object handle.
+        ///
+        /// \param[in] h  Initial object handle value
+        ///
+        basic_handle(_In_opt_ handle_type h) noexcept : m_h(h)
+        {}
+
+        ///
+        /// Move constructor
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        basic_handle(_Inout_ basic_handle &&h) noexcept : m_h(h.m_h)
+        {
+            h.m_h = invalid;
+        }
+
+        ///
+        /// Destroys the object
+        ///
+        ~basic_handle()
+        {
+            if (m_h != invalid)
+                _Traits::close(m_h);
+        }
+
+        ///
+        /// Attaches already available object handle.
+        ///
+        /// \param[in] h  Object handle value
+        ///
+        basic_handle& operator=(_In_opt_ handle_type h) noexcept
+        {
+            attach(h);
+            return *this;
+        }
+
+        ///
+        /// Move assignment
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        basic_handle& operator=(_Inout_ basic_handle &&h) noexcept
+        {
+            if (this != std::addressof(h)) {
+                // Transfer handle.
+                if (m_h != invalid)
+                    _Traits::close(m_h);
+                m_h   = h.m_h;
+                h.m_h = invalid;
+            }
+            return *this;
+        }
+
+        ///
+        /// Auto-typecasting operator
+        ///
+        /// \return Object handle
+        ///
+        operator handle_type() const noexcept
+        {
+            return m_h;
+        }
+
+        ///
+        /// Returns the object handle value when the object handle is a pointer to a value (class, struct, etc.).
+        ///
+        /// \return Object handle value
+        ///
+        handle_type*& operator*() const
+        {
+            assert(m_h != invalid);
+            return *m_h;
+        }
+
+        ///
+        /// Returns the object handle reference.
+        /// \return Object handle reference
+        ///
+        handle_type* operator&()
+        {
+            assert(m_h == invalid);
+            return &m_h;
+        }
+
+        ///
+        /// Provides object handle member access when the object handle is a pointer to a class or struct.
+        ///
+        /// \return Object handle
+        ///
+        handle_type operator->() const
+        {
+            assert(m_h != invalid);
+            return m_h;
+        }
+
+        ///
+        /// Tests if the object handle is invalid.
+        ///
+        /// \return
+        /// - Non zero when object handle is invalid;
+        /// - Zero otherwise.
+        ///
+        /// \note Use `!!` to test if the object handle is valid. See handle::operator!() for reasoning.
+        ///
+        bool operator!() const noexcept
+        {
+            return m_h == invalid;
+        }
+
+        ///
+        /// Is handle less than?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator<(_In_opt_ handle_type h) const noexcept
+        {
+            return m_h < h;
+        }
+
+        ///
+        /// Is handle less than or equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator<=(_In_opt_ handle_type h) const noexcept
+        {
+            return !operator>(h);
+        }
+
+        ///
+        /// Is handle greater than or equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator>=(_In_opt_ handle_type h) const noexcept
+        {
+            return !operator<(h);
+        }
+
+        ///
+        /// Is handle greater than?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator>(_In_opt_ handle_type h) const noexcept
+        {
+            return h < m_h;
+        }
+
+        ///
+        /// Is handle not equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator!=(_In_opt_ handle_type h) const noexcept
+        {
+            return !operator==(h);
+        }
+
+        ///
+        /// Is handle equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator==(_In_opt_ handle_type h) const noexcept
+        {
+            return m_h == h;
+        }
+
+        ///
+        /// Sets a new object handle for the class
+        ///
+        /// When the current object handle of the class is valid, the object is destroyed first.
+        ///
+        /// \param[in] h  New object handle
+        ///
+        void attach(_In_opt_ handle_type h) noexcept
+        {
+            if (m_h != invalid)
+                _Traits::close(m_h);
+            m_h = h;
+        }
+
+        ///
+        /// Dismisses the object handle from this class
+        ///
+        /// \return Object handle
+        ///
+        handle_type detach() noexcept
+        {
+            handle_type h = m_h;
+            m_h = invalid;
+            return h;
+        }
+
+        ///
+        /// Destroys the object
+        ///
+        void free() noexcept
+        {
+            if (m_h != invalid) {
+                _Traits::close(m_h);
+                m_h = invalid;
+            }
+        }
+
+    protected:
+        handle_type m_h; ///< Object handle
+    };
+
+    ///
+    /// Template class to support object handle keeping for objects that support handle duplication, without virtual dispatch
+    ///
+    /// The object handle is duplicated by `_Traits::duplicate()`.
+    ///
+    /// \sa basic_handle_traits
+    ///
+    template <class _Traits>
+    class basic_dplhandle : public basic_handle<_Traits>
+    {
+    public:
+        using typename basic_handle<_Traits>::handle_type;
+        using basic_handle<_Traits>::invalid;
+
+        ///
+        /// Initializes a new class instance with the object handle set to invalid.
+        ///
+        basic_dplhandle() noexcept
+        {}
+
+        ///
+        /// Initializes a new class instance with an already available object handle.
+        ///
+        /// \param[in] h  Initial object handle value
+        ///
+        basic_dplhandle(_In_opt_ handle_type h) noexcept : basic_handle<_Traits>(h)
+        {}
+
+        ///
+        /// Copy constructor
+        ///
+        /// \param[in] h  A reference of another object
+        ///
+        basic_dplhandle(_In_ const basic_dplhandle &h) : basic_handle<_Traits>(h.m_h != invalid ? _Traits::duplicate(h.m_h) : invalid)
+        {}
+
+        ///
+        /// Move constructor
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        basic_dplhandle(_Inout_ basic_dplhandle &&h) noexcept : basic_handle<_Traits>(std::move(h))
+        {}
+
+        ///
+        /// Attaches already available object handle.
+        ///
+        /// \param[in] h  Object handle value
+        ///
+        basic_dplhandle& operator=(_In_opt_ handle_type h) noexcept
+        {
+            basic_handle<_Traits>::operator=(h);
+            return *this;
+        }
+
+        ///
+        /// Duplicates the object.
+        ///
+        /// \param[in] h  Object
+        ///
+        basic_dplhandle& operator=(_In_ const basic_dplhandle &h)
+        {
+            if (this != std::addressof(h))
+                basic_handle<_Traits>::attach(h.m_h != invalid ? _Traits::duplicate(h.m_h) : invalid);
+            return *this;
+        }
+
+        ///
+        /// Moves the object.
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        basic_dplhandle& operator=(_Inout_ basic_dplhandle &&h) noexcept
+        {
+            basic_handle<_Traits>::operator=(std::move(h));
+            return *this;
+        }
+
+        ///
+        /// Duplicates and returns a new object handle.
+        ///
+        /// \return Duplicated object handle
+        ///
+        handle_type duplicate() const
+        {
+            return this->m_h != invalid ? _Traits::duplicate(this->m_h) : invalid;
+        }
+
+        ///
+        /// Duplicates an object handle and sets a new object handle.
+        ///
+        /// \param[in] h  Object handle of existing object
+        ///
+        void attach_duplicated(_In_opt_ handle_type h)
+        {
+            basic_handle<_Traits>::attach(h != invalid ? _Traits::duplicate(h) : invalid);
+        }
+    };
+
+    ///
+    /// Copy and duplication counters of shared_dplhandle
+    ///
+    struct shared_dplhandle_stats
+    {
+        std::atomic<uint64_t> shared;       ///< Number of copies made by reference, each avoiding a duplication
+        std::atomic<uint64_t> duplicated;   ///< Number of objects duplicated on write
+    };
+
+    ///
+    /// Template class to share an object handle between copies, duplicating the object on write only
+    ///
+    /// The handle is kept in a heap-allocated block together with an atomic reference counter. Copying the object
+    /// increments the counter and does not duplicate the object. The object is duplicated by `_Traits::duplicate()` when
+    /// mutable_ref() or detach() is called while the handle is shared with other copies.
+    ///
+    /// \note Copies may be used from different threads. A single instance is not thread-safe.
+    ///
+    /// \sa basic_handle_traits
+    ///
+    template <class _Traits>
+    class shared_dplhandle
+    {
+    public:
+        ///
+        /// Object handle traits
+        ///
+        typedef _Traits traits_type;
+
+        ///
+        /// Datatype of the object handle this template class handles
+        ///
+        typedef typename _Traits::handle_type handle_type;
+
+        ///
+        /// Invalid handle value
+        ///
+        static constexpr handle_type invalid = _Traits::invalid;
+
+        ///
+        /// Initializes a new class instance with the object handle set to invalid.
+        ///
+        shared_dplhandle() noexcept : m_block(NULL)
+        {}
+
+        ///
+        /// Initializes a new class instance with an already available object handle.
+        ///
+        /// \param[in] h  Initial object handle value. The object is destroyed when the block cannot be allocated.
+        ///
+        shared_dplhandle(_In_opt_ handle_type h) : m_block(h != invalid ? make_block(h) : NULL)
+        {}
+
+        ///
+        /// Takes over the object handle of a basic_dplhandle
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        shared_dplhandle(_Inout_ basic_dplhandle<_Traits> &&h) : m_block(!!h ? new block(h.detach()) : NULL)
+        {}
+
+        ///
+        /// Copy constructor
+        ///
+        /// Shares the object handle with \p h. The object is not duplicated.
+        ///
+        /// \param[in] h  A reference of another object
+        ///
+        shared_dplhandle(_In_ const shared_dplhandle &h) noexcept : m_block(h.m_block)
+        {
+            add_ref();
+        }
+
+        ///
+        /// Move constructor
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        shared_dplhandle(_Inout_ shared_dplhandle &&h) noexcept : m_block(h.m_block)
+        {
+            h.m_block = NULL;
+        }
+
+        ///
+        /// Releases the object handle. The object is destroyed when no other copies share it.
+        ///
+        ~shared_dplhandle()
+        {
+            release();
+        }
+
+        ///
+        /// Attaches already available object handle.
+        ///
+        /// \param[in] h  Object handle value
+        ///
+        shared_dplhandle& operator=(_In_opt_ handle_type h)
+        {
+            attach(h);
+            return *this;
+        }
+
+        ///
+        /// Shares the object handle with \p h. The object is not duplicated.
+        ///
+        /// \param[in] h  A reference of another object
+        ///
+        shared_dplhandle& operator=(_In_ const shared_dplhandle &h) noexcept
+        {
+            if (m_block != h.m_block) {
+                block *b = h.m_block;
+                h.add_ref();
+                release();
+                m_block = b;
+            }
+            return *this;
+        }
+
+        ///
+        /// Moves the object.
+        ///
+        /// \param[inout] h  A rvalue reference of another object
+        ///
+        shared_dplhandle& operator=(_Inout_ shared_dplhandle &&h) noexcept
+        {
+            if (this != std::addressof(h)) {
+                release();
+                m_block   = h.m_block;
+                h.m_block = NULL;
+            }
+            return *this;
+        }
+
+        ///
+        /// Auto-typecasting operator
+        ///
+        /// \return Object handle. The object is shared with other copies and must not be modified.
+        ///
+        operator handle_type() const noexcept
+        {
+            return m_block ? m_block->h : invalid;
+        }
+
+        ///
+        /// Provides object handle member access when the object handle is a pointer to a class or struct.
+        ///
+        /// \return Object handle. The object is shared with other copies and must not be modified.
+        ///
+        handle_type operator->() const
+        {
+            assert(m_block);
+            return m_block->h;
+        }
+
+        ///
+        /// Tests if the object handle is invalid.
+        ///
+        /// \return
+        /// - Non zero when object handle is invalid;
+        /// - Zero otherwise.
+        ///
+        bool operator!() const noexcept
+        {
+            return !m_block;
+        }
+
+        ///
+        /// Is handle equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator==(_In_opt_ handle_type h) const noexcept
+        {
+            return operator handle_type() == h;
+        }
+
+        ///
+        /// Is handle not equal to?
+        ///
+        /// \param[in] h  Object handle to compare against
+        ///
+        bool operator!=(_In_opt_ handle_type h) const noexcept
+        {
+            return !operator==(h);
+        }
+
+        ///
+        /// Returns the object handle for modification
+        ///
+        /// When the object handle is shared with other copies, the object is duplicated first.
+        ///
+        /// \return Object handle no other copy shares
+        ///
+        handle_type mutable_ref()
+        {
+            if (m_block && m_block->refs.load(std::memory_order_acquire) != 1) {
+                block *b = new block(_Traits::duplicate(m_block->h));
+                stats().duplicated.fetch_add(1, std::memory_order_relaxed);
+                release();
+                m_block = b;
+            }
+            return m_block ? m_block->h : invalid;
+        }
+
+        ///
+        /// Sets a new object handle for the class
+        ///
+        /// The previous object is released and destroyed when no other copies share it.
+        ///
+        /// \param[in] h  New object handle
+        ///
+        void attach(_In_opt_ handle_type h)
+        {
+            block *b = h != invalid ? make_block(h) : NULL;
+            release();
+            m_block = b;
+        }
+
+        ///
+        /// Dismisses the object handle from this class
+        ///
+        /// When the object handle is shared with other copies, a duplicate is returned.
+        ///
+        /// \return Object handle the caller owns
+        ///
+        handle_type detach()
+        {
+            if (!m_block)
+                return invalid;
+            handle_type h;
+            if (m_block->refs.load(std::memory_order_acquire) == 1) {
+                h = m_block->h;
+                delete m_block;
+            } else {
+                h = _Traits::duplicate(m_block->h);
+                stats().duplicated.fetch_add(1, std::memory_order_relaxed);
+                release();
+            }
+            m_block = NULL;
+            return h;
+        }
+
+        ///
+        /// Releases the object handle. The object is destroyed when no other copies share it.
+        ///
+        void free() noexcept
+        {
+            release();
+            m_block = NULL;
+        }
+
+        ///
+        /// Returns the number of copies sharing the object handle
+        ///
+        long use_count() const noexcept
+        {
+            return m_block ? m_block->refs.load(std::memory_order_relaxed) : 0;
+        }
+
+        ///
+        /// Returns counters of all shared_dplhandle<_Traits> instances
+        ///
+        static shared_dplhandle_stats& stats() noexcept
+        {
+            static shared_dplhandle_stats s = {};
+            return s;
+        }
+
+    protected:
+        /// \cond internal
+        struct block
+        {
+            block(_In_ handle_type _h) noexcept : refs(1), h(_h) {}
+
+            std::atomic<long> refs;
+            handle_type h;
+        };
+
+        static block* make_block(_In_ handle_type h)
+        {
+            try {
+                return new block(h);
+            }
+            catch (...) {
+                _Traits::close(h);
+                throw;
+            }
+        }
+
+        void add_ref() const noexcept
+        {
+            if (m_block) {
+                m_block->refs.fetch_add(1, std::memory_order_relaxed);
+                stats().shared.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void release() noexcept
+        {
+            if (m_block && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                _Traits::close(m_block->h);
+                delete m_block;
+            }
+        }
+        /// \endcond
+
+    protected:
+        block *m_block; ///< Shared object handle block
+    };
+
+    ///
+    /// Counters of close_queue
+    ///
+    struct close_queue_stats
+    {
+        size_t depth;               ///< Number of handles waiting to be closed
+        size_t max_depth;           ///< Maximum number of handles waiting to be closed at once
+        uint64_t queued;            ///< Number of handles queued
+        uint64_t closed;            ///< Number of handles closed
+        uint64_t batches;           ///< Number of batches closed
+        uint64_t close_time;        ///< Total time spent closing handles in microseconds
+        uint64_t max_close_time;    ///< Longest time spent closing a single handle in microseconds
+        uint64_t max_wait;          ///< Longest time from queuing a handle until it was closed in microseconds
+    };
+
+    ///
+    /// Queue closing object handles on a thread pool
+    ///
+    /// Handles are pushed to an interlocked singly linked list. When the list becomes non-empty, a thread pool work item
+    /// is submitted. It takes all queued handles at once and closes them in the order they were queued.
+    ///
+    /// When the thread pool work item cannot be created, the queue is shut down, or memory for the queue entry cannot be
+    /// allocated, handles are closed synchronously.
+    ///
+    /// \note Call shutdown() before unloading the module that holds the queue. Waiting for the thread pool inside
+    /// `DllMain` may deadlock.
+    ///
+    /// \sa deferred_close_traits
+    ///
+    class close_queue
+    {
+        WINSTD_NONCOPYABLE(close_queue)
+        WINSTD_NONMOVABLE(close_queue)
+
+    public:
+        ///
+        /// Constructs an empty queue
+        ///
+        close_queue() noexcept :
+            m_work(CreateThreadpoolWork(work_callback, this, NULL)),
+            m_shutdown(false),
+            m_depth(0),
+            m_max_depth(0),
+            m_queued(0),
+            m_closed(0),
+            m_batches(0),
+            m_close_time(0),
+            m_max_close_time(0),
+            m_max_wait(0)
+        {
+            InitializeSListHead(&m_list);
+            LARGE_INTEGER f;
+            QueryPerformanceFrequency(&f);
+            m_frequency = f.QuadPart;
+        }
+
+        ///
+        /// Closes all queued handles and releases the thread pool work item
+        ///
+        ~close_queue()
+        {
+            shutdown();
+            if (m_work)
+                CloseThreadpoolWork(m_work);
+        }
+
+        ///
+        /// Returns the process-wide queue
+        ///
+        static close_queue& instance() noexcept
+        {
+            static close_queue queue;
+            return queue;
+        }
+
+        ///
+        /// Queues object handle to be closed by `_Traits::close()`
+        ///
+        /// \param[in] h  Object handle
+        ///
+        template <class _Traits>
+        void push(_In_ typename _Traits::handle_type h) noexcept
+        {
+            if (!m_work || m_shutdown.load(std::memory_order_acquire)) {
+                _Traits::close(h);
+                return;
+            }
+            handle_entry<_Traits> *e = new (std::nothrow) handle_entry<_Traits>;
+            if (!e) {
+                _Traits::close(h);
+                return;
+            }
+            e->close = close_entry<_Traits>;
+            e->h = h;
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            e->queued = now.QuadPart;
+            update_max(m_max_depth, m_depth.fetch_add(1, std::memory_order_relaxed) + 1);
+            m_queued.fetch_add(1, std::memory_order_relaxed);
+            if (!InterlockedPushEntrySList(&m_list, &e->link))
+                SubmitThreadpoolWork(m_work);
+        }
+
+        ///
+        /// Closes all queued handles
+        ///
+        /// When the function returns, all handles queued before the call are closed.
+        ///
+        /// \note Must not be called from `_Traits::close()` of a queued handle.
+        ///
+        void flush() noexcept
+        {
+            drain();
+            if (m_work)
+                WaitForThreadpoolWorkCallbacks(m_work, FALSE);
+        }
+
+        ///
+        /// Closes all queued handles and makes the queue close any further handles synchronously
+        ///
+        void shutdown() noexcept
+        {
+            m_shutdown.store(true, std::memory_order_release);
+            flush();
+        }
+
+        ///
+        /// Returns queue counters
+        ///
+        close_queue_stats stats() const noexcept
+        {
+            close_queue_stats s;
+            s.depth          = m_depth.load(std::memory_order_relaxed);
+            s.max_depth      = m_max_depth.load(std::memory_order_relaxed);
+            s.queued         = m_queued.load(std::memory_order_relaxed);
+            s.closed         = m_closed.load(std::memory_order_relaxed);
+            s.batches        = m_batches.load(std::memory_order_relaxed);
+            s.close_time     = to_us(m_close_time.load(std::memory_order_relaxed));
+            s.max_close_time = to_us(m_max_close_time.load(std::memory_order_relaxed));
+            s.max_wait       = to_us(m_max_wait.load(std::memory_order_relaxed));
+            return s;
+        }
+
+    protected:
+        /// \cond internal
+        struct alignas(MEMORY_ALLOCATION_ALIGNMENT) entry
+        {
+            SLIST_ENTRY link;
+            void (*close)(_In_ entry *e) noexcept;
+            LONGLONG queued;
+        };
+
+        template <class _Traits>
+        struct handle_entry : entry
+        {
+            typename _Traits::handle_type h;
+        };
+
+        template <class _Traits>
+        static void close_entry(_In_ entry *e) noexcept
+        {
+            handle_entry<_Traits> *he = static_cast<handle_entry<_Traits>*>(e);
+            _Traits::close(he->h);
+            delete he;
+        }
+
+        static void CALLBACK work_callback(_Inout_ PTP_CALLBACK_INSTANCE Instance, _Inout_opt_ PVOID Context, _Inout_ PTP_WORK Work) noexcept
+        {
+            UNREFERENCED_PARAMETER(Instance);
+            UNREFERENCED_PARAMETER(Work);
+            static_cast<close_queue*>(Context)->drain();
+        }
+
+        void drain() noexcept
+        {
+            PSLIST_ENTRY list = InterlockedFlushSList(&m_list);
+            if (!list)
+                return;
+
+            // The list is LIFO. Reverse it to close handles in the order they were queued.
+            PSLIST_ENTRY ordered = NULL;
+            while (list) {
+                PSLIST_ENTRY next = list->Next;
+                list->Next = ordered;
+                ordered = list;
+                list = next;
+            }
+
+            size_t count = 0;
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+            LARGE_INTEGER now = start;
+            const LONGLONG batch_start = start.QuadPart;
+            while (ordered) {
+                PSLIST_ENTRY next = ordered->Next;
+                entry *e = CONTAINING_RECORD(ordered, entry, link);
+                const LONGLONG queued = e->queued;
+                e->close(e);
+                QueryPerformanceCounter(&now);
+                update_max(m_max_close_time, static_cast<uint64_t>(now.QuadPart - start.QuadPart));
+                update_max(m_max_wait, static_cast<uint64_t>(now.QuadPart - queued));
+                start = now;
+                ordered = next;
+                count++;
+            }
+            m_close_time.fetch_add(static_cast<uint64_t>(now.QuadPart - batch_start), std::memory_order_relaxed);
+            m_depth.fetch_sub(count, std::memory_order_relaxed);
+            m_closed.fetch_add(count, std::memory_order_relaxed);
+            m_batches.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        template <class T>
+        static void update_max(_Inout_ std::atomic<T> &value, _In_ T candidate) noexcept
+        {
+            T current = value.load(std::memory_order_relaxed);
+            while (current < candidate && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed));
+        }
+
+        uint64_t to_us(_In_ uint64_t ticks) const noexcept
+        {
+            return m_frequency ? ticks / m_frequency * 1000000 + ticks % m_frequency * 1000000 / m_frequency : 0;
+        }
+        /// \endcond
+
+    protected:
+        SLIST_HEADER m_list;                    ///< Queued handles
+        PTP_WORK m_work;                        ///< Thread pool work item closing queued handles
+        std::atomic<bool> m_shutdown;           ///< Is queue shut down?
+        uint64_t m_frequency;                   ///< Performance counter frequency
+        std::atomic<size_t> m_depth;            ///< Number of handles waiting to be closed
+        std::atomic<size_t> m_max_depth;        ///< Maximum number of handles waiting to be closed at once
+        std::atomic<uint64_t> m_queued;         ///< Number of handles queued
+        std::atomic<uint64_t> m_closed;         ///< Number of handles closed
+        std::atomic<uint64_t> m_batches;        ///< Number of batches closed
+        std::atomic<uint64_t> m_close_time;     ///< Total time spent closing handles in performance counter ticks
+        std::atomic<uint64_t> m_max_close_time; ///< Longest time spent closing a single handle in performance counter ticks
+        std::atomic<uint64_t> m_max_wait;       ///< Longest time from queuing a handle until it was closed in performance counter ticks
+    };
+
+    ///
+    /// Traits closing object handles on the close_queue instead of the releasing thread
+    ///
+    /// Use as `basic_handle<deferred_close_traits<win_handle_traits<INVALID_HANDLE_VALUE>>>` to move slow `CloseHandle()`,
+    /// `RegCloseKey()`, `CloseServiceHandle()` etc. off the hot path.
+    ///
+    template <class _Traits>
+    struct deferred_close_traits : _Traits
+    {
+        ///
+        /// Queues the object handle to be closed by `_Traits::close()`
+        ///
+        static void close(_In_ typename _Traits::handle_type h) noexcept
+        {
+            close_queue::instance().push<_Traits>(h);
+        }
+    };
+
+    /// @}
+
+    /// \addtogroup WinStdExceptions
+    /// @{
+
+    ///
+    /// Process-wide cache of message texts
+    ///
+    /// Caches system messages, message table entries and string resources by module, message ID and language, so
+    /// reporting the same errors repeatedly does not call the system every time. Messages not found are cached too,
+    /// along with the error code of the failed lookup, but other failures are not, as they may be transient.
+    ///
+    /// Lookups are lock-free. The entries form an immutable table, which a miss copies, extends and publishes as a
+    /// whole. Lookups read the published table without a lock, announcing themselves in a counter of their thread's
+    /// shard only. The replaced table is freed once no lookup may read it anymore. Hit and miss counters are sharded the
+    /// same way, and recency is tracked with a coarse per-entry timestamp, so hits do not write to memory shared by all
+    /// threads. When the cache is full, the least recently used entry is evicted.
+    ///
+    /// \note Entries remain cached after their module is unloaded. Call clear() after unloading a module, as another
+    /// module may be loaded at the same address.
+    ///
+    class message_cache
+    {
+        WINSTD_NONCOPYABLE(message_cache)
+        WINSTD_NONMOVABLE(message_cache)
+
+    public:
+        ///
+        /// Constructs an empty cache
+        ///
+        /// \param[in] capacity  Maximum number of entries
+        ///
+        message_cache(_In_ size_t capacity = WINSTD_MESSAGE_CACHE_SIZE) noexcept :
+            m_capacity(capacity ? capacity : 1),
+            m_table(NULL),
+            m_phase(0),
+            m_shards(),
+            m_evictions(0)
+        {
+            InitializeSRWLock(&m_lock);
+        }
+
+        ///
+        /// Destroys the cache
+        ///
+        virtual ~message_cache()
+        {
+            delete m_table.load(std::memory_order_relaxed);
+        }
+
+        ///
+        /// Returns the process-wide cache
+        ///
+        static message_cache& instance() noexcept
+        {
+            static message_cache cache;
+            return cache;
+        }
+
+        ///
+        /// Retrieves message text from the system or module message table
+        ///
+        /// \param[in ] dwFlags       `FORMAT_MESSAGE_FROM_SYSTEM` and/or `FORMAT_MESSAGE_FROM_HMODULE`. Other flags are ignored.
+        /// \param[in ] hModule       Module containing the message table
+        /// \param[in ] dwMessageId   Message identifier
+        /// \param[in ] dwLanguageId  Language identifier
+        /// \param[out] str           Message text with inserts left intact
+        ///
+        /// \return `true` if the message was found
+        ///
+        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+        ///
+        template<class _Traits, class _Ax>
+        bool format_message(_In_ DWORD dwFlags, _In_opt_ HMODULE hModule, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &str)
+        {
+            dwFlags &= FORMAT_MESSAGE_FROM_HMODULE | FORMAT_MESSAGE_FROM_SYSTEM;
+            if (!(dwFlags & FORMAT_MESSAGE_FROM_HMODULE))
+                hModule = NULL;
+            return lookup({ hModule, dwMessageId, dwLanguageId, dwFlags }, str, [&](_Out_ std::wstring &text)
+            {
+                return FormatMessageW(dwFlags | FORMAT_MESSAGE_IGNORE_INSERTS, hModule, dwMessageId, dwLanguageId, text, NULL) != 0;
+            });
+        }
+
+        ///
+        /// Retrieves message text from module string resource
+        ///
+        /// \param[in ] hModule    Module to load resource string from
+        /// \param[in ] nId        Resource string ID number
+        /// \param[in ] wLanguage  Resource string language
+        /// \param[out] str        Resource string
+        ///
+        /// \return `true` if the resource was found
+        ///
+        template<class _Traits, class _Ax>
+        bool load_resource(_In_opt_ HMODULE hModule, _In_ UINT nId, _In_ WORD wLanguage, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &str)
+        {
+            return lookup({ hModule, nId, wLanguage, 0 }, str, [&](_Out_ std::wstring &text)
+            {
+                HRSRC hFoundRes = FindResourceExW(hModule, MAKEINTRESOURCEW(6), MAKEINTRESOURCEW(nId), wLanguage);
+                if (hFoundRes) {
+                    DWORD dwSize = SizeofResource(hModule, hFoundRes);
+                    if (dwSize) {
+                        HGLOBAL hLoadedRes = LoadResource(hModule, hFoundRes);
+                        if (hLoadedRes) {
+                            LPCWSTR szMessage = reinterpret_cast<LPCWSTR>(LockResource(hLoadedRes));
+                            if (szMessage) {
+                                text.assign(szMessage, dwSize / sizeof(*szMessage));
+                                return true;
+                            } else
+                                SetLastError(ERROR_LOCK_FAILED);
+                        }
+                    } else
+                        SetLastError(ERROR_RESOURCE_DATA_NOT_FOUND);
+                }
+                return false;
+            });
+        }
+
+        ///
+        /// Removes all entries
+        ///
+        void clear() noexcept
+        {
+            AcquireSRWLockExclusive(&m_lock);
+            table *t = m_table.exchange(NULL, std::memory_order_seq_cst);
+            synchronize();
+            ReleaseSRWLockExclusive(&m_lock);
+            delete t;
+        }
+
+        ///
+        /// Returns number of lookups served from the cache
+        ///
+        uint64_t hits() const noexcept
+        {
+            uint64_t n = 0;
+            for (auto &s : m_shards)
+                n += s.hits.load(std::memory_order_relaxed);
+            return n;
+        }
+
+        ///
+        /// Returns number of lookups that called the system
+        ///
+        uint64_t misses() const noexcept
+        {
+            uint64_t n = 0;
+            for (auto &s : m_shards)
+                n += s.misses.load(std::memory_order_relaxed);
+            return n;
+        }
+
+        ///
+        /// Returns number of entries evicted to make room for new ones
+        ///
+        uint64_t evictions() const noexcept { return m_evictions.load(std::memory_order_relaxed); }
+
+    protected:
+        /// \cond internal
+
+        struct key
+        {
+            HMODULE module;
+            DWORD id;
+            DWORD language;
+            DWORD source; // FORMAT_MESSAGE_FROM_* flags; 0 for string resources
+
+            bool operator==(_In_ const key &other) const noexcept
+            {
+                return module == other.module && id == other.id && language == other.language && source == other.source;
+            }
+        };
+
+        struct key_hash
+        {
+            size_t operator()(_In_ const key &k) const noexcept
+            {
+                return std::hash<const void*>()(k.module) ^ (static_cast<size_t>(k.id) * 0x9e3779b9) ^ (static_cast<size_t>(k.language) << 16) ^ k.source;
+            }
+        };
+
+        struct entry
+        {
+            std::wstring text;
+            DWORD error;                // ERROR_SUCCESS if found; GetLastError() of the failed load otherwise
+            std::atomic<uint64_t> used; // GetTickCount64() of the last lookup
+
+            entry(_Inout_ std::wstring &&_text, _In_ DWORD _error, _In_ uint64_t _used) noexcept : text(std::move(_text)), error(_error), used(_used) {}
+        };
+
+        typedef std::unordered_map<key, std::shared_ptr<entry>, key_hash> table;
+
+        static const size_t shard_count = 16;
+
+#pragma warning(push)
+#pragma warning(disable: 4324) // Padded to keep shards on separate cache lines.
+        struct alignas(64) shard
+        {
+            std::atomic<size_t> readers[2]; // Lookups reading the table, per phase
+            std::atomic<uint64_t> hits;
+            std::atomic<uint64_t> misses;
+        };
+#pragma warning(pop)
+
+        template<class _Traits, class _Ax, class _Fn>
+        bool lookup(_In_ const key &k, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &str, _In_ _Fn &&load)
+        {
+            shard &s = m_shards[(GetCurrentThreadId() >> 2) % shard_count];
+            bool cached = false;
+            DWORD error = ERROR_SUCCESS;
+            std::atomic<size_t> &readers = s.readers[m_phase.load(std::memory_order_relaxed)];
+            readers.fetch_add(1, std::memory_order_seq_cst);
+            const table *t = m_table.load(std::memory_order_seq_cst);
+            if (t) {
+                auto e = t->find(k);
+                if (e != t->end()) {
+                    // Skip the store while the coarse clock has not advanced, to keep the cache line shared.
+                    const uint64_t now = GetTickCount64();
+                    if (e->second->used.load(std::memory_order_relaxed) != now)
+                        e->second->used.store(now, std::memory_order_relaxed);
+                    error = e->second->error;
+                    if (error == ERROR_SUCCESS) {
+                        try {
+                            str.assign(e->second->text.data(), e->second->text.size());
+                        } catch (...) {
+                            readers.fetch_sub(1, std::memory_order_release);
+                            throw;
+                        }
+                    }
+                    cached = true;
+                }
+            }
+            readers.fetch_sub(1, std::memory_order_release);
+            if (cached) {
+                s.hits.fetch_add(1, std::memory_order_relaxed);
+                if (error == ERROR_SUCCESS)
+                    return true;
+                SetLastError(error);
+                return false;
+            }
+
+            s.misses.fetch_add(1, std::memory_order_relaxed);
+            std::wstring loaded;
+            if (load(loaded)) {
+                str.assign(loaded.data(), loaded.size());
+                insert(k, std::move(loaded), ERROR_SUCCESS);
+                return true;
+            }
+            error = GetLastError();
+            if (error == ERROR_MR_MID_NOT_FOUND || error == ERROR_RESOURCE_NAME_NOT_FOUND || error == ERROR_RESOURCE_TYPE_NOT_FOUND)
+                insert(k, std::move(loaded), error);
+            SetLastError(error);
+            return false;
+        }
+
+        void insert(_In_ const key &k, _Inout_ std::wstring &&text, _In_ DWORD error) noexcept
+        {
+            AcquireSRWLockExclusive(&m_lock);
+            table *t = m_table.load(std::memory_order_relaxed), *t_new = NULL;
+            if (!t || t->find(k) == t->end()) {
+                bool evicted = false;
+                try {
+                    t_new = t ? new table(*t) : new table;
+                    if (t_new->size() >= m_capacity) {
+                        auto lru = t_new->begin();
+                        for (auto e = lru; ++e != t_new->end();)
+                            if (e->second->used.load(std::memory_order_relaxed) < lru->second->used.load(std::memory_order_relaxed))
+                                lru = e;
+                        t_new->erase(lru);
+                        evicted = true;
+                    }
+                    t_new->emplace(k, std::make_shared<entry>(std::move(text), error, GetTickCount64()));
+                }
+                catch (...) {
+                    // Caching is best-effort. The caller has the text already.
+                    delete t_new;
+                    t_new = NULL;
+                }
+                if (t_new) {
+                    m_table.store(t_new, std::memory_order_seq_cst);
+                    if (evicted)
+                        m_evictions.fetch_add(1, std::memory_order_relaxed);
+                    synchronize();
+                } else
+                    t = NULL;
+            } else
+                t = NULL;
+            ReleaseSRWLockExclusive(&m_lock);
+            delete t;
+        }
+
+        void synchronize() noexcept
+        {
+            // Waits for lookups that may still read the table replaced before the call. Those counted themselves in
+            // either phase. Each flip lets the counters of the previous phase drain, as lookups starting after the flip
+            // count in the other one. Must be called with the lock held.
+            for (size_t i = 0; i < 2; ++i) {
+                const size_t phase = m_phase.load(std::memory_order_relaxed);
+                m_phase.store(phase ^ 1, std::memory_order_seq_cst);
+                for (auto &s : m_shards)
+                    while (s.readers[phase].load(std::memory_order_seq_cst))
+                        SwitchToThread();
+            }
+        }
+
+        /// \endcond
+
+    protected:
+        SRWLOCK m_lock;                         ///< Lock serializing misses
+        size_t m_capacity;                      ///< Maximum number of entries
+        std::atomic<table*> m_table;            ///< Published table of entries; immutable but for recency timestamps
+        std::atomic<size_t> m_phase;            ///< Reader counter lookups count themselves in
+        shard m_shards[shard_count];            ///< Reader, hit and miss counters sharded by thread
+        std::atomic<uint64_t> m_evictions;      ///< Number of evicted entries
+    };
+
+    ///
+    /// Loads exception message string from resources and converts it to UTF-8.
+    ///
+    /// \param[in] hModule    Module to load resource string from
+    /// \param[in] nId        Resource string ID number
+    /// \param[in] wLanguage  Resource string language
+    ///
+    /// \return Loaded string in UTF-8 encoding. As std::exception messages may only be char*, we use UTF-8 by convention.
+    ///
+    inline std::string load_msg_from_res(_In_opt_ HMODULE hModule, _In_ UINT nId, _In_ WORD wLanguage)
+    {
+        std::string sResult;
+        std::wstring sMessage;
+        if (message_cache::instance().load_resource(hModule, nId, wLanguage, sMessage)) {
+            WideCharToMultiByte(CP_UTF8, 0, sMessage, sResult, NULL, NULL);
+            return sResult;
+        }
+        sprintf(sResult, "msg %u", nId);
+        return sResult;
+    }
+
+    ///
+    /// Loads exception message sprintf template from resources, formats it and converts it to UTF-8.
+    ///
+    /// \param[in] hModule    Module to load resource string from
+    /// \param[in] nId        Resource string ID number
+    /// \param[in] wLanguage  Resource string language
+    ///
+    /// \return Loaded string in UTF-8 encoding. As std::exception messages may only be char*, we use UTF-8 by convention.
+    ///
+    inline std::string fmt_msg_from_res(_In_opt_ HMODULE hModule, _In_ UINT nId, _In_ WORD wLanguage, ...)
+    {
+        std::string sResult;
+        HRSRC hFoundRes = FindResourceExW(hModule, MAKEINTRESOURCEW(6), MAKEINTRESOURCEW(nId), wLanguage);
+        if (hFoundRes) {
+            DWORD dwSize = SizeofResource(hModule, hFoundRes);
+            if (dwSize) {
+                HGLOBAL hLoadedRes = LoadResource(hModule, hFoundRes);
+                if (hLoadedRes) {
+                    LPCWSTR szFormat = reinterpret_cast<LPCWSTR>(LockResource(hLoadedRes));
+                    if (szFormat) {
+                        dwSize /= sizeof(*szFormat);
+                        assert(wcsnlen(szFormat, dwSize) < dwSize); // Resource strings must be zero-terminated to make strings directly usable with sprintf.
+                        va_list arg;
+                        va_start(arg, wLanguage);
+                        std::wstring sMessage;
+                        vsprintf(sMessage, szFormat, arg);
+                        va_end(arg);
+                        WideCharToMultiByte(CP_UTF8, 0, sMessage, sResult, NULL, NULL);
+                        return sResult;
+                    } else
+                        SetLastError(ERROR_LOCK_FAILED);
+                }
+            }
+        }
+        sprintf(sResult, "msg %u", nId);
+        return sResult;
+    }
+
+    ///
+    /// Numerical runtime error
+    ///
+    template <typename _Tn>
+    class num_runtime_error : public std::runtime_error
+    {
+    public:
+        typedef _Tn error_type; ///< Error number type
+
+    public:
+        ///
+        /// Constructs an exception
+        ///
+        /// \param[in] num  Numeric error code
+        /// \param[in] msg  Error message
+        ///
+        num_runtime_error(_In_ error_type num, _In_ const std::string& msg) :
+            m_num(num),
+            m_lazy(false),
+            m_what(nullptr),
+            runtime_error(msg)
+        {}
+
+        ///
+        /// Constructs an exception
+        ///
+        /// \param[in] num  Numeric error code
+        /// \param[in] msg  Error message
+        ///
+        num_runtime_error(_In_ error_type num, _In_opt_z_ const char *msg = nullptr) :
+            m_num(num),
+            m_lazy(false),
+            m_what(nullptr),
+            runtime_error(msg)
+        {}
+
+        ///
+        /// Copies an exception
+        ///
+        /// The context is shared with the copy. The formatted message is not copied: the copy formats its own on the first
+        /// what() call.
+        ///
+        /// \param[in] other  Exception to copy from
+        ///
+        num_runtime_error(_In_ const num_runtime_error &other) noexcept :
+            m_num(other.m_num),
+            m_lazy(other.m_lazy),
+            m_context(other.m_context),
+            m_what(nullptr),
+            runtime_error(other)
+        {}
+
+        ///
+        /// Destroys the exception
+        ///
+        virtual ~num_runtime_error()
+        {
+            delete m_what.load(std::memory_order_relaxed);
+        }
+
+        ///
+        /// Copies an exception
+        ///
+        /// \param[in] other  Exception to copy from
+        ///
+        num_runtime_error& operator=(_In_ const num_runtime_error &other)
+        {
+            if (this != std::addressof(other)) {
+                runtime_error::operator=(other);
+                m_num = other.m_num;
+                m_lazy = other.m_lazy;
+                m_context = other.m_context;
+                delete m_what.exchange(nullptr, std::memory_order_relaxed);
+            }
+            return *this;
+        }
+
+        ///
+        /// Returns the error number
+        ///
+        error_type number() const
+        {
+            return m_num;
+        }
+
+        ///
+        /// Returns the error message
+        ///
+        /// Exceptions constructed with lazy_message_t format their message on the first call. Concurrent calls are safe.
+        ///
+        const char* what() const noexcept override
+        {
+            if (!m_lazy)
+                return runtime_error::what();
+            std::string *what = m_what.load(std::memory_order_acquire);
+            if (!what) {
+                try {
+                    std::string text = message_text();
+                    what = new std::string(m_context ? *m_context + ": " + text : std::move(text));
+                }
+                catch (...) {
+                    return m_context ? m_context->c_str() : runtime_error::what();
+                }
+                std::string *expected = nullptr;
+                if (!m_what.compare_exchange_strong(expected, what, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    // Another thread was first.
+                    delete what;
+                    what = expected;
+                }
+            }
+            return what->c_str();
+        }
+
+    protected:
+        ///
+        /// Tag selecting constructors which defer formatting the message to the first what() call
+        ///
+        /// The base std::runtime_error is constructed with an empty message, so the context is not copied twice.
+        ///
+        struct lazy_message_t {};
+
+        ///
+        /// Constructs an exception formatting its message on the first what() call
+        ///
+        /// \param[in] num      Numeric error code
+        /// \param[in] context  Error message to prepend to message_text()
+        ///
+        num_runtime_error(_In_ error_type num, _In_ const std::string& context, _In_ lazy_message_t) :
+            m_num(num),
+            m_lazy(true),
+            m_context(std::make_shared<const std::string>(context)),
+            m_what(nullptr),
+            runtime_error("")
+        {}
+
+        ///
+        /// Constructs an exception formatting its message on the first what() call
+        ///
+        /// \param[in] num      Numeric error code
+        /// \param[in] context  Error message to prepend to message_text(); `nullptr` for none
+        ///
+        num_runtime_error(_In_ error_type num, _In_opt_z_ const char *context, _In_ lazy_message_t) :
+            m_num(num),
+            m_lazy(true),
+            m_context(context ? std::make_shared<const std::string>(context) : nullptr),
+            m_what(nullptr),
+            runtime_error("")
+        {}
+
+        ///
+        /// Returns user-readable description of the error number
+        ///
+        /// Called on the first what() call of exceptions constructed with lazy_message_t.
+        ///
+        virtual std::string message_text() const
+        {
+            return std::string();
+        }
+
+    protected:
+        error_type m_num;                           ///< Numeric error code
+        bool m_lazy;                                ///< Is message formatted on the first what() call?
+        std::shared_ptr<const std::string> m_context;   ///< Error message to prepend to the formatted message, even when empty; `nullptr` for none
+        mutable std::atomic<std::string*> m_what;   ///< Formatted message
+    };
+
+    ///
+    /// Saves GetLastError and restores SetLastError when going out of scope
+    ///
+    class last_error_saver
+    {
+    public:
+        ///
+        /// Saves the calling thread's last-error code value.
+        ///
+        /// \sa [GetLastError function](https://learn.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror)
+        ///
+        last_error_saver(_In_ DWORD error = GetLastError()) :
+            m_error(error)
+        {}
+
+        ///
+        /// Sets the last-error code for the calling thread.
+        ///
+        /// \sa [SetLastError function](https://learn.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-setlasterror)
+        ///
+        ~last_error_saver()
+        {
+            SetLastError(m_error);
+        }
+
+    protected:
+        DWORD m_error;
+    };
+
+    ///
+    /// Windows runtime error
+    ///
+    class win_runtime_error : public num_runtime_error<DWORD>
+    {
+    public:
+        ///
+        /// Constructs an exception
+        ///
+        /// \param[in] num Windows error code
+        ///
+        win_runtime_error(_In_ error_type num) : num_runtime_error<DWORD>(num, nullptr, lazy_message_t())
+        {}
+
+        ///
+        /// Constructs an exception
+        ///
+        /// \param[in] num Windows error code
+        /// \param[in] msg Error message
+        ///
+        win_runtime_error(_In_ error_type num, _In_ const std::string& msg) : num_runtime_error<DWORD>(num, msg, lazy_message_t())
+        {}
+
+        ///
+        /// Constructs an exception
+        ///
+        /// \param[in] num  Windows error code
+        /// \param[in] msg  Error message
+        ///
+        win_runtime_error(_In_ error_type num, _In_z_ const char *msg) : num_runtime_error<DWORD>(num, msg, lazy_message_t())
+        {}
+
+        ///
+        /// Constructs an exception using `GetLastError()`
+        ///
+        win_runtime_error() : num_runtime_error<DWORD>(GetLastError(), nullptr, lazy_message_t())
+        {}
+
+        ///
+        /// Constructs an exception using `GetLastError()`
+        ///
+        /// \param[in] msg  Error message
+        ///
+        win_runtime_error(_In_ const std::string& msg) : num_runtime_error<DWORD>(GetLastError(), msg, lazy_message_t())
+        {}
+
+        ///
+        /// Constructs an exception using `GetLastError()`
+        ///
+        /// \param[in] msg  Error message
+        ///
+        win_runtime_error(_In_z_ const char *msg) : num_runtime_error<DWORD>(GetLastError(), msg, lazy_message_t())
+        {}
+
+    protected:
+        ///
+        /// Returns a user-readable Windows error message
+        ///
+        std::string message_text() const override
+        {
+            return message(m_num);
+        }
+
+        ///
+        /// Returns a user-readable Windows error message.
+        /// As std::exception messages may only be char*, we use UTF-8 by convention.
+        ///
+        /// \sa [FormatMessage function](https://docs.microsoft.com/en-us/windows/desktop/api/winbase/nf-winbase-formatmessage)
+        ///
+        static std::string message(_In_ error_type num, _In_opt_ DWORD dwLanguageId = 0)
+        {
+            last_error_saver last_error_save;
+            std::wstring wstr;
+            if (message_cache::instance().format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, num, dwLanguageId, wstr)) {
+                // Stock Windows error messages contain CRLF. Well... Trim all the trailing white space.
+                wstr.erase(wstr.find_last_not_of(L" \t\n\r\f\v") + 1);
+            } else
+                sprintf(wstr, num >= 0x10000 ? L"Error 0x%X" : L"Error %u", num);
+            std::string str;
+            WideCharToMultiByte(CP_UTF8, 0, wstr, str, NULL, NULL);
+            return str;
+        }
+    };
+
+    /// @}
+
+    /// \addtogroup WinStdStrFormat
     /// @{
 
     ///
-    /// Multi-byte / Wide-character string (according to _UNICODE)
+    /// Base template class to support string formatting using `printf()` style templates
+    ///
+    template<class _Elem, class _Traits, class _Ax>
+    class basic_string_printf : public std::basic_string<_Elem, _Traits, _Ax>
+    {
+    public:
+        /// \name Initializing string using template in memory
+        /// @{
+
+        ///
+        /// Initializes a new string and formats its contents using `printf()` style template.
+        ///
+        /// \param[in] format  String template using `printf()` style
+        ///
+        basic_string_printf(_In_z_ _Printf_format_string_ const _Elem *format, ...)
+        {
+            va_list arg;
+            va_start(arg, format);
+            vsprintf(*this, format, arg);
+            va_end(arg);
+        }
+
+        /// @}
+
+        /// \name Initializing string using template in resources
+        /// @{
+
+        ///
+        /// Initializes a new string and formats its contents using `printf()` style template in resources.
+        ///
+        /// \param[in] hInstance  Resource module handle
+        /// \param[in] nFormatID  Resource ID of the string template using `printf()` style
+        ///
+        basic_string_printf(_In_ HINSTANCE hInstance, _In_ UINT nFormatID, ...)
+        {
+            _Myt format;
+            ATLENSURE(format.LoadString(hInstance, nFormatID));
+
+            va_list arg;
+            va_start(arg, nFormatID);
+            vsprintf(*this, format, arg);
+            va_end(arg);
+        }
+
+        ///
+        /// Initializes a new string and formats its contents using `printf()` style template in resources.
+        ///
+        /// \param[in] hInstance    Resource module handle
+        /// \param[in] wLanguageID  Resource language
+        /// \param[in] nFormatID    Resource ID of the string template using `printf()` style
+        ///
+        basic_string_printf(_In_ HINSTANCE hInstance, _In_ WORD wLanguageID, _In_ UINT nFormatID, ...)
+        {
+            _Myt format;
+            ATLENSURE(format.LoadString(hInstance, nFormatID, wLanguageID));
+
+            va_list arg;
+            va_start(arg, nFormatID);
+            vsprintf(*this, format, arg);
+            va_end(arg);
+        }
+
+        /// }@
+    };
+
+    ///
+    /// Single-byte character implementation of a class to support string formatting using `printf()` style templates
+    ///
+    typedef basic_string_printf<char, std::char_traits<char>, std::allocator<char> > string_printf;
+
+    ///
+    /// Wide character implementation of a class to support string formatting using `printf()` style templates
+    ///
+    typedef basic_string_printf<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> > wstring_printf;
+
+    ///
+    /// Multi-byte / Wide-character formatted string (according to _UNICODE)
     ///
 #ifdef _UNICODE
-    typedef std::wstring tstring;
+    typedef wstring_printf tstring_printf;
 #else
-    typedef std::string tstring;
+    typedef string_printf tstring_printf;
 #endif
 
+#ifdef __cpp_lib_format
+
     ///
-    /// Deleter for unique_ptr using LocalFree
+    /// Base template class to support string formatting using `std::format()` style templates
     ///
-    template <class _Ty>
-    struct LocalFree_delete
+    /// The template is checked against the arguments at compile time.
+    ///
+    template<class _Elem, class _Traits, class _Ax>
+    class basic_string_format : public std::basic_string<_Elem, _Traits, _Ax>
     {
-        typedef LocalFree_delete<_Ty> _Myt; ///< This type
-
+    public:
         ///
-        /// Default construct
+        /// Format string type for given argument types
         ///
-        LocalFree_delete() {}
+        template<class... _Types>
+        using format_string = std::conditional_t<std::is_same_v<_Elem, wchar_t>, std::wformat_string<_Types...>, std::format_string<_Types...>>;
+
+        /// \name Initializing string using template in memory
+        /// @{
 
         ///
-        /// Construct from another LocalFree_delete
+        /// Initializes a new string and formats its contents using `std::format()` style template.
         ///
-        template <class _Ty2> LocalFree_delete(const LocalFree_delete<_Ty2>&) {}
+        /// \param[in] format  String template using `std::format()` style
+        /// \param[in] args    Arguments to `format`
+        ///
+        template<class... _Types>
+        basic_string_format(_In_ const format_string<_Types...> format, _In_ _Types&&... args)
+        {
+            ::format_to(*this, format, std::forward<_Types>(args)...);
+        }
+
+        /// @}
+    };
+
+    ///
+    /// Single-byte character implementation of a class to support string formatting using `std::format()` style templates
+    ///
+    typedef basic_string_format<char, std::char_traits<char>, std::allocator<char> > string_format;
+
+    ///
+    /// Wide character implementation of a class to support string formatting using `std::format()` style templates
+    ///
+    typedef basic_string_format<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> > wstring_format;
+
+    ///
+    /// Multi-byte / Wide-character formatted string (according to _UNICODE)
+    ///
+#ifdef _UNICODE
+    typedef wstring_format tstring_format;
+#else
+    typedef string_format tstring_format;
+#endif
+
+#endif
+
+    ///
+    /// Base template class to support string formatting using `FormatMessage()` style templates
+    ///
+    template<class _Elem, class _Traits, class _Ax>
+    class basic_string_msg : public std::basic_string<_Elem, _Traits, _Ax>
+    {
+    public:
+        /// \name Initializing string using template in memory
+        /// @{
 
         ///
-        /// Delete a pointer
+        /// Initializes a new string and formats its contents using `FormatMessage()` style template.
         ///
-        /// \sa [LocalFree function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366730.aspx)
+        /// \param[in] format  String template using `FormatMessage()` style
         ///
-        void operator()(_Frees_ptr_opt_ _Ty *_Ptr) const
+        basic_string_msg(_In_z_ _FormatMessage_format_string_ const _Elem *format, ...)
         {
-            LocalFree(_Ptr);
+            va_list arg;
+            va_start(arg, format);
+            FormatMessage(FORMAT_MESSAGE_FROM_STRING, format, 0, 0, *this, &arg);
+            va_end(arg);
         }
-    };
 
-    ///
-    /// Deleter for unique_ptr to array of unknown size using LocalFree
-    ///
-    template <class _Ty>
-    struct LocalFree_delete<_Ty[]>
-    {
-        typedef LocalFree_delete<_Ty> _Myt; ///< This type
+        /// @}
 
-        ///
-        /// Default construct
-        ///
-        LocalFree_delete() noexcept {}
+        /// \name Initializing string using template in resources
+        /// @{
 
         ///
-        /// Delete a pointer
+        /// Initializes a new string and formats its contents using `FormatMessage()` style template in resources.
         ///
-        void operator()(_Frees_ptr_opt_ _Ty *_Ptr) const noexcept
+        /// \param[in] hInstance  Resource module handle
+        /// \param[in] nFormatID  Resource ID of the string template using `FormatMessage()` style
+        ///
+        basic_string_msg(_In_ HINSTANCE hInstance, _In_ UINT nFormatID, ...)
         {
-            LocalFree(_Ptr);
+            _Myt format(GetManager());
+            ATLENSURE(format.LoadString(hInstance, nFormatID));
+
+            va_list arg;
+            va_start(arg, nFormatID);
+            FormatMessage(FORMAT_MESSAGE_FROM_STRING, format, 0, 0, *this, &arg);
+            va_end(arg);
         }
 
         ///
-        /// Delete a pointer of another type
+        /// Initializes a new string and formats its contents using `FormatMessage()` style template in resources.
         ///
-        /// \sa [LocalFree function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366730.aspx)
+        /// \param[in] hInstance    Resource module handle
+        /// \param[in] wLanguageID  Resource language
+        /// \param[in] nFormatID    Resource ID of the string template using `FormatMessage()` style
         ///
-        template<class _Other>
-        void operator()(_Other *) const
+        basic_string_msg(_In_ HINSTANCE hInstance, _In_ WORD wLanguageID, _In_ UINT nFormatID, ...)
         {
-            LocalFree(_Ptr);
+            _Myt format(GetManager());
+            ATLENSURE(format.LoadString(hInstance, nFormatID, wLanguageID));
+
+            va_list arg;
+            va_start(arg, nFormatID);
+            FormatMessage(FORMAT_MESSAGE_FROM_STRING, format, 0, 0, *this, &arg);
+            va_end(arg);
         }
-    };
 
-    ///
-    /// Deleter for unique_ptr using GlobalFree
-    ///
-    struct GlobalFree_delete
-    {
-        ///
-        /// Default construct
-        ///
-        GlobalFree_delete() {}
+        /// @}
 
         ///
-        /// Delete a pointer
+        /// Initializes a new string and formats its contents using `FormatMessage()` style.
         ///
-        /// \sa [GlobalFree function](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-globalfree)
+        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
         ///
-        void operator()(HGLOBAL _Ptr) const
+        basic_string_msg(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _In_opt_ va_list *Arguments)
         {
-            GlobalFree(_Ptr);
+            if (cacheable(dwFlags))
+                load_cached(dwFlags, lpSource, dwMessageId, dwLanguageId);
+            else
+                FormatMessage(dwFlags & ~FORMAT_MESSAGE_ARGUMENT_ARRAY, lpSource, dwMessageId, dwLanguageId, *this, Arguments);
         }
-    };
-
-    ///
-    /// Context scope automatic GlobalAlloc (un)access
-    ///
-    template <class T>
-    class globalmem_accessor
-    {
-        WINSTD_NONCOPYABLE(globalmem_accessor)
-        WINSTD_NONMOVABLE(globalmem_accessor)
 
-    public:
         ///
-        /// Locks a global memory object and returns a pointer to the first byte of the object's memory block.
+        /// Initializes a new string and formats its contents using `FormatMessage()` style.
         ///
-        /// \sa [GlobalLock function](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-globallock)
+        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
         ///
-        globalmem_accessor(_In_ HGLOBAL hMem) : m_h(hMem)
+        basic_string_msg(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _In_opt_ DWORD_PTR *Arguments)
         {
-            m_data = reinterpret_cast<T*>(GlobalLock(hMem));
-            if (!m_data)
-                throw win_runtime_error("GlobalLock failed");
+            if (cacheable(dwFlags))
+                load_cached(dwFlags, lpSource, dwMessageId, dwLanguageId);
+            else
+                FormatMessage(dwFlags | FORMAT_MESSAGE_ARGUMENT_ARRAY, lpSource, dwMessageId, dwLanguageId, *this, (va_list*)Arguments);
         }
 
         ///
-        /// Decrements the lock count associated with a memory object.
+        /// Initializes a new string and formats its contents using `FormatMessage()` style.
         ///
-        /// \sa [GlobalUnlock function](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-globalunlock)
+        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
         ///
-        virtual ~globalmem_accessor()
+        basic_string_msg(_In_ DWORD dwFlags, _In_z_ LPCTSTR pszFormat, _In_opt_ va_list *Arguments)
         {
-            GlobalUnlock(m_h);
+            FormatMessage(dwFlags & ~FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_FROM_STRING, pszFormat, 0, 0, *this, Arguments);
         }
 
         ///
-        /// Return data pointer.
+        /// Initializes a new string and formats its contents using `FormatMessage()` style.
         ///
-        T* data() const noexcept
+        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+        ///
+        basic_string_msg(_In_ DWORD dwFlags, _In_z_ LPCTSTR pszFormat, _In_opt_ DWORD_PTR *Arguments)
         {
-            return m_data;
+            FormatMessage(dwFlags | FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_FROM_STRING, pszFormat, 0, 0, *this, (va_list*)Arguments);
         }
 
     protected:
-        HGLOBAL m_h;  ///< memory handle
-        T* m_data;    ///< memory pointer
+        /// \cond internal
+
+        // Messages without inserts from message tables are served by message_cache.
+        static bool cacheable(_In_ DWORD dwFlags) noexcept
+        {
+            return
+                (dwFlags & (FORMAT_MESSAGE_FROM_STRING | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_MAX_WIDTH_MASK)) == FORMAT_MESSAGE_IGNORE_INSERTS &&
+                (dwFlags & (FORMAT_MESSAGE_FROM_HMODULE | FORMAT_MESSAGE_FROM_SYSTEM));
+        }
+
+        void load_cached(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId)
+        {
+            std::basic_string<_Elem, _Traits, _Ax> &str = *this;
+            HMODULE hModule = static_cast<HMODULE>(const_cast<LPVOID>(lpSource));
+            if constexpr (std::is_same_v<_Elem, wchar_t>)
+                message_cache::instance().format_message(dwFlags, hModule, dwMessageId, dwLanguageId, str);
+            else {
+                std::wstring wstr;
+                if (message_cache::instance().format_message(dwFlags, hModule, dwMessageId, dwLanguageId, wstr))
+                    WideCharToMultiByte(CP_ACP, 0, wstr, str, NULL, NULL);
+            }
+        }
+
+        /// \endcond
     };
 
-    /// @}
+    ///
+    /// Single-byte character implementation of a class to support string formatting using `FormatMessage()` style templates
+    ///
+    typedef basic_string_msg<char, std::char_traits<char>, std::allocator<char> > string_msg;
 
-    /// \addtogroup WinStdSysHandles
-    /// @{
+    ///
+    /// Wide character implementation of a class to support string formatting using `FormatMessage()` style templates
+    ///
+    typedef basic_string_msg<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> > wstring_msg;
 
     ///
-    /// Base abstract template class to support generic object handle keeping
+    /// Multi-byte / Wide-character formatted string (according to _UNICODE)
     ///
-    /// It provides basic operators and methods common to all descendands of this class establishing a base to ease the replacement of native object handle type with classes in object-oriented approach.
+#ifdef _UNICODE
+    typedef wstring_msg tstring_msg;
+#else
+    typedef string_msg tstring_msg;
+#endif
+
     ///
-    template <class T, const T INVAL>
-    class handle
+    /// Number of characters in GUID string representation `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}`
+    ///
+    const size_t guid_chars = 38;
+
+    /// \cond internal
+
+    inline void guid_to_bytes(_In_ const GUID &guid, _Out_writes_all_(16) unsigned char *b) noexcept
     {
-    public:
-        ///
-        /// Datatype of the object handle this template class handles
-        ///
-        typedef T handle_type;
+        // Arrange GUID bytes in the order they appear in the string representation.
+        b[0] = static_cast<unsigned char>(guid.Data1 >> 24);
+        b[1] = static_cast<unsigned char>(guid.Data1 >> 16);
+        b[2] = static_cast<unsigned char>(guid.Data1 >>  8);
+        b[3] = static_cast<unsigned char>(guid.Data1      );
+        b[4] = static_cast<unsigned char>(guid.Data2 >>  8);
+        b[5] = static_cast<unsigned char>(guid.Data2      );
+        b[6] = static_cast<unsigned char>(guid.Data3 >>  8);
+        b[7] = static_cast<unsigned char>(guid.Data3      );
+        memcpy(b + 8, guid.Data4, sizeof(guid.Data4));
+    }
 
-        ///
-        /// Invalid handle value
-        ///
-        static const T invalid;
+    inline void bytes_to_guid(_In_reads_(16) const unsigned char *b, _Out_ GUID &guid) noexcept
+    {
+        guid.Data1 =
+            (static_cast<unsigned long>(b[0]) << 24) |
+            (static_cast<unsigned long>(b[1]) << 16) |
+            (static_cast<unsigned long>(b[2]) <<  8) |
+             static_cast<unsigned long>(b[3]);
+        guid.Data2 = static_cast<unsigned short>((b[4] << 8) | b[5]);
+        guid.Data3 = static_cast<unsigned short>((b[6] << 8) | b[7]);
+        memcpy(guid.Data4, b + 8, sizeof(guid.Data4));
+    }
 
-        ///
-        /// Initializes a new class instance with the object handle set to INVAL.
-        ///
-        handle() noexcept : m_h(invalid)
-        {}
+#ifdef WINSTD_SSE2
+    inline __m128i guid_nibbles_to_hex(_In_ __m128i n) noexcept
+    {
+        // '0'-'9' for 0-9, 'A'-'F' for 10-15
+        return _mm_add_epi8(
+            _mm_add_epi8(n, _mm_set1_epi8('0')),
+            _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '0' - 10)));
+    }
 
-        ///
-        /// Initializes a new class instance with an already available object handle.
-        ///
-        /// \param[in] h  Initial object handle value
-        ///
-        handle(_In_opt_ handle_type h) noexcept : m_h(h)
-        {}
+    inline void guid_store_hex(_Out_writes_all_(32) char *hex, _In_ __m128i h0, _In_ __m128i h1) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hex     ), h0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 16), h1);
+    }
 
-        ///
-        /// Move constructor
-        ///
-        /// \param[inout] h  A rvalue reference of another object
-        ///
-        handle(_Inout_ handle<handle_type, INVAL> &&h) noexcept
-        {
-            // Transfer handle.
-            m_h   = h.m_h;
-            h.m_h = invalid;
-        }
+    inline void guid_store_hex(_Out_writes_all_(32) wchar_t *hex, _In_ __m128i h0, _In_ __m128i h1) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hex     ), _mm_unpacklo_epi8(h0, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hex +  8), _mm_unpackhi_epi8(h0, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 16), _mm_unpacklo_epi8(h1, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hex + 24), _mm_unpackhi_epi8(h1, zero));
+    }
 
-    private:
-        // This class is noncopyable.
-        handle(_In_ const handle<handle_type, INVAL> &h) noexcept {};
-        handle<handle_type, INVAL>& operator=(_In_ const handle<handle_type, INVAL> &h) noexcept {};
+    inline __m128i guid_load_hex(_In_reads_(16) const char *hex) noexcept
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex));
+    }
 
-    public:
-        ///
-        /// Attaches already available object handle.
-        ///
-        /// \param[in] h  Object handle value
-        ///
-        handle<handle_type, INVAL>& operator=(_In_opt_ handle_type h) noexcept
-        {
-            attach(h);
-            return *this;
+    inline __m128i guid_load_hex(_In_reads_(16) const wchar_t *hex) noexcept
+    {
+        // Code units above 0xff saturate to 0x00 or 0xff, neither being a hex digit.
+        return _mm_packus_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex    )),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + 8)));
+    }
+
+    inline __m128i guid_hex_to_nibbles(_In_ __m128i c, _Inout_ int &valid) noexcept
+    {
+        const __m128i
+            is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1))),
+            lc = _mm_or_si128(c, _mm_set1_epi8(0x20)),
+            is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lc, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lc, _mm_set1_epi8('f' + 1)));
+        valid &= _mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha));
+        return _mm_or_si128(
+            _mm_and_si128(is_digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+            _mm_and_si128(is_alpha, _mm_sub_epi8(lc, _mm_set1_epi8('a' - 10))));
+    }
+
+    inline __m128i guid_pack_nibbles(_In_ __m128i n) noexcept
+    {
+        // Each 16-bit lane holds high nibble in the low byte and low nibble in the high byte.
+        return _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00ff)), 4),
+            _mm_srli_epi16(n, 8));
+    }
+#else
+    inline unsigned int guid_hex_value(_In_ unsigned int c) noexcept
+    {
+        if (c - '0' < 10)
+            return c - '0';
+        c |= 0x20;
+        if (c - 'a' < 6)
+            return c - 'a' + 10;
+        return 0x100;
+    }
+#endif
+
+    /// \endcond
+
+    ///
+    /// Formats GUID as `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}`
+    ///
+    /// The output is not zero-terminated. Uses SSE2 when available; define `WINSTD_NO_SIMD` to use the scalar code.
+    ///
+    /// \param[in ] guid  GUID to format
+    /// \param[out] str   Buffer to receive `guid_chars` characters
+    ///
+    template<class _Elem>
+    void guid_to_chars(_In_ const GUID &guid, _Out_writes_all_(guid_chars) _Elem *str) noexcept
+    {
+        unsigned char b[16];
+        _Elem hex[32];
+        guid_to_bytes(guid, b);
+#ifdef WINSTD_SSE2
+        const __m128i
+            v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)),
+            mask = _mm_set1_epi8(0x0f),
+            hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask),
+            lo = _mm_and_si128(v, mask);
+        guid_store_hex(hex,
+            guid_nibbles_to_hex(_mm_unpacklo_epi8(hi, lo)),
+            guid_nibbles_to_hex(_mm_unpackhi_epi8(hi, lo)));
+#else
+        for (size_t i = 0; i < 16; ++i) {
+            hex[2 * i    ] = static_cast<_Elem>("0123456789ABCDEF"[b[i] >> 4]);
+            hex[2 * i + 1] = static_cast<_Elem>("0123456789ABCDEF"[b[i] & 0xf]);
+        }
+#endif
+        str[0] = '{';
+        for (size_t i = 0; i < 8; ++i) str[ 1 + i] = hex[     i];
+        str[9] = '-';
+        for (size_t i = 0; i < 4; ++i) str[10 + i] = hex[ 8 + i];
+        str[14] = '-';
+        for (size_t i = 0; i < 4; ++i) str[15 + i] = hex[12 + i];
+        str[19] = '-';
+        for (size_t i = 0; i < 4; ++i) str[20 + i] = hex[16 + i];
+        str[24] = '-';
+        for (size_t i = 0; i < 12; ++i) str[25 + i] = hex[20 + i];
+        str[37] = '}';
+    }
+
+    ///
+    /// Parses GUID from `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}` representation
+    ///
+    /// Hexadecimal digits are case-insensitive. Uses SSE2 when available; define `WINSTD_NO_SIMD` to use the scalar code.
+    ///
+    /// \param[in ] str   String of at least `guid_chars` characters
+    /// \param[out] guid  Parsed GUID
+    ///
+    /// \returns
+    /// - `true` if GUID successfuly parsed;
+    /// - `false` otherwise.
+    ///
+    template<class _Elem>
+    _Success_(return) bool chars_to_guid(_In_reads_(guid_chars) const _Elem *str, _Out_ GUID &guid) noexcept
+    {
+        if (str[0] != '{' || str[9] != '-' || str[14] != '-' || str[19] != '-' || str[24] != '-' || str[37] != '}')
+            return false;
+        _Elem hex[32];
+        for (size_t i = 0; i < 8; ++i) hex[     i] = str[ 1 + i];
+        for (size_t i = 0; i < 4; ++i) hex[ 8 + i] = str[10 + i];
+        for (size_t i = 0; i < 4; ++i) hex[12 + i] = str[15 + i];
+        for (size_t i = 0; i < 4; ++i) hex[16 + i] = str[20 + i];
+        for (size_t i = 0; i < 12; ++i) hex[20 + i] = str[25 + i];
+        unsigned char b[16];
+#ifdef WINSTD_SSE2
+        int valid = 0xffff;
+        const __m128i
+            n0 = guid_hex_to_nibbles(guid_load_hex(hex     ), valid),
+            n1 = guid_hex_to_nibbles(guid_load_hex(hex + 16), valid);
+        if (valid != 0xffff)
+            return false;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b), _mm_packus_epi16(guid_pack_nibbles(n0), guid_pack_nibbles(n1)));
+#else
+        unsigned int invalid = 0;
+        for (size_t i = 0; i < 16; ++i) {
+            const unsigned int
+                hi = guid_hex_value(static_cast<unsigned int>(hex[2 * i    ])),
+                lo = guid_hex_value(static_cast<unsigned int>(hex[2 * i + 1]));
+            invalid |= hi | lo;
+            b[i] = static_cast<unsigned char>((hi << 4) | lo);
         }
+        if (invalid & 0x100)
+            return false;
+#endif
+        bytes_to_guid(b, guid);
+        return true;
+    }
+
+    ///
+    /// Formats array of GUIDs as `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}`
+    ///
+    /// \param[in ] guids   Array of GUIDs
+    /// \param[in ] count   Number of GUIDs
+    /// \param[out] str     Buffer to receive `guid_chars` characters per GUID
+    /// \param[in ] stride  Distance between the starts of two consecutive GUID strings in characters
+    ///
+    template<class _Elem>
+    void guids_to_chars(_In_reads_(count) const GUID *guids, _In_ size_t count, _Out_ _Elem *str, _In_ size_t stride = guid_chars) noexcept
+    {
+        assert(stride >= guid_chars);
+        for (size_t i = 0; i < count; ++i, str += stride)
+            guid_to_chars(guids[i], str);
+    }
 
+    ///
+    /// Parses array of GUIDs from `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}` representations
+    ///
+    /// \param[in ] str     Buffer of `guid_chars` characters per GUID
+    /// \param[in ] count   Number of GUIDs
+    /// \param[out] guids   Array of parsed GUIDs
+    /// \param[in ] stride  Distance between the starts of two consecutive GUID strings in characters
+    ///
+    /// \returns Number of GUIDs parsed before the first invalid one.
+    ///
+    template<class _Elem>
+    size_t chars_to_guids(_In_ const _Elem *str, _In_ size_t count, _Out_writes_to_(count, return) GUID *guids, _In_ size_t stride = guid_chars) noexcept
+    {
+        assert(stride >= guid_chars);
+        size_t i;
+        for (i = 0; i < count && chars_to_guid(str, guids[i]); ++i, str += stride);
+        return i;
+    }
+
+    ///
+    /// GUID string representation in a fixed-size buffer
+    ///
+    /// Unlike basic_string_guid, this class never allocates memory.
+    ///
+    template<class _Elem>
+    class basic_guid_string
+    {
+    public:
         ///
-        /// Move assignment
+        /// Formats GUID as `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}`
         ///
-        /// \param[inout] h  A rvalue reference of another object
+        /// \param[in] guid  GUID to format
         ///
-        #pragma warning(suppress: 26432) // Move constructor is also present, but not detected by code analysis somehow.
-        handle<handle_type, INVAL>& operator=(_Inout_ handle<handle_type, INVAL> &&h) noexcept
+        basic_guid_string(_In_ const GUID &guid) noexcept
         {
-            if (this != std::addressof(h)) {
-                // Transfer handle.
-                if (m_h != invalid)
-                    free_internal();
-                m_h   = h.m_h;
-                h.m_h = invalid;
-            }
-            return *this;
+            guid_to_chars(guid, m_data.data());
+            m_data[guid_chars] = 0;
         }
 
         ///
-        /// Auto-typecasting operator
+        /// Returns zero-terminated string
         ///
-        /// \return Object handle
+        const _Elem* c_str() const noexcept { return m_data.data(); }
+
         ///
-        operator handle_type() const
-        {
-            return m_h;
-        }
+        /// Returns zero-terminated string
+        ///
+        const _Elem* data() const noexcept { return m_data.data(); }
 
         ///
-        /// Returns the object handle value when the object handle is a pointer to a value (class, struct, etc.).
+        /// Returns zero-terminated string
         ///
-        /// \return Object handle value
+        operator const _Elem*() const noexcept { return m_data.data(); }
+
         ///
-        handle_type*& operator*() const
-        {
-            assert(m_h != invalid);
-            return *m_h;
-        }
+        /// Returns string view
+        ///
+        operator std::basic_string_view<_Elem>() const noexcept { return std::basic_string_view<_Elem>(m_data.data(), guid_chars); }
 
         ///
-        /// Returns the object handle reference.
-        /// \return Object handle reference
+        /// Returns string length in characters
         ///
-        handle_type* operator&()
-        {
-            assert(m_h == invalid);
-            return &m_h;
-        }
+        static constexpr size_t size() noexcept { return guid_chars; }
 
         ///
-        /// Provides object handle member access when the object handle is a pointer to a class or struct.
+        /// Returns string length in characters
         ///
-        /// \return Object handle
+        static constexpr size_t length() noexcept { return guid_chars; }
+
         ///
-        handle_type operator->() const
-        {
-            assert(m_h != invalid);
-            return m_h;
-        }
+        /// Returns iterator to the first character
+        ///
+        const _Elem* begin() const noexcept { return m_data.data(); }
 
         ///
-        /// Tests if the object handle is invalid.
+        /// Returns iterator past the last character
         ///
-        /// \return
-        /// - Non zero when object handle is invalid;
-        /// - Zero otherwise.
+        const _Elem* end() const noexcept { return m_data.data() + guid_chars; }
+
+    protected:
+        std::array<_Elem, guid_chars + 1> m_data;  ///< Zero-terminated string
+    };
+
+    ///
+    /// Single-byte character GUID string in a fixed-size buffer
+    ///
+    typedef basic_guid_string<char> guid_string;
+
+    ///
+    /// Wide character GUID string in a fixed-size buffer
+    ///
+    typedef basic_guid_string<wchar_t> wguid_string;
+
+    ///
+    /// Multi-byte / Wide-character GUID string in a fixed-size buffer (according to _UNICODE)
+    ///
+#ifdef _UNICODE
+    typedef wguid_string tguid_string;
+#else
+    typedef guid_string tguid_string;
+#endif
+
+    ///
+    /// Base template class to support converting GUID to string
+    ///
+    template<class _Elem, class _Traits, class _Ax>
+    class basic_string_guid : public std::basic_string<_Elem, _Traits, _Ax>
+    {
+    public:
+        /// \name Initializing string using template in memory
+        /// @{
+
         ///
-        /// \note Implementing `operator bool() const` would be correct C++ approach here. Unfortunately, it would produce ambiguities where `bool` and `handle_type` are polymorphed.
-        /// Use `!!` to test if the object handle is valid.
+        /// Initializes a new string and formats its contents to string representation of given GUID.
         ///
-        bool operator!() const
+        /// \param[in] guid    GUID to convert
+        /// \param[in] format  A `printf()` syntax template to convert GUID to string (i.e. `"{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}"`)
+        ///
+        basic_string_guid(_In_ const GUID &guid, _In_z_ _Printf_format_string_ const _Elem *format)
         {
-            return m_h == invalid;
+            sprintf<_Elem, _Traits, _Ax>(*this, format,
+                guid.Data1,
+                guid.Data2,
+                guid.Data3,
+                guid.Data4[0], guid.Data4[1],
+                guid.Data4[2], guid.Data4[3], guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
         }
 
         ///
-        /// Is handle less than?
+        /// Initializes a new string and formats its contents to `{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}` representation of given GUID.
         ///
-        /// \param[in] h  Object handle to compare against
-        /// \return
-        /// - Non zero when object handle is less than h;
-        /// - Zero otherwise.
+        /// \param[in] guid    GUID to convert
         ///
-        bool operator<(_In_opt_ handle_type h) const
+        basic_string_guid(_In_ const GUID &guid) : std::basic_string<_Elem, _Traits, _Ax>(guid_chars, 0)
         {
-            return m_h < h;
+            guid_to_chars(guid, &(*this)[0]);
         }
 
+        /// @}
+    };
+
+    ///
+    /// Single-byte character implementation of a class to support converting GUID to string
+    ///
+    class string_guid : public basic_string_guid<char, std::char_traits<char>, std::allocator<char> >
+    {
+    public:
+        /// \name Initializing string using template in memory
+        /// @{
+
         ///
-        /// Is handle less than or equal to?
+        /// Initializes a new string and formats its contents to string representation of given GUID.
         ///
-        /// \param[in] h  Object handle to compare against
-        /// \return
-        /// - Non zero when object handle is less than or equal to h;
-        /// - Zero otherwise.
+        /// \param[in] guid  GUID to convert
         ///
-        bool operator<=(_In_opt_ handle_type h) const
-        {
-            return !operator>(h);
-        }
+        string_guid(_In_ const GUID &guid) :
+            basic_string_guid<char, std::char_traits<char>, std::allocator<char> >(guid)
+        {}
+
+        /// @}
+    };
+
+    ///
+    /// Wide character implementation of a class to support converting GUID to string
+    ///
+    class wstring_guid : public basic_string_guid<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> >
+    {
+    public:
+        /// \name Initializing string using template in memory
+        /// @{
 
         ///
-        /// Is handle greater than or equal to?
+        /// Initializes a new string and formats its contents to string representation of given GUID.
         ///
-        /// \param[in] h  Object handle to compare against
-        /// \return
-        /// - Non zero when object handle is greater than or equal to h;
-        /// - Zero otherwise.
+        /// \param[in] guid  GUID to convert
         ///
-        bool operator>=(_In_opt_ handle_type h) const
+        wstring_guid(_In_ const GUID &guid) :
+            basic_string_guid<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> >(guid)
+        {}
+
+        /// @}
+    };
+
+    ///
+    /// Multi-byte / Wide-character string GUID (according to _UNICODE)
+    ///
+#ifdef _UNICODE
+    typedef wstring_guid tstring_guid;
+#else
+    typedef string_guid tstring_guid;
+#endif
+
+    /// @}
+
+    /// \addtogroup WinStdMemSanitize
+    /// @{
+
+    // winstd::sanitizing_allocator::destroy() member generates _Ptr parameter not used warning for primitive datatypes _Ty.
+    #pragma warning(push)
+    #pragma warning(disable: 4100)
+
+    ///
+    /// An allocator template that sanitizes each memory block before it is destroyed or reallocated
+    ///
+    /// \note
+    /// `sanitizing_allocator` introduces a performance penalty. However, it provides an additional level of security.
+    /// Use for security sensitive data memory storage only.
+    ///
+    template<class _Ty>
+    class sanitizing_allocator : public std::allocator<_Ty>
+    {
+    public:
+        typedef std::allocator<_Ty> _Mybase; ///< Base type
+
+        ///
+        /// Convert this type to sanitizing_allocator<_Other>
+        ///
+        template<class _Other>
+        struct rebind
         {
-            return !operator<(h);
-        }
+            typedef sanitizing_allocator<_Other> other; ///< Other type
+        };
 
         ///
-        /// Is handle greater than?
+        /// Construct default allocator
         ///
-        /// \param[in] h  Object handle to compare against
-        /// \return
-        /// - Non zero when object handle is greater than h;
-        /// - Zero otherwise.
+        sanitizing_allocator() noexcept : _Mybase()
+        {}
+
         ///
-        bool operator>(_In_opt_ handle_type h) const
-        {
-            return h < m_h;
-        }
+        /// Construct by copying
+        ///
+        sanitizing_allocator(_In_ const sanitizing_allocator<_Ty> &_Othr) : _Mybase(_Othr)
+        {}
 
         ///
-        /// Is handle not equal to?
+        /// Construct from a related allocator
         ///
-        /// \param[in] h  Object handle to compare against
-        /// \return
-        /// - Non zero when object handle is not equal to h;
-        /// - Zero otherwise.
+        template<class _Other>
+        sanitizing_allocator(_In_ const sanitizing_allocator<_Other> &_Othr) noexcept : _Mybase(_Othr)
+        {}
+
         ///
-        bool operator!=(_In_opt_ handle_type h) const
+        /// Deallocate object at _Ptr sanitizing its content first
+        ///
+        void deallocate(_In_ _Ty* const _Ptr, _In_ const std::size_t _Count)
         {
-            return !operator==(h);
+            // Sanitize then free.
+            secure_wipe(_Ptr, sizeof(_Ty) * _Count);
+            _Mybase::deallocate(_Ptr, _Count);
         }
+    };
 
+    #pragma warning(pop)
+
+    ///
+    /// A sanitizing variant of std::string
+    ///
+    /// \note
+    /// `sanitizing_string` introduces a performance penalty. However, it provides an additional level of security.
+    /// Use for security sensitive data memory storage only.
+    ///
+    typedef std::basic_string<char, std::char_traits<char>, sanitizing_allocator<char> > sanitizing_string;
+
+    ///
+    /// A sanitizing variant of std::wstring
+    ///
+    /// \note
+    /// `sanitizing_wstring` introduces a performance penalty. However, it provides an additional level of security.
+    /// Use for security sensitive data memory storage only.
+    ///
+    typedef std::basic_string<wchar_t, std::char_traits<wchar_t>, sanitizing_allocator<wchar_t> > sanitizing_wstring;
+
+    ///
+    /// Multi-byte / Wide-character sanitizing string (according to _UNICODE)
+    ///
+#ifdef _UNICODE
+    typedef sanitizing_wstring sanitizing_tstring;
+#else
+    typedef sanitizing_string sanitizing_tstring;
+#endif
+
+#ifdef __cpp_lib_memory_resource
+    ///
+    /// Memory resource adapter that sanitizes each memory block before returning it to the upstream resource
+    ///
+    /// Brings sanitizing_allocator behaviour to `std::pmr` containers.
+    ///
+    /// \note
+    /// `sanitizing_memory_resource` introduces a performance penalty. However, it provides an additional level of security.
+    /// Use for security sensitive data memory storage only.
+    ///
+    class sanitizing_memory_resource : public std::pmr::memory_resource
+    {
+    public:
         ///
-        /// Is handle equal to?
-        ///
-        /// \param[in] h  Object handle to compare against
-        /// \return
-        /// - Non zero when object handle is equal to h;
-        /// - Zero otherwise.
-        ///
-        bool operator==(_In_opt_ handle_type h) const
-        {
-            return m_h == h;
-        }
-
+        /// Constructs adapter
         ///
-        /// Sets a new object handle for the class
+        /// \param[in] upstream  Resource to allocate from
         ///
-        /// When the current object handle of the class is non-INVAL, the object is destroyed first.
+        sanitizing_memory_resource(_In_ std::pmr::memory_resource *upstream = std::pmr::get_default_resource()) noexcept :
+            m_upstream(upstream)
+        {}
+
         ///
-        /// \param[in] h  New object handle
+        /// Returns the upstream resource
         ///
-        void attach(_In_opt_ handle_type h) noexcept
+        std::pmr::memory_resource* upstream_resource() const noexcept
         {
-            if (m_h != invalid)
-                free_internal();
-            m_h = h;
+            return m_upstream;
         }
 
-        ///
-        /// Dismisses the object handle from this class
-        ///
-        /// \return Object handle
-        ///
-        handle_type detach()
+    protected:
+        /// \cond internal
+        virtual void* do_allocate(_In_ size_t size, _In_ size_t align) override
         {
-            handle_type h = m_h;
-            m_h = invalid;
-            return h;
+            return m_upstream->allocate(size, align);
         }
 
-        ///
-        /// Destroys the object
-        ///
-        void free()
+        virtual void do_deallocate(_In_ void *p, _In_ size_t size, _In_ size_t align) override
         {
-            if (m_h != invalid) {
-                free_internal();
-                m_h = invalid;
-            }
+            // Sanitize then free.
+            secure_wipe(p, size);
+            m_upstream->deallocate(p, size, align);
         }
 
-    protected:
-        ///
-        /// Abstract member function that must be implemented by child classes to do the actual object destruction.
-        ///
-        virtual void free_internal() noexcept = 0;
+        virtual bool do_is_equal(_In_ const std::pmr::memory_resource &other) const noexcept override
+        {
+            const sanitizing_memory_resource *o = dynamic_cast<const sanitizing_memory_resource*>(&other);
+            return this == &other || (o && m_upstream->is_equal(*o->m_upstream));
+        }
+        /// \endcond
 
     protected:
-        handle_type m_h; ///< Object handle
+        std::pmr::memory_resource *m_upstream;  ///< Upstream resource
     };
+#endif
 
-    template <class T, const T INVAL>
-    const T handle<T, INVAL>::invalid = INVAL;
+    ///
+    /// Size of sanitizing_blob determined at runtime
+    ///
+    const size_t dynamic_blob_size = (size_t)-1;
 
     ///
-    /// Base abstract template class to support object handle keeping for objects that support trivial handle duplication
+    /// Sanitizing BLOB
     ///
-    template <class T, T INVAL>
-    class dplhandle : public handle<T, INVAL>
+    /// \tparam N  Size of BLOB in bytes; `dynamic_blob_size` for size determined at runtime
+    ///
+    template<size_t N = dynamic_blob_size>
+    class sanitizing_blob
     {
     public:
         ///
-        /// Initializes a new class instance with the object handle set to INVAL.
-        ///
-        dplhandle() noexcept
-        {}
-
-        ///
-        /// Initializes a new class instance with an already available object handle.
-        ///
-        /// \param[in] h  Initial object handle value
-        ///
-        dplhandle(_In_opt_ handle_type h) noexcept : handle<handle_type, INVAL>(h)
-        {}
-
-        ///
-        /// Copy constructor
-        ///
-        /// \param[inout] h  A reference of another object
+        /// Constructs zero-initialized BLOB
         ///
-        dplhandle<handle_type, INVAL>(_In_ const dplhandle<handle_type, INVAL> &h) : handle<handle_type, INVAL>(duplicate_internal(h.m_h))
-        {}
+        sanitizing_blob() noexcept
+        {
+            ZeroMemory(m_data, N);
+        }
 
         ///
-        /// Move constructor
-        ///
-        /// \param[inout] h  A rvalue reference of another object
+        /// Copies BLOB
         ///
-        dplhandle<handle_type, INVAL>(_Inout_ dplhandle<handle_type, INVAL> &&h) noexcept : handle<handle_type, INVAL>(std::move(h))
-        {}
+        sanitizing_blob(_In_ const sanitizing_blob &other) noexcept
+        {
+            memcpy(m_data, other.m_data, N);
+        }
 
         ///
-        /// Attaches already available object handle.
-        ///
-        /// \param[in] h  Object handle value
+        /// Moves BLOB and sanitizes the source
         ///
-        dplhandle<handle_type, INVAL>& operator=(_In_opt_ handle_type h) noexcept
+        sanitizing_blob(_Inout_ sanitizing_blob &&other) noexcept
         {
-            handle<handle_type, INVAL>::operator=(h);
-            return *this;
+            memcpy(m_data, other.m_data, N);
+            secure_wipe(other.m_data, N);
         }
 
         ///
-        /// Duplicates the object.
-        ///
-        /// \param[in] h  Object
+        /// Sanitizes BLOB
         ///
-        dplhandle<handle_type, INVAL>& operator=(_In_ const dplhandle<handle_type, INVAL> &h) noexcept
+        ~sanitizing_blob()
         {
-            if (this != std::addressof(h)) {
-                if (h.m_h != invalid) {
-                    handle_type h_new = duplicate_internal(h.m_h);
-
-                    if (m_h != invalid)
-                        free_internal();
-
-                    m_h = h_new;
-                } else {
-                    if (m_h != invalid)
-                        free_internal();
-
-                    m_h = invalid;
-                }
-            }
-            return *this;
+            secure_wipe(m_data, N);
         }
 
         ///
-        /// Moves the object.
-        ///
-        /// \param[inout] h  A rvalue reference of another object
+        /// Copies BLOB
         ///
-        #pragma warning(disable: 26432) // Move constructor is also present, but not detected by code analysis somehow.
-        dplhandle<handle_type, INVAL>& operator=(_Inout_ dplhandle<handle_type, INVAL> &&h) noexcept
+        sanitizing_blob& operator=(_In_ const sanitizing_blob &other) noexcept
         {
-            handle<handle_type, INVAL>::operator=(std::move(h));
+            if (this != std::addressof(other))
+                memcpy(m_data, other.m_data, N);
             return *this;
         }
 
         ///
-        /// Duplicates and returns a new object handle.
-        ///
-        /// \return Duplicated object handle
+        /// Moves BLOB and sanitizes the source
         ///
-        handle_type duplicate() const
+        sanitizing_blob& operator=(_Inout_ sanitizing_blob &&other) noexcept
         {
-            return m_h != invalid ? duplicate_internal(m_h) : invalid;
+            if (this != std::addressof(other)) {
+                memcpy(m_data, other.m_data, N);
+                secure_wipe(other.m_data, N);
+            }
+            return *this;
         }
 
         ///
-        /// Duplicates an object handle and sets a new object handle.
-        ///
-        /// \param[in] h  Object handle of existing object
+        /// Returns BLOB data
         ///
-        void attach_duplicated(_In_opt_ handle_type h)
-        {
-            if (m_h != invalid)
-                free_internal();
-
-            m_h = h != invalid ? duplicate_internal(h) : invalid;
-        }
+        unsigned char* data() noexcept { return m_data; }
 
-    protected:
         ///
-        /// Abstract member function that must be implemented by child classes to do the actual object handle duplication.
-        /// On failure, it should throw appropriate exception describing the cause, rather than return an invalid handle.
+        /// Returns BLOB data
         ///
-        /// \param[in] h  Object handle of existing object
+        const unsigned char* data() const noexcept { return m_data; }
+
         ///
-        /// \return Duplicated object handle
+        /// Returns BLOB size in bytes
         ///
-        virtual handle_type duplicate_internal(_In_ handle_type h) const = 0;
-    };
-
-    /// @}
-
-    /// \addtogroup WinStdExceptions
-    /// @{
-
-    ///
-    /// Loads exception message string from resources and converts it to UTF-8.
-    ///
-    /// \param[in] hModule    Module to load resource string from
-    /// \param[in] nId        Resource string ID number
-    /// \param[in] wLanguage  Resource string language
-    ///
-    /// \return Loaded string in UTF-8 encoding. As std::exception messages may only be char*, we use UTF-8 by convention.
-    ///
-    inline std::string load_msg_from_res(_In_opt_ HMODULE hModule, _In_ UINT nId, _In_ WORD wLanguage)
-    {
-        std::string sResult;
-        HRSRC hFoundRes = FindResourceExW(hModule, MAKEINTRESOURCEW(6), MAKEINTRESOURCEW(nId), wLanguage);
-        if (hFoundRes) {
-            DWORD dwSize = SizeofResource(hModule, hFoundRes);
-            if (dwSize) {
-                HGLOBAL hLoadedRes = LoadResource(hModule, hFoundRes);
-                if (hLoadedRes) {
-                    LPCWSTR szMessage = reinterpret_cast<LPCWSTR>(LockResource(hLoadedRes));
-                    if (szMessage) {
-                        WideCharToMultiByte(CP_UTF8, 0, szMessage, dwSize / sizeof(*szMessage), sResult, NULL, NULL);
-                        return sResult;
-                    } else
-                        SetLastError(ERROR_LOCK_FAILED);
-                }
-            }
-        }
-        sprintf(sResult, "msg %u", nId);
-        return sResult;
-    }
+        static constexpr size_t size() noexcept { return N; }
 
-    ///
-    /// Loads exception message sprintf template from resources, formats it and converts it to UTF-8.
-    ///
-    /// \param[in] hModule    Module to load resource string from
-    /// \param[in] nId        Resource string ID number
-    /// \param[in] wLanguage  Resource string language
-    ///
-    /// \return Loaded string in UTF-8 encoding. As std::exception messages may only be char*, we use UTF-8 by convention.
-    ///
-    inline std::string fmt_msg_from_res(_In_opt_ HMODULE hModule, _In_ UINT nId, _In_ WORD wLanguage, ...)
-    {
-        std::string sResult;
-        HRSRC hFoundRes = FindResourceExW(hModule, MAKEINTRESOURCEW(6), MAKEINTRESOURCEW(nId), wLanguage);
-        if (hFoundRes) {
-            DWORD dwSize = SizeofResource(hModule, hFoundRes);
-            if (dwSize) {
-                HGLOBAL hLoadedRes = LoadResource(hModule, hFoundRes);
-                if (hLoadedRes) {
-                    LPCWSTR szFormat = reinterpret_cast<LPCWSTR>(LockResource(hLoadedRes));
-                    if (szFormat) {
-                        dwSize /= sizeof(*szFormat);
-                        assert(wcsnlen(szFormat, dwSize) < dwSize); // Resource strings must be zero-terminated to make strings directly usable with sprintf.
-                        va_list arg;
-                        va_start(arg, wLanguage);
-                        std::wstring sMessage;
-                        vsprintf(sMessage, szFormat, arg);
-                        va_end(arg);
-                        WideCharToMultiByte(CP_UTF8, 0, sMessage, sResult, NULL, NULL);
-                        return sResult;
-                    } else
-                        SetLastError(ERROR_LOCK_FAILED);
-                }
-            }
-        }
-        sprintf(sResult, "msg %u", nId);
-        return sResult;
-    }
+    public:
+        unsigned char m_data[N];    ///< BLOB data
+    };
 
     ///
-    /// Numerical runtime error
+    /// Sanitizing BLOB of size determined at runtime
     ///
-    template <typename _Tn>
-    class num_runtime_error : public std::runtime_error
+    template<>
+    class sanitizing_blob<dynamic_blob_size>
     {
     public:
-        typedef _Tn error_type; ///< Error number type
+        ///
+        /// Constructs empty BLOB
+        ///
+        sanitizing_blob() noexcept :
+            m_data(NULL),
+            m_size(0)
+        {}
 
-    public:
         ///
-        /// Constructs an exception
+        /// Constructs zero-initialized BLOB
         ///
-        /// \param[in] num  Numeric error code
-        /// \param[in] msg  Error message
+        /// \param[in] size  Size of BLOB in bytes
         ///
-        num_runtime_error(_In_ error_type num, _In_ const std::string& msg) :
-            m_num(num),
-            runtime_error(msg)
+        explicit sanitizing_blob(_In_ size_t size) :
+            m_data(size ? new unsigned char[size]() : NULL),
+            m_size(size)
         {}
 
         ///
-        /// Constructs an exception
+        /// Constructs BLOB from data
         ///
-        /// \param[in] num  Numeric error code
-        /// \param[in] msg  Error message
+        /// \param[in] data  BLOB data
+        /// \param[in] size  Size of BLOB in bytes
         ///
-        num_runtime_error(_In_ error_type num, _In_opt_z_ const char *msg = nullptr) :
-            m_num(num),
-            runtime_error(msg)
+        sanitizing_blob(_In_reads_bytes_(size) const void *data, _In_ size_t size) :
+            m_data(size ? new unsigned char[size] : NULL),
+            m_size(size)
+        {
+            if (size)
+                memcpy(m_data, data, size);
+        }
+
+        ///
+        /// Copies BLOB
+        ///
+        sanitizing_blob(_In_ const sanitizing_blob &other) : sanitizing_blob(other.m_data, other.m_size)
         {}
 
         ///
-        /// Returns the error number
+        /// Moves BLOB
+        ///
+        /// Data is not copied: the source is left empty.
+        ///
+        sanitizing_blob(_Inout_ sanitizing_blob &&other) noexcept :
+            m_data(other.m_data),
+            m_size(other.m_size)
+        {
+            other.m_data = NULL;
+            other.m_size = 0;
+        }
+
+        ///
+        /// Sanitizes BLOB
+        ///
+        ~sanitizing_blob()
+        {
+            destroy();
+        }
+
+        ///
+        /// Copies BLOB
+        ///
+        sanitizing_blob& operator=(_In_ const sanitizing_blob &other)
+        {
+            if (this != std::addressof(other))
+                *this = sanitizing_blob(other);
+            return *this;
+        }
+
+        ///
+        /// Moves BLOB
         ///
-        error_type number() const
+        sanitizing_blob& operator=(_Inout_ sanitizing_blob &&other) noexcept
         {
-            return m_num;
+            if (this != std::addressof(other)) {
+                destroy();
+                m_data = other.m_data;
+                m_size = other.m_size;
+                other.m_data = NULL;
+                other.m_size = 0;
+            }
+            return *this;
         }
 
-    protected:
-        error_type m_num;  ///< Numeric error code
-    };
-
-    ///
-    /// Saves GetLastError and restores SetLastError when going out of scope
-    ///
-    class last_error_saver
-    {
-    public:
         ///
-        /// Saves the calling thread's last-error code value.
+        /// Resizes BLOB
         ///
-        /// \sa [GetLastError function](https://learn.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror)
+        /// Existing data is preserved up to the new size, and the old memory is sanitized. New bytes are zero.
         ///
-        last_error_saver(_In_ DWORD error = GetLastError()) :
-            m_error(error)
-        {}
+        /// \param[in] size  New size of BLOB in bytes
+        ///
+        void resize(_In_ size_t size)
+        {
+            if (size == m_size)
+                return;
+            sanitizing_blob other(size);
+            if (m_size && size)
+                memcpy(other.m_data, m_data, size < m_size ? size : m_size);
+            *this = std::move(other);
+        }
 
         ///
-        /// Sets the last-error code for the calling thread.
+        /// Returns BLOB data
         ///
-        /// \sa [SetLastError function](https://learn.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-setlasterror)
+        unsigned char* data() noexcept { return m_data; }
+
         ///
-        ~last_error_saver()
+        /// Returns BLOB data
+        ///
+        const unsigned char* data() const noexcept { return m_data; }
+
+        ///
+        /// Returns BLOB size in bytes
+        ///
+        size_t size() const noexcept { return m_size; }
+
+    protected:
+        /// \cond internal
+        void destroy() noexcept
         {
-            SetLastError(m_error);
+            if (m_data) {
+                secure_wipe(m_data, m_size);
+                delete[] m_data;
+            }
         }
+        /// \endcond
 
     protected:
-        DWORD m_error;
+        unsigned char *m_data;  ///< BLOB data
+        size_t m_size;          ///< BLOB size in bytes
     };
 
     ///
-    /// Windows runtime error
+    /// Sanitizing memory arena for security sensitive data
     ///
-    class win_runtime_error : public num_runtime_error<DWORD>
+    /// Memory is reserved in slabs of locked pages, which the system does not write to the page file. Blocks of up to
+    /// `max_block_size` bytes are carved from slabs in power-of-two size classes and recycled through per-class free
+    /// lists without returning to the system heap. Larger blocks get their own locked region. Each block is wiped on
+    /// deallocation, and all slabs are wiped in bulk when the arena is released.
+    ///
+    /// Locking pages may fail when it would exceed the working set quota of the process. The arena keeps working
+    /// without locking then, and locked() reports `false`.
+    ///
+    /// The arena is thread-safe. It is a `std::pmr::memory_resource` when the standard library provides one.
+    ///
+    /// \sa sanitizing_arena_allocator
+    ///
+    class sanitizing_arena
+#ifdef __cpp_lib_memory_resource
+        : public std::pmr::memory_resource
+#endif
     {
+        WINSTD_NONCOPYABLE(sanitizing_arena)
+        WINSTD_NONMOVABLE(sanitizing_arena)
+
     public:
+        static const size_t min_block_size = 0x10;   ///< Smallest size class
+        static const size_t max_block_size = 0x1000; ///< Largest size class; larger blocks get their own region
+
         ///
-        /// Constructs an exception
+        /// Constructs arena
         ///
-        /// \param[in] num Windows error code
+        /// \param[in] slab_size  Size of locked regions to carve blocks from; rounded up to page size
         ///
-        win_runtime_error(_In_ error_type num) : num_runtime_error<DWORD>(num, message(num))
-        {}
+        sanitizing_arena(_In_ size_t slab_size = 0x10000) noexcept :
+            m_slab_size(slab_size > max_block_size ? slab_size : max_block_size),
+            m_locked(true),
+            m_free(),
+            m_next(NULL),
+            m_end(NULL)
+        {
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            m_slab_size = (m_slab_size + si.dwPageSize - 1) & ~(size_t)(si.dwPageSize - 1);
+            InitializeSRWLock(&m_lock);
+        }
 
         ///
-        /// Constructs an exception
-        ///
-        /// \param[in] num Windows error code
-        /// \param[in] msg Error message
+        /// Wipes and releases all memory
         ///
-        win_runtime_error(_In_ error_type num, _In_ const std::string& msg) : num_runtime_error<DWORD>(num, msg + ": " + message(num))
-        {}
+        virtual ~sanitizing_arena()
+        {
+            release();
+        }
 
         ///
-        /// Constructs an exception
+        /// Allocates block of memory
         ///
-        /// \param[in] num  Windows error code
-        /// \param[in] msg  Error message
+        /// \param[in] size   Number of bytes
+        /// \param[in] align  Alignment; must be power of two
         ///
-        win_runtime_error(_In_ error_type num, _In_z_ const char *msg) : num_runtime_error<DWORD>(num, std::string(msg) + ": " + message(num))
-        {}
-
+        /// \return Pointer to the block
         ///
-        /// Constructs an exception using `GetLastError()`
+        /// \throw std::bad_alloc when the system is out of memory
         ///
-        win_runtime_error() : num_runtime_error<DWORD>(GetLastError(), message(GetLastError()))
-        {}
+        _Ret_notnull_ void* allocate(_In_ size_t size, _In_ size_t align = alignof(std::max_align_t))
+        {
+            const size_t block = block_size(size, align);
+            AcquireSRWLockExclusive(&m_lock);
+            void *p;
+            if (block > max_block_size) {
+                try {
+                    m_regions.reserve(m_regions.size() + 1);
+                    p = alloc_region(block);
+                }
+                catch (...) {
+                    ReleaseSRWLockExclusive(&m_lock);
+                    throw;
+                }
+                m_regions.push_back({ p, block });
+            } else {
+                void *&head = m_free[size_class(block)];
+                if (head) {
+                    // Recycle.
+                    p = head;
+                    head = *reinterpret_cast<void**>(p);
+                    *reinterpret_cast<void**>(p) = NULL;
+                } else {
+                    // Slabs are page-aligned. Carving each block at a multiple of its size keeps it naturally aligned.
+                    unsigned char *next = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(m_next) + block - 1) & ~static_cast<uintptr_t>(block - 1));
+                    if (next > m_end || static_cast<size_t>(m_end - next) < block) {
+                        try {
+                            m_slabs.reserve(m_slabs.size() + 1);
+                            next = reinterpret_cast<unsigned char*>(alloc_region(m_slab_size));
+                        }
+                        catch (...) {
+                            ReleaseSRWLockExclusive(&m_lock);
+                            throw;
+                        }
+                        m_slabs.push_back({ next, m_slab_size });
+                        m_end = next + m_slab_size;
+                    }
+                    p = next;
+                    m_next = next + block;
+                }
+            }
+            ReleaseSRWLockExclusive(&m_lock);
+            return p;
+        }
 
         ///
-        /// Constructs an exception using `GetLastError()`
+        /// Wipes and deallocates block of memory
         ///
-        /// \param[in] msg  Error message
+        /// \param[in] p      Pointer to the block
+        /// \param[in] size   Number of bytes as passed to allocate()
+        /// \param[in] align  Alignment as passed to allocate()
         ///
-        win_runtime_error(_In_ const std::string& msg) : num_runtime_error<DWORD>(GetLastError(), msg + ": " + message(GetLastError()))
-        {}
+        void deallocate(_In_opt_ void *p, _In_ size_t size, _In_ size_t align = alignof(std::max_align_t)) noexcept
+        {
+            if (!p)
+                return;
+            const size_t block = block_size(size, align);
+            if (block <= max_block_size)
+                secure_wipe(p, block);
+            AcquireSRWLockExclusive(&m_lock);
+            if (block > max_block_size) {
+                for (auto r = m_regions.begin(); r != m_regions.end(); ++r) {
+                    if (r->base == p) {
+                        free_region(r->base, r->size);
+                        m_regions.erase(r);
+                        break;
+                    }
+                }
+            } else {
+                void *&head = m_free[size_class(block)];
+                *reinterpret_cast<void**>(p) = head;
+                head = p;
+            }
+            ReleaseSRWLockExclusive(&m_lock);
+        }
 
         ///
-        /// Constructs an exception using `GetLastError()`
+        /// Wipes and releases all memory back to the system
         ///
-        /// \param[in] msg  Error message
+        /// All blocks allocated from the arena become invalid.
         ///
-        win_runtime_error(_In_z_ const char *msg) : num_runtime_error<DWORD>(GetLastError(), std::string(msg) + ": " + message(GetLastError()))
-        {}
+        void release() noexcept
+        {
+            AcquireSRWLockExclusive(&m_lock);
+            for (auto &r : m_regions)
+                free_region(r.base, r.size);
+            m_regions.clear();
+            for (auto &s : m_slabs)
+                free_region(s.base, s.size);
+            m_slabs.clear();
+            memset(m_free, 0, sizeof(m_free));
+            m_next = m_end = NULL;
+            ReleaseSRWLockExclusive(&m_lock);
+        }
 
-    protected:
         ///
-        /// Returns a user-readable Windows error message.
-        /// As std::exception messages may only be char*, we use UTF-8 by convention.
-        ///
-        /// \sa [FormatMessage function](https://docs.microsoft.com/en-us/windows/desktop/api/winbase/nf-winbase-formatmessage)
+        /// Returns `true` if all memory of the arena was locked in physical memory
         ///
-        static std::string message(_In_ error_type num, _In_opt_ DWORD dwLanguageId = 0)
+        bool locked() const noexcept
         {
-            last_error_saver last_error_save;
-            std::wstring wstr;
-            if (FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, 0, num, dwLanguageId, wstr, NULL)) {
-                // Stock Windows error messages contain CRLF. Well... Trim all the trailing white space.
-                wstr.erase(wstr.find_last_not_of(L" \t\n\r\f\v") + 1);
-            } else
-                sprintf(wstr, num >= 0x10000 ? L"Error 0x%X" : L"Error %u", num);
-            std::string str;
-            WideCharToMultiByte(CP_UTF8, 0, wstr, str, NULL, NULL);
-            return str;
+            return m_locked.load(std::memory_order_relaxed);
         }
-    };
 
-    /// @}
+    protected:
+        /// \cond internal
 
-    /// \addtogroup WinStdStrFormat
-    /// @{
+#ifdef __cpp_lib_memory_resource
+        virtual void* do_allocate(_In_ size_t size, _In_ size_t align) override
+        {
+            return allocate(size, align);
+        }
+
+        virtual void do_deallocate(_In_ void *p, _In_ size_t size, _In_ size_t align) override
+        {
+            deallocate(p, size, align);
+        }
+
+        virtual bool do_is_equal(_In_ const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+#endif
+
+        static size_t block_size(_In_ size_t size, _In_ size_t align)
+        {
+            if (size < align)
+                size = align;
+            if (size > max_block_size) {
+                // Regions are aligned to allocation granularity (64 kB).
+                if (align > 0x10000)
+                    throw std::bad_alloc();
+                return size;
+            }
+            size_t block = min_block_size;
+            while (block < size)
+                block <<= 1;
+            return block;
+        }
+
+        static size_t size_class(_In_ size_t block) noexcept
+        {
+            size_t c = 0;
+            for (size_t b = min_block_size; b < block; b <<= 1)
+                ++c;
+            return c;
+        }
+
+        void* alloc_region(_In_ size_t size)
+        {
+            void *p = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (!p)
+                throw std::bad_alloc();
+            if (!VirtualLock(p, size))
+                m_locked.store(false, std::memory_order_relaxed);
+            return p;
+        }
+
+        static void free_region(_In_ void *p, _In_ size_t size) noexcept
+        {
+            secure_wipe(p, size);
+            VirtualUnlock(p, size);
+            VirtualFree(p, 0, MEM_RELEASE);
+        }
+
+        /// \endcond
+
+    protected:
+        /// \cond internal
+        struct region {
+            void *base;
+            size_t size;
+        };
+        /// \endcond
+
+        SRWLOCK m_lock;                     ///< Lock
+        size_t m_slab_size;                 ///< Size of a slab
+        std::atomic<bool> m_locked;         ///< Were all regions locked successfully? Readable without the lock
+        std::vector<region> m_slabs;        ///< Slabs to carve blocks from
+        std::vector<region> m_regions;      ///< Regions of blocks larger than `max_block_size`
+        void *m_free[9];                    ///< Free lists per size class: 16, 32, ..., 4096
+        unsigned char *m_next;              ///< Next free byte in the current slab
+        unsigned char *m_end;               ///< End of the current slab
+    };
 
     ///
-    /// Base template class to support string formatting using `printf()` style templates
+    /// An allocator template that allocates from a sanitizing_arena
     ///
-    template<class _Elem, class _Traits, class _Ax>
-    class basic_string_printf : public std::basic_string<_Elem, _Traits, _Ax>
+    /// The allocator stays with the container on copy and move assignment and swap. Assigning a container that uses
+    /// a different arena copies or moves its elements one by one into memory of the target arena, so secrets never
+    /// leave the arena they were allocated from. Swapping containers of different arenas is undefined.
+    ///
+    template<class _Ty>
+    class sanitizing_arena_allocator
     {
+        template<class _Other>
+        friend class sanitizing_arena_allocator;
+
     public:
-        /// \name Initializing string using template in memory
-        /// @{
+        typedef _Ty value_type;                                             ///< Element type
+        typedef std::false_type propagate_on_container_copy_assignment;     ///< Allocator stays with the container
+        typedef std::false_type propagate_on_container_move_assignment;     ///< Allocator stays with the container; elements are moved one by one between different arenas
+        typedef std::false_type propagate_on_container_swap;                ///< Allocator stays with the container
+        typedef std::false_type is_always_equal;                            ///< Allocators of different arenas are not interchangeable
 
         ///
-        /// Initializes a new string and formats its contents using `printf()` style template.
-        ///
-        /// \param[in] format  String template using `printf()` style
+        /// Convert this type to sanitizing_arena_allocator<_Other>
         ///
-        basic_string_printf(_In_z_ _Printf_format_string_ const _Elem *format, ...)
+        template<class _Other>
+        struct rebind
         {
-            va_list arg;
-            va_start(arg, format);
-            vsprintf(*this, format, arg);
-            va_end(arg);
-        }
-
-        /// @}
+            typedef sanitizing_arena_allocator<_Other> other; ///< Other type
+        };
 
-        /// \name Initializing string using template in resources
-        /// @{
+        ///
+        /// Construct allocator
+        ///
+        /// \param[in] arena  Arena to allocate from. Must outlive the allocator and all of its allocations.
+        ///
+        sanitizing_arena_allocator(_In_ sanitizing_arena &arena) noexcept : m_arena(&arena)
+        {}
 
         ///
-        /// Initializes a new string and formats its contents using `printf()` style template in resources.
+        /// Construct from a related allocator
         ///
-        /// \param[in] hInstance  Resource module handle
-        /// \param[in] nFormatID  Resource ID of the string template using `printf()` style
+        template<class _Other>
+        sanitizing_arena_allocator(_In_ const sanitizing_arena_allocator<_Other> &other) noexcept : m_arena(other.m_arena)
+        {}
+
         ///
-        basic_string_printf(_In_ HINSTANCE hInstance, _In_ UINT nFormatID, ...)
+        /// Allocate memory for `count` objects
+        ///
+        _Ret_notnull_ _Ty* allocate(_In_ size_t count)
         {
-            _Myt format;
-            ATLENSURE(format.LoadString(hInstance, nFormatID));
-
-            va_list arg;
-            va_start(arg, nFormatID);
-            vsprintf(*this, format, arg);
-            va_end(arg);
+            if (count > SIZE_MAX / sizeof(_Ty))
+                throw std::bad_array_new_length();
+            return static_cast<_Ty*>(m_arena->allocate(count * sizeof(_Ty), alignof(_Ty)));
         }
 
         ///
-        /// Initializes a new string and formats its contents using `printf()` style template in resources.
+        /// Sanitize and deallocate memory of `count` objects
         ///
-        /// \param[in] hInstance    Resource module handle
-        /// \param[in] wLanguageID  Resource language
-        /// \param[in] nFormatID    Resource ID of the string template using `printf()` style
+        void deallocate(_In_ _Ty *p, _In_ size_t count) noexcept
+        {
+            m_arena->deallocate(p, count * sizeof(_Ty), alignof(_Ty));
+        }
+
         ///
-        basic_string_printf(_In_ HINSTANCE hInstance, _In_ WORD wLanguageID, _In_ UINT nFormatID, ...)
+        /// Are allocators interchangeable?
+        ///
+        template<class _Other>
+        bool operator==(_In_ const sanitizing_arena_allocator<_Other> &other) const noexcept
         {
-            _Myt format;
-            ATLENSURE(format.LoadString(hInstance, nFormatID, wLanguageID));
+            return m_arena == other.m_arena;
+        }
 
-            va_list arg;
-            va_start(arg, nFormatID);
-            vsprintf(*this, format, arg);
-            va_end(arg);
+        ///
+        /// Are allocators not interchangeable?
+        ///
+        template<class _Other>
+        bool operator!=(_In_ const sanitizing_arena_allocator<_Other> &other) const noexcept
+        {
+            return m_arena != other.m_arena;
         }
 
-        /// }@
+    private:
+        sanitizing_arena *m_arena; ///< Arena to allocate from
     };
 
-    ///
-    /// Single-byte character implementation of a class to support string formatting using `printf()` style templates
-    ///
-    typedef basic_string_printf<char, std::char_traits<char>, std::allocator<char> > string_printf;
+    /// @}
+
+    /// \addtogroup WinStdGeneral
+    /// @{
 
     ///
-    /// Wide character implementation of a class to support string formatting using `printf()` style templates
+    /// In-place storage of inline_allocator
     ///
-    typedef basic_string_printf<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> > wstring_printf;
+    /// \tparam _Elem  Element type
+    /// \tparam N      Number of elements
+    ///
+    template<class _Elem, size_t N>
+    struct inline_buffer
+    {
+        alignas(_Elem) unsigned char m_data[sizeof(_Elem) * N];  ///< Storage
+        bool m_in_use = false;                                  ///< Is storage allocated?
+    };
 
     ///
-    /// Multi-byte / Wide-character formatted string (according to _UNICODE)
+    /// Allocator handing out in-place storage first and spilling to heap
     ///
-#ifdef _UNICODE
-    typedef wstring_printf tstring_printf;
-#else
-    typedef string_printf tstring_printf;
-#endif
-
+    /// The storage is handed out to one allocation of up to N elements of type `_Elem` at a time. Larger allocations,
+    /// allocations of other types, and allocations while the storage is in use come from heap. Allocators of different
+    /// storage are not interchangeable, so containers copy and move elements between them instead of stealing memory.
     ///
-    /// Base template class to support string formatting using `FormatMessage()` style templates
+    /// \tparam _Ty    Allocated type
+    /// \tparam _Elem  Element type of the storage
+    /// \tparam N      Number of elements of the storage
     ///
-    template<class _Elem, class _Traits, class _Ax>
-    class basic_string_msg : public std::basic_string<_Elem, _Traits, _Ax>
+    /// \sa basic_inline_string, inline_vector
+    ///
+    template<class _Ty, class _Elem, size_t N>
+    class inline_allocator
     {
     public:
-        /// \name Initializing string using template in memory
-        /// @{
+        typedef _Ty value_type;                                             ///< Element type
+        typedef std::false_type propagate_on_container_copy_assignment;     ///< Storage stays with the container
+        typedef std::false_type propagate_on_container_move_assignment;     ///< Storage stays with the container
+        typedef std::false_type propagate_on_container_swap;                ///< Storage stays with the container
+        typedef std::false_type is_always_equal;                            ///< Allocators of different storage are not interchangeable
 
         ///
-        /// Initializes a new string and formats its contents using `FormatMessage()` style template.
-        ///
-        /// \param[in] format  String template using `FormatMessage()` style
+        /// Convert this type to inline_allocator<_Other, _Elem, N>
         ///
-        basic_string_msg(_In_z_ _FormatMessage_format_string_ const _Elem *format, ...)
+        template<class _Other>
+        struct rebind
         {
-            va_list arg;
-            va_start(arg, format);
-            FormatMessage(FORMAT_MESSAGE_FROM_STRING, format, 0, 0, *this, &arg);
-            va_end(arg);
-        }
-
-        /// @}
+            typedef inline_allocator<_Other, _Elem, N> other; ///< Other type
+        };
 
-        /// \name Initializing string using template in resources
-        /// @{
+        ///
+        /// Construct allocator using heap only
+        ///
+        inline_allocator() noexcept : m_buffer(NULL)
+        {}
 
         ///
-        /// Initializes a new string and formats its contents using `FormatMessage()` style template in resources.
+        /// Construct allocator
         ///
-        /// \param[in] hInstance  Resource module handle
-        /// \param[in] nFormatID  Resource ID of the string template using `FormatMessage()` style
+        /// \param[in] buffer  Storage to allocate from first. Must outlive the allocator and all of its allocations.
         ///
-        basic_string_msg(_In_ HINSTANCE hInstance, _In_ UINT nFormatID, ...)
-        {
-            _Myt format(GetManager());
-            ATLENSURE(format.LoadString(hInstance, nFormatID));
-
-            va_list arg;
-            va_start(arg, nFormatID);
-            FormatMessage(FORMAT_MESSAGE_FROM_STRING, format, 0, 0, *this, &arg);
-            va_end(arg);
-        }
+        inline_allocator(_In_ inline_buffer<_Elem, N> &buffer) noexcept : m_buffer(&buffer)
+        {}
 
         ///
-        /// Initializes a new string and formats its contents using `FormatMessage()` style template in resources.
+        /// Construct from a related allocator
         ///
-        /// \param[in] hInstance    Resource module handle
-        /// \param[in] wLanguageID  Resource language
-        /// \param[in] nFormatID    Resource ID of the string template using `FormatMessage()` style
+        template<class _Other>
+        inline_allocator(_In_ const inline_allocator<_Other, _Elem, N> &other) noexcept : m_buffer(other.m_buffer)
+        {}
+
         ///
-        basic_string_msg(_In_ HINSTANCE hInstance, _In_ WORD wLanguageID, _In_ UINT nFormatID, ...)
+        /// Returns allocator for a copy of the container: using heap only, as the storage belongs to the original
+        ///
+        inline_allocator select_on_container_copy_construction() const noexcept
         {
-            _Myt format(GetManager());
-            ATLENSURE(format.LoadString(hInstance, nFormatID, wLanguageID));
-
-            va_list arg;
-            va_start(arg, nFormatID);
-            FormatMessage(FORMAT_MESSAGE_FROM_STRING, format, 0, 0, *this, &arg);
-            va_end(arg);
+            return inline_allocator();
         }
 
-        /// @}
-
         ///
-        /// Initializes a new string and formats its contents using `FormatMessage()` style.
-        ///
-        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+        /// Allocate memory for `count` objects
         ///
-        basic_string_msg(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _In_opt_ va_list *Arguments)
+        _Ret_notnull_ _Ty* allocate(_In_ size_t count)
         {
-            FormatMessage(dwFlags & ~FORMAT_MESSAGE_ARGUMENT_ARRAY, lpSource, dwMessageId, dwLanguageId, *this, Arguments);
+            if constexpr (std::is_same_v<_Ty, _Elem>) {
+                if (m_buffer && !m_buffer->m_in_use && count <= N) {
+                    m_buffer->m_in_use = true;
+                    return reinterpret_cast<_Ty*>(m_buffer->m_data);
+                }
+            }
+            return std::allocator<_Ty>().allocate(count);
         }
 
         ///
-        /// Initializes a new string and formats its contents using `FormatMessage()` style.
-        ///
-        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+        /// Deallocate memory of `count` objects
         ///
-        basic_string_msg(_In_ DWORD dwFlags, _In_opt_ LPCVOID lpSource, _In_ DWORD dwMessageId, _In_ DWORD dwLanguageId, _In_opt_ DWORD_PTR *Arguments)
+        void deallocate(_In_ _Ty *p, _In_ size_t count) noexcept
         {
-            FormatMessage(dwFlags | FORMAT_MESSAGE_ARGUMENT_ARRAY, lpSource, dwMessageId, dwLanguageId, *this, (va_list*)Arguments);
+            if constexpr (std::is_same_v<_Ty, _Elem>) {
+                if (m_buffer && p == reinterpret_cast<_Ty*>(m_buffer->m_data)) {
+                    m_buffer->m_in_use = false;
+                    return;
+                }
+            }
+            std::allocator<_Ty>().deallocate(p, count);
         }
 
         ///
-        /// Initializes a new string and formats its contents using `FormatMessage()` style.
-        ///
-        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+        /// Are allocators interchangeable?
         ///
-        basic_string_msg(_In_ DWORD dwFlags, _In_z_ LPCTSTR pszFormat, _In_opt_ va_list *Arguments)
+        template<class _Other>
+        bool operator==(_In_ const inline_allocator<_Other, _Elem, N> &other) const noexcept
         {
-            FormatMessage(dwFlags & ~FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_FROM_STRING, pszFormat, 0, 0, *this, Arguments);
+            return m_buffer == other.m_buffer;
         }
 
         ///
-        /// Initializes a new string and formats its contents using `FormatMessage()` style.
-        ///
-        /// \sa [FormatMessage function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms679351.aspx)
+        /// Are allocators not interchangeable?
         ///
-        basic_string_msg(_In_ DWORD dwFlags, _In_z_ LPCTSTR pszFormat, _In_opt_ DWORD_PTR *Arguments)
+        template<class _Other>
+        bool operator!=(_In_ const inline_allocator<_Other, _Elem, N> &other) const noexcept
         {
-            FormatMessage(dwFlags | FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_FROM_STRING, pszFormat, 0, 0, *this, (va_list*)Arguments);
+            return m_buffer != other.m_buffer;
         }
-    };
 
-    ///
-    /// Single-byte character implementation of a class to support string formatting using `FormatMessage()` style templates
-    ///
-    typedef basic_string_msg<char, std::char_traits<char>, std::allocator<char> > string_msg;
+    public:
+        inline_buffer<_Elem, N> *m_buffer; ///< Storage to allocate from first; NULL for heap only
+    };
 
     ///
-    /// Wide character implementation of a class to support string formatting using `FormatMessage()` style templates
-    ///
-    typedef basic_string_msg<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> > wstring_msg;
-
+    /// String holding up to N characters in place, spilling to heap when longer
     ///
-    /// Multi-byte / Wide-character formatted string (according to _UNICODE)
+    /// Derives from std::basic_string, so it can be passed to any helper writing into a std::basic_string. Helper
+    /// results of typical length, like module paths, window texts and account names, never touch the heap then.
     ///
-#ifdef _UNICODE
-    typedef wstring_msg tstring_msg;
-#else
-    typedef string_msg tstring_msg;
-#endif
-
+    /// \note
+    /// Do not move the string into a std::basic_string of the same allocator type: it would take the in-place storage
+    /// along. Use the allocator-extended constructors or assign() instead.
     ///
-    /// Base template class to support converting GUID to string
+    /// \tparam _Elem    Character type
+    /// \tparam N        Number of characters held in place
+    /// \tparam _Traits  Character traits
     ///
-    template<class _Elem, class _Traits, class _Ax>
-    class basic_string_guid : public std::basic_string<_Elem, _Traits, _Ax>
+    template<class _Elem, size_t N = MAX_PATH, class _Traits = std::char_traits<_Elem>>
+    class basic_inline_string :
+        private inline_buffer<_Elem, (N | 0xf) + 1>, // Strings round capacity up and add zero terminator.
+        public std::basic_string<_Elem, _Traits, inline_allocator<_Elem, _Elem, (N | 0xf) + 1>>
     {
     public:
-        /// \name Initializing string using template in memory
-        /// @{
+        typedef inline_buffer<_Elem, (N | 0xf) + 1> buffer_type;                   ///< In-place storage type
+        typedef inline_allocator<_Elem, _Elem, (N | 0xf) + 1> allocator_type;      ///< Allocator type
+        typedef std::basic_string<_Elem, _Traits, allocator_type> _Mybase;         ///< Base type
 
         ///
-        /// Initializes a new string and formats its contents to string representation of given GUID.
+        /// Constructs an empty string
         ///
-        /// \param[in] guid    GUID to convert
-        /// \param[in] format  A `printf()` syntax template to convert GUID to string (i.e. `"{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}"`)
+        basic_inline_string() : _Mybase(allocator_type(static_cast<buffer_type&>(*this)))
+        {
+            // Take the storage right away, so the string does not outgrow it while growing up to N characters.
+            this->reserve(N);
+        }
+
         ///
-        basic_string_guid(_In_ const GUID &guid, _In_z_ _Printf_format_string_ const _Elem *format)
+        /// Constructs a string from a zero-terminated string
+        ///
+        basic_inline_string(_In_z_ const _Elem *str) : basic_inline_string()
         {
-            sprintf<_Elem, _Traits, _Ax>(*this, format,
-                guid.Data1,
-                guid.Data2,
-                guid.Data3,
-                guid.Data4[0], guid.Data4[1],
-                guid.Data4[2], guid.Data4[3], guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+            this->assign(str);
         }
 
-        /// @}
-    };
+        ///
+        /// Constructs a string from a character sequence
+        ///
+        basic_inline_string(_In_reads_(count) const _Elem *str, _In_ size_t count) : basic_inline_string()
+        {
+            this->assign(str, count);
+        }
 
-    ///
-    /// Single-byte character implementation of a class to support converting GUID to string
-    ///
-    class string_guid : public basic_string_guid<char, std::char_traits<char>, std::allocator<char> >
-    {
-    public:
-        /// \name Initializing string using template in memory
-        /// @{
+        ///
+        /// Constructs a string from a string view
+        ///
+        basic_inline_string(_In_ std::basic_string_view<_Elem, _Traits> str) : basic_inline_string()
+        {
+            this->assign(str.data(), str.size());
+        }
 
         ///
-        /// Initializes a new string and formats its contents to string representation of given GUID.
+        /// Constructs a string from another string
         ///
-        /// \param[in] guid  GUID to convert
+        template<class _Ax>
+        basic_inline_string(_In_ const std::basic_string<_Elem, _Traits, _Ax> &str) : basic_inline_string()
+        {
+            this->assign(str.data(), str.size());
+        }
+
         ///
-        string_guid(_In_ const GUID &guid) :
-            basic_string_guid<char, std::char_traits<char>, std::allocator<char> >(guid, "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}")
-        {}
+        /// Copies the string
+        ///
+        basic_inline_string(_In_ const basic_inline_string &other) : basic_inline_string()
+        {
+            this->assign(other.data(), other.size());
+        }
 
-        /// @}
-    };
+        ///
+        /// Moves the string. Characters held in place are copied.
+        ///
+        /// Does not throw, so containers of strings move them when they grow. Moving a string that spilled to heap
+        /// allocates, and calls std::terminate() when the system is out of memory.
+        ///
+        basic_inline_string(_Inout_ basic_inline_string &&other) noexcept : basic_inline_string()
+        {
+            this->assign(other.data(), other.size());
+        }
 
-    ///
-    /// Wide character implementation of a class to support converting GUID to string
-    ///
-    class wstring_guid : public basic_string_guid<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> >
-    {
-    public:
-        /// \name Initializing string using template in memory
-        /// @{
+        ///
+        /// Copies the string
+        ///
+        basic_inline_string& operator=(_In_ const basic_inline_string &other)
+        {
+            _Mybase::operator=(other);
+            return *this;
+        }
 
         ///
-        /// Initializes a new string and formats its contents to string representation of given GUID.
+        /// Moves the string. Characters held in place are copied.
         ///
-        /// \param[in] guid  GUID to convert
+        basic_inline_string& operator=(_Inout_ basic_inline_string &&other)
+        {
+            _Mybase::operator=(std::move(other));
+            return *this;
+        }
+
+        using _Mybase::operator=;
+
         ///
-        wstring_guid(_In_ const GUID &guid) :
-            basic_string_guid<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t> >(guid, L"{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}")
-        {}
+        /// Exchanges the strings. Characters are copied, as strings of different storage cannot exchange memory.
+        ///
+        void swap(_Inout_ basic_inline_string &other)
+        {
+            if (this == &other)
+                return;
+            basic_inline_string tmp(other);
+            other.assign(this->data(), this->size());
+            this->assign(tmp.data(), tmp.size());
+        }
 
-        /// @}
+        ///
+        /// Is the string held in place?
+        ///
+        bool is_inline() const noexcept
+        {
+            const void *p = this->data();
+            return !std::less<const void*>()(p, this) && std::less<const void*>()(p, this + 1);
+        }
     };
 
     ///
-    /// Multi-byte / Wide-character string GUID (according to _UNICODE)
+    /// Exchanges the strings
     ///
-#ifdef _UNICODE
-    typedef wstring_guid tstring_guid;
-#else
-    typedef string_guid tstring_guid;
-#endif
+    template<class _Elem, size_t N, class _Traits>
+    void swap(_Inout_ basic_inline_string<_Elem, N, _Traits> &a, _Inout_ basic_inline_string<_Elem, N, _Traits> &b)
+    {
+        a.swap(b);
+    }
 
-    /// @}
+    ///
+    /// String holding up to N characters in place
+    ///
+    template<size_t N = MAX_PATH>
+    using inline_string = basic_inline_string<char, N>;
 
-    /// \addtogroup WinStdMemSanitize
-    /// @{
+    ///
+    /// Wide string holding up to N characters in place
+    ///
+    template<size_t N = MAX_PATH>
+    using inline_wstring = basic_inline_string<wchar_t, N>;
 
-    // winstd::sanitizing_allocator::destroy() member generates _Ptr parameter not used warning for primitive datatypes _Ty.
-    #pragma warning(push)
-    #pragma warning(disable: 4100)
+    ///
+    /// Multi-byte / Wide-character string holding up to N characters in place (according to _UNICODE)
+    ///
+    template<size_t N = MAX_PATH>
+    using inline_tstring = basic_inline_string<TCHAR, N>;
 
     ///
-    /// An allocator template that sanitizes each memory block before it is destroyed or reallocated
+    /// Vector holding up to N elements in place, spilling to heap when larger
+    ///
+    /// Derives from std::vector, so it can be passed to any helper writing into a std::vector.
     ///
     /// \note
-    /// `sanitizing_allocator` introduces a performance penalty. However, it provides an additional level of security.
-    /// Use for security sensitive data memory storage only.
+    /// Do not move the vector into a std::vector of the same allocator type: it would take the in-place storage
+    /// along. Use the allocator-extended constructors or assign() instead.
     ///
-    template<class _Ty>
-    class sanitizing_allocator : public std::allocator<_Ty>
+    /// \tparam _Ty  Element type
+    /// \tparam N    Number of elements held in place
+    ///
+    template<class _Ty, size_t N>
+    class inline_vector :
+        private inline_buffer<_Ty, N>,
+        public std::vector<_Ty, inline_allocator<_Ty, _Ty, N>>
     {
     public:
-        typedef std::allocator<_Ty> _Mybase; ///< Base type
+        typedef inline_buffer<_Ty, N> buffer_type;                 ///< In-place storage type
+        typedef inline_allocator<_Ty, _Ty, N> allocator_type;      ///< Allocator type
+        typedef std::vector<_Ty, allocator_type> _Mybase;          ///< Base type
 
         ///
-        /// Convert this type to sanitizing_allocator<_Other>
+        /// Constructs an empty vector
         ///
-        template<class _Other>
-        struct rebind
+        inline_vector() : _Mybase(allocator_type(static_cast<buffer_type&>(*this)))
         {
-            typedef sanitizing_allocator<_Other> other; ///< Other type
-        };
+            // Take the storage right away, so the vector does not outgrow it while growing up to N elements.
+            this->reserve(N);
+        }
 
         ///
-        /// Construct default allocator
+        /// Constructs a vector of `count` value-initialized elements
         ///
-        sanitizing_allocator() noexcept : _Mybase()
-        {}
+        explicit inline_vector(_In_ size_t count) : inline_vector()
+        {
+            this->resize(count);
+        }
 
         ///
-        /// Construct by copying
+        /// Constructs a vector from an initializer list
         ///
-        sanitizing_allocator(_In_ const sanitizing_allocator<_Ty> &_Othr) : _Mybase(_Othr)
-        {}
+        inline_vector(_In_ std::initializer_list<_Ty> list) : inline_vector()
+        {
+            this->assign(list);
+        }
 
         ///
-        /// Construct from a related allocator
+        /// Copies the vector
         ///
-        template<class _Other>
-        sanitizing_allocator(_In_ const sanitizing_allocator<_Other> &_Othr) noexcept : _Mybase(_Othr)
-        {}
+        inline_vector(_In_ const inline_vector &other) : inline_vector()
+        {
+            this->assign(other.begin(), other.end());
+        }
 
         ///
-        /// Deallocate object at _Ptr sanitizing its content first
+        /// Moves the vector. Elements held in place are moved one by one.
         ///
-        void deallocate(_In_ _Ty* const _Ptr, _In_ const std::size_t _Count)
+        /// Does not throw when moving elements does not throw, so containers of vectors move them when they grow. Moving
+        /// a vector that spilled to heap allocates, and calls std::terminate() when the system is out of memory.
+        ///
+        inline_vector(_Inout_ inline_vector &&other) noexcept(std::is_nothrow_move_constructible_v<_Ty>) : inline_vector()
         {
-            // Sanitize then free.
-            SecureZeroMemory(_Ptr, sizeof(_Ty) * _Count);
-            _Mybase::deallocate(_Ptr, _Count);
+            this->assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
         }
-    };
-
-    #pragma warning(pop)
 
-    ///
-    /// A sanitizing variant of std::string
-    ///
-    /// \note
-    /// `sanitizing_string` introduces a performance penalty. However, it provides an additional level of security.
-    /// Use for security sensitive data memory storage only.
-    ///
-    typedef std::basic_string<char, std::char_traits<char>, sanitizing_allocator<char> > sanitizing_string;
+        ///
+        /// Copies the vector
+        ///
+        inline_vector& operator=(_In_ const inline_vector &other)
+        {
+            _Mybase::operator=(other);
+            return *this;
+        }
 
-    ///
-    /// A sanitizing variant of std::wstring
-    ///
-    /// \note
-    /// `sanitizing_wstring` introduces a performance penalty. However, it provides an additional level of security.
-    /// Use for security sensitive data memory storage only.
-    ///
-    typedef std::basic_string<wchar_t, std::char_traits<wchar_t>, sanitizing_allocator<wchar_t> > sanitizing_wstring;
+        ///
+        /// Moves the vector. Elements held in place are moved one by one.
+        ///
+        inline_vector& operator=(_Inout_ inline_vector &&other)
+        {
+            _Mybase::operator=(std::move(other));
+            return *this;
+        }
 
-    ///
-    /// Multi-byte / Wide-character sanitizing string (according to _UNICODE)
-    ///
-#ifdef _UNICODE
-    typedef sanitizing_wstring sanitizing_tstring;
-#else
-    typedef sanitizing_string sanitizing_tstring;
-#endif
+        using _Mybase::operator=;
 
-    ///
-    /// Sanitizing BLOB
-    ///
-    template<size_t N>
-    class sanitizing_blob
-    {
-    public:
         ///
-        /// Constructs uninitialized BLOB
+        /// Exchanges the vectors. Elements are moved one by one, as vectors of different storage cannot exchange memory.
         ///
-        sanitizing_blob()
+        void swap(_Inout_ inline_vector &other)
         {
-            ZeroMemory(m_data, N);
+            if (this == &other)
+                return;
+            inline_vector tmp(std::move(other));
+            other.assign(std::make_move_iterator(this->begin()), std::make_move_iterator(this->end()));
+            this->assign(std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
         }
 
         ///
-        /// Sanitizes BLOB
+        /// Are the elements held in place?
         ///
-        ~sanitizing_blob()
+        bool is_inline() const noexcept
         {
-            SecureZeroMemory(m_data, N);
+            const void *p = this->data();
+            return !std::less<const void*>()(p, this) && std::less<const void*>()(p, this + 1);
         }
-
-    public:
-        unsigned char m_data[N];    ///< BLOB data
     };
 
+    ///
+    /// Exchanges the vectors
+    ///
+    template<class _Ty, size_t N>
+    void swap(_Inout_ inline_vector<_Ty, N> &a, _Inout_ inline_vector<_Ty, N> &b)
+    {
+        a.swap(b);
+    }
+
     /// @}
 }
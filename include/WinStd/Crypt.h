@@ -14,20 +14,34 @@
 #include <algorithm>
 #include <string>
 #include <vector>
+#ifdef __cpp_lib_span
+#include <span>
+#endif
+
+WINSTD_BACKEND_FN(CryptGetHashParam)
+WINSTD_BACKEND_FN(CryptExportKey)
+WINSTD_BACKEND_FN(CryptEncrypt)
+WINSTD_BACKEND_FN(CryptDecrypt)
 
 /// \addtogroup WinStdCryptoAPI
 /// @{
 
 /// @copydoc CertGetNameStringW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static DWORD CertGetNameStringA(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwType, _In_ DWORD dwFlags, _In_opt_ void *pvTypePara, _Out_ std::basic_string<char, _Traits, _Ax> &sNameString)
 {
-    // Query the final string length first.
-    DWORD dwSize = ::CertGetNameStringA(pCertContext, dwType, dwFlags, pvTypePara, NULL, 0);
-
-    // Allocate buffer on heap to format the string data into and read it.
-    sNameString.resize(dwSize - 1);
-    return ::CertGetNameStringA(pCertContext, dwType, dwFlags, pvTypePara, &sNameString[0], dwSize);
+    WINSTD_BUFFER_SITE("CertGetNameStringA");
+    DWORD dwSize = 0;
+    winstd::probe_then_fill<_Policy>(sNameString, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        dwSize = ::CertGetNameStringA(pCertContext, dwType, dwFlags, pvTypePara, pBuffer, (DWORD)cchBuffer);
+        if (dwSize < cchBuffer)
+            return winstd::buffer_probe::ok((size_t)dwSize - 1);
+        // The name was either truncated or fits exactly. Query the final string length to tell.
+        dwSize = ::CertGetNameStringA(pCertContext, dwType, dwFlags, pvTypePara, NULL, 0);
+        return dwSize <= cchBuffer ? winstd::buffer_probe::ok((size_t)dwSize - 1, 2) : winstd::buffer_probe::more(dwSize, 2);
+    });
+    return dwSize;
 }
 
 ///
@@ -35,15 +49,47 @@ static DWORD CertGetNameStringA(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwT
 ///
 /// \sa [CertGetNameString function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376086.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static DWORD CertGetNameStringW(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwType, _In_ DWORD dwFlags, _In_opt_ void *pvTypePara, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sNameString)
 {
-    // Query the final string length first.
-    DWORD dwSize = ::CertGetNameStringW(pCertContext, dwType, dwFlags, pvTypePara, NULL, 0);
+    WINSTD_BUFFER_SITE("CertGetNameStringW");
+    DWORD dwSize = 0;
+    winstd::probe_then_fill<_Policy>(sNameString, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        dwSize = ::CertGetNameStringW(pCertContext, dwType, dwFlags, pvTypePara, pBuffer, (DWORD)cchBuffer);
+        if (dwSize < cchBuffer)
+            return winstd::buffer_probe::ok((size_t)dwSize - 1);
+        // The name was either truncated or fits exactly. Query the final string length to tell.
+        dwSize = ::CertGetNameStringW(pCertContext, dwType, dwFlags, pvTypePara, NULL, 0);
+        return dwSize <= cchBuffer ? winstd::buffer_probe::ok((size_t)dwSize - 1, 2) : winstd::buffer_probe::more(dwSize, 2);
+    });
+    return dwSize;
+}
 
-    // Allocate buffer on heap to format the string data into and read it.
-    sNameString.resize(dwSize - 1);
-    return ::CertGetNameStringW(pCertContext, dwType, dwFlags, pvTypePara, &sNameString[0], dwSize);
+/// @copydoc CertGetNameStringW(PCCERT_CONTEXT, DWORD, DWORD, void*)
+template<class _Policy = winstd::default_buffer_policy, class _Traits = std::char_traits<char>, class _Ax = std::allocator<char>>
+static winstd::expected<std::basic_string<char, _Traits, _Ax>> CertGetNameStringA(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwType, _In_ DWORD dwFlags, _In_opt_ void *pvTypePara) noexcept
+{
+    return winstd::expect_fill<std::basic_string<char, _Traits, _Ax>>([&](_Out_ std::basic_string<char, _Traits, _Ax> &sNameString)
+    {
+        return CertGetNameStringA<_Policy>(pCertContext, dwType, dwFlags, pvTypePara, sNameString) ? ERROR_SUCCESS : ::GetLastError();
+    });
+}
+
+///
+/// Obtains the subject or issuer name from a certificate [CERT_CONTEXT](https://msdn.microsoft.com/en-us/library/windows/desktop/aa377189.aspx) structure.
+///
+/// \returns Name on success; error code otherwise. The error is reported in-band and `GetLastError()` need not be consulted.
+///
+/// \sa [CertGetNameString function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376086.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits = std::char_traits<wchar_t>, class _Ax = std::allocator<wchar_t>>
+static winstd::expected<std::basic_string<wchar_t, _Traits, _Ax>> CertGetNameStringW(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwType, _In_ DWORD dwFlags, _In_opt_ void *pvTypePara) noexcept
+{
+    return winstd::expect_fill<std::basic_string<wchar_t, _Traits, _Ax>>([&](_Out_ std::basic_string<wchar_t, _Traits, _Ax> &sNameString)
+    {
+        return CertGetNameStringW<_Policy>(pCertContext, dwType, dwFlags, pvTypePara, sNameString) ? ERROR_SUCCESS : ::GetLastError();
+    });
 }
 
 ///
@@ -51,24 +97,33 @@ static DWORD CertGetNameStringW(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwT
 ///
 /// \sa [CertGetCertificateContextProperty function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376079.aspx)
 ///
-template<class _Ty, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Ty, class _Ax>
 static _Success_(return != 0) BOOL WINAPI CertGetCertificateContextProperty(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwPropId, _Out_ std::vector<_Ty, _Ax> &aData)
 {
-    BYTE buf[WINSTD_STACK_BUFFER_BYTES];
-    DWORD dwSize = WINSTD_STACK_BUFFER_BYTES;
-
-    // Try with the stack buffer first.
-    if (CertGetCertificateContextProperty(pCertContext, dwPropId, buf, &dwSize)) {
-        // Copy from stack.
-        aData.assign((const _Ty*)buf, (const _Ty*)buf + (dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
-        return TRUE;
-    } else if (GetLastError() == ERROR_MORE_DATA) {
-        aData.resize((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
-        if (CertGetCertificateContextProperty(pCertContext, dwPropId, aData.data(), &dwSize))
-            return TRUE;
-    }
+    WINSTD_BUFFER_SITE("CertGetCertificateContextProperty");
+    return winstd::probe_then_fill<_Policy>(aData, [&](_Out_writes_(cchBuffer) _Ty *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)(cchBuffer * sizeof(_Ty));
+        if (::CertGetCertificateContextProperty(pCertContext, dwPropId, pBuffer, &dwSize))
+            return winstd::buffer_probe::ok((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
+        return ::GetLastError() == ERROR_MORE_DATA ? winstd::buffer_probe::more((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty)) : winstd::buffer_probe::fail();
+    }) ? TRUE : FALSE;
+}
 
-    return FALSE;
+///
+/// Retrieves the information contained in an extended property of a certificate context.
+///
+/// \returns Property data on success; error code otherwise. The error is reported in-band and `GetLastError()` need not be consulted.
+///
+/// \sa [CertGetCertificateContextProperty function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376079.aspx)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Ty = unsigned char, class _Ax = std::allocator<_Ty>>
+static winstd::expected<std::vector<_Ty, _Ax>> CertGetCertificateContextProperty(_In_ PCCERT_CONTEXT pCertContext, _In_ DWORD dwPropId) noexcept
+{
+    return winstd::expect_fill<std::vector<_Ty, _Ax>>([&](_Out_ std::vector<_Ty, _Ax> &aData)
+    {
+        return CertGetCertificateContextProperty<_Policy>(pCertContext, dwPropId, aData) ? ERROR_SUCCESS : ::GetLastError();
+    });
 }
 
 ///
@@ -83,13 +138,13 @@ static _Success_(return != 0) BOOL CryptGetHashParam(_In_ HCRYPTHASH hHash, _In_
     DWORD dwSize = WINSTD_STACK_BUFFER_BYTES;
 
     // Try with the stack buffer first.
-    if (CryptGetHashParam(hHash, dwParam, buf, &dwSize, dwFlags)) {
+    if (WINSTD_BACKEND(CryptGetHashParam)(hHash, dwParam, buf, &dwSize, dwFlags)) {
         // Copy from stack.
         aData.assign((const _Ty*)buf, (const _Ty*)buf + (dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
         return TRUE;
     } else if (GetLastError() == ERROR_MORE_DATA) {
         aData.resize((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
-        if (CryptGetHashParam(hHash, dwParam, reinterpret_cast<BYTE*>(aData.data()), &dwSize, dwFlags))
+        if (WINSTD_BACKEND(CryptGetHashParam)(hHash, dwParam, reinterpret_cast<BYTE*>(aData.data()), &dwSize, dwFlags))
             return TRUE;
     }
 
@@ -105,7 +160,7 @@ template<class T>
 static _Success_(return != 0) BOOL CryptGetHashParam(_In_ HCRYPTHASH hHash, _In_ DWORD dwParam, _Out_ T &data, _In_ DWORD dwFlags)
 {
     DWORD dwSize = sizeof(T);
-    return CryptGetHashParam(hHash, dwParam, (BYTE*)&data, &dwSize, dwFlags);
+    return WINSTD_BACKEND(CryptGetHashParam)(hHash, dwParam, (BYTE*)&data, &dwSize, dwFlags);
 }
 
 ///
@@ -155,9 +210,9 @@ static _Success_(return != 0) BOOL CryptExportKey(_In_ HCRYPTKEY hKey, _In_ HCRY
 {
     DWORD dwKeyBLOBSize = 0;
 
-    if (CryptExportKey(hKey, hExpKey, dwBlobType, dwFlags, NULL, &dwKeyBLOBSize)) {
+    if (WINSTD_BACKEND(CryptExportKey)(hKey, hExpKey, dwBlobType, dwFlags, NULL, &dwKeyBLOBSize)) {
         aData.resize((dwKeyBLOBSize + sizeof(_Ty) - 1) / sizeof(_Ty));
-        if (CryptExportKey(hKey, hExpKey, dwBlobType, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwKeyBLOBSize))
+        if (WINSTD_BACKEND(CryptExportKey)(hKey, hExpKey, dwBlobType, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwKeyBLOBSize))
             return TRUE;
     }
 
@@ -185,7 +240,7 @@ static _Success_(return != 0) BOOL CryptEncrypt(_In_ HCRYPTKEY hKey, _In_opt_ HC
 
     if (dwBufLen) {
         aData.resize(dwBufLen);
-        if (CryptEncrypt(hKey, hHash, Final, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwEncLen, dwBufLen)) {
+        if (WINSTD_BACKEND(CryptEncrypt)(hKey, hHash, Final, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwEncLen, dwBufLen)) {
             // Encryption succeeded.
             assert(dwEncLen <= dwBufLen);
             if (dwEncLen < dwBufLen)
@@ -193,7 +248,7 @@ static _Success_(return != 0) BOOL CryptEncrypt(_In_ HCRYPTKEY hKey, _In_opt_ HC
             return TRUE;
         } else
             dwResult = GetLastError();
-    } else if (CryptEncrypt(hKey, NULL, Final, dwFlags, NULL, &dwEncLen, 0)) {
+    } else if (WINSTD_BACKEND(CryptEncrypt)(hKey, NULL, Final, dwFlags, NULL, &dwEncLen, 0)) {
         // CryptEncrypt() always succeeds for output data size queries.
         // dwEncLen contains required output data size. Continue as if the buffer was to small. Actually, the output buffer _was_ too small!
         dwResult = ERROR_MORE_DATA;
@@ -204,7 +259,7 @@ static _Success_(return != 0) BOOL CryptEncrypt(_In_ HCRYPTKEY hKey, _In_opt_ HC
         // Encrypted data will be longer. Reserve more space and retry.
         aData.resize(((dwBufLen = dwEncLen) + sizeof(_Ty) - 1) / sizeof(_Ty));
         dwEncLen = dwDataLen;
-        if (CryptEncrypt(hKey, hHash, Final, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwEncLen, dwBufLen)) {
+        if (WINSTD_BACKEND(CryptEncrypt)(hKey, hHash, Final, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwEncLen, dwBufLen)) {
             // Encryption succeeded.
             assert(dwEncLen <= dwBufLen);
             if (dwEncLen < dwBufLen)
@@ -232,7 +287,7 @@ static _Success_(return != 0) BOOL CryptDecrypt(_In_ HCRYPTKEY hKey, _In_opt_ HC
         throw std::invalid_argument("Data too big");
     DWORD dwDataLen = static_cast<DWORD>(sDataLen);
 
-    if (CryptDecrypt(hKey, hHash, Final, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwDataLen)) {
+    if (WINSTD_BACKEND(CryptDecrypt)(hKey, hHash, Final, dwFlags, reinterpret_cast<BYTE*>(aData.data()), &dwDataLen)) {
         // Decryption succeeded.
         aData.resize((dwDataLen + sizeof(_Ty) - 1) / sizeof(_Ty));
         return TRUE;
@@ -241,6 +296,31 @@ static _Success_(return != 0) BOOL CryptDecrypt(_In_ HCRYPTKEY hKey, _In_opt_ HC
     return FALSE;
 }
 
+#ifdef __cpp_lib_span
+
+///
+/// Adds data to a specified hash object.
+///
+/// Data larger than 4 GiB, like memory-mapped files, is hashed in multiple calls.
+///
+/// \sa [CryptHashData function](https://learn.microsoft.com/en-us/windows/win32/api/wincrypt/nf-wincrypt-crypthashdata)
+///
+template<class _Ty, size_t _Extent>
+static _Success_(return != 0) BOOL CryptHashData(_In_ HCRYPTHASH hHash, _In_ std::span<_Ty, _Extent> aData, _In_ DWORD dwFlags)
+{
+    const BYTE *pbData = reinterpret_cast<const BYTE*>(aData.data());
+    for (size_t size = aData.size_bytes(); size;) {
+        const DWORD dwDataLen = size > DWORD_MAX ? DWORD_MAX : static_cast<DWORD>(size);
+        if (!CryptHashData(hHash, pbData, dwDataLen, dwFlags))
+            return FALSE;
+        pbData += dwDataLen;
+        size -= dwDataLen;
+    }
+    return TRUE;
+}
+
+#endif
+
 /// @}
 
 namespace winstd
@@ -249,26 +329,46 @@ namespace winstd
     /// @{
 
     ///
-    /// PCCERT_CONTEXT wrapper class
-    ///
-    /// \sa [CertCreateCertificateContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376033.aspx)
+    /// Traits of cert_context
     ///
-    class cert_context : public dplhandle<PCCERT_CONTEXT, NULL>
+    struct cert_context_traits : basic_handle_traits<PCCERT_CONTEXT, NULL>
     {
-        WINSTD_DPLHANDLE_IMPL(cert_context, PCCERT_CONTEXT, NULL)
-
-    public:
         ///
         /// Destroys the certificate context.
         ///
         /// \sa [CertFreeCertificateContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376075.aspx)
         ///
-        virtual ~cert_context()
+        static void close(_In_ PCCERT_CONTEXT h) noexcept
         {
-            if (m_h != invalid)
-                free_internal();
+            CertFreeCertificateContext(h);
         }
 
+        ///
+        /// Duplicates the certificate context.
+        ///
+        /// \param[in] h  Object handle of existing object
+        ///
+        /// \return Duplicated certificate context handle
+        ///
+        /// \sa [CertDuplicateCertificateContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376045.aspx)
+        ///
+        static PCCERT_CONTEXT duplicate(_In_ PCCERT_CONTEXT h)
+        {
+            // As per doc, this only increases refcounter. Should never fail.
+            return CertDuplicateCertificateContext(h);
+        }
+    };
+
+    ///
+    /// PCCERT_CONTEXT wrapper class
+    ///
+    /// \sa [CertCreateCertificateContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376033.aspx)
+    ///
+    class cert_context : public basic_dplhandle<cert_context_traits>
+    {
+        WINSTD_BASIC_DPLHANDLE_IMPL(cert_context, cert_context_traits)
+
+    public:
         ///
         /// Is certificate equal to?
         ///
@@ -353,64 +453,28 @@ namespace winstd
         {
             return !operator<(other);
         }
-
-    protected:
-        ///
-        /// Destroys the certificate context.
-        ///
-        /// \sa [CertFreeCertificateContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376075.aspx)
-        ///
-        void free_internal() noexcept override
-        {
-            CertFreeCertificateContext(m_h);
-        }
-
-        ///
-        /// Duplicates the certificate context.
-        ///
-        /// \param[in] h  Object handle of existing certificate context
-        ///
-        /// \return Duplicated certificate context handle
-        ///
-        /// \sa [CertDuplicateCertificateContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376045.aspx)
-        ///
-        handle_type duplicate_internal(_In_ handle_type h) const override
-        {
-            // As per doc, this only increases refcounter. Should never fail.
-            return CertDuplicateCertificateContext(h);
-        }
     };
 
     ///
-    /// PCCERT_CHAIN_CONTEXT wrapper class
+    /// PCCERT_CONTEXT wrapper sharing the object between copies
     ///
-    /// \sa [CertGetCertificateChain function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376078.aspx)
+    /// \sa shared_dplhandle
     ///
-    class cert_chain_context : public dplhandle<PCCERT_CHAIN_CONTEXT, NULL>
-    {
-        WINSTD_DPLHANDLE_IMPL(cert_chain_context, PCCERT_CHAIN_CONTEXT, NULL)
+    typedef shared_dplhandle<cert_context_traits> shared_cert_context;
 
-    public:
-        ///
-        /// Destroys the certificate chain context.
-        ///
-        /// \sa [CertFreeCertificateChain function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376073.aspx)
-        ///
-        virtual ~cert_chain_context()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
+    ///
+    /// Traits of cert_chain_context
+    ///
+    struct cert_chain_context_traits : basic_handle_traits<PCCERT_CHAIN_CONTEXT, NULL>
+    {
         ///
         /// Destroys the certificate chain context.
         ///
         /// \sa [CertFreeCertificateChain function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376073.aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ PCCERT_CHAIN_CONTEXT h) noexcept
         {
-            CertFreeCertificateChain(m_h);
+            CertFreeCertificateChain(h);
         }
 
         ///
@@ -422,7 +486,7 @@ namespace winstd
         ///
         /// \sa [CertDuplicateCertificateChain function](https://learn.microsoft.com/en-us/windows/win32/api/wincrypt/nf-wincrypt-certduplicatecertificatechain)
         ///
-        handle_type duplicate_internal(_In_ handle_type h) const override
+        static PCCERT_CHAIN_CONTEXT duplicate(_In_ PCCERT_CHAIN_CONTEXT h)
         {
             // As per doc, this only increases refcounter. Should never fail.
             return CertDuplicateCertificateChain(h);
@@ -430,36 +494,49 @@ namespace winstd
     };
 
     ///
-    /// HCERTSTORE wrapper class
+    /// PCCERT_CHAIN_CONTEXT wrapper class
     ///
-    /// \sa [CertOpenStore function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376559.aspx)
-    /// \sa [CertOpenSystemStore function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376560.aspx)
+    /// \sa [CertGetCertificateChain function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376078.aspx)
     ///
-    class cert_store : public handle<HCERTSTORE, NULL>
-    {
-        WINSTD_HANDLE_IMPL(cert_store, HCERTSTORE, NULL)
+    typedef basic_dplhandle<cert_chain_context_traits> cert_chain_context;
 
-    public:
+    ///
+    /// Traits of cert_store
+    ///
+    struct cert_store_traits : basic_handle_traits<HCERTSTORE, NULL>
+    {
         ///
         /// Closes the certificate store.
         ///
         /// \sa [CertCloseStore function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376026.aspx)
         ///
-        virtual ~cert_store()
+        static void close(_In_ HCERTSTORE h) noexcept
         {
-            if (m_h != invalid)
-                free_internal();
+            CertCloseStore(h, 0);
         }
+    };
 
-    protected:
+    ///
+    /// HCERTSTORE wrapper class
+    ///
+    /// \sa [CertOpenStore function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376559.aspx)
+    /// \sa [CertOpenSystemStore function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376560.aspx)
+    ///
+    typedef basic_handle<cert_store_traits> cert_store;
+
+    ///
+    /// Traits of crypt_prov
+    ///
+    struct crypt_prov_traits : basic_handle_traits<HCRYPTPROV, NULL>
+    {
         ///
-        /// Closes the certificate store.
+        /// Releases the cryptographic context.
         ///
-        /// \sa [CertCloseStore function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa376026.aspx)
+        /// \sa [CryptReleaseContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa380268.aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HCRYPTPROV h) noexcept
         {
-            CertCloseStore(m_h, 0);
+            CryptReleaseContext(h, 0);
         }
     };
 
@@ -468,31 +545,38 @@ namespace winstd
     ///
     /// \sa [CryptAcquireContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379886.aspx)
     ///
-    class crypt_prov : public handle<HCRYPTPROV, NULL>
-    {
-        WINSTD_HANDLE_IMPL(crypt_prov, HCRYPTPROV, NULL)
+    typedef basic_handle<crypt_prov_traits> crypt_prov;
 
-    public:
+    ///
+    /// Traits of crypt_hash
+    ///
+    struct crypt_hash_traits : basic_handle_traits<HCRYPTHASH, NULL>
+    {
         ///
-        /// Releases the cryptographic context.
+        /// Destroys the hash context.
         ///
-        /// \sa [CryptReleaseContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa380268.aspx)
+        /// \sa [CryptDestroyHash function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379917.aspx)
         ///
-        virtual ~crypt_prov()
+        static void close(_In_ HCRYPTHASH h) noexcept
         {
-            if (m_h != invalid)
-                free_internal();
+            CryptDestroyHash(h);
         }
 
-    protected:
         ///
-        /// Releases the cryptographic context.
+        /// Duplicates the hash context.
         ///
-        /// \sa [CryptReleaseContext function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa380268.aspx)
+        /// \param[in] h  Object handle of existing hash context
+        ///
+        /// \return Duplicated hash context handle
+        ///
+        /// \sa [CryptDuplicateHash function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379919.aspx)
         ///
-        void free_internal() noexcept override
+        static HCRYPTHASH duplicate(_In_ HCRYPTHASH h)
         {
-            CryptReleaseContext(m_h, 0);
+            handle_type hNew;
+            if (CryptDuplicateHash(h, NULL, 0, &hNew))
+                return hNew;
+            throw win_runtime_error("CryptDuplicateHash failed");
         }
     };
 
@@ -501,48 +585,45 @@ namespace winstd
     ///
     /// \sa [CryptCreateHash function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379908.aspx)
     ///
-    class crypt_hash : public dplhandle<HCRYPTHASH, NULL>
-    {
-        WINSTD_DPLHANDLE_IMPL(crypt_hash, HCRYPTHASH, NULL)
+    typedef basic_dplhandle<crypt_hash_traits> crypt_hash;
 
-    public:
-        ///
-        /// Destroys the hash context.
-        ///
-        /// \sa [CryptDestroyHash function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379917.aspx)
-        ///
-        virtual ~crypt_hash()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
+    ///
+    /// HCRYPTHASH wrapper sharing the object between copies
+    ///
+    /// \sa shared_dplhandle
+    ///
+    typedef shared_dplhandle<crypt_hash_traits> shared_crypt_hash;
 
-    protected:
+    ///
+    /// Traits of crypt_key
+    ///
+    struct crypt_key_traits : basic_handle_traits<HCRYPTKEY, NULL>
+    {
         ///
-        /// Destroys the hash context.
+        /// Destroys the key.
         ///
-        /// \sa [CryptDestroyHash function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379917.aspx)
+        /// \sa [CryptDestroyKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379918.aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HCRYPTKEY h) noexcept
         {
-            CryptDestroyHash(m_h);
+            CryptDestroyKey(h);
         }
 
         ///
-        /// Duplicates the hash context.
+        /// Duplicates the key.
         ///
-        /// \param[in] h  Object handle of existing hash context
+        /// \param[in] h  Object handle of existing object
         ///
-        /// \return Duplicated hash context handle
+        /// \return Duplicated key handle
         ///
-        /// \sa [CryptDuplicateHash function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379919.aspx)
+        /// \sa [CryptDuplicateKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379920.aspx)
         ///
-        handle_type duplicate_internal(_In_ handle_type h) const override
+        static HCRYPTKEY duplicate(_In_ HCRYPTKEY h)
         {
             handle_type hNew;
-            if (CryptDuplicateHash(h, NULL, 0, &hNew))
+            if (CryptDuplicateKey(h, NULL, 0, &hNew))
                 return hNew;
-            throw win_runtime_error("CryptDuplicateHash failed");
+            throw win_runtime_error("CryptDuplicateKey failed");
         }
     };
 
@@ -554,22 +635,11 @@ namespace winstd
     /// \sa [CryptImportPublicKeyInfo function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa380209.aspx)
     /// \sa [CryptDeriveKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379916.aspx)
     ///
-    class crypt_key : public dplhandle<HCRYPTKEY, NULL>
+    class crypt_key : public basic_dplhandle<crypt_key_traits>
     {
-        WINSTD_DPLHANDLE_IMPL(crypt_key, HCRYPTKEY, NULL)
+        WINSTD_BASIC_DPLHANDLE_IMPL(crypt_key, crypt_key_traits)
 
     public:
-        ///
-        /// Destroys the key.
-        ///
-        /// \sa [CryptDestroyKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379918.aspx)
-        ///
-        virtual ~crypt_key()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
         ///
         /// Creates Exponent-of-one key
         ///
@@ -639,36 +709,15 @@ namespace winstd
 
             return false;
         }
-
-    protected:
-        ///
-        /// Destroys the key.
-        ///
-        /// \sa [CryptDestroyKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379918.aspx)
-        ///
-        void free_internal() noexcept override
-        {
-            CryptDestroyKey(m_h);
-        }
-
-        ///
-        /// Duplicates the key.
-        ///
-        /// \param[in] h  Object handle of existing key
-        ///
-        /// \return Duplicated key handle
-        ///
-        /// \sa [CryptDuplicateKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa379920.aspx)
-        ///
-        handle_type duplicate_internal(_In_ handle_type h) const override
-        {
-            handle_type hNew;
-            if (CryptDuplicateKey(h, NULL, 0, &hNew))
-                return hNew;
-            throw win_runtime_error("CryptDuplicateKey failed");
-        }
     };
 
+    ///
+    /// HCRYPTKEY wrapper sharing the object between copies
+    ///
+    /// \sa shared_dplhandle
+    ///
+    typedef shared_dplhandle<crypt_key_traits> shared_crypt_key;
+
     ///
     /// DATA_BLOB wrapper class
     ///
@@ -881,6 +930,22 @@ static bool CryptImportKey(_In_ HCRYPTPROV hProv, __in_bcount(dwDataLen) LPCBYTE
     return bResult;
 }
 
+#ifdef __cpp_lib_span
+
+///
+/// Imports the key.
+///
+/// \sa [CryptImportKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa380207.aspx)
+///
+static bool CryptImportKey(_In_ HCRYPTPROV hProv, _In_ std::span<const BYTE> aData, _In_ HCRYPTKEY hPubKey, _In_ DWORD dwFlags, _Inout_ winstd::crypt_key &key)
+{
+    if (aData.size() > DWORD_MAX)
+        throw std::invalid_argument("Data too big");
+    return CryptImportKey(hProv, aData.data(), static_cast<DWORD>(aData.size()), hPubKey, dwFlags, key);
+}
+
+#endif
+
 ///
 /// Imports the public key.
 ///
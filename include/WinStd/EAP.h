@@ -401,22 +401,43 @@ namespace winstd
     };
 
     ///
-    /// EapPacket wrapper class
+    /// Traits of eap_packet
     ///
-    class eap_packet : public dplhandle<EapPacket*, NULL>
+    struct eap_packet_traits : basic_handle_traits<EapPacket*, NULL>
     {
-        WINSTD_DPLHANDLE_IMPL(eap_packet, EapPacket*, NULL)
-
-    public:
         ///
         /// Destroys the EAP packet.
         ///
-        virtual ~eap_packet()
+        static void close(_In_ EapPacket* h) noexcept
         {
-            if (m_h != invalid)
-                free_internal();
+            HeapFree(GetProcessHeap(), 0, h);
+        }
+
+        ///
+        /// Duplicates the EAP packet.
+        ///
+        static EapPacket* duplicate(_In_ EapPacket* h)
+        {
+            assert(h);
+            const WORD n = ntohs(*reinterpret_cast<WORD*>(h->Length));
+            handle_type h2 = static_cast<handle_type>(HeapAlloc(GetProcessHeap(), 0, n));
+            if (h2 != invalid) {
+                _Analysis_assume_(h2 != NULL); // VS2022 can't figure out `invalid` is `NULL`
+                memcpy(h2, h, n);
+                return h2;
+            }
+            throw std::bad_alloc();
         }
+    };
 
+    ///
+    /// EapPacket wrapper class
+    ///
+    class eap_packet : public basic_dplhandle<eap_packet_traits>
+    {
+        WINSTD_BASIC_DPLHANDLE_IMPL(eap_packet, eap_packet_traits)
+
+    public:
         ///
         /// Create new EAP packet
         ///
@@ -455,33 +476,15 @@ namespace winstd
         {
             return m_h != NULL ? ntohs(*(WORD*)m_h->Length) : 0;
         }
-
-    protected:
-        ///
-        /// Destroys the EAP packet.
-        ///
-        void free_internal() noexcept override
-        {
-            HeapFree(GetProcessHeap(), 0, m_h);
-        }
-
-        ///
-        /// Duplicates the EAP packet.
-        ///
-        handle_type duplicate_internal(_In_ handle_type h) const override
-        {
-            assert(h);
-            const WORD n = ntohs(*reinterpret_cast<WORD*>(h->Length));
-            handle_type h2 = static_cast<handle_type>(HeapAlloc(GetProcessHeap(), 0, n));
-            if (h2 != invalid) {
-                _Analysis_assume_(h2 != NULL); // VS2022 can't figure out `invalid` is `NULL`
-                memcpy(h2, h, n);
-                return h2;
-            }
-            throw std::bad_alloc();
-        }
     };
 
+    ///
+    /// EapPacket wrapper sharing the object between copies
+    ///
+    /// \sa shared_dplhandle
+    ///
+    typedef shared_dplhandle<eap_packet_traits> shared_eap_packet;
+
     ///
     /// EAP_METHOD_INFO_ARRAY wrapper class
     ///
@@ -18,6 +18,12 @@
 #include <string>
 #include <vector>
 
+WINSTD_BACKEND_FN(EventWrite)
+WINSTD_BACKEND_FN(EventWriteString)
+WINSTD_BACKEND_FN(EventProviderEnabled)
+WINSTD_BACKEND_FN(TdhGetProperty)
+WINSTD_BACKEND_FN(TdhGetEventInformation)
+
 #pragma warning(push)
 #pragma warning(disable: 4505) // Don't warn on unused code
 
@@ -40,7 +46,7 @@ static _Success_(return == ERROR_SUCCESS) ULONG TdhGetProperty(_In_ PEVENT_RECOR
         if (ulSize) {
             // Query property value.
             aData.resize((ulSize + sizeof(_Ty) - 1) / sizeof(_Ty));
-            ulResult = TdhGetProperty(pEvent, TdhContextCount, pTdhContext, PropertyDataCount, pPropertyData, ulSize, reinterpret_cast<PBYTE>(aData.data()));
+            ulResult = WINSTD_BACKEND(TdhGetProperty)(pEvent, TdhContextCount, pTdhContext, PropertyDataCount, pPropertyData, ulSize, reinterpret_cast<PBYTE>(aData.data()));
         } else {
             // Property value size is zero.
             aData.clear();
@@ -61,7 +67,7 @@ static _Success_(return == ERROR_SUCCESS) ULONG TdhGetEventInformation(_In_ PEVE
     ULONG ulSize = sizeof(szBuffer), ulResult;
 
     // Try with stack buffer first.
-    ulResult = TdhGetEventInformation(pEvent, TdhContextCount, pTdhContext, (PTRACE_EVENT_INFO)szBuffer, &ulSize);
+    ulResult = WINSTD_BACKEND(TdhGetEventInformation)(pEvent, TdhContextCount, pTdhContext, (PTRACE_EVENT_INFO)szBuffer, &ulSize);
     if (ulResult == ERROR_SUCCESS) {
         // Copy from stack.
         info.reset(reinterpret_cast<PTRACE_EVENT_INFO>(new char[ulSize]));
@@ -70,7 +76,7 @@ static _Success_(return == ERROR_SUCCESS) ULONG TdhGetEventInformation(_In_ PEVE
     } else if (ulResult == ERROR_INSUFFICIENT_BUFFER) {
         // Create buffer on heap and retry.
         info.reset(reinterpret_cast<PTRACE_EVENT_INFO>(new char[ulSize]));
-        return TdhGetEventInformation(pEvent, TdhContextCount, pTdhContext, info.get(), &ulSize);
+        return WINSTD_BACKEND(TdhGetEventInformation)(pEvent, TdhContextCount, pTdhContext, info.get(), &ulSize);
     }
 
     return ulResult;
@@ -534,7 +540,7 @@ namespace winstd
         ULONG write(_In_ PCEVENT_DESCRIPTOR EventDescriptor)
         {
             assert(m_h != invalid);
-            return EventWrite(m_h, EventDescriptor, 0, NULL);
+            return WINSTD_BACKEND(EventWrite)(m_h, EventDescriptor, 0, NULL);
         }
 
         ///
@@ -549,7 +555,7 @@ namespace winstd
         ULONG write(_In_ PCEVENT_DESCRIPTOR EventDescriptor, _In_ ULONG UserDataCount = 0, _In_opt_count_(UserDataCount) PEVENT_DATA_DESCRIPTOR UserData = NULL)
         {
             assert(m_h != invalid);
-            return EventWrite(m_h, EventDescriptor, UserDataCount, UserData);
+            return WINSTD_BACKEND(EventWrite)(m_h, EventDescriptor, UserDataCount, UserData);
         }
 
         ///
@@ -571,7 +577,7 @@ namespace winstd
             if (param1.Ptr      == winstd::blank_event_data.Ptr      &&
                 param1.Size     == winstd::blank_event_data.Size     &&
                 param1.Reserved == winstd::blank_event_data.Reserved)
-                return EventWrite(m_h, EventDescriptor, 0, NULL);
+                return WINSTD_BACKEND(EventWrite)(m_h, EventDescriptor, 0, NULL);
 
             va_list arg;
             va_start(arg, param1);
@@ -602,7 +608,7 @@ namespace winstd
             va_end(arg);
 #pragma warning(push)
 #pragma warning(disable: 28020)
-            return EventWrite(m_h, EventDescriptor, param_count, params.data());
+            return WINSTD_BACKEND(EventWrite)(m_h, EventDescriptor, param_count, params.data());
 #pragma warning(pop)
         }
 
@@ -646,7 +652,7 @@ namespace winstd
 
 #pragma warning(push)
 #pragma warning(disable: 28020)
-            return EventWrite(m_h, EventDescriptor, param_count, params.data());
+            return WINSTD_BACKEND(EventWrite)(m_h, EventDescriptor, param_count, params.data());
 #pragma warning(pop)
         }
 
@@ -663,18 +669,49 @@ namespace winstd
         {
             assert(m_h != invalid);
 
-            std::wstring msg;
+            // Skip formatting when no session is listening.
+            if (!WINSTD_BACKEND(EventProviderEnabled)(m_h, Level, Keyword))
+                return ERROR_SUCCESS;
+
+            winstd::wformat_buffer::scratch msg;
             va_list arg;
 
             // Format message.
             va_start(arg, String);
-            vsprintf(msg, String, arg);
+            vsprintf(*msg, String, arg);
             va_end(arg);
 
             // Write string event.
-            return EventWriteString(m_h, Level, Keyword, msg.c_str());
+            return WINSTD_BACKEND(EventWriteString)(m_h, Level, Keyword, msg->c_str());
         }
 
+#ifdef __cpp_lib_format
+        ///
+        /// Writes a string event formatted using `std::format()` style template.
+        ///
+        /// The template is checked against the arguments at compile time.
+        ///
+        /// \return
+        /// - `ERROR_SUCCESS` when write succeeds;
+        /// - error code otherwise.
+        ///
+        /// \sa [EventWriteString function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa363750v=vs.85.aspx)
+        ///
+        template<class... _Types>
+        ULONG write_format(_In_ UCHAR Level, _In_ ULONGLONG Keyword, _In_ const std::wformat_string<_Types...> format, _In_ _Types&&... args)
+        {
+            assert(m_h != invalid);
+
+            // Skip formatting when no session is listening.
+            if (!WINSTD_BACKEND(EventProviderEnabled)(m_h, Level, Keyword))
+                return ERROR_SUCCESS;
+
+            winstd::wformat_buffer::scratch msg;
+            ::format_to(*msg, format, std::forward<_Types>(args)...);
+            return WINSTD_BACKEND(EventWriteString)(m_h, Level, Keyword, msg->c_str());
+        }
+#endif
+
     protected:
         ///
         /// Releases the event provider.
@@ -896,38 +933,28 @@ namespace winstd
     };
 
     ///
-    /// ETW trace
+    /// Traits of event_trace
     ///
-    /// \sa [OpenTrace function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa364089.aspx)
-    ///
-    class event_trace : public handle<TRACEHANDLE, INVALID_PROCESSTRACE_HANDLE>
+    struct event_trace_traits : basic_handle_traits<TRACEHANDLE, INVALID_PROCESSTRACE_HANDLE>
     {
-        WINSTD_HANDLE_IMPL(event_trace, TRACEHANDLE, INVALID_PROCESSTRACE_HANDLE)
-
-    public:
-        ///
-        /// Closes the trace.
-        ///
-        /// \sa [CloseTrace function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa363686.aspx)
-        ///
-        virtual ~event_trace()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Closes the trace.
         ///
         /// \sa [CloseTrace function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa363686.aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ TRACEHANDLE h) noexcept
         {
-            CloseTrace(m_h);
+            CloseTrace(h);
         }
     };
 
+    ///
+    /// ETW trace
+    ///
+    /// \sa [OpenTrace function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa364089.aspx)
+    ///
+    typedef basic_handle<event_trace_traits> event_trace;
+
     ///
     /// Helper class to enable event provider in constructor and disables it in destructor
     ///
@@ -1221,5 +1248,89 @@ namespace winstd
         T &m_result;                            ///< Function result
     };
 
+#ifdef WINSTD_BUFFER_STATS
+    ///
+    /// Periodically writes buffer statistics of all call sites as events
+    ///
+    /// One event is written per call site. Its data is the call site name (ANSI string), followed by the number of
+    /// invocations, stack buffer hits, heap retries, heap-allocated bytes and system function calls (all `UINT64`).
+    ///
+    /// \sa buffer_stats_registry
+    ///
+    class buffer_stats_reporter
+    {
+        WINSTD_NONCOPYABLE(buffer_stats_reporter)
+        WINSTD_NONMOVABLE(buffer_stats_reporter)
+
+    public:
+        ///
+        /// Starts reporting
+        ///
+        /// \param[in] ep          Event provider to write events with. Must outlive the reporter.
+        /// \param[in] event_desc  Event descriptor
+        /// \param[in] period      Reporting period in milliseconds
+        ///
+        buffer_stats_reporter(_In_ event_provider &ep, _In_ const EVENT_DESCRIPTOR &event_desc, _In_ DWORD period) :
+            m_ep(ep),
+            m_event_desc(event_desc)
+        {
+            m_timer = CreateThreadpoolTimer(callback, this, NULL);
+            if (!m_timer)
+                throw win_runtime_error("CreateThreadpoolTimer failed");
+            ULARGE_INTEGER due;
+            due.QuadPart = (ULONGLONG)-(LONGLONG)period * 10000;
+            FILETIME ft = { due.LowPart, due.HighPart };
+            SetThreadpoolTimer(m_timer, &ft, period, 0);
+        }
+
+        ///
+        /// Stops reporting
+        ///
+        virtual ~buffer_stats_reporter()
+        {
+            SetThreadpoolTimer(m_timer, NULL, 0, 0);
+            WaitForThreadpoolTimerCallbacks(m_timer, TRUE);
+            CloseThreadpoolTimer(m_timer);
+        }
+
+        ///
+        /// Writes buffer statistics of all call sites now
+        ///
+        void report()
+        {
+            for (const auto &s : buffer_stats_registry::instance().stats()) {
+                EVENT_DATA_DESCRIPTOR desc[6];
+                EventDataDescCreate(desc + 0, s.site, (ULONG)(strlen(s.site) + 1)*sizeof(*s.site));
+                EventDataDescCreate(desc + 1, &s.invocations, sizeof(s.invocations));
+                EventDataDescCreate(desc + 2, &s.stack_hits, sizeof(s.stack_hits));
+                EventDataDescCreate(desc + 3, &s.heap_retries, sizeof(s.heap_retries));
+                EventDataDescCreate(desc + 4, &s.bytes_allocated, sizeof(s.bytes_allocated));
+                EventDataDescCreate(desc + 5, &s.system_calls, sizeof(s.system_calls));
+                m_ep.write(&m_event_desc, _countof(desc), desc);
+            }
+        }
+
+    protected:
+        /// \cond internal
+        static VOID CALLBACK callback(_Inout_ PTP_CALLBACK_INSTANCE Instance, _Inout_opt_ PVOID Context, _Inout_ PTP_TIMER Timer)
+        {
+            UNREFERENCED_PARAMETER(Instance);
+            UNREFERENCED_PARAMETER(Timer);
+            try {
+                static_cast<buffer_stats_reporter*>(Context)->report();
+            }
+            catch (...) {
+                // Skip this period.
+            }
+        }
+        /// \endcond
+
+    protected:
+        event_provider &m_ep;                   ///< Event provider
+        const EVENT_DESCRIPTOR m_event_desc;    ///< Event descriptor
+        PTP_TIMER m_timer;                      ///< Reporting timer
+    };
+#endif
+
     /// @}
 }
@@ -15,99 +15,70 @@ namespace winstd
     /// @{
 
     ///
-    /// Windows HGDIOBJ wrapper class
+    /// Traits of gdi_handle
     ///
     template<class T>
-    class gdi_handle : public handle<T, NULL>
+    struct gdi_handle_traits : basic_handle_traits<T, NULL>
     {
-        WINSTD_HANDLE_IMPL(gdi_handle, T, NULL)
-
-    public:
         ///
         /// Closes an open object handle.
         ///
         /// \sa [DeleteObject function](https://docs.microsoft.com/en-us/windows/win32/api/wingdi/nf-wingdi-deleteobject)
         ///
-        virtual ~gdi_handle()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
-        ///
-        /// Closes an open object handle.
-        ///
-        /// \sa [DeleteObject function](https://docs.microsoft.com/en-us/windows/win32/api/wingdi/nf-wingdi-deleteobject)
-        ///
-        void free_internal() noexcept override
+        static void close(_In_ T h) noexcept
         {
-            DeleteObject(m_h);
+            DeleteObject(h);
         }
     };
 
     ///
-    /// Windows HICON wrapper class
+    /// Windows HGDIOBJ wrapper class
     ///
-    class icon : public handle<HICON, NULL>
-    {
-        WINSTD_HANDLE_IMPL(icon, HICON, NULL)
-
-    public:
-        ///
-        /// Closes an open object handle.
-        ///
-        /// \sa [DestroyIcon function](https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-destroyicon)
-        ///
-        virtual ~icon()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
+    template<class T>
+    using gdi_handle = basic_handle<gdi_handle_traits<T>>;
 
-    protected:
+    ///
+    /// Traits of icon
+    ///
+    struct icon_traits : basic_handle_traits<HICON, NULL>
+    {
         ///
         /// Closes an open object handle.
         ///
         /// \sa [DestroyIcon function](https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-destroyicon)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HICON h) noexcept
         {
-            DestroyIcon(m_h);
+            DestroyIcon(h);
         }
     };
 
     ///
-    /// Device context wrapper class
+    /// Windows HICON wrapper class
     ///
-    class dc : public handle<HDC, NULL>
-    {
-        WINSTD_HANDLE_IMPL(dc, HDC, NULL)
+    typedef basic_handle<icon_traits> icon;
 
-    public:
-        ///
-        /// Deletes the specified device context (DC).
-        ///
-        /// \sa [DeleteDC function](https://docs.microsoft.com/en-us/windows/win32/api/wingdi/nf-wingdi-deletedc)
-        ///
-        virtual ~dc()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
+    ///
+    /// Traits of dc
+    ///
+    struct dc_traits : basic_handle_traits<HDC, NULL>
+    {
         ///
         /// Deletes the specified device context (DC).
         ///
         /// \sa [DeleteDC function](https://docs.microsoft.com/en-us/windows/win32/api/wingdi/nf-wingdi-deletedc)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HDC h) noexcept
         {
-            DeleteDC(m_h);
+            DeleteDC(h);
         }
     };
 
+    ///
+    /// Device context wrapper class
+    ///
+    typedef basic_handle<dc_traits> dc;
+
     ///
     /// Device context wrapper class
     ///
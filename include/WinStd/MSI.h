@@ -17,29 +17,23 @@
 /// @{
 
 /// @copydoc MsiGetPropertyW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiGetPropertyA(_In_ MSIHANDLE hInstall, _In_z_ LPCSTR szName, _Inout_ std::basic_string<char, _Traits, _Ax> &sValue)
 {
+    WINSTD_BUFFER_SITE("MsiGetPropertyA");
     assert(0); // TODO: Test this code.
 
-    char szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiGetPropertyA(hInstall, szName, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to read the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiGetPropertyA(hInstall, szName, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiGetPropertyA(hInstall, szName, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 ///
@@ -47,53 +41,41 @@ static UINT MsiGetPropertyA(_In_ MSIHANDLE hInstall, _In_z_ LPCSTR szName, _Inou
 ///
 /// \sa [MsiGetProperty function](https://msdn.microsoft.com/en-us/library/aa370134.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiGetPropertyW(_In_ MSIHANDLE hInstall, _In_z_ LPCWSTR szName, _Inout_ std::basic_string<wchar_t, _Traits, _Ax> &sValue)
 {
-    wchar_t szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiGetPropertyW(hInstall, szName, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to read the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiGetPropertyW(hInstall, szName, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    WINSTD_BUFFER_SITE("MsiGetPropertyW");
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiGetPropertyW(hInstall, szName, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 /// @copydoc MsiRecordGetStringW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiRecordGetStringA(_In_ MSIHANDLE hRecord, _In_ unsigned int iField, _Inout_ std::basic_string<char, _Traits, _Ax> &sValue)
 {
+    WINSTD_BUFFER_SITE("MsiRecordGetStringA");
     assert(0); // TODO: Test this code.
 
-    char szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiRecordGetStringA(hRecord, iField, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to read the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiRecordGetStringA(hRecord, iField, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiRecordGetStringA(hRecord, iField, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 ///
@@ -101,53 +83,41 @@ static UINT MsiRecordGetStringA(_In_ MSIHANDLE hRecord, _In_ unsigned int iField
 ///
 /// \sa [MsiRecordGetString function](https://msdn.microsoft.com/en-us/library/aa370368.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiRecordGetStringW(_In_ MSIHANDLE hRecord, _In_ unsigned int iField, _Inout_ std::basic_string<wchar_t, _Traits, _Ax> &sValue)
 {
-    wchar_t szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiRecordGetStringW(hRecord, iField, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to read the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiRecordGetStringW(hRecord, iField, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    WINSTD_BUFFER_SITE("MsiRecordGetStringW");
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiRecordGetStringW(hRecord, iField, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 /// @copydoc MsiFormatRecordW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiFormatRecordA(_In_opt_ MSIHANDLE hInstall, _In_ MSIHANDLE hRecord, _Inout_ std::basic_string<char, _Traits, _Ax> &sValue)
 {
+    WINSTD_BUFFER_SITE("MsiFormatRecordA");
     assert(0); // TODO: Test this code.
 
-    char szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiFormatRecordA(hInstall, hRecord, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to format the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiFormatRecordA(hInstall, hRecord, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiFormatRecordA(hInstall, hRecord, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 ///
@@ -155,27 +125,21 @@ static UINT MsiFormatRecordA(_In_opt_ MSIHANDLE hInstall, _In_ MSIHANDLE hRecord
 ///
 /// \sa [MsiFormatRecord function](https://msdn.microsoft.com/en-us/library/aa370109.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiFormatRecordW(_In_opt_ MSIHANDLE hInstall, _In_ MSIHANDLE hRecord, _Inout_ std::basic_string<wchar_t, _Traits, _Ax> &sValue)
 {
-    wchar_t szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiFormatRecordW(hInstall, hRecord, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to format the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiFormatRecordW(hInstall, hRecord, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    WINSTD_BUFFER_SITE("MsiFormatRecordW");
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiFormatRecordW(hInstall, hRecord, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 ///
@@ -203,29 +167,23 @@ static UINT MsiRecordReadStream(_In_ MSIHANDLE hRecord, _In_ unsigned int iField
 }
 
 /// @copydoc MsiGetTargetPathW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiGetTargetPathA(_In_ MSIHANDLE hInstall, _In_z_ LPCSTR szFolder, _Out_ std::basic_string<char, _Traits, _Ax> &sValue)
 {
+    WINSTD_BUFFER_SITE("MsiGetTargetPathA");
     assert(0); // TODO: Test this code.
 
-    char szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiGetTargetPathA(hInstall, szFolder, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to format the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiGetTargetPathA(hInstall, szFolder, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiGetTargetPathA(hInstall, szFolder, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 ///
@@ -233,51 +191,39 @@ static UINT MsiGetTargetPathA(_In_ MSIHANDLE hInstall, _In_z_ LPCSTR szFolder, _
 ///
 /// \sa [MsiGetTargetPath function](https://msdn.microsoft.com/en-us/library/aa370303.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static UINT MsiGetTargetPathW(_In_ MSIHANDLE hInstall, _In_z_ LPCWSTR szFolder, _Inout_ std::basic_string<wchar_t, _Traits, _Ax> &sValue)
 {
-    wchar_t szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
-    DWORD dwSize = _countof(szStackBuffer);
-    UINT uiResult;
-
-    // Try with stack buffer first.
-    uiResult = ::MsiGetTargetPathW(hInstall, szFolder, szStackBuffer, &dwSize);
-    if (uiResult == ERROR_SUCCESS) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return ERROR_SUCCESS;
-    } else if (uiResult == ERROR_MORE_DATA) {
-        // Allocate buffer on heap to format the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiGetTargetPathW(hInstall, szFolder, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return uiResult;
-    }
+    WINSTD_BUFFER_SITE("MsiGetTargetPathW");
+    UINT uiResult = ERROR_SUCCESS;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        uiResult = ::MsiGetTargetPathW(hInstall, szFolder, pBuffer, &dwSize);
+        return
+            uiResult == ERROR_SUCCESS ? winstd::buffer_probe::ok(dwSize) :
+            uiResult == ERROR_MORE_DATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return uiResult;
 }
 
 /// @copydoc MsiGetComponentPathW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static INSTALLSTATE MsiGetComponentPathA(_In_z_ LPCSTR szProduct, _In_z_ LPCSTR szComponent, _Inout_ std::basic_string<char, _Traits, _Ax> &sValue)
 {
-    char szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
-    DWORD dwSize = _countof(szStackBuffer);
-    INSTALLSTATE state;
-
-    // Try with stack buffer first.
-    state = ::MsiGetComponentPathA(szProduct, szComponent, szStackBuffer, &dwSize);
-    if (state >= INSTALLSTATE_BROKEN) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return state;
-    } else if (state == INSTALLSTATE_MOREDATA) {
-        // Allocate buffer on heap to format the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiGetComponentPathA(szProduct, szComponent, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return state;
-    }
+    WINSTD_BUFFER_SITE("MsiGetComponentPathA");
+    INSTALLSTATE state = INSTALLSTATE_UNKNOWN;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        state = ::MsiGetComponentPathA(szProduct, szComponent, pBuffer, &dwSize);
+        return
+            state >= INSTALLSTATE_BROKEN ? winstd::buffer_probe::ok(dwSize) :
+            state == INSTALLSTATE_MOREDATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return state;
 }
 
 ///
@@ -285,27 +231,21 @@ static INSTALLSTATE MsiGetComponentPathA(_In_z_ LPCSTR szProduct, _In_z_ LPCSTR
 ///
 /// \sa [MsiGetComponentPath function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa370112.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static INSTALLSTATE MsiGetComponentPathW(_In_z_ LPCWSTR szProduct, _In_z_ LPCWSTR szComponent, _Inout_ std::basic_string<wchar_t, _Traits, _Ax> &sValue)
 {
-    wchar_t szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
-    DWORD dwSize = _countof(szStackBuffer);
-    INSTALLSTATE state;
-
-    // Try with stack buffer first.
-    state = ::MsiGetComponentPathW(szProduct, szComponent, szStackBuffer, &dwSize);
-    if (state >= INSTALLSTATE_BROKEN) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwSize);
-        return state;
-    } else if (state == INSTALLSTATE_MOREDATA) {
-        // Allocate buffer on heap to format the string data into and read it.
-        sValue.resize(dwSize++);
-        return ::MsiGetComponentPathW(szProduct, szComponent, &sValue[0], &dwSize);
-    } else {
-        // Return error code.
-        return state;
-    }
+    WINSTD_BUFFER_SITE("MsiGetComponentPathW");
+    INSTALLSTATE state = INSTALLSTATE_UNKNOWN;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        state = ::MsiGetComponentPathW(szProduct, szComponent, pBuffer, &dwSize);
+        return
+            state >= INSTALLSTATE_BROKEN ? winstd::buffer_probe::ok(dwSize) :
+            state == INSTALLSTATE_MOREDATA ? winstd::buffer_probe::more((size_t)dwSize + 1) :
+            winstd::buffer_probe::fail();
+    });
+    return state;
 }
 
 /// @}
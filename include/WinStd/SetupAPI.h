@@ -17,39 +17,29 @@ namespace winstd
     /// @{
 
     ///
-    /// HDEVINFO wrapper class
-    ///
-    /// \sa [SetupDiCreateDeviceInfoList function](https://docs.microsoft.com/en-us/windows/desktop/api/setupapi/nf-setupapi-setupdicreatedeviceinfolist)
-    /// \sa [SetupDiGetClassDevsExW function](https://docs.microsoft.com/en-us/windows/desktop/api/setupapi/nf-setupapi-setupdigetclassdevsexw)
+    /// Traits of setup_device_info_list
     ///
-    class setup_device_info_list : public handle<HDEVINFO, INVALID_HANDLE_VALUE>
+    struct setup_device_info_list_traits : basic_handle_traits<HDEVINFO, INVALID_HANDLE_VALUE>
     {
-        WINSTD_HANDLE_IMPL(setup_device_info_list, HDEVINFO, INVALID_HANDLE_VALUE)
-
-    public:
-        ///
-        /// Frees the device information set.
-        ///
-        /// \sa [SetupDiDestroyDeviceInfoList function](https://docs.microsoft.com/en-us/windows/desktop/api/setupapi/nf-setupapi-setupdidestroydeviceinfolist)
-        ///
-        virtual ~setup_device_info_list()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Frees the device information set.
         ///
         /// \sa [SetupDiDestroyDeviceInfoList function](https://docs.microsoft.com/en-us/windows/desktop/api/setupapi/nf-setupapi-setupdidestroydeviceinfolist)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HDEVINFO h) noexcept
         {
-            SetupDiDestroyDeviceInfoList(m_h);
+            SetupDiDestroyDeviceInfoList(h);
         }
     };
 
+    ///
+    /// HDEVINFO wrapper class
+    ///
+    /// \sa [SetupDiCreateDeviceInfoList function](https://docs.microsoft.com/en-us/windows/desktop/api/setupapi/nf-setupapi-setupdicreatedeviceinfolist)
+    /// \sa [SetupDiGetClassDevsExW function](https://docs.microsoft.com/en-us/windows/desktop/api/setupapi/nf-setupapi-setupdigetclassdevsexw)
+    ///
+    typedef basic_handle<setup_device_info_list_traits> setup_device_info_list;
+
     ///
     /// Builds a list of drivers in constructor and deletes it in destructor
     ///
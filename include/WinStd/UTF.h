@@ -0,0 +1,569 @@
+﻿/*
+    SPDX-License-Identifier: MIT
+    Copyright © 2024 Amebis
+*/
+
+/// \defgroup WinStdUTF UTF Transcoding
+
+#pragma once
+
+#if (defined(_MSVC_LANG) ? _MSVC_LANG : __cplusplus) < 201703L
+#error WinStd requires C++17 or later. Set C++ Language Standard to ISO C++17 (/std:c++17) or later.
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <utility>
+#if __has_include(<version>)
+#include <version>
+#endif
+#ifdef __cpp_lib_span
+#include <span>
+#endif
+
+/// \cond internal
+#if !defined(WINSTD_NO_SIMD) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__))
+#define WINSTD_SSE2
+#include <emmintrin.h>
+#ifdef __AVX__
+#define WINSTD_AVX
+#include <immintrin.h>
+#endif
+#endif
+/// \endcond
+
+namespace winstd
+{
+    /// \addtogroup WinStdUTF
+    /// @{
+
+    ///
+    /// Returned by UTF transcoding functions when the input is not well-formed
+    ///
+    const size_t utf_invalid = (size_t)-1;
+
+    /// \cond internal
+
+    inline size_t utf8_ascii_run(const char *src, size_t count) noexcept
+    {
+        size_t i = 0;
+#ifdef WINSTD_SSE2
+        for (; i + 16 <= count; i += 16)
+            if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))))
+                break;
+#endif
+        for (; i < count && !(src[i] & 0x80); ++i);
+        return i;
+    }
+
+    template<class _Ch16>
+    inline size_t utf16_ascii_run(const _Ch16 *src, size_t count) noexcept
+    {
+        size_t i = 0;
+#ifdef WINSTD_SSE2
+        const __m128i mask = _mm_set1_epi16(-0x80), zero = _mm_setzero_si128();
+        for (; i + 8 <= count; i += 8)
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), mask), zero)) != 0xffff)
+                break;
+#endif
+        for (; i < count && static_cast<unsigned int>(src[i]) < 0x80; ++i);
+        return i;
+    }
+
+    inline ptrdiff_t utf8_decode(const unsigned char *s, size_t count, unsigned int &cp) noexcept
+    {
+        // Well-formed sequences according to Unicode Table 3-7
+        // Returns sequence length, 0 when incomplete, or negated length of the maximal ill-formed subpart.
+        const unsigned int c = s[0];
+        if (c < 0x80) {
+            cp = c;
+            return 1;
+        }
+        if (c < 0xc2 || c > 0xf4)
+            return -1;
+        size_t n;
+        unsigned int lo = 0x80, hi = 0xbf;
+        if (c < 0xe0) {
+            n = 2;
+            cp = c & 0x1f;
+        } else if (c < 0xf0) {
+            n = 3;
+            cp = c & 0x0f;
+            if (c == 0xe0)
+                lo = 0xa0;
+            else if (c == 0xed)
+                hi = 0x9f;
+        } else {
+            n = 4;
+            cp = c & 0x07;
+            if (c == 0xf0)
+                lo = 0x90;
+            else if (c == 0xf4)
+                hi = 0x8f;
+        }
+        for (size_t i = 1; i < n; ++i, lo = 0x80, hi = 0xbf) {
+            if (i >= count)
+                return 0;
+            if (s[i] < lo || s[i] > hi)
+                return -(ptrdiff_t)i;
+            cp = (cp << 6) | (s[i] & 0x3f);
+        }
+        return (ptrdiff_t)n;
+    }
+
+    template<class _Ch16>
+    inline ptrdiff_t utf16_decode(const _Ch16 *s, size_t count, unsigned int &cp) noexcept
+    {
+        // Returns sequence length, 0 when incomplete, or -1 for an unpaired surrogate.
+        const unsigned int c = static_cast<unsigned int>(s[0]);
+        if (c < 0xd800 || c > 0xdfff) {
+            cp = c;
+            return 1;
+        }
+        if (c > 0xdbff)
+            return -1;
+        if (count < 2)
+            return 0;
+        const unsigned int c2 = static_cast<unsigned int>(s[1]);
+        if (c2 < 0xdc00 || c2 > 0xdfff)
+            return -1;
+        cp = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+        return 2;
+    }
+
+    inline size_t utf8_encode(unsigned int cp, char *dst) noexcept
+    {
+        if (cp < 0x80) {
+            dst[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800) {
+            dst[0] = static_cast<char>(0xc0 | (cp >> 6));
+            dst[1] = static_cast<char>(0x80 | (cp & 0x3f));
+            return 2;
+        }
+        if (cp < 0x10000) {
+            dst[0] = static_cast<char>(0xe0 | (cp >> 12));
+            dst[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+            dst[2] = static_cast<char>(0x80 | (cp & 0x3f));
+            return 3;
+        }
+        dst[0] = static_cast<char>(0xf0 | (cp >> 18));
+        dst[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        dst[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        dst[3] = static_cast<char>(0x80 | (cp & 0x3f));
+        return 4;
+    }
+
+    template<class _Ch16>
+    inline size_t utf16_encode(unsigned int cp, _Ch16 *dst) noexcept
+    {
+        if (cp < 0x10000) {
+            dst[0] = static_cast<_Ch16>(cp);
+            return 1;
+        }
+        dst[0] = static_cast<_Ch16>(0xd800 + ((cp - 0x10000) >> 10));
+        dst[1] = static_cast<_Ch16>(0xdc00 + ((cp - 0x10000) & 0x3ff));
+        return 2;
+    }
+
+    /// \endcond
+
+    ///
+    /// Returns number of UTF-16 code units required to represent UTF-8 string
+    ///
+    /// Runs of ASCII characters are scanned 16 bytes at a time when SSE2 is available.
+    ///
+    /// \param[in] src    UTF-8 string
+    /// \param[in] count  Number of bytes in `src`
+    ///
+    /// \return Number of UTF-16 code units; `utf_invalid` if `src` is not well-formed UTF-8.
+    ///
+    inline size_t utf8_to_utf16_length(const char *src, size_t count) noexcept
+    {
+        size_t len = 0;
+        for (size_t i = 0; i < count;) {
+            const size_t n = utf8_ascii_run(src + i, count - i);
+            len += n;
+            if ((i += n) >= count)
+                break;
+            unsigned int cp;
+            const ptrdiff_t seq = utf8_decode(reinterpret_cast<const unsigned char*>(src + i), count - i, cp);
+            if (seq <= 0)
+                return utf_invalid;
+            len += cp < 0x10000 ? 1 : 2;
+            i += (size_t)seq;
+        }
+        return len;
+    }
+
+    ///
+    /// Converts UTF-8 string to UTF-16
+    ///
+    /// Runs of ASCII characters are converted 16 bytes at a time when SSE2 is available.
+    ///
+    /// \param[in ] src    UTF-8 string
+    /// \param[in ] count  Number of bytes in `src`
+    /// \param[out] dst    Buffer of at least `utf8_to_utf16_length(src, count)` 16-bit code units
+    ///
+    /// \return Number of UTF-16 code units written; `utf_invalid` if `src` is not well-formed UTF-8.
+    ///
+    template<class _Ch16>
+    size_t utf8_to_utf16(const char *src, size_t count, _Ch16 *dst) noexcept
+    {
+        static_assert(sizeof(_Ch16) == 2, "UTF-16 code unit must be 16-bit");
+        _Ch16 *const start = dst;
+        for (size_t i = 0; i < count;) {
+#ifdef WINSTD_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 16 <= count; i += 16, dst += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                if (_mm_movemask_epi8(v))
+                    break;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst    ), _mm_unpacklo_epi8(v, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpackhi_epi8(v, zero));
+            }
+#endif
+            for (; i < count && !(src[i] & 0x80); ++i)
+                *dst++ = static_cast<_Ch16>(src[i]);
+            if (i >= count)
+                break;
+            unsigned int cp;
+            const ptrdiff_t seq = utf8_decode(reinterpret_cast<const unsigned char*>(src + i), count - i, cp);
+            if (seq <= 0)
+                return utf_invalid;
+            dst += utf16_encode(cp, dst);
+            i += (size_t)seq;
+        }
+        return static_cast<size_t>(dst - start);
+    }
+
+    ///
+    /// Returns number of bytes required to represent UTF-16 string in UTF-8
+    ///
+    /// Runs of ASCII characters are scanned 8 code units at a time when SSE2 is available.
+    ///
+    /// \param[in] src    UTF-16 string
+    /// \param[in] count  Number of 16-bit code units in `src`
+    ///
+    /// \return Number of bytes; `utf_invalid` if `src` contains unpaired surrogates.
+    ///
+    template<class _Ch16>
+    size_t utf16_to_utf8_length(const _Ch16 *src, size_t count) noexcept
+    {
+        static_assert(sizeof(_Ch16) == 2, "UTF-16 code unit must be 16-bit");
+        size_t len = 0;
+        for (size_t i = 0; i < count;) {
+            const size_t n = utf16_ascii_run(src + i, count - i);
+            len += n;
+            if ((i += n) >= count)
+                break;
+            unsigned int cp;
+            const ptrdiff_t seq = utf16_decode(src + i, count - i, cp);
+            if (seq <= 0)
+                return utf_invalid;
+            len += cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+            i += (size_t)seq;
+        }
+        return len;
+    }
+
+    ///
+    /// Converts UTF-16 string to UTF-8
+    ///
+    /// Runs of ASCII characters are converted 16 code units at a time when SSE2 is available.
+    ///
+    /// \param[in ] src    UTF-16 string
+    /// \param[in ] count  Number of 16-bit code units in `src`
+    /// \param[out] dst    Buffer of at least `utf16_to_utf8_length(src, count)` bytes
+    ///
+    /// \return Number of bytes written; `utf_invalid` if `src` contains unpaired surrogates.
+    ///
+    template<class _Ch16>
+    size_t utf16_to_utf8(const _Ch16 *src, size_t count, char *dst) noexcept
+    {
+        static_assert(sizeof(_Ch16) == 2, "UTF-16 code unit must be 16-bit");
+        char *const start = dst;
+        for (size_t i = 0; i < count;) {
+#ifdef WINSTD_SSE2
+            const __m128i mask = _mm_set1_epi16(-0x80), zero = _mm_setzero_si128();
+            for (; i + 16 <= count; i += 16, dst += 16) {
+                const __m128i
+                    v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i    )),
+                    v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(v0, v1), mask), zero)) != 0xffff)
+                    break;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(v0, v1));
+            }
+#endif
+            for (; i < count && static_cast<unsigned int>(src[i]) < 0x80; ++i)
+                *dst++ = static_cast<char>(src[i]);
+            if (i >= count)
+                break;
+            unsigned int cp;
+            const ptrdiff_t seq = utf16_decode(src + i, count - i, cp);
+            if (seq <= 0)
+                return utf_invalid;
+            dst += utf8_encode(cp, dst);
+            i += (size_t)seq;
+        }
+        return static_cast<size_t>(dst - start);
+    }
+
+    ///
+    /// Stateful UTF-8/UTF-16 transcoder for input of any size
+    ///
+    /// Input may be fed in chunks split at arbitrary positions: a sequence left incomplete at the end of a chunk is
+    /// carried over to the next one. Output is passed to the sink in blocks of up to `buffer_size` code units, so
+    /// memory use is constant regardless of input size. Totals are counted in 64 bits.
+    ///
+    /// Ill-formed input is replaced with U+FFFD per maximal subpart, as recommended by the Unicode Standard. Strict
+    /// transcoder stops at the first ill-formed sequence instead.
+    ///
+    /// \tparam _Src   Source code unit: `char` for UTF-8, or a 16-bit type for UTF-16
+    /// \tparam _Dst   Destination code unit: `char` for UTF-8, or a 16-bit type for UTF-16
+    /// \tparam _Sink  Callable as `sink(const _Dst *data, size_t count)`
+    ///
+    /// \par Example
+    /// \code
+    /// std::wstring out;
+    /// winstd::utf8_to_utf16_transcoder t([&](const wchar_t *data, size_t count) { out.append(data, count); });
+    /// for (auto &chunk : chunks)
+    ///     t.feed(chunk.data(), chunk.size());
+    /// t.finish();
+    /// \endcode
+    ///
+    template<class _Src, class _Dst, class _Sink = std::function<void(const _Dst*, size_t)>>
+    class utf_transcoder
+    {
+        static_assert(sizeof(_Src) + sizeof(_Dst) == 3, "Transcoding must be between UTF-8 and UTF-16");
+
+    public:
+        ///
+        /// Maximum number of code units passed to the sink at once
+        ///
+        static const size_t buffer_size = 0x400;
+
+        ///
+        /// Constructs transcoder
+        ///
+        /// \param[in] sink    Output sink
+        /// \param[in] strict  `true` to stop at ill-formed input; `false` to replace it with U+FFFD
+        ///
+        utf_transcoder(_Sink sink, bool strict = false) :
+            m_sink(std::move(sink)),
+            m_strict(strict),
+            m_failed(false),
+            m_carry_len(0),
+            m_buf_len(0),
+            m_consumed(0),
+            m_produced(0)
+        {}
+
+        ///
+        /// Transcodes next chunk of input
+        ///
+        /// \param[in] data   Input chunk
+        /// \param[in] count  Number of code units in `data`
+        ///
+        /// \return `false` if strict transcoder encountered ill-formed input; `true` otherwise.
+        ///
+        bool feed(const _Src *data, size_t count)
+        {
+            if (m_failed)
+                return false;
+            size_t i = 0;
+
+            // Complete the sequence carried over from the previous chunk.
+            while (m_carry_len && i < count) {
+                m_carry[m_carry_len++] = data[i++];
+                unsigned int cp;
+                const ptrdiff_t seq = decode(m_carry, m_carry_len, cp);
+                if (seq > 0) {
+                    emit(cp);
+                    m_consumed += m_carry_len;
+                    m_carry_len = 0;
+                } else if (seq < 0) {
+                    // Carry was a valid prefix: the unit just added is not part of the ill-formed subpart.
+                    if (!replace()) {
+                        m_carry_len = 0;
+                        return false;
+                    }
+                    m_consumed += m_carry_len - 1;
+                    m_carry_len = 0;
+                    --i;
+                }
+            }
+
+            const size_t start = i;
+            while (i < count) {
+                for (size_t n = ascii_run(data + i, count - i); n;) {
+                    if (m_buf_len == buffer_size)
+                        flush();
+                    const size_t k = n < buffer_size - m_buf_len ? n : buffer_size - m_buf_len;
+                    if constexpr (sizeof(_Src) == 1)
+                        utf8_to_utf16(data + i, k, m_buf + m_buf_len);
+                    else
+                        utf16_to_utf8(data + i, k, m_buf + m_buf_len);
+                    m_buf_len += k;
+                    i += k;
+                    n -= k;
+                }
+                if (i >= count)
+                    break;
+                unsigned int cp;
+                const ptrdiff_t seq = decode(data + i, count - i, cp);
+                if (seq > 0) {
+                    emit(cp);
+                    i += (size_t)seq;
+                } else if (seq < 0) {
+                    if (!replace()) {
+                        m_consumed += i - start;
+                        return false;
+                    }
+                    i += (size_t)-seq;
+                } else {
+                    // Incomplete at the end of the chunk.
+                    for (; i < count; ++i)
+                        m_carry[m_carry_len++] = data[i];
+                    m_consumed += count - start - m_carry_len;
+                    flush();
+                    return true;
+                }
+            }
+            m_consumed += count - start;
+            flush();
+            return true;
+        }
+
+#ifdef __cpp_lib_span
+        ///
+        /// Transcodes next chunk of input
+        ///
+        /// \param[in] data  Input chunk
+        ///
+        /// \return `false` if strict transcoder encountered ill-formed input; `true` otherwise.
+        ///
+        bool feed(std::span<const _Src> data)
+        {
+            return feed(data.data(), data.size());
+        }
+#endif
+
+        ///
+        /// Completes transcoding
+        ///
+        /// An incomplete sequence at the end of input is ill-formed. The transcoder may be reused for new input afterwards.
+        ///
+        /// \return `false` if strict transcoder encountered ill-formed input; `true` otherwise.
+        ///
+        bool finish()
+        {
+            if (m_failed)
+                return false;
+            if (m_carry_len) {
+                if (!replace()) {
+                    m_carry_len = 0;
+                    return false;
+                }
+                m_consumed += m_carry_len;
+                m_carry_len = 0;
+            }
+            flush();
+            return true;
+        }
+
+        ///
+        /// Returns `true` if strict transcoder encountered ill-formed input
+        ///
+        bool failed() const noexcept { return m_failed; }
+
+        ///
+        /// Returns number of input code units transcoded so far
+        ///
+        /// When strict transcoder fails, this is the offset of the ill-formed sequence.
+        ///
+        uint64_t consumed() const noexcept { return m_consumed; }
+
+        ///
+        /// Returns number of code units passed to the sink so far
+        ///
+        uint64_t produced() const noexcept { return m_produced; }
+
+    protected:
+        /// \cond internal
+
+        static size_t ascii_run(const _Src *s, size_t count) noexcept
+        {
+            if constexpr (sizeof(_Src) == 1)
+                return utf8_ascii_run(s, count);
+            else
+                return utf16_ascii_run(s, count);
+        }
+
+        static ptrdiff_t decode(const _Src *s, size_t count, unsigned int &cp) noexcept
+        {
+            if constexpr (sizeof(_Src) == 1)
+                return utf8_decode(reinterpret_cast<const unsigned char*>(s), count, cp);
+            else
+                return utf16_decode(s, count, cp);
+        }
+
+        void emit(unsigned int cp)
+        {
+            if (m_buf_len + 4 > buffer_size)
+                flush();
+            if constexpr (sizeof(_Dst) == 1)
+                m_buf_len += utf8_encode(cp, m_buf + m_buf_len);
+            else
+                m_buf_len += utf16_encode(cp, m_buf + m_buf_len);
+        }
+
+        bool replace()
+        {
+            if (m_strict) {
+                m_failed = true;
+                flush();
+                return false;
+            }
+            emit(0xfffd);
+            return true;
+        }
+
+        void flush()
+        {
+            if (m_buf_len) {
+                m_sink(m_buf, m_buf_len);
+                m_produced += m_buf_len;
+                m_buf_len = 0;
+            }
+        }
+
+        /// \endcond
+
+    protected:
+        _Sink m_sink;                   ///< Output sink
+        bool m_strict;                  ///< Stop at ill-formed input?
+        bool m_failed;                  ///< Strict transcoder encountered ill-formed input
+        _Src m_carry[4];                ///< Incomplete sequence carried over from the previous chunk
+        size_t m_carry_len;             ///< Number of code units in `m_carry`
+        _Dst m_buf[buffer_size];        ///< Output buffer
+        size_t m_buf_len;               ///< Number of code units in `m_buf`
+        uint64_t m_consumed;            ///< Number of input code units transcoded
+        uint64_t m_produced;            ///< Number of code units passed to the sink
+    };
+
+    ///
+    /// UTF-8 to UTF-16 streaming transcoder
+    ///
+    typedef utf_transcoder<char, wchar_t> utf8_to_utf16_transcoder;
+
+    ///
+    /// UTF-16 to UTF-8 streaming transcoder
+    ///
+    typedef utf_transcoder<wchar_t, char> utf16_to_utf8_transcoder;
+
+    /// @}
+}
@@ -125,38 +125,28 @@ namespace winstd
     };
 
     ///
-    /// WLAN handle wrapper
-    ///
-    /// \sa [WlanOpenHandle function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms706759.aspx)
+    /// Traits of wlan_handle
     ///
-    class wlan_handle : public handle<HANDLE, NULL>
+    struct wlan_handle_traits : basic_handle_traits<HANDLE, NULL>
     {
-        WINSTD_HANDLE_IMPL(wlan_handle, HANDLE, NULL)
-
-    public:
-        ///
-        /// Closes a connection to the server.
-        ///
-        /// \sa [WlanCloseHandle function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms706610(v=vs.85).aspx)
-        ///
-        virtual ~wlan_handle()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Closes a connection to the server.
         ///
         /// \sa [WlanCloseHandle function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms706610(v=vs.85).aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HANDLE h) noexcept
         {
-            WlanCloseHandle(m_h, NULL);
+            WlanCloseHandle(h, NULL);
         }
     };
 
+    ///
+    /// WLAN handle wrapper
+    ///
+    /// \sa [WlanOpenHandle function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms706759.aspx)
+    ///
+    typedef basic_handle<wlan_handle_traits> wlan_handle;
+
     /// @}
 }
 
@@ -12,9 +12,16 @@
 #include <AclAPI.h>
 #include <tlhelp32.h>
 #include <winsvc.h>
+#include <deque>
 #include <string>
 #include <vector>
 
+WINSTD_BACKEND_FN(GetModuleFileNameA)
+WINSTD_BACKEND_FN(GetModuleFileNameW)
+WINSTD_BACKEND_FN(RegQueryValueExA)
+WINSTD_BACKEND_FN(RegQueryValueExW)
+WINSTD_BACKEND_FN(NormalizeString)
+
 #pragma warning(push)
 #pragma warning(disable: 4505) // Don't warn on unused code
 
@@ -22,30 +29,19 @@
 /// @{
 
 /// @copydoc GetModuleFileNameW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static DWORD GetModuleFileNameA(_In_opt_ HMODULE hModule, _Out_ std::basic_string<char, _Traits, _Ax> &sValue) noexcept
 {
+    WINSTD_BUFFER_SITE("GetModuleFileNameA");
     assert(0); // TODO: Test this code.
 
-    char szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(char)];
-
-    // Try with stack buffer first.
-    DWORD dwResult = ::GetModuleFileNameA(hModule, szStackBuffer, _countof(szStackBuffer));
-    if (dwResult < _countof(szStackBuffer)) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwResult);
-        return dwResult;
-    } else {
-        for (DWORD dwCapacity = 2*WINSTD_STACK_BUFFER_BYTES/sizeof(char);; dwCapacity *= 2) {
-            // Allocate on heap and retry.
-            sValue.resize(dwCapacity - 1);
-            dwResult = ::GetModuleFileNameA(hModule, &sValue[0], dwCapacity);
-            if (dwResult < dwCapacity) {
-                sValue.resize(dwResult);
-                return dwResult;
-            }
-        }
-    }
+    DWORD dwResult = 0;
+    return winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        // The function does not report the required length. Let the policy grow the buffer.
+        dwResult = WINSTD_BACKEND(GetModuleFileNameA)(hModule, pBuffer, (DWORD)cchBuffer);
+        return dwResult < cchBuffer ? winstd::buffer_probe::ok(dwResult) : winstd::buffer_probe::more();
+    }) ? dwResult : 0;
 }
 
 ///
@@ -53,28 +49,17 @@ static DWORD GetModuleFileNameA(_In_opt_ HMODULE hModule, _Out_ std::basic_strin
 ///
 /// \sa [GetModuleFileName function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms683197.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static DWORD GetModuleFileNameW(_In_opt_ HMODULE hModule, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sValue) noexcept
 {
-    wchar_t szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t)];
-
-    // Try with stack buffer first.
-    DWORD dwResult = ::GetModuleFileNameW(hModule, szStackBuffer, _countof(szStackBuffer));
-    if (dwResult < _countof(szStackBuffer)) {
-        // Copy from stack.
-        sValue.assign(szStackBuffer, dwResult);
-        return dwResult;
-    } else {
-        for (DWORD dwCapacity = 2*WINSTD_STACK_BUFFER_BYTES/sizeof(wchar_t);; dwCapacity *= 2) {
-            // Allocate on heap and retry.
-            sValue.resize(dwCapacity - 1);
-            dwResult = ::GetModuleFileNameW(hModule, &sValue[0], dwCapacity);
-            if (dwResult < dwCapacity) {
-                sValue.resize(dwResult);
-                return dwResult;
-            }
-        }
-    }
+    WINSTD_BUFFER_SITE("GetModuleFileNameW");
+    DWORD dwResult = 0;
+    return winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        // The function does not report the required length. Let the policy grow the buffer.
+        dwResult = WINSTD_BACKEND(GetModuleFileNameW)(hModule, pBuffer, (DWORD)cchBuffer);
+        return dwResult < cchBuffer ? winstd::buffer_probe::ok(dwResult) : winstd::buffer_probe::more();
+    }) ? dwResult : 0;
 }
 
 /// @copydoc GetWindowTextW()
@@ -158,29 +143,25 @@ static _Success_(return != 0) BOOL GetFileVersionInfoW(_In_z_ LPCWSTR lptstrFile
 }
 
 /// @copydoc ExpandEnvironmentStringsW()
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static _Success_(return != 0) DWORD ExpandEnvironmentStringsA(_In_z_ LPCSTR lpSrc, _Out_ std::basic_string<char, _Traits, _Ax> &sValue)
 {
+    WINSTD_BUFFER_SITE("ExpandEnvironmentStringsA");
     assert(0); // TODO: Test this code.
 
-    for (SIZE_T sSizeOut = SIZETAdd(strlen(lpSrc), 0x100);;) {
-        if (sSizeOut > DWORD_MAX)
+    DWORD dwResult = 0;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        if (cchBuffer > DWORD_MAX)
             throw std::invalid_argument("String too big");
-        DWORD dwSizeIn = static_cast<DWORD>(sSizeOut);
-        sValue.resize((size_t)dwSizeIn + 1); // Note: ANSI version requires one extra char.
-        sSizeOut = ::ExpandEnvironmentStringsA(lpSrc, &sValue[0], dwSizeIn);
-        if (sSizeOut == 0) {
-            // Error or zero-length input.
-            break;
-        } else if (sSizeOut <= dwSizeIn) {
-            // The buffer was sufficient.
-            sValue.resize(sSizeOut - 1);
-            return static_cast<DWORD>(sSizeOut);
-        }
-    }
-
-    sValue.clear();
-    return 0;
+        // Note: ANSI version requires one extra char.
+        dwResult = ::ExpandEnvironmentStringsA(lpSrc, pBuffer, (DWORD)cchBuffer - 1);
+        return
+            dwResult == 0 ? winstd::buffer_probe::fail() :
+            dwResult < cchBuffer ? winstd::buffer_probe::ok((size_t)dwResult - 1) :
+            winstd::buffer_probe::more((size_t)dwResult + 1);
+    });
+    return dwResult;
 }
 
 ///
@@ -188,27 +169,22 @@ static _Success_(return != 0) DWORD ExpandEnvironmentStringsA(_In_z_ LPCSTR lpSr
 ///
 /// \sa [ExpandEnvironmentStrings function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724265.aspx)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static _Success_(return != 0) DWORD ExpandEnvironmentStringsW(_In_z_ LPCWSTR lpSrc, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sValue)
 {
-    for (SIZE_T sSizeOut = SIZETAdd(wcslen(lpSrc), 0x100);;) {
-        if (sSizeOut > DWORD_MAX)
+    WINSTD_BUFFER_SITE("ExpandEnvironmentStringsW");
+    DWORD dwResult = 0;
+    winstd::probe_then_fill<_Policy>(sValue, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        if (cchBuffer > DWORD_MAX)
             throw std::invalid_argument("String too big");
-        DWORD dwSizeIn = static_cast<DWORD>(sSizeOut);
-        sValue.resize(dwSizeIn);
-        sSizeOut = ::ExpandEnvironmentStringsW(lpSrc, &sValue[0], dwSizeIn);
-        if (sSizeOut == 0) {
-            // Error or zero-length input.
-            break;
-        } else if (sSizeOut <= dwSizeIn) {
-            // The buffer was sufficient.
-            sValue.resize(sSizeOut - 1);
-            return static_cast<DWORD>(sSizeOut);
-        }
-    }
-
-    sValue.clear();
-    return 0;
+        dwResult = ::ExpandEnvironmentStringsW(lpSrc, pBuffer, (DWORD)cchBuffer);
+        return
+            dwResult == 0 ? winstd::buffer_probe::fail() :
+            dwResult <= cchBuffer ? winstd::buffer_probe::ok((size_t)dwResult - 1) :
+            winstd::buffer_probe::more(dwResult);
+    });
+    return dwResult;
 }
 
 /// @copydoc GuidToStringW()
@@ -217,12 +193,9 @@ static VOID GuidToStringA(_In_ LPCGUID lpGuid, _Out_ std::basic_string<char, _Tr
 {
     assert(0); // TODO: Test this code.
 
-    sprintf(str, "{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
-        lpGuid->Data1,
-        lpGuid->Data2,
-        lpGuid->Data3,
-        lpGuid->Data4[0], lpGuid->Data4[1],
-        lpGuid->Data4[2], lpGuid->Data4[3], lpGuid->Data4[4], lpGuid->Data4[5], lpGuid->Data4[6], lpGuid->Data4[7]);
+    char szBuffer[winstd::guid_chars];
+    winstd::guid_to_chars(*lpGuid, szBuffer);
+    str.assign(szBuffer, winstd::guid_chars);
 }
 
 ///
@@ -236,12 +209,9 @@ static VOID GuidToStringW(_In_ LPCGUID lpGuid, _Out_ std::basic_string<wchar_t,
 {
     assert(0); // TODO: Test this code.
 
-    sprintf(str, L"{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
-        lpGuid->Data1,
-        lpGuid->Data2,
-        lpGuid->Data3,
-        lpGuid->Data4[0], lpGuid->Data4[1],
-        lpGuid->Data4[2], lpGuid->Data4[3], lpGuid->Data4[4], lpGuid->Data4[5], lpGuid->Data4[6], lpGuid->Data4[7]);
+    wchar_t szBuffer[winstd::guid_chars];
+    winstd::guid_to_chars(*lpGuid, szBuffer);
+    str.assign(szBuffer, winstd::guid_chars);
 }
 
 /// @copydoc GuidToStringW()
@@ -259,9 +229,19 @@ static _Success_(return) BOOL StringToGuidA(_In_z_ LPCSTR lpszGuid, _Out_ LPGUID
     unsigned long ulTmp;
     unsigned long long ullTmp;
 
-    if (!lpszGuid || !lpGuid || *lpszGuid != '{') return FALSE;
+    if (!lpszGuid || !lpGuid) return FALSE;
+
+    // Try the canonical representation first.
+    if (strnlen(lpszGuid, winstd::guid_chars) == winstd::guid_chars && winstd::chars_to_guid(lpszGuid, *lpGuid)) {
+        if (lpszGuidEnd)
+            *lpszGuidEnd = lpszGuid + winstd::guid_chars;
+        return TRUE;
+    }
+
+    if (*lpszGuid != '{') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     g.Data1 = strtoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE) return FALSE;
     lpszGuid = lpszEnd;
@@ -269,6 +249,7 @@ static _Success_(return) BOOL StringToGuidA(_In_z_ LPCSTR lpszGuid, _Out_ LPGUID
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ulTmp = strtoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
     g.Data2 = static_cast<unsigned short>(ulTmp);
@@ -277,6 +258,7 @@ static _Success_(return) BOOL StringToGuidA(_In_z_ LPCSTR lpszGuid, _Out_ LPGUID
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ulTmp = strtoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
     g.Data3 = static_cast<unsigned short>(ulTmp);
@@ -285,6 +267,7 @@ static _Success_(return) BOOL StringToGuidA(_In_z_ LPCSTR lpszGuid, _Out_ LPGUID
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ulTmp = strtoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
     g.Data4[0] = static_cast<unsigned char>((ulTmp >> 8) & 0xff);
@@ -294,6 +277,7 @@ static _Success_(return) BOOL StringToGuidA(_In_z_ LPCSTR lpszGuid, _Out_ LPGUID
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ullTmp = _strtoui64(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ullTmp > 0xFFFFFFFFFFFF) return FALSE;
     g.Data4[2] = static_cast<unsigned char>((ullTmp >> 40) & 0xff);
@@ -332,9 +316,19 @@ static _Success_(return) BOOL StringToGuidW(_In_z_ LPCWSTR lpszGuid, _Out_ LPGUI
     unsigned long ulTmp;
     unsigned long long ullTmp;
 
-    if (!lpszGuid || !lpGuid || *lpszGuid != '{') return FALSE;
+    if (!lpszGuid || !lpGuid) return FALSE;
+
+    // Try the canonical representation first.
+    if (wcsnlen(lpszGuid, winstd::guid_chars) == winstd::guid_chars && winstd::chars_to_guid(lpszGuid, *lpGuid)) {
+        if (lpszGuidEnd)
+            *lpszGuidEnd = lpszGuid + winstd::guid_chars;
+        return TRUE;
+    }
+
+    if (*lpszGuid != '{') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     g.Data1 = wcstoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE) return FALSE;
     lpszGuid = lpszEnd;
@@ -342,6 +336,7 @@ static _Success_(return) BOOL StringToGuidW(_In_z_ LPCWSTR lpszGuid, _Out_ LPGUI
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ulTmp = wcstoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
     g.Data2 = static_cast<unsigned short>(ulTmp);
@@ -350,6 +345,7 @@ static _Success_(return) BOOL StringToGuidW(_In_z_ LPCWSTR lpszGuid, _Out_ LPGUI
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ulTmp = wcstoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
     g.Data3 = static_cast<unsigned short>(ulTmp);
@@ -358,6 +354,7 @@ static _Success_(return) BOOL StringToGuidW(_In_z_ LPCWSTR lpszGuid, _Out_ LPGUI
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ulTmp = wcstoul(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ulTmp > 0xFFFF) return FALSE;
     g.Data4[0] = static_cast<unsigned char>((ulTmp >> 8) & 0xff);
@@ -367,6 +364,7 @@ static _Success_(return) BOOL StringToGuidW(_In_z_ LPCWSTR lpszGuid, _Out_ LPGUI
     if (*lpszGuid != '-') return FALSE;
     lpszGuid++;
 
+    errno = 0;
     ullTmp = _wcstoui64(lpszGuid, &lpszEnd, 16);
     if (errno == ERANGE || ullTmp > 0xFFFFFFFFFFFF) return FALSE;
     g.Data4[2] = static_cast<unsigned char>((ullTmp >> 40) & 0xff);
@@ -415,49 +413,57 @@ static _Success_(return) BOOL StringToGuidW(_In_z_ LPCWSTR lpszGuid, _Out_ LPGUI
 template<class _Traits, class _Ax>
 static LSTATUS RegQueryStringValue(_In_ HKEY hReg, _In_z_ LPCSTR pszName, _Out_ std::basic_string<char, _Traits, _Ax> &sValue) noexcept
 {
-    LSTATUS lResult;
-    BYTE aStackBuffer[WINSTD_STACK_BUFFER_BYTES];
-    DWORD dwSize = sizeof(aStackBuffer), dwType;
-
-    // Try with stack buffer first.
-    lResult = ::RegQueryValueExA(hReg, pszName, NULL, &dwType, aStackBuffer, &dwSize);
-    if (lResult == ERROR_SUCCESS) {
-        if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
-            // The value is REG_SZ or REG_MULTI_SZ.
-            dwSize /= sizeof(CHAR);
-            sValue.assign(reinterpret_cast<LPCSTR>(aStackBuffer), dwSize && reinterpret_cast<LPCSTR>(aStackBuffer)[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
-        } else if (dwType == REG_EXPAND_SZ) {
-            // The value is REG_EXPAND_SZ. Expand it from stack buffer.
-            if (::ExpandEnvironmentStringsA(reinterpret_cast<LPCSTR>(aStackBuffer), sValue) == 0)
-                lResult = ::GetLastError();
-        } else {
-            // The value is not a string type.
-            lResult = ERROR_INVALID_DATA;
-        }
-    } else if (lResult == ERROR_MORE_DATA) {
-        if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
-            // The value is REG_SZ or REG_MULTI_SZ. Read it now.
-            sValue.resize(dwSize / sizeof(CHAR));
-            if ((lResult = ::RegQueryValueExA(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(&sValue[0]), &dwSize)) == ERROR_SUCCESS) {
-                dwSize /= sizeof(CHAR);
-                sValue.resize(dwSize && sValue[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
-            }
-        } else if (dwType == REG_EXPAND_SZ) {
-            // The value is REG_EXPAND_SZ. Read it and expand environment variables.
-            std::unique_ptr<CHAR[]> szBuffer(new CHAR[dwSize / sizeof(CHAR) + 1]);
-            if ((lResult = ::RegQueryValueExA(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(szBuffer.get()), &dwSize)) == ERROR_SUCCESS) {
+    WINSTD_BUFFER_SITE("RegQueryStringValueA");
+    try {
+        LSTATUS lResult;
+        BYTE aStackBuffer[WINSTD_STACK_BUFFER_BYTES];
+        DWORD dwSize = sizeof(aStackBuffer), dwType;
+
+        // Try with stack buffer first.
+        lResult = WINSTD_BACKEND(RegQueryValueExA)(hReg, pszName, NULL, &dwType, aStackBuffer, &dwSize);
+        if (lResult == ERROR_SUCCESS) {
+            WINSTD_BUFFER_RECORD(true, 0, dwSize, 1);
+            if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
+                // The value is REG_SZ or REG_MULTI_SZ.
                 dwSize /= sizeof(CHAR);
-                szBuffer[dwSize] = 0;
-                if (::ExpandEnvironmentStringsA(szBuffer.get(), sValue) == 0)
+                sValue.assign(reinterpret_cast<LPCSTR>(aStackBuffer), dwSize && reinterpret_cast<LPCSTR>(aStackBuffer)[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
+            } else if (dwType == REG_EXPAND_SZ) {
+                // The value is REG_EXPAND_SZ. Expand it from stack buffer.
+                if (::ExpandEnvironmentStringsA(reinterpret_cast<LPCSTR>(aStackBuffer), sValue) == 0)
                     lResult = ::GetLastError();
+            } else {
+                // The value is not a string type.
+                lResult = ERROR_INVALID_DATA;
             }
-        } else {
-            // The value is not a string type.
-            lResult = ERROR_INVALID_DATA;
-        }
-    }
+        } else if (lResult == ERROR_MORE_DATA) {
+            WINSTD_BUFFER_RECORD(false, 1, dwSize, 2);
+            if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
+                // The value is REG_SZ or REG_MULTI_SZ. Read it now.
+                sValue.resize(dwSize / sizeof(CHAR));
+                if ((lResult = WINSTD_BACKEND(RegQueryValueExA)(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(&sValue[0]), &dwSize)) == ERROR_SUCCESS) {
+                    dwSize /= sizeof(CHAR);
+                    sValue.resize(dwSize && sValue[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
+                }
+            } else if (dwType == REG_EXPAND_SZ) {
+                // The value is REG_EXPAND_SZ. Read it and expand environment variables.
+                std::unique_ptr<CHAR[]> szBuffer(new CHAR[dwSize / sizeof(CHAR) + 1]);
+                if ((lResult = WINSTD_BACKEND(RegQueryValueExA)(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(szBuffer.get()), &dwSize)) == ERROR_SUCCESS) {
+                    dwSize /= sizeof(CHAR);
+                    szBuffer[dwSize] = 0;
+                    if (::ExpandEnvironmentStringsA(szBuffer.get(), sValue) == 0)
+                        lResult = ::GetLastError();
+                }
+            } else {
+                // The value is not a string type.
+                lResult = ERROR_INVALID_DATA;
+            }
+        } else
+            WINSTD_BUFFER_RECORD(false, 0, 0, 1);
 
-    return lResult;
+        return lResult;
+    } catch (const std::bad_alloc&) {
+        return ERROR_OUTOFMEMORY;
+    }
 }
 
 ///
@@ -481,49 +487,88 @@ static LSTATUS RegQueryStringValue(_In_ HKEY hReg, _In_z_ LPCSTR pszName, _Out_
 template<class _Traits, class _Ax>
 static LSTATUS RegQueryStringValue(_In_ HKEY hReg, _In_z_ LPCWSTR pszName, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sValue) noexcept
 {
-    LSTATUS lResult;
-    BYTE aStackBuffer[WINSTD_STACK_BUFFER_BYTES];
-    DWORD dwSize = sizeof(aStackBuffer), dwType;
-
-    // Try with stack buffer first.
-    lResult = ::RegQueryValueExW(hReg, pszName, NULL, &dwType, aStackBuffer, &dwSize);
-    if (lResult == ERROR_SUCCESS) {
-        if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
-            // The value is REG_SZ or REG_MULTI_SZ.
-            dwSize /= sizeof(WCHAR);
-            sValue.assign(reinterpret_cast<LPCWSTR>(aStackBuffer), dwSize && reinterpret_cast<LPCWSTR>(aStackBuffer)[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
-        } else if (dwType == REG_EXPAND_SZ) {
-            // The value is REG_EXPAND_SZ. Expand it from stack buffer.
-            if (::ExpandEnvironmentStringsW(reinterpret_cast<LPCWSTR>(aStackBuffer), sValue) == 0)
-                lResult = ::GetLastError();
-        } else {
-            // The value is not a string type.
-            lResult = ERROR_INVALID_DATA;
-        }
-    } else if (lResult == ERROR_MORE_DATA) {
-        if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
-            // The value is REG_SZ or REG_MULTI_SZ. Read it now.
-            sValue.resize(dwSize / sizeof(WCHAR));
-            if ((lResult = ::RegQueryValueExW(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(&sValue[0]), &dwSize)) == ERROR_SUCCESS) {
-                dwSize /= sizeof(WCHAR);
-                sValue.resize(dwSize && sValue[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
-            }
-        } else if (dwType == REG_EXPAND_SZ) {
-            // The value is REG_EXPAND_SZ. Read it and expand environment variables.
-            std::unique_ptr<WCHAR[]> szBuffer(new WCHAR[dwSize / sizeof(WCHAR) + 1]);
-            if ((lResult = ::RegQueryValueExW(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(szBuffer.get()), &dwSize)) == ERROR_SUCCESS) {
+    WINSTD_BUFFER_SITE("RegQueryStringValueW");
+    try {
+        LSTATUS lResult;
+        BYTE aStackBuffer[WINSTD_STACK_BUFFER_BYTES];
+        DWORD dwSize = sizeof(aStackBuffer), dwType;
+
+        // Try with stack buffer first.
+        lResult = WINSTD_BACKEND(RegQueryValueExW)(hReg, pszName, NULL, &dwType, aStackBuffer, &dwSize);
+        if (lResult == ERROR_SUCCESS) {
+            WINSTD_BUFFER_RECORD(true, 0, dwSize, 1);
+            if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
+                // The value is REG_SZ or REG_MULTI_SZ.
                 dwSize /= sizeof(WCHAR);
-                szBuffer[dwSize] = 0;
-                if (::ExpandEnvironmentStringsW(szBuffer.get(), sValue) == 0)
+                sValue.assign(reinterpret_cast<LPCWSTR>(aStackBuffer), dwSize && reinterpret_cast<LPCWSTR>(aStackBuffer)[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
+            } else if (dwType == REG_EXPAND_SZ) {
+                // The value is REG_EXPAND_SZ. Expand it from stack buffer.
+                if (::ExpandEnvironmentStringsW(reinterpret_cast<LPCWSTR>(aStackBuffer), sValue) == 0)
                     lResult = ::GetLastError();
+            } else {
+                // The value is not a string type.
+                lResult = ERROR_INVALID_DATA;
             }
-        } else {
-            // The value is not a string type.
-            lResult = ERROR_INVALID_DATA;
-        }
+        } else if (lResult == ERROR_MORE_DATA) {
+            WINSTD_BUFFER_RECORD(false, 1, dwSize, 2);
+            if (dwType == REG_SZ || dwType == REG_MULTI_SZ) {
+                // The value is REG_SZ or REG_MULTI_SZ. Read it now.
+                sValue.resize(dwSize / sizeof(WCHAR));
+                if ((lResult = WINSTD_BACKEND(RegQueryValueExW)(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(&sValue[0]), &dwSize)) == ERROR_SUCCESS) {
+                    dwSize /= sizeof(WCHAR);
+                    sValue.resize(dwSize && sValue[dwSize - 1] == 0 ? dwSize - 1 : dwSize);
+                }
+            } else if (dwType == REG_EXPAND_SZ) {
+                // The value is REG_EXPAND_SZ. Read it and expand environment variables.
+                std::unique_ptr<WCHAR[]> szBuffer(new WCHAR[dwSize / sizeof(WCHAR) + 1]);
+                if ((lResult = WINSTD_BACKEND(RegQueryValueExW)(hReg, pszName, NULL, NULL, reinterpret_cast<LPBYTE>(szBuffer.get()), &dwSize)) == ERROR_SUCCESS) {
+                    dwSize /= sizeof(WCHAR);
+                    szBuffer[dwSize] = 0;
+                    if (::ExpandEnvironmentStringsW(szBuffer.get(), sValue) == 0)
+                        lResult = ::GetLastError();
+                }
+            } else {
+                // The value is not a string type.
+                lResult = ERROR_INVALID_DATA;
+            }
+        } else
+            WINSTD_BUFFER_RECORD(false, 0, 0, 1);
+
+        return lResult;
+    } catch (const std::bad_alloc&) {
+        return ERROR_OUTOFMEMORY;
     }
+}
 
-    return lResult;
+/// @copydoc RegQueryStringValue(HKEY, LPCWSTR)
+template<class _Traits = std::char_traits<char>, class _Ax = std::allocator<char>>
+static winstd::expected<std::basic_string<char, _Traits, _Ax>> RegQueryStringValue(_In_ HKEY hReg, _In_z_ LPCSTR pszName) noexcept
+{
+    return winstd::expect_fill<std::basic_string<char, _Traits, _Ax>>([&](_Out_ std::basic_string<char, _Traits, _Ax> &sValue)
+    {
+        return static_cast<winstd::error_code>(RegQueryStringValue(hReg, pszName, sValue));
+    });
+}
+
+///
+/// Queries for a string value in the registry.
+///
+/// `REG_EXPAND_SZ` are expanded using `ExpandEnvironmentStrings()`.
+///
+/// \param[in] hReg     A handle to an open registry key. The key must have been opened with the KEY_QUERY_VALUE access right.
+/// \param[in] pszName  The name of the registry value. If lpValueName is NULL or an empty string, "", the function retrieves the type and data for the key's unnamed or default value, if any.
+///
+/// \returns String value on success; `ERROR_INVALID_DATA` when the registy value type is not a string, or error code of `RegQueryValueEx()` otherwise.
+///
+/// \sa [RegQueryValueEx function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724911.aspx)
+///
+template<class _Traits = std::char_traits<wchar_t>, class _Ax = std::allocator<wchar_t>>
+static winstd::expected<std::basic_string<wchar_t, _Traits, _Ax>> RegQueryStringValue(_In_ HKEY hReg, _In_z_ LPCWSTR pszName) noexcept
+{
+    return winstd::expect_fill<std::basic_string<wchar_t, _Traits, _Ax>>([&](_Out_ std::basic_string<wchar_t, _Traits, _Ax> &sValue)
+    {
+        return static_cast<winstd::error_code>(RegQueryStringValue(hReg, pszName, sValue));
+    });
 }
 
 /// @copydoc RegQueryValueExW()
@@ -535,7 +580,7 @@ static LSTATUS RegQueryValueExA(_In_ HKEY hKey, _In_opt_z_ LPCSTR lpValueName, _
     DWORD dwSize = sizeof(aStackBuffer);
 
     // Try with stack buffer first.
-    lResult = RegQueryValueExA(hKey, lpValueName, lpReserved, lpType, aStackBuffer, &dwSize);
+    lResult = WINSTD_BACKEND(RegQueryValueExA)(hKey, lpValueName, lpReserved, lpType, aStackBuffer, &dwSize);
     if (lResult == ERROR_SUCCESS) {
         // Copy from stack buffer.
         aData.resize((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
@@ -543,7 +588,7 @@ static LSTATUS RegQueryValueExA(_In_ HKEY hKey, _In_opt_z_ LPCSTR lpValueName, _
     } else if (lResult == ERROR_MORE_DATA) {
         // Allocate buffer on heap and retry.
         aData.resize((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
-        lResult = RegQueryValueExA(hKey, lpValueName, lpReserved, NULL, reinterpret_cast<LPBYTE>(aData.data()), &dwSize);
+        lResult = WINSTD_BACKEND(RegQueryValueExA)(hKey, lpValueName, lpReserved, NULL, reinterpret_cast<LPBYTE>(aData.data()), &dwSize);
     }
 
     return lResult;
@@ -562,7 +607,7 @@ static LSTATUS RegQueryValueExW(_In_ HKEY hKey, _In_opt_z_ LPCWSTR lpValueName,
     DWORD dwSize = sizeof(aStackBuffer);
 
     // Try with stack buffer first.
-    lResult = RegQueryValueExW(hKey, lpValueName, lpReserved, lpType, aStackBuffer, &dwSize);
+    lResult = WINSTD_BACKEND(RegQueryValueExW)(hKey, lpValueName, lpReserved, lpType, aStackBuffer, &dwSize);
     if (lResult == ERROR_SUCCESS) {
         // Copy from stack buffer.
         aData.resize((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
@@ -570,7 +615,7 @@ static LSTATUS RegQueryValueExW(_In_ HKEY hKey, _In_opt_z_ LPCWSTR lpValueName,
     } else if (lResult == ERROR_MORE_DATA) {
         // Allocate buffer on heap and retry.
         aData.resize((dwSize + sizeof(_Ty) - 1) / sizeof(_Ty));
-        lResult = RegQueryValueExW(hKey, lpValueName, lpReserved, NULL, reinterpret_cast<LPBYTE>(aData.data()), &dwSize);
+        lResult = WINSTD_BACKEND(RegQueryValueExW)(hKey, lpValueName, lpReserved, NULL, reinterpret_cast<LPBYTE>(aData.data()), &dwSize);
     }
 
     return lResult;
@@ -623,42 +668,53 @@ static LSTATUS RegLoadMUIStringW(_In_ HKEY hKey, _In_opt_z_ LPCWSTR pszValue, _O
 ///
 /// \sa [NormalizeString function](https://docs.microsoft.com/en-us/windows/win32/api/winnls/nf-winnls-normalizestring)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static _Success_(return > 0) int NormalizeString(_In_ NORM_FORM NormForm, _In_ LPCWSTR lpSrcString, _In_ int cwSrcLength, _Out_ std::basic_string<wchar_t, _Traits, _Ax> &sDstString) noexcept
 {
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(WCHAR)];
-
-    // Try to convert to stack buffer first.
-    int cch = ::NormalizeString(NormForm, lpSrcString, cwSrcLength, szStackBuffer, _countof(szStackBuffer));
-    if (cch > 0) {
-        // Copy from stack.
-        sDstString.assign(szStackBuffer, cwSrcLength != -1 ? wcsnlen(szStackBuffer, cch) : (size_t)cch - 1);
-    } else {
-        switch (::GetLastError()) {
-            case ERROR_INSUFFICIENT_BUFFER:
-                for (int i = 10; i--;) {
-                    // Allocate buffer. Then convert again.
-                    cch = -cch;
-                    sDstString.resize((size_t)cch - 1);
-                    cch = ::NormalizeString(NormForm, lpSrcString, cwSrcLength, &sDstString[0], cch);
-                    if (cch > 0) {
-                        sDstString.resize(cwSrcLength != -1 ? wcsnlen(&sDstString[0], cch) : (size_t)cch - 1);
-                        break;
-                    }
-                    if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
-                        sDstString.clear();
-                        break;
-                    }
-                }
-                break;
-
-            case ERROR_SUCCESS:
-                sDstString.clear();
-                break;
-        }
+    WINSTD_BUFFER_SITE("NormalizeString");
+    try {
+        int cch = 0;
+        winstd::probe_then_fill<_Policy>(sDstString, [&](_Out_writes_(cchBuffer) WCHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(NormalizeString)(NormForm, lpSrcString, cwSrcLength, pBuffer, (int)cchBuffer);
+            if (cch > 0) {
+                // Be careful not to include zero terminator.
+                return winstd::buffer_probe::ok(cwSrcLength != -1 ? wcsnlen(pBuffer, cch) : (size_t)cch - 1);
+            }
+            // The function returns negated estimate of the required length on insufficient buffer.
+            return ::GetLastError() == ERROR_INSUFFICIENT_BUFFER ? winstd::buffer_probe::more(-cch) : winstd::buffer_probe::fail();
+        }, cwSrcLength != -1 ? (size_t)cwSrcLength : 0);
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
     }
+}
 
-    return cch;
+///
+/// Normalizes characters of a text string according to Unicode 4.0 TR#15.
+///
+/// \sa [NormalizeString function](https://docs.microsoft.com/en-us/windows/win32/api/winnls/nf-winnls-normalizestring)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits1, class _Traits2, class _Ax2>
+static _Success_(return > 0) int NormalizeString(_In_ NORM_FORM NormForm, _In_ std::basic_string_view<wchar_t, _Traits1> sSrcString, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sDstString) noexcept
+{
+    WINSTD_BUFFER_SITE("NormalizeString");
+    try {
+        int cch = 0;
+        winstd::probe_then_fill<_Policy>(sDstString, [&](_Out_writes_(cchBuffer) WCHAR *pBuffer, _In_ size_t cchBuffer)
+        {
+            cch = WINSTD_BACKEND(NormalizeString)(NormForm, sSrcString.data(), (int)sSrcString.length(), pBuffer, (int)cchBuffer);
+            if (cch > 0)
+                return winstd::buffer_probe::ok(cch);
+            // The function returns negated estimate of the required length on insufficient buffer.
+            return ::GetLastError() == ERROR_INSUFFICIENT_BUFFER ? winstd::buffer_probe::more(-cch) : winstd::buffer_probe::fail();
+        }, sSrcString.length());
+        return cch;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
+        return 0;
+    }
 }
 
 ///
@@ -666,40 +722,26 @@ static _Success_(return > 0) int NormalizeString(_In_ NORM_FORM NormForm, _In_ L
 ///
 /// \sa [NormalizeString function](https://docs.microsoft.com/en-us/windows/win32/api/winnls/nf-winnls-normalizestring)
 ///
-template<class _Traits1, class _Ax1, class _Traits2, class _Ax2>
+template<class _Policy = winstd::default_buffer_policy, class _Traits1, class _Ax1, class _Traits2, class _Ax2>
 static _Success_(return > 0) int NormalizeString(_In_ NORM_FORM NormForm, _In_ const std::basic_string<wchar_t, _Traits1, _Ax1> &sSrcString, _Out_ std::basic_string<wchar_t, _Traits2, _Ax2> &sDstString) noexcept
 {
-    WCHAR szStackBuffer[WINSTD_STACK_BUFFER_BYTES/sizeof(WCHAR)];
-
-    // Try to convert to stack buffer first.
-    int cch = ::NormalizeString(NormForm, sSrcString.c_str(), (int)sSrcString.length(), szStackBuffer, _countof(szStackBuffer));
-    if (cch > 0) {
-        // Copy from stack.
-        sDstString.assign(szStackBuffer, cch);
-    } else {
-        switch (::GetLastError()) {
-            case ERROR_INSUFFICIENT_BUFFER:
-                for (int i = 10; i--;) {
-                    // Allocate buffer. Then convert again.
-                    cch = -cch;
-                    sDstString.resize(cch);
-                    cch = ::NormalizeString(NormForm, sSrcString.c_str(), (int)sSrcString.length(), &sDstString[0], cch);
-                    if (cch > 0)
-                        break;
-                    if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
-                        sDstString.clear();
-                        break;
-                    }
-                }
-                break;
-
-            case ERROR_SUCCESS:
-                sDstString.clear();
-                break;
-        }
-    }
+    return NormalizeString<_Policy>(NormForm, std::basic_string_view<wchar_t, _Traits1>(sSrcString), sDstString);
+}
 
-    return cch;
+///
+/// Normalizes characters of a text string according to Unicode 4.0 TR#15.
+///
+/// \returns Normalized string on success; error code otherwise. The error is reported in-band and `GetLastError()` need not be consulted.
+///
+/// \sa [NormalizeString function](https://docs.microsoft.com/en-us/windows/win32/api/winnls/nf-winnls-normalizestring)
+///
+template<class _Policy = winstd::default_buffer_policy, class _Traits = std::char_traits<wchar_t>, class _Ax = std::allocator<wchar_t>>
+static winstd::expected<std::basic_string<wchar_t, _Traits, _Ax>> NormalizeString(_In_ NORM_FORM NormForm, _In_ std::wstring_view sSrcString) noexcept
+{
+    return winstd::expect_fill<std::basic_string<wchar_t, _Traits, _Ax>>([&](_Out_ std::basic_string<wchar_t, _Traits, _Ax> &sDstString)
+    {
+        return sSrcString.empty() || NormalizeString<_Policy>(NormForm, sSrcString, sDstString) > 0 ? ERROR_SUCCESS : ::GetLastError();
+    });
 }
 
 /// @copydoc LoadStringW
@@ -741,9 +783,9 @@ static _Success_(return != 0) int WINAPI LoadStringW(_In_opt_ HINSTANCE hInstanc
 ///
 static VOID OutputDebugStrV(_In_z_ LPCSTR lpOutputString, _In_ va_list arg) noexcept
 {
-    std::string str;
-    try { vsprintf(str, lpOutputString, arg); } catch (...) { return; }
-    OutputDebugStringA(str.c_str());
+    winstd::format_buffer::scratch buf;
+    try { vsprintf(*buf, lpOutputString, arg); } catch (...) { return; }
+    OutputDebugStringA(buf->c_str());
 }
 
 ///
@@ -753,9 +795,9 @@ static VOID OutputDebugStrV(_In_z_ LPCSTR lpOutputString, _In_ va_list arg) noex
 ///
 static VOID OutputDebugStrV(_In_z_ LPCWSTR lpOutputString, _In_ va_list arg) noexcept
 {
-    std::wstring str;
-    try { vsprintf(str, lpOutputString, arg); } catch (...) { return; }
-    OutputDebugStringW(str.c_str());
+    winstd::wformat_buffer::scratch buf;
+    try { vsprintf(*buf, lpOutputString, arg); } catch (...) { return; }
+    OutputDebugStringW(buf->c_str());
 }
 
 ///
@@ -921,20 +963,41 @@ static _Success_(return != FALSE) BOOL CreateWellKnownSid(_In_ WELL_KNOWN_SID_TY
 template<class _Ty>
 static _Success_(return != 0) BOOL GetTokenInformation(_In_ HANDLE TokenHandle, _In_ TOKEN_INFORMATION_CLASS TokenInformationClass, _Out_ std::unique_ptr<_Ty> &TokenInformation) noexcept
 {
-    BYTE szStackBuffer[WINSTD_STACK_BUFFER_BYTES];
-    DWORD dwSize;
-
-    if (GetTokenInformation(TokenHandle, TokenInformationClass, szStackBuffer, sizeof(szStackBuffer), &dwSize)) {
-        // The stack buffer was big enough to retrieve complete data. Alloc and copy.
-        TokenInformation.reset((_Ty*)(new BYTE[dwSize]));
-        memcpy(TokenInformation.get(), szStackBuffer, dwSize);
-        return TRUE;
-    } else if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
-        // The stack buffer was too small to retrieve complete data. Alloc and retry.
-        TokenInformation.reset((_Ty*)(new BYTE[dwSize]));
-        return GetTokenInformation(TokenHandle, TokenInformationClass, TokenInformation.get(), dwSize, &dwSize);
-    } else
+    try {
+        BYTE szStackBuffer[WINSTD_STACK_BUFFER_BYTES];
+        DWORD dwSize;
+
+        if (GetTokenInformation(TokenHandle, TokenInformationClass, szStackBuffer, sizeof(szStackBuffer), &dwSize)) {
+            // The stack buffer was big enough to retrieve complete data. Alloc and copy.
+            TokenInformation.reset((_Ty*)(new BYTE[dwSize]));
+            memcpy(TokenInformation.get(), szStackBuffer, dwSize);
+            return TRUE;
+        } else if (GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+            // The stack buffer was too small to retrieve complete data. Alloc and retry.
+            TokenInformation.reset((_Ty*)(new BYTE[dwSize]));
+            return GetTokenInformation(TokenHandle, TokenInformationClass, TokenInformation.get(), dwSize, &dwSize);
+        } else
+            return FALSE;
+    } catch (const std::bad_alloc&) {
+        ::SetLastError(ERROR_OUTOFMEMORY);
         return FALSE;
+    }
+}
+
+///
+/// Retrieves a specified type of information about an access token. The calling process must have appropriate access rights to obtain the information.
+///
+/// \returns Token information on success; error code otherwise. The error is reported in-band and `GetLastError()` need not be consulted.
+///
+/// \sa [GetTokenInformation function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa446671.aspx)
+///
+template<class _Ty>
+static winstd::expected<std::unique_ptr<_Ty>> GetTokenInformation(_In_ HANDLE TokenHandle, _In_ TOKEN_INFORMATION_CLASS TokenInformationClass) noexcept
+{
+    return winstd::expect_fill<std::unique_ptr<_Ty>>([&](_Out_ std::unique_ptr<_Ty> &TokenInformation)
+    {
+        return GetTokenInformation(TokenHandle, TokenInformationClass, TokenInformation) ? ERROR_SUCCESS : ::GetLastError();
+    });
 }
 
 ///
@@ -942,28 +1005,18 @@ static _Success_(return != 0) BOOL GetTokenInformation(_In_ HANDLE TokenHandle,
 ///
 /// \sa [QueryFullProcessImageNameA function](https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-queryfullprocessimagenamea)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static _Success_(return != 0) BOOL QueryFullProcessImageNameA(_In_ HANDLE hProcess, _In_ DWORD dwFlags, _Inout_ std::basic_string<char, _Traits, _Ax>& sExeName)
 {
-    char szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(char)];
-    DWORD dwSize = _countof(szStackBuffer);
-
-    // Try with stack buffer first.
-    if (::QueryFullProcessImageNameA(hProcess, dwFlags, szStackBuffer, &dwSize)) {
-        // Copy from stack.
-        sExeName.assign(szStackBuffer, dwSize);
-        return TRUE;
-    }
-    for (DWORD dwCapacity = 2 * WINSTD_STACK_BUFFER_BYTES / sizeof(char); GetLastError() == ERROR_INSUFFICIENT_BUFFER; dwCapacity *= 2) {
-        // Allocate on heap and retry.
-        sExeName.resize(dwCapacity - 1);
-        dwSize = dwCapacity;
-        if (::QueryFullProcessImageNameA(hProcess, dwFlags, &sExeName[0], &dwSize)) {
-            sExeName.resize(dwSize);
-            return TRUE;
-        }
-    }
-    return FALSE;
+    WINSTD_BUFFER_SITE("QueryFullProcessImageNameA");
+    return winstd::probe_then_fill<_Policy>(sExeName, [&](_Out_writes_(cchBuffer) char *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        if (::QueryFullProcessImageNameA(hProcess, dwFlags, pBuffer, &dwSize))
+            return winstd::buffer_probe::ok(dwSize);
+        // The function does not report the required length. Let the policy grow the buffer.
+        return ::GetLastError() == ERROR_INSUFFICIENT_BUFFER ? winstd::buffer_probe::more() : winstd::buffer_probe::fail();
+    }) ? TRUE : FALSE;
 }
 
 ///
@@ -971,28 +1024,18 @@ static _Success_(return != 0) BOOL QueryFullProcessImageNameA(_In_ HANDLE hProce
 ///
 /// \sa [QueryFullProcessImageNameW function](https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-queryfullprocessimagenamew)
 ///
-template<class _Traits, class _Ax>
+template<class _Policy = winstd::default_buffer_policy, class _Traits, class _Ax>
 static _Success_(return != 0) BOOL QueryFullProcessImageNameW(_In_ HANDLE hProcess, _In_ DWORD dwFlags, _Inout_ std::basic_string<wchar_t, _Traits, _Ax>& sExeName)
 {
-    wchar_t szStackBuffer[WINSTD_STACK_BUFFER_BYTES / sizeof(wchar_t)];
-    DWORD dwSize = _countof(szStackBuffer);
-
-    // Try with stack buffer first.
-    if (::QueryFullProcessImageNameW(hProcess, dwFlags, szStackBuffer, &dwSize)) {
-        // Copy from stack.
-        sExeName.assign(szStackBuffer, dwSize);
-        return TRUE;
-    }
-    for (DWORD dwCapacity = 2 * WINSTD_STACK_BUFFER_BYTES / sizeof(wchar_t); GetLastError() == ERROR_INSUFFICIENT_BUFFER; dwCapacity *= 2) {
-        // Allocate on heap and retry.
-        sExeName.resize(dwCapacity - 1);
-        dwSize = dwCapacity;
-        if (::QueryFullProcessImageNameW(hProcess, dwFlags, &sExeName[0], &dwSize)) {
-            sExeName.resize(dwSize);
-            return TRUE;
-        }
-    }
-    return FALSE;
+    WINSTD_BUFFER_SITE("QueryFullProcessImageNameW");
+    return winstd::probe_then_fill<_Policy>(sExeName, [&](_Out_writes_(cchBuffer) wchar_t *pBuffer, _In_ size_t cchBuffer)
+    {
+        DWORD dwSize = (DWORD)cchBuffer;
+        if (::QueryFullProcessImageNameW(hProcess, dwFlags, pBuffer, &dwSize))
+            return winstd::buffer_probe::ok(dwSize);
+        // The function does not report the required length. Let the policy grow the buffer.
+        return ::GetLastError() == ERROR_INSUFFICIENT_BUFFER ? winstd::buffer_probe::more() : winstd::buffer_probe::fail();
+    }) ? TRUE : FALSE;
 }
 
 /// @}
@@ -1005,70 +1048,51 @@ namespace winstd
     /// @{
 
     ///
-    /// Windows HANDLE wrapper class
+    /// Traits of win_handle
     ///
     template<HANDLE INVALID>
-    class win_handle : public handle<HANDLE, INVALID>
+    struct win_handle_traits : basic_handle_traits<HANDLE, INVALID>
     {
-        WINSTD_HANDLE_IMPL(win_handle, HANDLE, INVALID)
-
-    public:
-        ///
-        /// Closes an open object handle.
-        ///
-        /// \sa [CloseHandle function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724211.aspx)
-        ///
-        virtual ~win_handle()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Closes an open object handle.
         ///
         /// \sa [CloseHandle function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724211.aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HANDLE h) noexcept
         {
-            CloseHandle(m_h);
+            CloseHandle(h);
         }
     };
 
     ///
-    /// Module handle wrapper
+    /// Windows HANDLE wrapper class
     ///
-    /// \sa [LoadLibraryEx function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms684179.aspx)
+    template<HANDLE INVALID>
+    using win_handle = basic_handle<win_handle_traits<INVALID>>;
+
+    ///
+    /// Traits of library
     ///
-    class library : public handle<HMODULE, NULL>
+    struct library_traits : basic_handle_traits<HMODULE, NULL>
     {
-        WINSTD_HANDLE_IMPL(library, HMODULE, NULL)
-
-    public:
-        ///
-        /// Frees the module.
-        ///
-        /// \sa [FreeLibrary function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms683152.aspx)
-        ///
-        virtual ~library()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Frees the module.
         ///
         /// \sa [FreeLibrary function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms683152.aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HMODULE h) noexcept
         {
-            FreeLibrary(m_h);
+            FreeLibrary(h);
         }
     };
 
+    ///
+    /// Module handle wrapper
+    ///
+    /// \sa [LoadLibraryEx function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms684179.aspx)
+    ///
+    typedef basic_handle<library_traits> library;
+
     ///
     /// Process handle wrapper
     ///
@@ -1172,184 +1196,1877 @@ namespace winstd
     };
 
     ///
-    /// Event handle wrapper
-    ///
-    /// \sa [CreateEventW function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-createeventw)
-    /// \sa [OpenEventW function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-openeventw)
+    /// Mapped view of a file mapping
     ///
-    typedef win_handle<NULL> event;
-
+    /// The view may start at any offset. The mapping is aligned down to the allocation granularity internally.
     ///
-    /// Critical section wrapper
+    /// \sa [MapViewOfFile function](https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-mapviewoffile)
     ///
-    class critical_section
+    class mapped_view
     {
-        WINSTD_NONCOPYABLE(critical_section)
-        WINSTD_NONMOVABLE(critical_section)
+        WINSTD_NONCOPYABLE(mapped_view)
 
     public:
         ///
-        /// Construct the object and initializes a critical section object
+        /// Constructs an empty view
         ///
-        /// \sa [InitializeCriticalSection function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-initializecriticalsection)
+        mapped_view() noexcept :
+            m_base(NULL),
+            m_data(NULL),
+            m_size(0),
+            m_offset(0)
+        {}
+
         ///
-        critical_section() noexcept
+        /// Maps a view of a file mapping
+        ///
+        /// \param[in] hFileMappingObject  File mapping handle
+        /// \param[in] dwDesiredAccess     Access to the view (`FILE_MAP_READ`, `FILE_MAP_WRITE`, etc.)
+        /// \param[in] offset              Offset of the first byte of the view in the file
+        /// \param[in] size                Number of bytes to map. Must not be 0.
+        ///
+        /// \sa [MapViewOfFile function](https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-mapviewoffile)
+        ///
+        mapped_view(_In_ HANDLE hFileMappingObject, _In_ DWORD dwDesiredAccess, _In_ ULONGLONG offset, _In_ SIZE_T size) noexcept :
+            m_base(NULL),
+            m_data(NULL),
+            m_size(0),
+            m_offset(offset)
         {
-            InitializeCriticalSection(&m_data);
+            assert(size);
+            const ULONGLONG aligned = offset - offset % allocation_granularity();
+            const SIZE_T bias = static_cast<SIZE_T>(offset - aligned);
+            if (size > SIZE_MAX - bias) {
+                SetLastError(ERROR_ARITHMETIC_OVERFLOW);
+                return;
+            }
+            m_base = MapViewOfFile(hFileMappingObject, dwDesiredAccess, static_cast<DWORD>(aligned >> 32), static_cast<DWORD>(aligned), bias + size);
+            if (m_base) {
+                m_data = static_cast<BYTE*>(m_base) + bias;
+                m_size = size;
+            }
         }
 
         ///
-        /// Releases all resources used by an unowned critical section object.
+        /// Move constructor
         ///
-        /// \sa [DeleteCriticalSection function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-deletecriticalsection)
+        /// \param[inout] other  View to take over
         ///
-        virtual ~critical_section()
+        mapped_view(_Inout_ mapped_view &&other) noexcept :
+            m_base(other.m_base),
+            m_data(other.m_data),
+            m_size(other.m_size),
+            m_offset(other.m_offset)
         {
-            DeleteCriticalSection(&m_data);
+            other.m_base = NULL;
+            other.m_data = NULL;
+            other.m_size = 0;
         }
 
         ///
-        /// Auto-typecasting operator
+        /// Move assignment
         ///
-        /// \return Pointer to critical section
+        /// \param[inout] other  View to take over
         ///
-        operator LPCRITICAL_SECTION() noexcept
+        mapped_view& operator=(_Inout_ mapped_view &&other) noexcept
         {
-            return &m_data;
+            if (this != std::addressof(other)) {
+                if (m_base)
+                    UnmapViewOfFile(m_base);
+                m_base = other.m_base;
+                m_data = other.m_data;
+                m_size = other.m_size;
+                m_offset = other.m_offset;
+                other.m_base = NULL;
+                other.m_data = NULL;
+                other.m_size = 0;
+            }
+            return *this;
         }
 
-    protected:
-        CRITICAL_SECTION m_data;    ///< Critical section struct
-    };
+        ///
+        /// Unmaps the view
+        ///
+        ~mapped_view()
+        {
+            if (m_base)
+                UnmapViewOfFile(m_base);
+        }
+
+        ///
+        /// Returns true if the view is mapped
+        ///
+        explicit operator bool() const noexcept
+        {
+            return m_base != NULL;
+        }
+
+        ///
+        /// Returns the first byte of the view
+        ///
+        BYTE* data() const noexcept
+        {
+            return m_data;
+        }
+
+        ///
+        /// Returns the size of the view in bytes
+        ///
+        SIZE_T size() const noexcept
+        {
+            return m_size;
+        }
+
+        ///
+        /// Returns the offset of the view in the file
+        ///
+        ULONGLONG offset() const noexcept
+        {
+            return m_offset;
+        }
+
+        ///
+        /// Returns true if the view covers the given file range
+        ///
+        /// \param[in] offset  Offset of the range in the file
+        /// \param[in] size    Size of the range in bytes
+        ///
+        bool contains(_In_ ULONGLONG offset, _In_ SIZE_T size) const noexcept
+        {
+            return m_base && m_offset <= offset && offset - m_offset <= m_size && size <= m_size - static_cast<SIZE_T>(offset - m_offset);
+        }
+
+#ifdef __cpp_lib_span
+        ///
+        /// Returns the view as a span
+        ///
+        std::span<BYTE> span() const noexcept
+        {
+            return std::span<BYTE>(m_data, m_size);
+        }
+#endif
+
+        ///
+        /// Hints the system to read the view into memory in large batches
+        ///
+        /// \note Requires Windows 8 or later. On earlier versions the function does nothing.
+        ///
+        /// \sa [PrefetchVirtualMemory function](https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-prefetchvirtualmemory)
+        ///
+        void prefetch() const noexcept
+        {
+#if _WIN32_WINNT >= _WIN32_WINNT_WIN8
+            if (m_base) {
+                WIN32_MEMORY_RANGE_ENTRY range = { m_data, m_size };
+                PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+            }
+#endif
+        }
+
+        ///
+        /// Returns the granularity of view offsets
+        ///
+        static DWORD allocation_granularity() noexcept
+        {
+            static const DWORD granularity = []
+            {
+                SYSTEM_INFO si;
+                GetSystemInfo(&si);
+                return si.dwAllocationGranularity;
+            }();
+            return granularity;
+        }
+
+    protected:
+        LPVOID m_base;      ///< View base address as returned by `MapViewOfFile()`
+        BYTE *m_data;       ///< First byte of the view
+        SIZE_T m_size;      ///< Size of the view in bytes
+        ULONGLONG m_offset; ///< Offset of the view in the file
+    };
+
+    ///
+    /// Maps a file through a sliding window of views
+    ///
+    /// Instead of mapping the whole file, which fails for files over 4 GB in 32-bit processes and fragments the address
+    /// space, views of `window_bytes` are mapped on demand. The most recently used views are kept mapped and reused when a
+    /// later request falls inside one of them.
+    ///
+    /// Iterating the object yields consecutive windows covering the whole file.
+    ///
+    class mapped_window
+    {
+        WINSTD_NONCOPYABLE(mapped_window)
+        WINSTD_NONMOVABLE(mapped_window)
+
+    public:
+        ///
+        /// Default window size in bytes
+        ///
+        static constexpr SIZE_T default_window_bytes = 0x1000000;
+
+        ///
+        /// Default number of views kept mapped besides the current one
+        ///
+        static constexpr size_t default_cached_views = 3;
+
+        ///
+        /// File window
+        ///
+        struct chunk
+        {
+            ULONGLONG offset;   ///< Offset of the window in the file
+            BYTE *data;         ///< First byte of the window
+            SIZE_T size;        ///< Size of the window in bytes
+
+#ifdef __cpp_lib_span
+            ///
+            /// Returns the window as a span
+            ///
+            std::span<BYTE> span() const noexcept
+            {
+                return std::span<BYTE>(data, size);
+            }
+#endif
+        };
+
+        ///
+        /// Input iterator over consecutive windows
+        ///
+        class iterator
+        {
+        public:
+            typedef std::input_iterator_tag iterator_category; ///< Iterator category
+            typedef chunk value_type;                          ///< Value type
+            typedef ptrdiff_t difference_type;                 ///< Difference type
+            typedef const chunk *pointer;                      ///< Pointer type
+            typedef const chunk &reference;                    ///< Reference type
+
+            ///
+            /// Constructs an iterator
+            ///
+            /// \param[in] window  Mapped window or `NULL` for the end iterator
+            /// \param[in] offset  Offset of the window in the file
+            ///
+            iterator(_In_opt_ mapped_window *window = NULL, _In_ ULONGLONG offset = 0) noexcept :
+                m_window(window),
+                m_chunk{ offset, NULL, 0 }
+            {
+                map();
+            }
+
+            ///
+            /// Returns the current window
+            ///
+            reference operator*() const noexcept
+            {
+                return m_chunk;
+            }
+
+            ///
+            /// Accesses the current window
+            ///
+            pointer operator->() const noexcept
+            {
+                return &m_chunk;
+            }
+
+            ///
+            /// Advances to the next window
+            ///
+            iterator& operator++() noexcept
+            {
+                m_chunk.offset += m_chunk.size;
+                map();
+                return *this;
+            }
+
+            ///
+            /// Returns true if both iterators refer to the same window
+            ///
+            bool operator==(_In_ const iterator &other) const noexcept
+            {
+                return m_window == other.m_window && (!m_window || m_chunk.offset == other.m_chunk.offset);
+            }
+
+            ///
+            /// Returns true if iterators refer to different windows
+            ///
+            bool operator!=(_In_ const iterator &other) const noexcept
+            {
+                return !operator==(other);
+            }
+
+        protected:
+            /// \cond internal
+            void map() noexcept
+            {
+                if (!m_window)
+                    return;
+                const ULONGLONG left = m_window->m_size - m_chunk.offset;
+                m_chunk.size = left < m_window->m_window ? static_cast<SIZE_T>(left) : m_window->m_window;
+                if (!m_chunk.size || (m_chunk.data = m_window->view(m_chunk.offset, m_chunk.size)) == NULL)
+                    m_window = NULL;
+            }
+            /// \endcond
+
+        protected:
+            mapped_window *m_window;    ///< Mapped window; `NULL` when past the end
+            chunk m_chunk;              ///< Current window
+        };
+
+        ///
+        /// Creates a mapping of the file
+        ///
+        /// \param[in] hFile         File handle
+        /// \param[in] flProtect     Page protection of the mapping (`PAGE_READONLY`, `PAGE_READWRITE`, etc.)
+        /// \param[in] window_bytes  Window size in bytes. Rounded up to the allocation granularity.
+        /// \param[in] cached_views  Number of views kept mapped besides the current one
+        /// \param[in] prefetch      Hint the system to read each newly mapped view into memory in large batches
+        ///
+        /// \sa [CreateFileMapping function](https://docs.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-createfilemappingw)
+        ///
+        mapped_window(_In_ HANDLE hFile, _In_ DWORD flProtect = PAGE_READONLY, _In_ SIZE_T window_bytes = default_window_bytes, _In_ size_t cached_views = default_cached_views, _In_ bool prefetch = false) noexcept :
+            m_access((flProtect & 0xff) == PAGE_READWRITE || (flProtect & 0xff) == PAGE_EXECUTE_READWRITE ? FILE_MAP_WRITE : (flProtect & 0xff) == PAGE_WRITECOPY ? FILE_MAP_COPY : FILE_MAP_READ),
+            m_size(0),
+            m_prefetch(prefetch),
+            m_error(ERROR_SUCCESS),
+            m_maps(0),
+            m_reuses(0)
+        {
+            const SIZE_T granularity = mapped_view::allocation_granularity();
+            m_window = window_bytes > granularity ? (window_bytes + granularity - 1) / granularity * granularity : granularity;
+            m_capacity = cached_views + 1;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(hFile, &size)) {
+                m_error = GetLastError();
+                return;
+            }
+            m_size = static_cast<ULONGLONG>(size.QuadPart);
+            if (!m_size) {
+                // Empty files cannot be mapped.
+                return;
+            }
+            m_mapping.attach(CreateFileMappingW(hFile, NULL, flProtect, 0, 0, NULL));
+            if (!m_mapping) {
+                m_error = GetLastError();
+                return;
+            }
+            try {
+                m_views.reserve(m_capacity);
+            } catch (const std::bad_alloc&) {
+                m_mapping.free();
+                m_error = ERROR_OUTOFMEMORY;
+            }
+        }
+
+        ///
+        /// Returns true if the file was mapped or is empty
+        ///
+        explicit operator bool() const noexcept
+        {
+            return !!m_mapping || (!m_size && m_error == ERROR_SUCCESS);
+        }
+
+        ///
+        /// Returns the error of the last failed operation, or `ERROR_SUCCESS`
+        ///
+        DWORD error() const noexcept
+        {
+            return m_error;
+        }
+
+        ///
+        /// Returns the file size in bytes
+        ///
+        ULONGLONG size() const noexcept
+        {
+            return m_size;
+        }
+
+        ///
+        /// Returns the window size in bytes
+        ///
+        SIZE_T window_size() const noexcept
+        {
+            return m_window;
+        }
+
+        ///
+        /// Returns the number of views mapped
+        ///
+        uint64_t maps() const noexcept
+        {
+            return m_maps;
+        }
+
+        ///
+        /// Returns the number of requests served by a view mapped earlier
+        ///
+        uint64_t reuses() const noexcept
+        {
+            return m_reuses;
+        }
+
+        ///
+        /// Returns pointer to the given file range
+        ///
+        /// When the range is not covered by one of the mapped views, a view starting at the window containing `offset` is
+        /// mapped and the least recently used view is unmapped.
+        ///
+        /// \param[in] offset  Offset of the range in the file
+        /// \param[in] size    Size of the range in bytes. Must not be 0.
+        ///
+        /// \returns Pointer to the first byte of the range; `NULL` on error. The pointer remains valid until its view
+        ///          falls out of the `cached_views + 1` most recently used views.
+        ///
+        BYTE* view(_In_ ULONGLONG offset, _In_ SIZE_T size) noexcept
+        {
+            if (!size || offset >= m_size || size > m_size - offset) {
+                m_error = ERROR_INVALID_PARAMETER;
+                return NULL;
+            }
+            for (size_t i = 0; i < m_views.size(); ++i) {
+                if (m_views[i].contains(offset, size)) {
+                    if (i) {
+                        // Move to front.
+                        mapped_view v(std::move(m_views[i]));
+                        for (size_t j = i; j; --j)
+                            m_views[j] = std::move(m_views[j - 1]);
+                        m_views[0] = std::move(v);
+                    }
+                    m_reuses++;
+                    return m_views[0].data() + (offset - m_views[0].offset());
+                }
+            }
+
+            // Map the window containing offset, extended to cover the whole range.
+            const ULONGLONG start = offset - offset % m_window;
+            const ULONGLONG end = offset + size - start > m_window ? offset + size : (m_size - start > m_window ? start + m_window : m_size);
+            if (end - start > SIZE_MAX) {
+                m_error = ERROR_NOT_ENOUGH_MEMORY;
+                return NULL;
+            }
+            if (m_views.size() == m_capacity) {
+                // Unmap first to keep the address space use bounded.
+                m_views.pop_back();
+            }
+            mapped_view v(m_mapping, m_access, start, static_cast<SIZE_T>(end - start));
+            if (!v) {
+                m_error = GetLastError();
+                return NULL;
+            }
+            if (m_prefetch)
+                v.prefetch();
+            m_maps++;
+            m_views.emplace(m_views.begin(), std::move(v));
+            return m_views[0].data() + (offset - start);
+        }
+
+#ifdef __cpp_lib_span
+        ///
+        /// Returns span of the given file range
+        ///
+        /// \param[in] offset  Offset of the range in the file
+        /// \param[in] size    Size of the range in bytes
+        ///
+        /// \returns Span of the range; empty span on error
+        ///
+        std::span<BYTE> span(_In_ ULONGLONG offset, _In_ SIZE_T size) noexcept
+        {
+            BYTE *data = view(offset, size);
+            return data ? std::span<BYTE>(data, size) : std::span<BYTE>();
+        }
+#endif
+
+        ///
+        /// Returns iterator to the first window
+        ///
+        iterator begin() noexcept
+        {
+            return iterator(this, 0);
+        }
+
+        ///
+        /// Returns the end iterator
+        ///
+        iterator end() noexcept
+        {
+            return iterator();
+        }
+
+    protected:
+        file_mapping m_mapping;             ///< File mapping
+        DWORD m_access;                     ///< View access
+        ULONGLONG m_size;                   ///< File size
+        SIZE_T m_window;                    ///< Window size
+        size_t m_capacity;                  ///< Maximum number of mapped views
+        bool m_prefetch;                    ///< Prefetch newly mapped views?
+        DWORD m_error;                      ///< Error of the last failed operation
+        std::vector<mapped_view> m_views;   ///< Mapped views, most recently used first
+        uint64_t m_maps;                    ///< Number of views mapped
+        uint64_t m_reuses;                  ///< Number of requests served by a view mapped earlier
+    };
+
+    ///
+    /// Event handle wrapper
+    ///
+    /// \sa [CreateEventW function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-createeventw)
+    /// \sa [OpenEventW function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-openeventw)
+    ///
+    typedef win_handle<NULL> event;
+
+    ///
+    /// Critical section wrapper
+    ///
+    class critical_section
+    {
+        WINSTD_NONCOPYABLE(critical_section)
+        WINSTD_NONMOVABLE(critical_section)
+
+    public:
+        ///
+        /// Construct the object and initializes a critical section object
+        ///
+        /// \sa [InitializeCriticalSection function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-initializecriticalsection)
+        ///
+        critical_section() noexcept
+        {
+            InitializeCriticalSection(&m_data);
+        }
+
+        ///
+        /// Releases all resources used by an unowned critical section object.
+        ///
+        /// \sa [DeleteCriticalSection function](https://docs.microsoft.com/en-us/windows/desktop/api/synchapi/nf-synchapi-deletecriticalsection)
+        ///
+        virtual ~critical_section()
+        {
+            DeleteCriticalSection(&m_data);
+        }
+
+        ///
+        /// Auto-typecasting operator
+        ///
+        /// \return Pointer to critical section
+        ///
+        operator LPCRITICAL_SECTION() noexcept
+        {
+            return &m_data;
+        }
+
+    protected:
+        CRITICAL_SECTION m_data;    ///< Critical section struct
+    };
+
+    ///
+    /// Traits of find_file
+    ///
+    struct find_file_traits : basic_handle_traits<HANDLE, INVALID_HANDLE_VALUE>
+    {
+        ///
+        /// Closes a file search handle.
+        ///
+        /// \sa [FindClose function](https://docs.microsoft.com/en-us/windows/desktop/api/fileapi/nf-fileapi-findclose)
+        ///
+        static void close(_In_ HANDLE h) noexcept
+        {
+            FindClose(h);
+        }
+    };
+
+    ///
+    /// Find-file handle wrapper
+    ///
+    /// \sa [FindFirstFile function](https://docs.microsoft.com/en-us/windows/desktop/api/fileapi/nf-fileapi-findfirstfilew)
+    ///
+    typedef basic_handle<find_file_traits> find_file;
+
+#if _WIN32_WINNT >= _WIN32_WINNT_VISTA
+
+    ///
+    /// Directory entry as enumerated by directory_range
+    ///
+    /// The entry refers to the batch buffer of the range and is valid until the range fetches the next batch.
+    ///
+    class directory_entry
+    {
+    public:
+        ///
+        /// Wraps directory information
+        ///
+        /// \param[in] info  Directory information as returned by `GetFileInformationByHandleEx(FileIdBothDirectoryInfo)`
+        ///
+        directory_entry(_In_ const FILE_ID_BOTH_DIR_INFO *info) noexcept : m_info(info)
+        {}
+
+        ///
+        /// Returns the file name. The name is not zero-terminated.
+        ///
+        std::wstring_view name() const noexcept
+        {
+            return std::wstring_view(m_info->FileName, m_info->FileNameLength / sizeof(WCHAR));
+        }
+
+        ///
+        /// Returns the file attributes
+        ///
+        DWORD attributes() const noexcept
+        {
+            return m_info->FileAttributes;
+        }
+
+        ///
+        /// Returns true if the entry is a directory
+        ///
+        bool is_directory() const noexcept
+        {
+            return (m_info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        }
+
+        ///
+        /// Returns true if the entry is a reparse point (symbolic link, junction, etc.)
+        ///
+        bool is_reparse_point() const noexcept
+        {
+            return (m_info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+        }
+
+        ///
+        /// Returns the file size in bytes
+        ///
+        ULONGLONG size() const noexcept
+        {
+            return static_cast<ULONGLONG>(m_info->EndOfFile.QuadPart);
+        }
+
+        ///
+        /// Returns the time of the last write to the file in 100-nanosecond intervals since January 1, 1601 (UTC)
+        ///
+        ULONGLONG last_write_time() const noexcept
+        {
+            return static_cast<ULONGLONG>(m_info->LastWriteTime.QuadPart);
+        }
+
+        ///
+        /// Returns the file ID
+        ///
+        ULONGLONG file_id() const noexcept
+        {
+            return static_cast<ULONGLONG>(m_info->FileId.QuadPart);
+        }
+
+        ///
+        /// Returns the directory information
+        ///
+        const FILE_ID_BOTH_DIR_INFO* info() const noexcept
+        {
+            return m_info;
+        }
+
+    protected:
+        const FILE_ID_BOTH_DIR_INFO *m_info; ///< Directory information
+    };
+
+    ///
+    /// Enumerates a directory in large batches
+    ///
+    /// Unlike `FindFirstFile()`/`FindNextFile()` returning one entry per call, each `GetFileInformationByHandleEx()` call
+    /// fills the batch buffer with as many entries as fit. The `.` and `..` entries are skipped.
+    ///
+    /// The range is single-pass: calling begin() again restarts the enumeration.
+    ///
+    /// \sa [GetFileInformationByHandleEx function](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-getfileinformationbyhandleex)
+    ///
+    class directory_range
+    {
+        WINSTD_NONCOPYABLE(directory_range)
+        WINSTD_NONMOVABLE(directory_range)
+
+    public:
+        ///
+        /// Default size of the batch buffer in bytes
+        ///
+        /// Directory queries over SMB are limited to 64 KiB per call.
+        ///
+        static constexpr size_t default_batch_bytes = 0x10000;
+
+        ///
+        /// Input iterator over directory entries
+        ///
+        class iterator
+        {
+        public:
+            typedef std::input_iterator_tag iterator_category; ///< Iterator category
+            typedef directory_entry value_type;                ///< Value type
+            typedef ptrdiff_t difference_type;                 ///< Difference type
+            typedef const directory_entry *pointer;            ///< Pointer type
+            typedef const directory_entry &reference;          ///< Reference type
+
+            ///
+            /// Constructs an iterator
+            ///
+            /// \param[in] range  Directory range or `NULL` for the end iterator
+            ///
+            iterator(_In_opt_ directory_range *range = NULL) noexcept :
+                m_range(range),
+                m_entry(range ? range->m_entry : NULL)
+            {}
+
+            ///
+            /// Returns the current entry
+            ///
+            reference operator*() const noexcept
+            {
+                return m_entry;
+            }
+
+            ///
+            /// Accesses the current entry
+            ///
+            pointer operator->() const noexcept
+            {
+                return &m_entry;
+            }
+
+            ///
+            /// Advances to the next entry
+            ///
+            iterator& operator++() noexcept
+            {
+                m_range->next();
+                m_entry = directory_entry(m_range->m_entry);
+                if (!m_range->m_entry)
+                    m_range = NULL;
+                return *this;
+            }
+
+            ///
+            /// Returns true if both iterators refer to the same position
+            ///
+            bool operator==(_In_ const iterator &other) const noexcept
+            {
+                return m_range == other.m_range;
+            }
+
+            ///
+            /// Returns true if iterators refer to different positions
+            ///
+            bool operator!=(_In_ const iterator &other) const noexcept
+            {
+                return m_range != other.m_range;
+            }
+
+        protected:
+            directory_range *m_range; ///< Directory range; `NULL` when past the end
+            directory_entry m_entry;  ///< Current entry
+        };
+
+        ///
+        /// Opens the directory for enumeration
+        ///
+        /// \param[in] pszPath      Directory path
+        /// \param[in] batch_bytes  Size of the batch buffer in bytes
+        ///
+        directory_range(_In_z_ LPCWSTR pszPath, _In_ size_t batch_bytes = default_batch_bytes) noexcept :
+            m_h(CreateFileW(pszPath, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL)),
+            m_error(!m_h ? GetLastError() : ERROR_SUCCESS),
+            m_size(batch_bytes > min_batch_bytes ? batch_bytes : min_batch_bytes),
+            m_entry(NULL),
+            m_batches(0)
+        {
+            if (!m_h)
+                return;
+            m_buffer.reset(new (std::nothrow) ULONGLONG[(m_size + sizeof(ULONGLONG) - 1) / sizeof(ULONGLONG)]);
+            if (!m_buffer) {
+                m_h.free();
+                m_error = ERROR_OUTOFMEMORY;
+            }
+        }
+
+        ///
+        /// Returns true if the directory was opened
+        ///
+        explicit operator bool() const noexcept
+        {
+            return !!m_h;
+        }
+
+        ///
+        /// Returns the error that prevented opening or completing the enumeration, or `ERROR_SUCCESS`
+        ///
+        DWORD error() const noexcept
+        {
+            return m_error;
+        }
+
+        ///
+        /// Returns the number of batches fetched
+        ///
+        size_t batches() const noexcept
+        {
+            return m_batches;
+        }
+
+        ///
+        /// Starts (or restarts) the enumeration and returns an iterator to the first entry
+        ///
+        iterator begin() noexcept
+        {
+            m_entry = NULL;
+            if (!m_h || !fetch(FileIdBothDirectoryRestartInfo))
+                return iterator();
+            if (is_dots(m_entry))
+                next();
+            return iterator(m_entry ? this : NULL);
+        }
+
+        ///
+        /// Returns the end iterator
+        ///
+        iterator end() noexcept
+        {
+            return iterator();
+        }
+
+    protected:
+        /// \cond internal
+        static constexpr size_t min_batch_bytes = sizeof(FILE_ID_BOTH_DIR_INFO) + MAX_PATH * sizeof(WCHAR);
+
+        bool fetch(_In_ FILE_INFO_BY_HANDLE_CLASS cls) noexcept
+        {
+            if (GetFileInformationByHandleEx(m_h, cls, m_buffer.get(), static_cast<DWORD>(m_size))) {
+                m_entry = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(m_buffer.get());
+                m_batches++;
+                return true;
+            }
+            const DWORD error = GetLastError();
+            m_error = error == ERROR_NO_MORE_FILES ? ERROR_SUCCESS : error;
+            m_entry = NULL;
+            return false;
+        }
+
+        void next() noexcept
+        {
+            do {
+                if (m_entry->NextEntryOffset)
+                    m_entry = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(reinterpret_cast<const BYTE*>(m_entry) + m_entry->NextEntryOffset);
+                else if (!fetch(FileIdBothDirectoryInfo))
+                    return;
+            } while (is_dots(m_entry));
+        }
+
+        static bool is_dots(_In_ const FILE_ID_BOTH_DIR_INFO *info) noexcept
+        {
+            return
+                info->FileName[0] == L'.' && (
+                    info->FileNameLength == sizeof(WCHAR) ||
+                    (info->FileNameLength == 2 * sizeof(WCHAR) && info->FileName[1] == L'.'));
+        }
+        /// \endcond
+
+    protected:
+        file m_h;                                   ///< Directory handle
+        DWORD m_error;                              ///< Error that stopped the enumeration
+        size_t m_size;                              ///< Size of the batch buffer in bytes
+        std::unique_ptr<ULONGLONG[]> m_buffer;      ///< Batch buffer
+        const FILE_ID_BOTH_DIR_INFO *m_entry;       ///< Current entry; `NULL` when enumeration is over
+        size_t m_batches;                           ///< Number of batches fetched
+    };
+
+    ///
+    /// Directory tree walk counters
+    ///
+    struct directory_walk_stats
+    {
+        uint64_t directories;   ///< Number of directories visited
+        uint64_t entries;       ///< Number of entries reported to the callback
+        uint64_t batches;       ///< Number of batches fetched
+        uint64_t steals;        ///< Number of directories a worker took from another worker's queue
+        uint64_t errors;        ///< Number of directories failing to open or enumerate
+    };
+
+    /// \cond internal
+    template <class _Fn>
+    class directory_walker
+    {
+        WINSTD_NONCOPYABLE(directory_walker)
+        WINSTD_NONMOVABLE(directory_walker)
+
+    public:
+        directory_walker(_In_ _Fn &fn, _In_ size_t threads, _In_ size_t batch_bytes) :
+            m_fn(fn),
+            m_batch_bytes(batch_bytes),
+            m_queues(threads),
+            m_next_worker(0),
+            m_pending(0),
+            m_queued(0),
+            m_sleepers(0),
+            m_abort(false),
+            m_directories(0),
+            m_entries(0),
+            m_batches(0),
+            m_steals(0),
+            m_errors(0)
+        {
+            InitializeSRWLock(&m_idle_lock);
+            InitializeConditionVariable(&m_idle);
+        }
+
+        directory_walk_stats run(_In_z_ LPCWSTR pszRoot)
+        {
+            push(0, std::wstring(pszRoot));
+            PTP_WORK work = CreateThreadpoolWork(work_callback, this, NULL);
+            if (work) {
+                for (size_t i = 0; i < m_queues.size(); ++i)
+                    SubmitThreadpoolWork(work);
+                WaitForThreadpoolWorkCallbacks(work, FALSE);
+                CloseThreadpoolWork(work);
+            } else {
+                // Walk on the calling thread. Work pushed to the other queues is stolen.
+                worker(0);
+            }
+            if (m_exception)
+                std::rethrow_exception(m_exception);
+            directory_walk_stats s;
+            s.directories = m_directories.load(std::memory_order_relaxed);
+            s.entries     = m_entries.load(std::memory_order_relaxed);
+            s.batches     = m_batches.load(std::memory_order_relaxed);
+            s.steals      = m_steals.load(std::memory_order_relaxed);
+            s.errors      = m_errors.load(std::memory_order_relaxed);
+            return s;
+        }
+
+    protected:
+        struct queue
+        {
+            queue() noexcept
+            {
+                InitializeSRWLock(&lock);
+            }
+
+            SRWLOCK lock;
+            std::deque<std::wstring> dirs;
+        };
+
+        static void CALLBACK work_callback(_Inout_ PTP_CALLBACK_INSTANCE Instance, _Inout_opt_ PVOID Context, _Inout_ PTP_WORK Work) noexcept
+        {
+            UNREFERENCED_PARAMETER(Instance);
+            UNREFERENCED_PARAMETER(Work);
+            directory_walker *walker = static_cast<directory_walker*>(Context);
+            walker->worker(walker->m_next_worker.fetch_add(1, std::memory_order_relaxed) % walker->m_queues.size());
+        }
+
+        void worker(_In_ size_t idx) noexcept
+        {
+            uint64_t directories = 0, entries = 0, batches = 0, steals = 0, errors = 0;
+            try {
+                std::wstring dir;
+                while (!m_abort.load(std::memory_order_relaxed)) {
+                    if (!pop(idx, dir)) {
+                        if (!steal(idx, dir)) {
+                            if (!wait())
+                                break;
+                            continue;
+                        }
+                        steals++;
+                    }
+
+                    // Each worker keeps at most one directory open at a time.
+                    directory_range range(dir.c_str(), m_batch_bytes);
+                    if (range) {
+                        for (auto &entry : range) {
+                            entries++;
+                            if (m_fn(static_cast<const std::wstring&>(dir), entry) && entry.is_directory() && !entry.is_reparse_point()) {
+                                std::wstring_view name = entry.name();
+                                std::wstring sub;
+                                sub.reserve(dir.size() + 1 + name.size());
+                                sub += dir;
+                                if (!dir.empty() && dir.back() != L'\\' && dir.back() != L'/')
+                                    sub += L'\\';
+                                sub += name;
+                                push(idx, std::move(sub));
+                            }
+                        }
+                        batches += range.batches();
+                    }
+                    if (range.error() != ERROR_SUCCESS)
+                        errors++;
+                    directories++;
+                    done();
+                }
+            } catch (...) {
+                AcquireSRWLockExclusive(&m_idle_lock);
+                if (!m_exception)
+                    m_exception = std::current_exception();
+                m_abort.store(true, std::memory_order_relaxed);
+                ReleaseSRWLockExclusive(&m_idle_lock);
+                WakeAllConditionVariable(&m_idle);
+            }
+            m_directories.fetch_add(directories, std::memory_order_relaxed);
+            m_entries.fetch_add(entries, std::memory_order_relaxed);
+            m_batches.fetch_add(batches, std::memory_order_relaxed);
+            m_steals.fetch_add(steals, std::memory_order_relaxed);
+            m_errors.fetch_add(errors, std::memory_order_relaxed);
+        }
+
+        void push(_In_ size_t idx, _Inout_ std::wstring &&dir)
+        {
+            queue &q = m_queues[idx];
+            AcquireSRWLockExclusive(&q.lock);
+            try {
+                q.dirs.push_back(std::move(dir));
+            } catch (...) {
+                ReleaseSRWLockExclusive(&q.lock);
+                throw;
+            }
+            m_pending.fetch_add(1);
+            m_queued.fetch_add(1);
+            ReleaseSRWLockExclusive(&q.lock);
+            if (m_sleepers.load()) {
+                // Pass the lock to make sure the sleeper either sees the new directory or is already waiting.
+                AcquireSRWLockExclusive(&m_idle_lock);
+                ReleaseSRWLockExclusive(&m_idle_lock);
+                WakeConditionVariable(&m_idle);
+            }
+        }
+
+        bool pop(_In_ size_t idx, _Out_ std::wstring &dir) noexcept
+        {
+            // Own queue is LIFO: depth-first keeps the queue short.
+            queue &q = m_queues[idx];
+            AcquireSRWLockExclusive(&q.lock);
+            const bool found = !q.dirs.empty();
+            if (found) {
+                dir = std::move(q.dirs.back());
+                q.dirs.pop_back();
+                m_queued.fetch_sub(1);
+            }
+            ReleaseSRWLockExclusive(&q.lock);
+            return found;
+        }
+
+        bool steal(_In_ size_t idx, _Out_ std::wstring &dir) noexcept
+        {
+            // Steal FIFO: directories near the root carry the most work.
+            for (size_t i = 1; i < m_queues.size(); ++i) {
+                queue &q = m_queues[(idx + i) % m_queues.size()];
+                AcquireSRWLockExclusive(&q.lock);
+                const bool found = !q.dirs.empty();
+                if (found) {
+                    dir = std::move(q.dirs.front());
+                    q.dirs.pop_front();
+                    m_queued.fetch_sub(1);
+                }
+                ReleaseSRWLockExclusive(&q.lock);
+                if (found)
+                    return true;
+            }
+            return false;
+        }
+
+        bool wait() noexcept
+        {
+            AcquireSRWLockExclusive(&m_idle_lock);
+            m_sleepers.fetch_add(1);
+            while (!m_queued.load() && m_pending.load() && !m_abort.load(std::memory_order_relaxed))
+                SleepConditionVariableSRW(&m_idle, &m_idle_lock, INFINITE, 0);
+            m_sleepers.fetch_sub(1);
+            const bool more = m_pending.load() && !m_abort.load(std::memory_order_relaxed);
+            ReleaseSRWLockExclusive(&m_idle_lock);
+            return more;
+        }
+
+        void done() noexcept
+        {
+            if (m_pending.fetch_sub(1) == 1) {
+                AcquireSRWLockExclusive(&m_idle_lock);
+                ReleaseSRWLockExclusive(&m_idle_lock);
+                WakeAllConditionVariable(&m_idle);
+            }
+        }
+
+    protected:
+        _Fn &m_fn;
+        size_t m_batch_bytes;
+        std::vector<queue> m_queues;
+        std::atomic<size_t> m_next_worker;
+        std::atomic<size_t> m_pending;      // Directories queued or being enumerated
+        std::atomic<size_t> m_queued;       // Directories queued
+        std::atomic<size_t> m_sleepers;
+        std::atomic<bool> m_abort;
+        SRWLOCK m_idle_lock;
+        CONDITION_VARIABLE m_idle;
+        std::exception_ptr m_exception;
+        std::atomic<uint64_t> m_directories;
+        std::atomic<uint64_t> m_entries;
+        std::atomic<uint64_t> m_batches;
+        std::atomic<uint64_t> m_steals;
+        std::atomic<uint64_t> m_errors;
+    };
+    /// \endcond
+
+    ///
+    /// Walks a directory tree in parallel
+    ///
+    /// Directories are enumerated using directory_range by thread pool workers. Each worker queues subdirectories to its
+    /// own queue and processes them depth-first. Idle workers steal directories from the other queues, oldest first.
+    /// Each worker keeps at most one directory handle open, so no more than `threads` handles are open at a time.
+    /// Reparse points are never descended into.
+    ///
+    /// \param[in] pszRoot      Root directory path
+    /// \param[in] fn           Callback `bool fn(const std::wstring &dir, const winstd::directory_entry &entry)` called for each entry
+    ///                         in parallel. Return true to descend into a directory entry.
+    /// \param[in] threads      Maximum number of workers; 0 for the number of processors
+    /// \param[in] batch_bytes  Size of the batch buffer of each worker in bytes
+    ///
+    /// \returns Walk counters
+    ///
+    /// \note The first exception thrown by `fn` stops the walk and is rethrown to the caller.
+    ///
+    template <class _Fn>
+    directory_walk_stats walk_directory_tree(_In_z_ LPCWSTR pszRoot, _In_ _Fn &&fn, _In_ size_t threads = 0, _In_ size_t batch_bytes = directory_range::default_batch_bytes)
+    {
+        if (!threads) {
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            threads = si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+        }
+        directory_walker<std::remove_reference_t<_Fn>> walker(fn, threads, batch_bytes);
+        return walker.run(pszRoot);
+    }
+
+#endif
+
+    ///
+    /// Traits of heap
+    ///
+    struct heap_traits : basic_handle_traits<HANDLE, NULL>
+    {
+        ///
+        /// Enumerates allocated heap blocks using `OutputDebugString()`
+        ///
+        /// \param[in] h  Heap handle
+        ///
+        /// \returns
+        /// - `true` if any blocks found;
+        /// - `false` otherwise.
+        ///
+        static bool enumerate(_In_ HANDLE h) noexcept
+        {
+            bool found = false;
+
+            // Lock the heap for exclusive access.
+            HeapLock(h);
+
+            PROCESS_HEAP_ENTRY e;
+            e.lpData = NULL;
+            while (HeapWalk(h, &e) != FALSE) {
+                if ((e.wFlags & PROCESS_HEAP_ENTRY_BUSY) != 0) {
+                    OutputDebugStr(
+                        _T("Allocated block%s%s\n")
+                        _T("  Data portion begins at: %#p\n  Size: %d bytes\n")
+                        _T("  Overhead: %d bytes\n  Region index: %d\n"),
+                            (e.wFlags & PROCESS_HEAP_ENTRY_MOVEABLE) != 0 ? tstring_printf(_T(", movable with HANDLE %#p"), e.Block.hMem).c_str() : _T(""),
+                            (e.wFlags & PROCESS_HEAP_ENTRY_DDESHARE) != 0 ? _T(", DDESHARE") : _T(""),
+                             e.lpData,
+                             e.cbData,
+                             e.cbOverhead,
+                             e.iRegionIndex);
+
+                    found = true;
+                }
+            }
+
+            const DWORD dwResult = GetLastError();
+            if (dwResult != ERROR_NO_MORE_ITEMS)
+                OutputDebugStr(_T("HeapWalk failed (error %u).\n"), dwResult);
+
+            // Unlock the heap.
+            HeapUnlock(h);
+
+            return found;
+        }
+
+        ///
+        /// Destroys the heap.
+        ///
+        /// \sa [HeapDestroy function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366700.aspx)
+        ///
+        static void close(_In_ HANDLE h) noexcept
+        {
+#ifdef WINSTD_HEAP_ENUMERATE_ON_DESTROY
+            enumerate(h);
+#endif
+            HeapDestroy(h);
+        }
+    };
+
+    ///
+    /// Heap statistics
+    ///
+    /// \sa heap::stats
+    ///
+    struct heap_stats
+    {
+        static constexpr size_t histogram_bins = 24; ///< Number of block size histogram bins
+
+        size_t blocks;              ///< Number of allocated blocks
+        size_t allocated;           ///< Allocated bytes
+        size_t overhead;            ///< Bytes used by the heap to maintain the blocks
+        size_t free_blocks;         ///< Number of free committed blocks
+        size_t free;                ///< Free committed bytes
+        size_t largest_free;        ///< Size of the largest free committed block
+        size_t committed;           ///< Committed bytes
+        size_t uncommitted;         ///< Reserved, but uncommitted bytes
+        size_t histogram[histogram_bins];   ///< Number of allocated blocks by size: bin `i` counts blocks of [2^i, 2^(i+1)) bytes. Bin 0 includes empty blocks, the last bin includes all larger blocks.
+        bool truncated;             ///< `true` if the walk stopped at the entry limit before reaching the end of the heap
+
+        ///
+        /// Returns fragmentation of free committed memory
+        ///
+        /// \returns 0.0 when all free memory is in a single block, approaching 1.0 as it scatters into small blocks
+        ///
+        double fragmentation() const noexcept
+        {
+            return free ? 1.0 - static_cast<double>(largest_free) / free : 0.0;
+        }
+    };
 
     ///
-    /// Find-file handle wrapper
-    ///
-    /// \sa [FindFirstFile function](https://docs.microsoft.com/en-us/windows/desktop/api/fileapi/nf-fileapi-findfirstfilew)
+    /// Heap handle wrapper
+    ///
+    /// Allocated blocks are not reported when the heap is destroyed. Define `WINSTD_HEAP_ENUMERATE_ON_DESTROY`
+    /// before including WinStd to list them using `OutputDebugString()` as enumerate() does.
+    ///
+    /// \sa [HeapCreate function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366599.aspx)
     ///
-    class find_file : public handle<HANDLE, INVALID_HANDLE_VALUE>
+    class heap : public basic_handle<heap_traits>
     {
-        WINSTD_HANDLE_IMPL(find_file, HANDLE, INVALID_HANDLE_VALUE)
+        WINSTD_BASIC_HANDLE_IMPL(heap, heap_traits)
 
     public:
         ///
-        /// Closes a file search handle.
+        /// Collects heap statistics
         ///
-        /// \sa [FindClose function](https://docs.microsoft.com/en-us/windows/desktop/api/fileapi/nf-fileapi-findclose)
+        /// The heap is walked under `HeapLock()` without formatting any output. To keep the heap locked for a bounded time
+        /// on large heaps, limit the number of entries walked. This is a prefix walk, not a sample: block counts, sizes,
+        /// the histogram and fragmentation then describe only the first entries in walk order, which are typically the
+        /// oldest blocks of the first heap segment. Committed and uncommitted sizes still cover the whole heap where the
+        /// system can report them.
+        ///
+        /// \param[out] result       Heap statistics
+        /// \param[in]  max_entries  Maximum number of heap entries to walk
+        ///
+        /// \returns
+        /// - `true` on success;
+        /// - `false` otherwise. Use `GetLastError()` for failure reason.
+        ///
+        /// \sa [HeapWalk function](https://learn.microsoft.com/en-us/windows/win32/api/heapapi/nf-heapapi-heapwalk)
         ///
-        virtual ~find_file()
+        bool stats(_Out_ heap_stats &result, _In_ size_t max_entries = SIZE_MAX) const noexcept
         {
-            if (m_h != invalid)
-                free_internal();
+            assert(m_h != invalid);
+            memset(&result, 0, sizeof(result));
+            size_t region_committed = 0, region_uncommitted = 0, ranges_uncommitted = 0;
+            bool regions = false;
+
+            if (!HeapLock(m_h))
+                return false;
+            PROCESS_HEAP_ENTRY e;
+            e.lpData = NULL;
+            DWORD dwResult = ERROR_NO_MORE_ITEMS;
+            for (size_t n = 0;; ++n) {
+                if (!HeapWalk(m_h, &e)) {
+                    dwResult = GetLastError();
+                    break;
+                }
+                if (n >= max_entries) {
+                    // There is at least one more entry.
+                    result.truncated = true;
+                    break;
+                }
+                if (e.wFlags & PROCESS_HEAP_ENTRY_BUSY) {
+                    result.blocks++;
+                    result.allocated += e.cbData;
+                    result.overhead += e.cbOverhead;
+                    size_t bin = 0;
+                    for (size_t size = e.cbData >> 1; size && bin < heap_stats::histogram_bins - 1; size >>= 1)
+                        bin++;
+                    result.histogram[bin]++;
+                } else if (e.wFlags & PROCESS_HEAP_REGION) {
+                    regions = true;
+                    region_committed += e.Region.dwCommittedSize;
+                    region_uncommitted += e.Region.dwUnCommittedSize;
+                } else if (e.wFlags & PROCESS_HEAP_UNCOMMITTED_RANGE)
+                    ranges_uncommitted += e.cbData;
+                else {
+                    result.free_blocks++;
+                    result.free += e.cbData;
+                    result.overhead += e.cbOverhead;
+                    if (result.largest_free < e.cbData)
+                        result.largest_free = e.cbData;
+                }
+            }
+            HeapUnlock(m_h);
+            if (!result.truncated && dwResult != ERROR_NO_MORE_ITEMS) {
+                SetLastError(dwResult);
+                return false;
+            }
+
+            if (regions) {
+                result.committed = region_committed;
+                result.uncommitted = region_uncommitted;
+            } else {
+                result.committed = result.allocated + result.free + result.overhead;
+                result.uncommitted = ranges_uncommitted;
+            }
+#if _WIN32_WINNT >= _WIN32_WINNT_WIN7
+            if (result.truncated) {
+                // The walk did not reach all regions. Take totals from the heap summary instead.
+                HEAP_SUMMARY summary = { sizeof(summary) };
+                if (HeapSummary(m_h, 0, &summary)) {
+                    result.committed = summary.cbCommitted;
+                    result.uncommitted = summary.cbReserved > summary.cbCommitted ? summary.cbReserved - summary.cbCommitted : 0;
+                }
+            }
+#endif
+            return true;
         }
 
-    protected:
         ///
-        /// Closes a file search handle.
+        /// Enumerates allocated heap blocks using `OutputDebugString()`
         ///
-        /// \sa [FindClose function](https://docs.microsoft.com/en-us/windows/desktop/api/fileapi/nf-fileapi-findclose)
+        /// \returns
+        /// - `true` if any blocks found;
+        /// - `false` otherwise.
         ///
-        void free_internal() noexcept override
+        bool enumerate() noexcept
         {
-            FindClose(m_h);
+            assert(m_h != invalid);
+            return heap_traits::enumerate(m_h);
         }
     };
 
     ///
-    /// Heap handle wrapper
+    /// HeapAlloc allocator
     ///
-    /// \sa [HeapCreate function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366599.aspx)
+    template <class _Ty>
+    class heap_allocator
+    {
+    public:
+        typedef typename _Ty value_type;    ///< A type that is managed by the allocator
+
+        typedef _Ty *pointer;               ///< A type that provides a pointer to the type of object managed by the allocator
+        typedef _Ty& reference;             ///< A type that provides a reference to the type of object managed by the allocator
+        typedef const _Ty *const_pointer;   ///< A type that provides a constant pointer to the type of object managed by the allocator
+        typedef const _Ty& const_reference; ///< A type that provides a constant reference to type of object managed by the allocator
+
+        typedef SIZE_T size_type;           ///< An unsigned integral type that can represent the length of any sequence that an object of template class `heap_allocator` can allocate
+        typedef ptrdiff_t difference_type;  ///< A signed integral type that can represent the difference between values of pointers to the type of object managed by the allocator
+
+        ///
+        /// A structure that enables an allocator for objects of one type to allocate storage for objects of another type.
+        ///
+        template <class _Other>
+        struct rebind
+        {
+            typedef heap_allocator<_Other> other;   ///< Other allocator type
+        };
+
+    public:
+        ///
+        /// Constructs allocator
+        ///
+        /// \param[in] heap  Handle to existing heap
+        ///
+        heap_allocator(_In_ HANDLE heap) : m_heap(heap)
+        {}
+
+        ///
+        /// Constructs allocator from another type
+        ///
+        /// \param[in] other  Another allocator of the heap_allocator kind
+        ///
+        template <class _Other>
+        heap_allocator(_In_ const heap_allocator<_Other> &other) : m_heap(other.m_heap)
+        {}
+
+        ///
+        /// Allocates a new memory block
+        ///
+        /// \param[in] count  Number of elements
+        ///
+        /// \returns Pointer to new memory block
+        ///
+        pointer allocate(_In_ size_type count)
+        {
+            assert(m_heap);
+            return (pointer)HeapAlloc(m_heap, 0, count * sizeof(_Ty));
+        }
+
+        ///
+        /// Frees memory block
+        ///
+        /// \param[in] ptr   Pointer to memory block
+        /// \param[in] size  Size of memory block (in bytes)
+        ///
+        void deallocate(_In_ pointer ptr, _In_ size_type size)
+        {
+            UNREFERENCED_PARAMETER(size);
+            assert(m_heap);
+            HeapFree(m_heap, 0, ptr);
+        }
+
+        ///
+        /// Calls copying constructor for the element
+        ///
+        /// \param[in] ptr  Pointer to memory block
+        /// \param[in] val  Source element
+        ///
+        void construct(_Inout_ pointer ptr, _In_ const _Ty& val)
+        {
+            ::new ((void*)ptr) _Ty(val);
+        }
+
+        ///
+        /// Calls moving constructor for the element
+        ///
+        /// \param[in] ptr  Pointer to memory block
+        /// \param[in] val  Source element
+        ///
+        void construct(_Inout_ pointer ptr, _Inout_ _Ty&& val)
+        {
+            ::new ((void*)ptr) _Ty(std::forward<_Ty>(val));
+        }
+
+        ///
+        /// Calls destructor for the element
+        ///
+        /// \param[in] ptr  Pointer to memory block
+        ///
+        void destroy(_Inout_ pointer ptr)
+        {
+            ptr->_Ty::~_Ty();
+        }
+
+        ///
+        /// Returns maximum memory block size
+        ///
+        size_type max_size() const
+        {
+            return (SIZE_T)-1;
+        }
+
+        ///
+        /// Returns true if both allocators use the same heap
+        ///
+        template <class _Other>
+        bool operator==(_In_ const heap_allocator<_Other> &other) const noexcept
+        {
+            return m_heap == other.m_heap;
+        }
+
+        ///
+        /// Returns true if allocators use different heaps
+        ///
+        template <class _Other>
+        bool operator!=(_In_ const heap_allocator<_Other> &other) const noexcept
+        {
+            return m_heap != other.m_heap;
+        }
+
+    public:
+        HANDLE m_heap;  ///< Heap handle
+    };
+
+    ///
+    /// Small-object pool allocating from a heap
+    ///
+    /// Blocks up to `max_small_bytes` are served from size classes in `granularity` steps. Each thread keeps a magazine
+    /// (free list) per size class and exchanges whole batches of blocks with the shared depot, so the depot lock is taken
+    /// once per batch instead of once per block. The depot is refilled by carving slabs allocated from the heap. Larger
+    /// blocks are passed to `HeapAlloc()` and `HeapFree()` directly.
+    ///
+    /// A block freed on another thread is cached by the freeing thread. Blocks cached by a thread are returned to the
+    /// depot when the thread exits. Slabs are released to the heap when the pool is destroyed.
+    ///
+    /// All pools share one FLS index, holding a list of the thread's caches, so the number of pools is not limited by
+    /// FLS indexes. When a thread has no cache, because the FLS index or memory for the cache could not be allocated,
+    /// its blocks are taken from and returned to the depot one by one. Such allocations are counted by uncached().
+    /// Caches of a destroyed pool are released when their thread exits or creates a cache for another pool.
+    ///
+    /// \note The pool must outlive all allocators and containers using it.
+    ///
+    /// \sa pool_allocator
     ///
-    class heap : public handle<HANDLE, NULL>
+    class heap_pool
     {
-        WINSTD_HANDLE_IMPL(heap, HANDLE, NULL)
+        WINSTD_NONCOPYABLE(heap_pool)
+        WINSTD_NONMOVABLE(heap_pool)
 
     public:
+        static constexpr size_t granularity = 16;                           ///< Size class step in bytes
+        static constexpr size_t max_small_bytes = 256;                      ///< Largest block served from size classes
+        static constexpr size_t class_count = max_small_bytes / granularity; ///< Number of size classes
+
         ///
-        /// Destroys the heap.
+        /// Constructs a pool
         ///
-        /// \sa [HeapDestroy function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366700.aspx)
+        /// \param[in] heap  Heap to allocate slabs and large blocks from
         ///
-        virtual ~heap()
+        heap_pool(_In_ HANDLE heap = GetProcessHeap()) noexcept :
+            m_heap(heap),
+            m_caches(NULL),
+            m_uncached(0),
+            m_slabs(NULL)
         {
-            if (m_h != invalid)
-                free_internal();
+            InitializeSRWLock(&m_slab_lock);
+            for (size_t i = 0; i < class_count; ++i) {
+                InitializeSRWLock(&m_depot[i].lock);
+                m_depot[i].batches = NULL;
+            }
         }
 
         ///
-        /// Enumerates allocated heap blocks using `OutputDebugString()`
+        /// Detaches thread caches and releases slabs
         ///
-        /// \returns
-        /// - `true` if any blocks found;
-        /// - `false` otherwise.
+        ~heap_pool()
+        {
+            // The caches are released by their threads. Blocks they hold belong to the slabs and are discarded with them.
+            AcquireSRWLockExclusive(&registry_lock());
+            for (thread_cache *c = m_caches; c; c = c->pool_next)
+                c->pool.store(NULL, std::memory_order_relaxed);
+            ReleaseSRWLockExclusive(&registry_lock());
+            for (slab *s = m_slabs; s;) {
+                slab *next = s->next;
+                HeapFree(m_heap, 0, s);
+                s = next;
+            }
+        }
+
         ///
-        bool enumerate() noexcept
+        /// Allocates a memory block
+        ///
+        /// \param[in] size  Size of the block in bytes
+        ///
+        /// \returns Pointer to the block; `NULL` if out of memory
+        ///
+        _Ret_maybenull_ void* allocate(_In_ size_t size) noexcept
         {
-            assert(m_h != invalid);
+            if (size > max_small_bytes)
+                return HeapAlloc(m_heap, 0, size);
+            const size_t idx = size_class(size);
+            thread_cache *c = cache();
+            if (!c) {
+                // No cache for this thread. Take one block from the depot and return the rest of the batch.
+                m_uncached.fetch_add(1, std::memory_order_relaxed);
+                magazine m;
+                if (!refill(idx, m))
+                    return NULL;
+                block *b = m.head;
+                if (b->next)
+                    push_batch(idx, b->next);
+                return b;
+            }
+            magazine &m = c->magazines[idx];
+            if (!m.head && !refill(idx, m))
+                return NULL;
+            block *b = m.head;
+            m.head = b->next;
+            m.count--;
+            return b;
+        }
 
-            bool found = false;
+        ///
+        /// Frees a memory block
+        ///
+        /// \param[in] ptr   Pointer to the block as returned by allocate()
+        /// \param[in] size  Size of the block in bytes as passed to allocate()
+        ///
+        void deallocate(_In_opt_ void *ptr, _In_ size_t size) noexcept
+        {
+            if (!ptr)
+                return;
+            if (size > max_small_bytes) {
+                HeapFree(m_heap, 0, ptr);
+                return;
+            }
+            const size_t idx = size_class(size);
+            block *b = static_cast<block*>(ptr);
+            thread_cache *c = cache();
+            if (!c) {
+                // No cache for this thread. Return the block to the depot as a batch of one.
+                b->next = NULL;
+                push_batch(idx, b);
+                return;
+            }
+            magazine &m = c->magazines[idx];
+            b->next = m.head;
+            m.head = b;
+            if (++m.count >= 2 * batch_count(idx))
+                release(idx, m);
+        }
 
-            // Lock the heap for exclusive access.
-            HeapLock(m_h);
+        ///
+        /// Returns number of small block allocations served from the depot directly, as the thread had no cache
+        ///
+        uint64_t uncached() const noexcept
+        {
+            return m_uncached.load(std::memory_order_relaxed);
+        }
 
-            PROCESS_HEAP_ENTRY e;
-            e.lpData = NULL;
-            while (HeapWalk(m_h, &e) != FALSE) {
-                if ((e.wFlags & PROCESS_HEAP_ENTRY_BUSY) != 0) {
-                    OutputDebugStr(
-                        _T("Allocated block%s%s\n")
-                        _T("  Data portion begins at: %#p\n  Size: %d bytes\n")
-                        _T("  Overhead: %d bytes\n  Region index: %d\n"),
-                            (e.wFlags & PROCESS_HEAP_ENTRY_MOVEABLE) != 0 ? tstring_printf(_T(", movable with HANDLE %#p"), e.Block.hMem).c_str() : _T(""),
-                            (e.wFlags & PROCESS_HEAP_ENTRY_DDESHARE) != 0 ? _T(", DDESHARE") : _T(""),
-                             e.lpData,
-                             e.cbData,
-                             e.cbOverhead,
-                             e.iRegionIndex);
+    protected:
+        /// \cond internal
+        struct block
+        {
+            block *next;        // Next block in the batch
+            block *next_batch;  // Next batch in the depot; valid for the first block of a batch
+        };
+        static_assert(sizeof(block) <= granularity, "size class too small to link free blocks");
+
+        struct magazine
+        {
+            block *head;
+            size_t count;
+        };
+
+        struct thread_cache
+        {
+            std::atomic<heap_pool*> pool;   // NULL once the pool is destroyed
+            thread_cache *thread_next;      // Next cache of the same thread
+            thread_cache *pool_prev;        // Previous cache of the same pool
+            thread_cache *pool_next;        // Next cache of the same pool
+            magazine magazines[class_count];
+        };
+
+        struct depot
+        {
+            SRWLOCK lock;
+            block *batches;
+        };
+
+        struct slab
+        {
+            slab *next;
+            void *reserved; // Keeps blocks aligned to MEMORY_ALLOCATION_ALIGNMENT
+        };
+
+        struct fls_slot
+        {
+            DWORD index;
+
+            fls_slot() noexcept : index(FlsAlloc(fls_callback)) {}
+
+            ~fls_slot()
+            {
+                // Freeing the FLS index calls fls_callback() for the caches of all threads.
+                if (index != FLS_OUT_OF_INDEXES) {
+                    const DWORD i = index;
+                    index = FLS_OUT_OF_INDEXES;
+                    FlsFree(i);
+                }
+            }
+        };
+
+        static constexpr size_t slab_batches = 4;
+
+        static size_t size_class(_In_ size_t size) noexcept
+        {
+            return size ? (size - 1) / granularity : 0;
+        }
+
+        static size_t batch_count(_In_ size_t idx) noexcept
+        {
+            // Aim for 4 KiB batches.
+            const size_t count = 0x1000 / ((idx + 1) * granularity);
+            return count < 8 ? 8 : count > 64 ? 64 : count;
+        }
 
-                    found = true;
+        static DWORD fls_index() noexcept
+        {
+            static fls_slot slot;
+            return slot.index;
+        }
+
+        // Guards the links between pools and thread caches.
+        static SRWLOCK& registry_lock() noexcept
+        {
+            static SRWLOCK lock = SRWLOCK_INIT;
+            return lock;
+        }
+
+        thread_cache* cache() noexcept
+        {
+            const DWORD fls = fls_index();
+            if (fls == FLS_OUT_OF_INDEXES)
+                return NULL;
+            thread_cache *head = static_cast<thread_cache*>(FlsGetValue(fls));
+            for (thread_cache *c = head; c; c = c->thread_next)
+                if (c->pool.load(std::memory_order_relaxed) == this)
+                    return c;
+
+            // Thread caches may outlive the pool's heap. Allocate them from the process heap.
+            void *p = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(thread_cache));
+            if (!p)
+                return NULL;
+            thread_cache *c = new (p) thread_cache();
+            c->pool.store(this, std::memory_order_relaxed);
+            c->thread_next = head;
+            AcquireSRWLockExclusive(&registry_lock());
+            if (!FlsSetValue(fls, c)) {
+                ReleaseSRWLockExclusive(&registry_lock());
+                HeapFree(GetProcessHeap(), 0, c);
+                return NULL;
+            }
+            c->pool_next = m_caches;
+            if (m_caches)
+                m_caches->pool_prev = c;
+            m_caches = c;
+
+            // Release caches of destroyed pools.
+            for (thread_cache **link = &c->thread_next; *link;) {
+                thread_cache *dead = *link;
+                if (dead->pool.load(std::memory_order_relaxed)) {
+                    link = &dead->thread_next;
+                    continue;
                 }
+                *link = dead->thread_next;
+                HeapFree(GetProcessHeap(), 0, dead);
             }
+            ReleaseSRWLockExclusive(&registry_lock());
+            return c;
+        }
 
-            const DWORD dwResult = GetLastError();
-            if (dwResult != ERROR_NO_MORE_ITEMS)
-                OutputDebugStr(_T("HeapWalk failed (error %u).\n"), dwResult);
+        static void NTAPI fls_callback(_In_ PVOID lpFlsData) noexcept
+        {
+            AcquireSRWLockExclusive(&registry_lock());
+            for (thread_cache *c = static_cast<thread_cache*>(lpFlsData); c;) {
+                thread_cache *next = c->thread_next;
+                heap_pool *pool = c->pool.load(std::memory_order_relaxed);
+                if (pool) {
+                    for (size_t i = 0; i < class_count; ++i) {
+                        if (c->magazines[i].head)
+                            pool->push_batch(i, c->magazines[i].head);
+                    }
+                    if (c->pool_prev)
+                        c->pool_prev->pool_next = c->pool_next;
+                    else
+                        pool->m_caches = c->pool_next;
+                    if (c->pool_next)
+                        c->pool_next->pool_prev = c->pool_prev;
+                }
+                HeapFree(GetProcessHeap(), 0, c);
+                c = next;
+            }
+            ReleaseSRWLockExclusive(&registry_lock());
+        }
 
-            // Unlock the heap.
-            HeapUnlock(m_h);
+        void push_batch(_In_ size_t idx, _In_ block *b) noexcept
+        {
+            depot &d = m_depot[idx];
+            AcquireSRWLockExclusive(&d.lock);
+            b->next_batch = d.batches;
+            d.batches = b;
+            ReleaseSRWLockExclusive(&d.lock);
+        }
 
-            return found;
+        bool refill(_In_ size_t idx, _Inout_ magazine &m) noexcept
+        {
+            depot &d = m_depot[idx];
+            AcquireSRWLockExclusive(&d.lock);
+            block *b = d.batches;
+            if (b)
+                d.batches = b->next_batch;
+            ReleaseSRWLockExclusive(&d.lock);
+            if (!b && (b = carve(idx)) == NULL)
+                return false;
+            size_t count = 0;
+            for (block *i = b; i; i = i->next)
+                count++;
+            m.head = b;
+            m.count = count;
+            return true;
         }
 
-    protected:
-        ///
-        /// Destroys the heap.
-        ///
-        /// \sa [HeapDestroy function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa366700.aspx)
-        ///
-        void free_internal() noexcept override
+        void release(_In_ size_t idx, _Inout_ magazine &m) noexcept
         {
-            enumerate();
-            HeapDestroy(m_h);
+            // Keep the most recently freed blocks. Return the rest as one batch.
+            const size_t keep = batch_count(idx);
+            block *last = m.head;
+            for (size_t i = 1; i < keep; ++i)
+                last = last->next;
+            push_batch(idx, last->next);
+            last->next = NULL;
+            m.count = keep;
         }
+
+        block* carve(_In_ size_t idx) noexcept
+        {
+            const size_t size = (idx + 1) * granularity, count = batch_count(idx);
+            slab *s = static_cast<slab*>(HeapAlloc(m_heap, 0, sizeof(slab) + slab_batches * count * size));
+            if (!s)
+                return NULL;
+            AcquireSRWLockExclusive(&m_slab_lock);
+            s->next = m_slabs;
+            m_slabs = s;
+            ReleaseSRWLockExclusive(&m_slab_lock);
+
+            // Link blocks into batches. Keep the first batch and pass the rest to the depot.
+            BYTE *data = reinterpret_cast<BYTE*>(s + 1);
+            block *first = NULL, *rest = NULL;
+            for (size_t i = slab_batches; i--;) {
+                BYTE *batch = data + i * count * size;
+                for (size_t j = 0; j < count; ++j)
+                    reinterpret_cast<block*>(batch + j * size)->next = j + 1 < count ? reinterpret_cast<block*>(batch + (j + 1) * size) : NULL;
+                if (i) {
+                    reinterpret_cast<block*>(batch)->next_batch = rest;
+                    rest = reinterpret_cast<block*>(batch);
+                } else
+                    first = reinterpret_cast<block*>(batch);
+            }
+            if (rest) {
+                block *tail = rest;
+                while (tail->next_batch)
+                    tail = tail->next_batch;
+                depot &d = m_depot[idx];
+                AcquireSRWLockExclusive(&d.lock);
+                tail->next_batch = d.batches;
+                d.batches = rest;
+                ReleaseSRWLockExclusive(&d.lock);
+            }
+            return first;
+        }
+        /// \endcond
+
+    protected:
+        HANDLE m_heap;                  ///< Heap handle
+        thread_cache *m_caches;         ///< Caches of all threads; guarded by registry_lock()
+        std::atomic<uint64_t> m_uncached; ///< Number of small block allocations without a thread cache
+        depot m_depot[class_count];     ///< Shared batches of free blocks per size class
+        SRWLOCK m_slab_lock;            ///< Lock of the slab list
+        slab *m_slabs;                  ///< Slabs allocated from the heap
     };
 
     ///
-    /// HeapAlloc allocator
+    /// Allocator serving blocks from a heap_pool
+    ///
+    /// Allocators compare equal when they share the pool. The allocator propagates on container copy, move and swap.
+    ///
+    /// \sa heap_pool
     ///
     template <class _Ty>
-    class heap_allocator
+    class pool_allocator
     {
-    public:
-        typedef typename _Ty value_type;    ///< A type that is managed by the allocator
-
-        typedef _Ty *pointer;               ///< A type that provides a pointer to the type of object managed by the allocator
-        typedef _Ty& reference;             ///< A type that provides a reference to the type of object managed by the allocator
-        typedef const _Ty *const_pointer;   ///< A type that provides a constant pointer to the type of object managed by the allocator
-        typedef const _Ty& const_reference; ///< A type that provides a constant reference to type of object managed by the allocator
+        static_assert(alignof(_Ty) <= MEMORY_ALLOCATION_ALIGNMENT, "over-aligned types are not supported");
 
-        typedef SIZE_T size_type;           ///< An unsigned integral type that can represent the length of any sequence that an object of template class `heap_allocator` can allocate
-        typedef ptrdiff_t difference_type;  ///< A signed integral type that can represent the difference between values of pointers to the type of object managed by the allocator
+    public:
+        typedef _Ty value_type;                                     ///< A type that is managed by the allocator
+        typedef size_t size_type;                                   ///< An unsigned integral type that can represent the length of any sequence the allocator can allocate
+        typedef ptrdiff_t difference_type;                          ///< A signed integral type that can represent the difference between values of pointers to the type of object managed by the allocator
+        typedef std::true_type propagate_on_container_copy_assignment;  ///< Containers copy the allocator on copy assignment
+        typedef std::true_type propagate_on_container_move_assignment;  ///< Containers move the allocator on move assignment
+        typedef std::true_type propagate_on_container_swap;             ///< Containers swap allocators on swap
+        typedef std::false_type is_always_equal;                        ///< Allocators of different pools are not interchangeable
 
         ///
         /// A structure that enables an allocator for objects of one type to allocate storage for objects of another type.
@@ -1357,25 +3074,25 @@ namespace winstd
         template <class _Other>
         struct rebind
         {
-            typedef heap_allocator<_Other> other;   ///< Other allocator type
+            typedef pool_allocator<_Other> other;   ///< Other allocator type
         };
 
     public:
         ///
         /// Constructs allocator
         ///
-        /// \param[in] heap  Handle to existing heap
+        /// \param[in] pool  Pool to allocate from
         ///
-        heap_allocator(_In_ HANDLE heap) : m_heap(heap)
+        pool_allocator(_In_ heap_pool &pool) noexcept : m_pool(&pool)
         {}
 
         ///
         /// Constructs allocator from another type
         ///
-        /// \param[in] other  Another allocator of the heap_allocator kind
+        /// \param[in] other  Another allocator of the pool_allocator kind
         ///
         template <class _Other>
-        heap_allocator(_In_ const heap_allocator<_Other> &other) : m_heap(other.m_heap)
+        pool_allocator(_In_ const pool_allocator<_Other> &other) noexcept : m_pool(other.m_pool)
         {}
 
         ///
@@ -1385,68 +3102,104 @@ namespace winstd
         ///
         /// \returns Pointer to new memory block
         ///
-        pointer allocate(_In_ size_type count)
+        _Ty* allocate(_In_ size_type count)
         {
-            assert(m_heap);
-            return (pointer)HeapAlloc(m_heap, 0, count * sizeof(_Ty));
+            if (count > SIZE_MAX / sizeof(_Ty))
+                throw std::bad_array_new_length();
+            void *ptr = m_pool->allocate(count * sizeof(_Ty));
+            if (!ptr)
+                throw std::bad_alloc();
+            return static_cast<_Ty*>(ptr);
         }
 
         ///
         /// Frees memory block
         ///
-        /// \param[in] ptr   Pointer to memory block
-        /// \param[in] size  Size of memory block (in bytes)
+        /// \param[in] ptr    Pointer to memory block
+        /// \param[in] count  Number of elements
         ///
-        void deallocate(_In_ pointer ptr, _In_ size_type size)
+        void deallocate(_In_ _Ty *ptr, _In_ size_type count) noexcept
         {
-            UNREFERENCED_PARAMETER(size);
-            assert(m_heap);
-            HeapFree(m_heap, 0, ptr);
+            m_pool->deallocate(ptr, count * sizeof(_Ty));
         }
 
         ///
-        /// Calls copying constructor for the element
-        ///
-        /// \param[in] ptr  Pointer to memory block
-        /// \param[in] val  Source element
+        /// Returns true if both allocators use the same pool
         ///
-        void construct(_Inout_ pointer ptr, _In_ const _Ty& val)
+        template <class _Other>
+        bool operator==(_In_ const pool_allocator<_Other> &other) const noexcept
         {
-            ::new ((void*)ptr) _Ty(val);
+            return m_pool == other.m_pool;
         }
 
         ///
-        /// Calls moving constructor for the element
-        ///
-        /// \param[in] ptr  Pointer to memory block
-        /// \param[in] val  Source element
+        /// Returns true if allocators use different pools
         ///
-        void construct(_Inout_ pointer ptr, _Inout_ _Ty&& val)
+        template <class _Other>
+        bool operator!=(_In_ const pool_allocator<_Other> &other) const noexcept
         {
-            ::new ((void*)ptr) _Ty(std::forward<_Ty>(val));
+            return m_pool != other.m_pool;
         }
 
+    public:
+        heap_pool *m_pool;  ///< Pool
+    };
+
+#ifdef __cpp_lib_memory_resource
+    ///
+    /// Memory resource allocating from a heap
+    ///
+    /// Blocks aligned beyond `MEMORY_ALLOCATION_ALIGNMENT` are over-allocated and aligned manually.
+    ///
+    class heap_memory_resource : public std::pmr::memory_resource
+    {
+    public:
         ///
-        /// Calls destructor for the element
+        /// Constructs resource
         ///
-        /// \param[in] ptr  Pointer to memory block
+        /// \param[in] heap  Heap to allocate from
         ///
-        void destroy(_Inout_ pointer ptr)
+        heap_memory_resource(_In_ HANDLE heap = GetProcessHeap()) noexcept : m_heap(heap)
+        {}
+
+    protected:
+        /// \cond internal
+        virtual void* do_allocate(_In_ size_t size, _In_ size_t align) override
         {
-            ptr->_Ty::~_Ty();
+            if (align <= MEMORY_ALLOCATION_ALIGNMENT) {
+                void *p = HeapAlloc(m_heap, 0, size);
+                if (!p)
+                    throw std::bad_alloc();
+                return p;
+            }
+            // Keep the pointer returned by HeapAlloc() just before the aligned block.
+            if (size > SIZE_MAX - align - sizeof(void*))
+                throw std::bad_alloc();
+            void *p = HeapAlloc(m_heap, 0, size + align + sizeof(void*));
+            if (!p)
+                throw std::bad_alloc();
+            void *aligned = reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(p) + sizeof(void*) + align - 1) & ~static_cast<uintptr_t>(align - 1));
+            reinterpret_cast<void**>(aligned)[-1] = p;
+            return aligned;
         }
 
-        ///
-        /// Returns maximum memory block size
-        ///
-        size_type max_size() const
+        virtual void do_deallocate(_In_ void *p, _In_ size_t size, _In_ size_t align) override
         {
-            return (SIZE_T)-1;
+            UNREFERENCED_PARAMETER(size);
+            HeapFree(m_heap, 0, align <= MEMORY_ALLOCATION_ALIGNMENT ? p : reinterpret_cast<void**>(p)[-1]);
         }
 
-    public:
+        virtual bool do_is_equal(_In_ const std::pmr::memory_resource &other) const noexcept override
+        {
+            const heap_memory_resource *o = dynamic_cast<const heap_memory_resource*>(&other);
+            return o && o->m_heap == m_heap;
+        }
+        /// \endcond
+
+    protected:
         HANDLE m_heap;  ///< Heap handle
     };
+#endif
 
     ///
     /// Activates given activation context in constructor and deactivates it in destructor
@@ -1775,28 +3528,153 @@ namespace winstd
         HANDLE m_proc;  ///< Handle of memory's process
     };
 
+#ifdef __cpp_lib_memory_resource
     ///
-    /// Registry key wrapper class
+    /// Monotonic memory resource carving blocks from a reserved virtual memory region
     ///
-    /// \sa [RegCreateKeyEx function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724844.aspx)
-    /// \sa [RegOpenKeyEx function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724897.aspx)
+    /// The region is reserved up front and pages are committed on demand as blocks are allocated. Deallocation does
+    /// nothing. release() decommits the whole region with a single `VirtualFree()` call, making all blocks invalid at
+    /// once. This suits per-request arenas of containers released together.
+    ///
+    /// The resource is not thread-safe.
     ///
-    class reg_key : public handle<HKEY, NULL>
+    class monotonic_vmemory_resource : public std::pmr::memory_resource
     {
-        WINSTD_HANDLE_IMPL(reg_key, HKEY, NULL)
+        WINSTD_NONCOPYABLE(monotonic_vmemory_resource)
+        WINSTD_NONMOVABLE(monotonic_vmemory_resource)
 
     public:
+        ///
+        /// Reserves a virtual memory region
+        ///
+        /// \param[in] reserve_bytes  Size of the region in bytes. Allocations exceeding the region throw `std::bad_alloc`.
+        ///                           When the region cannot be reserved, all allocations throw `std::bad_alloc`.
+        /// \param[in] commit_bytes   Minimum number of bytes to commit at once. Rounded up to page size.
+        ///
+        monotonic_vmemory_resource(_In_ size_t reserve_bytes = 0x10000000, _In_ size_t commit_bytes = 0x10000) noexcept :
+            m_commit_bytes(commit_bytes)
+        {
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            const size_t page = si.dwPageSize;
+            m_commit_bytes = (m_commit_bytes ? m_commit_bytes + page - 1 : page) & ~(page - 1);
+            m_region.alloc(GetCurrentProcess(), NULL, reserve_bytes, MEM_RESERVE, PAGE_NOACCESS);
+            m_next = m_committed = m_end = static_cast<unsigned char*>(static_cast<LPVOID>(m_region));
+            if (m_end)
+                m_end += (reserve_bytes + page - 1) & ~(page - 1);
+        }
+
+        ///
+        /// Returns true if the region was reserved
+        ///
+        explicit operator bool() const noexcept
+        {
+            return m_end != NULL;
+        }
+
+        ///
+        /// Returns number of bytes allocated since construction or the last release()
+        ///
+        size_t used() const noexcept
+        {
+            return static_cast<size_t>(m_next - static_cast<unsigned char*>(static_cast<LPVOID>(m_region)));
+        }
+
+        ///
+        /// Returns number of bytes committed
+        ///
+        size_t committed() const noexcept
+        {
+            return static_cast<size_t>(m_committed - static_cast<unsigned char*>(static_cast<LPVOID>(m_region)));
+        }
+
+        ///
+        /// Decommits all memory, keeping the region reserved
+        ///
+        /// All blocks allocated from the resource become invalid.
+        ///
+        void release() noexcept
+        {
+            unsigned char *base = static_cast<unsigned char*>(static_cast<LPVOID>(m_region));
+            if (m_committed != base)
+                VirtualFree(base, static_cast<SIZE_T>(m_committed - base), MEM_DECOMMIT);
+            m_next = m_committed = base;
+        }
+
+    protected:
+        /// \cond internal
+        virtual void* do_allocate(_In_ size_t size, _In_ size_t align) override
+        {
+            // Without a region there is no address to return, not even for a zero-byte block.
+            if (!m_end)
+                throw std::bad_alloc();
+            unsigned char *p = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(m_next) + align - 1) & ~static_cast<uintptr_t>(align - 1));
+            if (p < m_next || p > m_end || size > static_cast<size_t>(m_end - p))
+                throw std::bad_alloc();
+            unsigned char *next = p + size;
+            if (next > m_committed) {
+                // Commit at least commit_bytes at once to keep VirtualAlloc() off the hot path.
+                size_t commit = static_cast<size_t>(next - m_committed);
+                commit = commit < m_commit_bytes ? m_commit_bytes : (commit + m_commit_bytes - 1) / m_commit_bytes * m_commit_bytes;
+                if (commit > static_cast<size_t>(m_end - m_committed))
+                    commit = static_cast<size_t>(m_end - m_committed);
+                if (!VirtualAlloc(m_committed, commit, MEM_COMMIT, PAGE_READWRITE))
+                    throw std::bad_alloc();
+                m_committed += commit;
+            }
+            m_next = next;
+            return p;
+        }
+
+        virtual void do_deallocate(_In_ void *p, _In_ size_t size, _In_ size_t align) override
+        {
+            UNREFERENCED_PARAMETER(p);
+            UNREFERENCED_PARAMETER(size);
+            UNREFERENCED_PARAMETER(align);
+        }
+
+        virtual bool do_is_equal(_In_ const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+        /// \endcond
+
+    protected:
+        vmemory m_region;               ///< Reserved region
+        size_t m_commit_bytes;          ///< Minimum number of bytes to commit at once
+        unsigned char *m_next;          ///< Next free byte
+        unsigned char *m_committed;     ///< End of committed pages
+        unsigned char *m_end;           ///< End of the region
+    };
+#endif
+
+    ///
+    /// Traits of reg_key
+    ///
+    struct reg_key_traits : basic_handle_traits<HKEY, NULL>
+    {
         ///
         /// Closes a handle to the registry key.
         ///
         /// \sa [RegCloseKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724837.aspx)
         ///
-        virtual ~reg_key()
+        static void close(_In_ HKEY h) noexcept
         {
-            if (m_h != invalid)
-                free_internal();
+            RegCloseKey(h);
         }
+    };
+
+    ///
+    /// Registry key wrapper class
+    ///
+    /// \sa [RegCreateKeyEx function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724844.aspx)
+    /// \sa [RegOpenKeyEx function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724897.aspx)
+    ///
+    class reg_key : public basic_handle<reg_key_traits>
+    {
+        WINSTD_BASIC_HANDLE_IMPL(reg_key, reg_key_traits)
 
+    public:
         ///
         /// Deletes the specified registry subkey.
         ///
@@ -1847,50 +3725,29 @@ namespace winstd
                 return false;
             }
         }
-
-    protected:
-        ///
-        /// Closes a handle to the registry key.
-        ///
-        /// \sa [RegCloseKey function](https://msdn.microsoft.com/en-us/library/windows/desktop/ms724837.aspx)
-        ///
-        void free_internal() noexcept override
-        {
-            RegCloseKey(m_h);
-        }
     };
 
     ///
-    /// SID wrapper class
+    /// Traits of security_id
     ///
-    class security_id : public handle<PSID, NULL>
+    struct security_id_traits : basic_handle_traits<PSID, NULL>
     {
-        WINSTD_HANDLE_IMPL(security_id, PSID, NULL)
-
-    public:
-        ///
-        /// Closes a handle to the SID.
-        ///
-        /// \sa [FreeSid function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa446631.aspx)
-        ///
-        virtual ~security_id()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Closes a handle to the SID.
         ///
         /// \sa [FreeSid function](https://msdn.microsoft.com/en-us/library/windows/desktop/aa446631.aspx)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ PSID h) noexcept
         {
-            FreeSid(m_h);
+            FreeSid(h);
         }
     };
 
+    ///
+    /// SID wrapper class
+    ///
+    typedef basic_handle<security_id_traits> security_id;
+
     ///
     /// PROCESS_INFORMATION struct wrapper
     ///
@@ -1930,69 +3787,70 @@ namespace winstd
     };
 
     ///
-    /// Event log handle wrapper
-    ///
-    /// \sa [RegisterEventSource function](https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-registereventsourcew)
+    /// Traits of event_log
     ///
-    class event_log : public handle<HANDLE, NULL>
+    struct event_log_traits : basic_handle_traits<HANDLE, NULL>
     {
-        WINSTD_HANDLE_IMPL(event_log, HANDLE, NULL)
-
-    public:
-        ///
-        /// Closes an event log handle.
-        ///
-        /// \sa [DeregisterEventSource function](https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-deregistereventsource)
-        ///
-        virtual ~event_log()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
         ///
         /// Closes an event log handle.
         ///
         /// \sa [DeregisterEventSource function](https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-deregistereventsource)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ HANDLE h) noexcept
         {
-            DeregisterEventSource(m_h);
+            DeregisterEventSource(h);
         }
     };
 
     ///
-    /// SC_HANDLE wrapper class
+    /// Event log handle wrapper
     ///
-    class sc_handle : public handle<SC_HANDLE, NULL>
-    {
-        WINSTD_HANDLE_IMPL(sc_handle, SC_HANDLE, NULL)
-
-    public:
-        ///
-        /// Closes an open object handle.
-        ///
-        /// \sa [CloseServiceHandle function](https://docs.microsoft.com/en-us/windows/win32/api/winsvc/nf-winsvc-closeservicehandle)
-        ///
-        virtual ~sc_handle()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
+    /// \sa [RegisterEventSource function](https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-registereventsourcew)
+    ///
+    typedef basic_handle<event_log_traits> event_log;
 
-    protected:
+    ///
+    /// Traits of sc_handle
+    ///
+    struct sc_handle_traits : basic_handle_traits<SC_HANDLE, NULL>
+    {
         ///
         /// Closes an open object handle.
         ///
         /// \sa [CloseServiceHandle function](https://docs.microsoft.com/en-us/windows/win32/api/winsvc/nf-winsvc-closeservicehandle)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ SC_HANDLE h) noexcept
         {
-            CloseServiceHandle(m_h);
+            CloseServiceHandle(h);
         }
     };
 
+    ///
+    /// SC_HANDLE wrapper class
+    ///
+    typedef basic_handle<sc_handle_traits> sc_handle;
+
+    ///
+    /// Windows HANDLE wrapper class closing the handle on the close_queue
+    ///
+    template<HANDLE INVALID>
+    using deferred_win_handle = basic_handle<deferred_close_traits<win_handle_traits<INVALID>>>;
+
+    ///
+    /// Registry key wrapper class closing the key on the close_queue
+    ///
+    typedef basic_handle<deferred_close_traits<reg_key_traits>> deferred_reg_key;
+
+    ///
+    /// Event log handle wrapper closing the handle on the close_queue
+    ///
+    typedef basic_handle<deferred_close_traits<event_log_traits>> deferred_event_log;
+
+    ///
+    /// SC_HANDLE wrapper class closing the handle on the close_queue
+    ///
+    typedef basic_handle<deferred_close_traits<sc_handle_traits>> deferred_sc_handle;
+
     /// @}
 }
 
@@ -64,37 +64,32 @@ namespace winstd
     /// @{
 
     ///
-    /// HTTP handle wrapper class
-    ///
-    /// \sa [WinHttpOpen function](https://learn.microsoft.com/en-us/windows/win32/api/winhttp/nf-winhttp-winhttpopen)
+    /// Traits of http
     ///
-    class http : public handle<HINTERNET, NULL>
+    struct http_traits : basic_handle_traits<HINTERNET, NULL>
     {
-        WINSTD_HANDLE_IMPL(http, HINTERNET, NULL)
-
-    public:
         ///
         /// Closes a handle to the HTTP.
         ///
         /// \sa [WinHttpCloseHandle function](https://learn.microsoft.com/en-us/windows/win32/api/winhttp/nf-winhttp-winhttpclosehandle)
         ///
-        virtual ~http()
+        static void close(_In_ HINTERNET h) noexcept
         {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
-        ///
-        /// Closes a handle to the HTTP.
-        ///
-        /// \sa [WinHttpCloseHandle function](https://learn.microsoft.com/en-us/windows/win32/api/winhttp/nf-winhttp-winhttpclosehandle)
-        ///
-        void free_internal() noexcept override
-        {
-            WinHttpCloseHandle(m_h);
+            WinHttpCloseHandle(h);
         }
     };
 
+    ///
+    /// HTTP handle wrapper class
+    ///
+    /// \sa [WinHttpOpen function](https://learn.microsoft.com/en-us/windows/win32/api/winhttp/nf-winhttp-winhttpopen)
+    ///
+    typedef basic_handle<http_traits> http;
+
+    ///
+    /// HINTERNET wrapper class closing the handle on the close_queue
+    ///
+    typedef basic_handle<deferred_close_traits<http_traits>> deferred_http;
+
     /// @}
 }
@@ -29,7 +29,7 @@ namespace winstd
         ///
         /// \param[in] num  WinSock2 error code
         ///
-        ws2_runtime_error(_In_ error_type num) : num_runtime_error<int>(num, message(num))
+        ws2_runtime_error(_In_ error_type num) : num_runtime_error<int>(num, nullptr, lazy_message_t())
         {}
 
         ///
@@ -38,7 +38,7 @@ namespace winstd
         /// \param[in] num  WinSock2 error code
         /// \param[in] msg  Error message
         ///
-        ws2_runtime_error(_In_ error_type num, _In_ const std::string& msg) : num_runtime_error<int>(num, msg + ": " + message(num))
+        ws2_runtime_error(_In_ error_type num, _In_ const std::string& msg) : num_runtime_error<int>(num, msg, lazy_message_t())
         {}
 
         ///
@@ -47,13 +47,13 @@ namespace winstd
         /// \param[in] num  WinSock2 error code
         /// \param[in] msg  Error message
         ///
-        ws2_runtime_error(_In_ error_type num, _In_z_ const char *msg) : num_runtime_error<int>(num, std::string(msg) + ": " + message(num))
+        ws2_runtime_error(_In_ error_type num, _In_z_ const char *msg) : num_runtime_error<int>(num, msg, lazy_message_t())
         {}
 
         ///
         /// Constructs an exception using `WSAGetLastError()`
         ///
-        ws2_runtime_error() : num_runtime_error<int>(WSAGetLastError(), message(WSAGetLastError()))
+        ws2_runtime_error() : num_runtime_error<int>(WSAGetLastError(), nullptr, lazy_message_t())
         {}
 
         ///
@@ -61,7 +61,7 @@ namespace winstd
         ///
         /// \param[in] msg  Error message
         ///
-        ws2_runtime_error(_In_ const std::string& msg) : num_runtime_error<int>(WSAGetLastError(), msg + ": " + message(WSAGetLastError()))
+        ws2_runtime_error(_In_ const std::string& msg) : num_runtime_error<int>(WSAGetLastError(), msg, lazy_message_t())
         {}
 
         ///
@@ -69,10 +69,18 @@ namespace winstd
         ///
         /// \param[in] msg  Error message
         ///
-        ws2_runtime_error(_In_z_ const char *msg) : num_runtime_error<int>(WSAGetLastError(), std::string(msg) + ": " + message(WSAGetLastError()))
+        ws2_runtime_error(_In_z_ const char *msg) : num_runtime_error<int>(WSAGetLastError(), msg, lazy_message_t())
         {}
 
     protected:
+        ///
+        /// Returns a user-readable Windows error message
+        ///
+        std::string message_text() const override
+        {
+            return message(m_num);
+        }
+
         ///
         /// Returns a user-readable Windows error message
         ///
@@ -81,7 +89,7 @@ namespace winstd
         static std::string message(_In_ error_type num, _In_opt_ DWORD dwLanguageId = 0)
         {
             std::wstring wstr;
-            if (FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, 0, num, dwLanguageId, wstr, NULL)) {
+            if (message_cache::instance().format_message(FORMAT_MESSAGE_FROM_SYSTEM, NULL, num, dwLanguageId, wstr)) {
                 // Stock Windows error messages contain CRLF. Well... Trim all the trailing white space.
                 wstr.erase(wstr.find_last_not_of(L" \t\n\r\f\v") + 1);
             }
@@ -101,71 +109,51 @@ namespace winstd
 #if (NTDDI_VERSION >= NTDDI_WINXPSP2) || (_WIN32_WINNT >= 0x0502)
 
     ///
-    /// ADDRINFOA wrapper class
-    ///
-    /// \sa [GetAddrInfoA function](https://docs.microsoft.com/en-us/windows/win32/api/ws2tcpip/nf-ws2tcpip-getaddrinfo)
+    /// Traits of addrinfo
     ///
-    class addrinfo : public handle<PADDRINFOA, NULL>
+    struct addrinfo_traits : basic_handle_traits<PADDRINFOA, NULL>
     {
-        WINSTD_HANDLE_IMPL(addrinfo, PADDRINFOA, NULL)
-
-    public:
         ///
         /// Frees address information
         ///
         /// \sa [FreeAddrInfoA function](https://docs.microsoft.com/en-us/windows/win32/api/ws2tcpip/nf-ws2tcpip-freeaddrinfo)
         ///
-        virtual ~addrinfo()
+        static void close(_In_ PADDRINFOA h) noexcept
         {
-            if (m_h != invalid)
-                free_internal();
-        }
-
-    protected:
-        ///
-        /// Frees address information
-        ///
-        /// \sa [FreeAddrInfoA function](https://docs.microsoft.com/en-us/windows/win32/api/ws2tcpip/nf-ws2tcpip-freeaddrinfo)
-        ///
-        void free_internal() noexcept override
-        {
-            FreeAddrInfoA(m_h);
+            FreeAddrInfoA(h);
         }
     };
 
     ///
-    /// ADDRINFOW wrapper class
+    /// ADDRINFOA wrapper class
     ///
-    /// \sa [GetAddrInfoW function](https://docs.microsoft.com/en-us/windows/desktop/api/ws2tcpip/nf-ws2tcpip-getaddrinfow)
+    /// \sa [GetAddrInfoA function](https://docs.microsoft.com/en-us/windows/win32/api/ws2tcpip/nf-ws2tcpip-getaddrinfo)
     ///
-    class waddrinfo : public handle<PADDRINFOW, NULL>
-    {
-        WINSTD_HANDLE_IMPL(waddrinfo, PADDRINFOW, NULL)
-
-    public:
-        ///
-        /// Frees address information
-        ///
-        /// \sa [FreeAddrInfoW function](https://docs.microsoft.com/en-us/windows/desktop/api/ws2tcpip/nf-ws2tcpip-freeaddrinfow)
-        ///
-        virtual ~waddrinfo()
-        {
-            if (m_h != invalid)
-                free_internal();
-        }
+    typedef basic_handle<addrinfo_traits> addrinfo;
 
-    protected:
+    ///
+    /// Traits of waddrinfo
+    ///
+    struct waddrinfo_traits : basic_handle_traits<PADDRINFOW, NULL>
+    {
         ///
         /// Frees address information
         ///
         /// \sa [FreeAddrInfoW function](https://docs.microsoft.com/en-us/windows/desktop/api/ws2tcpip/nf-ws2tcpip-freeaddrinfow)
         ///
-        void free_internal() noexcept override
+        static void close(_In_ PADDRINFOW h) noexcept
         {
-            FreeAddrInfoW(m_h);
+            FreeAddrInfoW(h);
         }
     };
 
+    ///
+    /// ADDRINFOW wrapper class
+    ///
+    /// \sa [GetAddrInfoW function](https://docs.microsoft.com/en-us/windows/desktop/api/ws2tcpip/nf-ws2tcpip-getaddrinfow)
+    ///
+    typedef basic_handle<waddrinfo_traits> waddrinfo;
+
     ///
     /// Multi-byte / Wide-character ADDRINFO wrapper class (according to _UNICODE)
     ///